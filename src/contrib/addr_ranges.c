@@ -0,0 +1,213 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "contrib/addr_ranges.h"
+#include "contrib/sockaddr.h"
+#include "libknot/errcode.h"
+
+/*! \brief Get the intervals and the address length for the family. */
+static addr_intervals_t *family_intervals(addr_ranges_t *ranges, int family,
+                                          size_t *len)
+{
+	switch (family) {
+	case AF_INET:
+		*len = IPV4_PREFIXLEN / 8;
+		return &ranges->ipv4;
+	case AF_INET6:
+		*len = IPV6_PREFIXLEN / 8;
+		return &ranges->ipv6;
+	default:
+		return NULL;
+	}
+}
+
+static int intervals_add(addr_intervals_t *list, const uint8_t *min,
+                         const uint8_t *max, size_t len)
+{
+	if (list->count == list->max) {
+		size_t new_max = (list->max > 0) ? 2 * list->max : 8;
+		addr_interval_t *items = realloc(list->items,
+		                                 new_max * sizeof(*items));
+		if (items == NULL) {
+			return KNOT_ENOMEM;
+		}
+		list->items = items;
+		list->max = new_max;
+	}
+
+	addr_interval_t *item = &list->items[list->count++];
+	memset(item, 0, sizeof(*item));
+	memcpy(item->min, min, len);
+	memcpy(item->max, max, len);
+
+	return KNOT_EOK;
+}
+
+static int interval_cmp(const void *a, const void *b)
+{
+	const addr_interval_t *i1 = a, *i2 = b;
+	return memcmp(i1->min, i2->min, sizeof(i1->min));
+}
+
+static void intervals_build(addr_intervals_t *list)
+{
+	if (list->count == 0) {
+		return;
+	}
+
+	qsort(list->items, list->count, sizeof(*list->items), interval_cmp);
+
+	/* Merge the overlapping intervals. */
+	size_t last = 0;
+	for (size_t i = 1; i < list->count; i++) {
+		addr_interval_t *cur = &list->items[last];
+		addr_interval_t *next = &list->items[i];
+		if (memcmp(next->min, cur->max, sizeof(cur->max)) <= 0) {
+			if (memcmp(next->max, cur->max, sizeof(cur->max)) > 0) {
+				memcpy(cur->max, next->max, sizeof(cur->max));
+			}
+		} else {
+			list->items[++last] = *next;
+		}
+	}
+	list->count = last + 1;
+}
+
+static bool intervals_match(const addr_intervals_t *list, const uint8_t *addr,
+                            size_t len)
+{
+	/* Find the last interval starting at or before the address. */
+	size_t lo = 0, hi = list->count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (memcmp(list->items[mid].min, addr, len) <= 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo > 0 && memcmp(addr, list->items[lo - 1].max, len) <= 0;
+}
+
+addr_ranges_t *addr_ranges_new(void)
+{
+	return calloc(1, sizeof(addr_ranges_t));
+}
+
+void addr_ranges_free(addr_ranges_t *ranges)
+{
+	if (ranges == NULL) {
+		return;
+	}
+
+	free(ranges->ipv4.items);
+	free(ranges->ipv6.items);
+	free(ranges);
+}
+
+int addr_ranges_add_net(addr_ranges_t *ranges, const struct sockaddr *net,
+                        unsigned prefix)
+{
+	if (ranges == NULL || net == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	size_t len = 0;
+	addr_intervals_t *list = family_intervals(ranges, net->sa_family, &len);
+	if (list == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	size_t raw_len = 0;
+	const uint8_t *raw = sockaddr_raw(net, &raw_len);
+
+	/* Clear (min) and set (max) the host bits. */
+	uint8_t min[16], max[16];
+	for (size_t i = 0; i < len; i++) {
+		unsigned bits = (prefix > 8 * i) ? prefix - 8 * i : 0;
+		uint8_t mask = (bits >= 8) ? 0xff : (uint8_t)(0xff << (8 - bits));
+		min[i] = raw[i] & mask;
+		max[i] = raw[i] | ~mask;
+	}
+
+	return intervals_add(list, min, max, len);
+}
+
+int addr_ranges_add_range(addr_ranges_t *ranges, const struct sockaddr *min,
+                          const struct sockaddr *max)
+{
+	if (ranges == NULL || min == NULL || max == NULL ||
+	    min->sa_family != max->sa_family) {
+		return KNOT_EINVAL;
+	}
+
+	size_t len = 0;
+	addr_intervals_t *list = family_intervals(ranges, min->sa_family, &len);
+	if (list == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	size_t raw_len = 0;
+	const uint8_t *raw_min = sockaddr_raw(min, &raw_len);
+	const uint8_t *raw_max = sockaddr_raw(max, &raw_len);
+	if (memcmp(raw_min, raw_max, len) > 0) {
+		return KNOT_EOK;
+	}
+
+	return intervals_add(list, raw_min, raw_max, len);
+}
+
+void addr_ranges_build(addr_ranges_t *ranges)
+{
+	if (ranges == NULL) {
+		return;
+	}
+
+	intervals_build(&ranges->ipv4);
+	intervals_build(&ranges->ipv6);
+}
+
+bool addr_ranges_match(const addr_ranges_t *ranges, const struct sockaddr *addr)
+{
+	if (addr == NULL) {
+		return false;
+	}
+
+	size_t raw_len = 0;
+	return addr_ranges_match_raw(ranges, addr->sa_family,
+	                             sockaddr_raw(addr, &raw_len));
+}
+
+bool addr_ranges_match_raw(const addr_ranges_t *ranges, int family,
+                           const uint8_t *addr)
+{
+	if (ranges == NULL || addr == NULL) {
+		return false;
+	}
+
+	size_t len = 0;
+	const addr_intervals_t *list = family_intervals((addr_ranges_t *)ranges,
+	                                                family, &len);
+	if (list == NULL) {
+		return false;
+	}
+
+	return intervals_match(list, addr, len);
+}
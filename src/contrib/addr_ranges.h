@@ -0,0 +1,120 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file
+ *
+ * \brief Compiled set of address ranges for fast matching.
+ *
+ * The network blocks and address ranges are added first, then the set is
+ * built into sorted disjoint intervals, which are searched by bisection.
+ * A built set is immutable and can be matched from multiple threads.
+ *
+ * \addtogroup contrib
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+/*! \brief Single interval of addresses (in network byte order). */
+typedef struct {
+	uint8_t min[16];
+	uint8_t max[16];
+} addr_interval_t;
+
+/*! \brief Intervals of one address family. */
+typedef struct {
+	addr_interval_t *items;
+	size_t count;
+	size_t max;
+} addr_intervals_t;
+
+/*! \brief Set of address ranges. */
+typedef struct {
+	addr_intervals_t ipv4;
+	addr_intervals_t ipv6;
+} addr_ranges_t;
+
+/*!
+ * \brief Create an empty set.
+ *
+ * \return Set or NULL if out of memory.
+ */
+addr_ranges_t *addr_ranges_new(void);
+
+/*!
+ * \brief Free the set.
+ */
+void addr_ranges_free(addr_ranges_t *ranges);
+
+/*!
+ * \brief Add a network block.
+ *
+ * \param ranges  Set.
+ * \param net     Network address.
+ * \param prefix  Network prefix length (longer ones are truncated).
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int addr_ranges_add_net(addr_ranges_t *ranges, const struct sockaddr *net,
+                        unsigned prefix);
+
+/*!
+ * \brief Add an address range (both bounds inclusive).
+ *
+ * \note An empty range (with the lower bound above the upper one) is ignored.
+ *
+ * \param ranges  Set.
+ * \param min     Lower bound.
+ * \param max     Upper bound (of the same address family).
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int addr_ranges_add_range(addr_ranges_t *ranges, const struct sockaddr *min,
+                          const struct sockaddr *max);
+
+/*!
+ * \brief Sort and merge the added ranges, must be called before matching.
+ */
+void addr_ranges_build(addr_ranges_t *ranges);
+
+/*!
+ * \brief Check if the address belongs to any of the ranges.
+ *
+ * \param ranges  Built set (NULL is an empty set).
+ * \param addr    Address to check.
+ *
+ * \return True if matches.
+ */
+bool addr_ranges_match(const addr_ranges_t *ranges, const struct sockaddr *addr);
+
+/*!
+ * \brief Check if the raw address belongs to any of the ranges.
+ *
+ * \param ranges  Built set (NULL is an empty set).
+ * \param family  Address family.
+ * \param addr    Address in network byte order.
+ *
+ * \return True if matches.
+ */
+bool addr_ranges_match_raw(const addr_ranges_t *ranges, int family,
+                           const uint8_t *addr);
+
+/*! @} */
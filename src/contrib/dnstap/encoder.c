@@ -0,0 +1,239 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "contrib/dnstap/convert.h"
+#include "contrib/dnstap/encoder.h"
+
+/*! \brief Protobuf wire types. */
+enum {
+	WIRE_VARINT  = 0,
+	WIRE_BYTES   = 2,
+	WIRE_FIXED32 = 5,
+};
+
+/*! \brief Field numbers of the Dnstap message. */
+enum {
+	DNSTAP_IDENTITY = 1,
+	DNSTAP_VERSION  = 2,
+	DNSTAP_MESSAGE  = 14,
+	DNSTAP_TYPE     = 15,
+};
+
+/*! \brief Field numbers of the Message message. */
+enum {
+	MSG_TYPE               = 1,
+	MSG_SOCKET_FAMILY      = 2,
+	MSG_SOCKET_PROTOCOL    = 3,
+	MSG_QUERY_ADDRESS      = 4,
+	MSG_RESPONSE_ADDRESS   = 5,
+	MSG_QUERY_PORT         = 6,
+	MSG_RESPONSE_PORT      = 7,
+	MSG_QUERY_TIME_SEC     = 8,
+	MSG_QUERY_TIME_NSEC    = 9,
+	MSG_QUERY_MESSAGE      = 10,
+	MSG_RESPONSE_TIME_SEC  = 12,
+	MSG_RESPONSE_TIME_NSEC = 13,
+	MSG_RESPONSE_MESSAGE   = 14,
+};
+
+#define TAG(field, wire_type) (((field) << 3) | (wire_type))
+
+typedef struct {
+	const uint8_t *data;
+	size_t len;
+	uint32_t port;
+	bool present;
+} address_t;
+
+/*! \brief Output stream, only counts the length if 'pos' is NULL. */
+typedef struct {
+	uint8_t *pos;
+	size_t len;
+} stream_t;
+
+static void put_varint(stream_t *s, uint64_t value)
+{
+	do {
+		uint8_t byte = value & 0x7f;
+		value >>= 7;
+		if (value != 0) {
+			byte |= 0x80;
+		}
+		if (s->pos != NULL) {
+			*s->pos++ = byte;
+		}
+		s->len += 1;
+	} while (value != 0);
+}
+
+static void put_fixed32(stream_t *s, uint32_t value)
+{
+	if (s->pos != NULL) {
+		for (int i = 0; i < 4; i++) {
+			*s->pos++ = value >> (8 * i);
+		}
+	}
+	s->len += 4;
+}
+
+static void put_data(stream_t *s, const uint8_t *data, size_t len)
+{
+	if (s->pos != NULL && len > 0) {
+		memcpy(s->pos, data, len);
+		s->pos += len;
+	}
+	s->len += len;
+}
+
+static void put_uint(stream_t *s, int field, uint64_t value)
+{
+	put_varint(s, TAG(field, WIRE_VARINT));
+	put_varint(s, value);
+}
+
+static void put_bytes(stream_t *s, int field, const uint8_t *data, size_t len)
+{
+	put_varint(s, TAG(field, WIRE_BYTES));
+	put_varint(s, len);
+	put_data(s, data, len);
+}
+
+static void put_time(stream_t *s, int sec_field, int nsec_field,
+                     const struct timespec *time)
+{
+	if (time != NULL) {
+		put_uint(s, sec_field, time->tv_sec);
+		put_varint(s, TAG(nsec_field, WIRE_FIXED32));
+		put_fixed32(s, time->tv_nsec);
+	}
+}
+
+static address_t get_address(const struct sockaddr *sa)
+{
+	address_t addr = { NULL };
+	if (sa == NULL) {
+		return addr;
+	}
+
+	addr.present = true;
+
+	if (sa->sa_family == AF_INET) {
+		const struct sockaddr_in *sai = (const struct sockaddr_in *)sa;
+		addr.data = (const uint8_t *)&sai->sin_addr.s_addr;
+		addr.len = sizeof(sai->sin_addr);
+		addr.port = ntohs(sai->sin_port);
+	} else if (sa->sa_family == AF_INET6) {
+		const struct sockaddr_in6 *sai6 = (const struct sockaddr_in6 *)sa;
+		addr.data = (const uint8_t *)&sai6->sin6_addr.s6_addr;
+		addr.len = sizeof(sai6->sin6_addr);
+		addr.port = ntohs(sai6->sin6_port);
+	}
+
+	return addr;
+}
+
+/*! \brief Write the Message fields in the field number order. */
+static void put_message(stream_t *s, const dt_encode_msg_t *msg)
+{
+	put_uint(s, MSG_TYPE, msg->type);
+
+	const struct sockaddr *source = msg->query_sa ? msg->query_sa : msg->response_sa;
+	int family = (source != NULL) ? dt_family_encode(source->sa_family) : 0;
+	if (family != 0) {
+		put_uint(s, MSG_SOCKET_FAMILY, family);
+	}
+
+	int protocol = dt_protocol_encode(msg->protocol);
+	if (protocol != 0) {
+		put_uint(s, MSG_SOCKET_PROTOCOL, protocol);
+	}
+
+	address_t query = get_address(msg->query_sa);
+	address_t response = get_address(msg->response_sa);
+	if (query.present) {
+		put_bytes(s, MSG_QUERY_ADDRESS, query.data, query.len);
+	}
+	if (response.present) {
+		put_bytes(s, MSG_RESPONSE_ADDRESS, response.data, response.len);
+	}
+	if (query.present) {
+		put_uint(s, MSG_QUERY_PORT, query.port);
+	}
+	if (response.present) {
+		put_uint(s, MSG_RESPONSE_PORT, response.port);
+	}
+
+	put_time(s, MSG_QUERY_TIME_SEC, MSG_QUERY_TIME_NSEC, msg->qtime);
+	if (dt_message_type_is_query(msg->type)) {
+		put_bytes(s, MSG_QUERY_MESSAGE, msg->wire, msg->wire_len);
+	}
+
+	put_time(s, MSG_RESPONSE_TIME_SEC, MSG_RESPONSE_TIME_NSEC, msg->rtime);
+	if (dt_message_type_is_response(msg->type)) {
+		put_bytes(s, MSG_RESPONSE_MESSAGE, msg->wire, msg->wire_len);
+	}
+}
+
+static void put_dnstap(stream_t *s, const dt_encode_msg_t *msg)
+{
+	if (msg->identity_len > 0) {
+		put_bytes(s, DNSTAP_IDENTITY, msg->identity, msg->identity_len);
+	}
+	if (msg->version_len > 0) {
+		put_bytes(s, DNSTAP_VERSION, msg->version, msg->version_len);
+	}
+
+	stream_t counter = { NULL };
+	put_message(&counter, msg);
+	put_varint(s, TAG(DNSTAP_MESSAGE, WIRE_BYTES));
+	put_varint(s, counter.len);
+	put_message(s, msg);
+
+	put_uint(s, DNSTAP_TYPE, DNSTAP__DNSTAP__TYPE__MESSAGE);
+}
+
+size_t dt_encode_size(const dt_encode_msg_t *msg)
+{
+	if (msg == NULL) {
+		return 0;
+	}
+
+	stream_t counter = { NULL };
+	put_dnstap(&counter, msg);
+
+	return counter.len;
+}
+
+size_t dt_encode(const dt_encode_msg_t *msg, uint8_t *buf, size_t maxlen)
+{
+	if (msg == NULL || buf == NULL) {
+		return 0;
+	}
+
+	size_t len = dt_encode_size(msg);
+	if (len > maxlen) {
+		return 0;
+	}
+
+	stream_t out = { buf };
+	put_dnstap(&out, msg);
+
+	return out.len;
+}
@@ -0,0 +1,70 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*!
+ * \file
+ *
+ * \brief Direct dnstap message encoder.
+ *
+ * Serializes a dnstap message of type MESSAGE straight into a caller-supplied
+ * buffer. The output is identical to dt_message_fill() followed by dt_pack(),
+ * but no intermediate protobuf structures or allocations are needed.
+ *
+ * \addtogroup dnstap
+ * @{
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <time.h>
+
+#include "contrib/dnstap/dnstap.pb-c.h"
+
+/*! \brief Dnstap message fields (see dt_message_fill() for the meaning). */
+typedef struct {
+	const uint8_t *identity;        /*!< Dnstap identity (can be NULL). */
+	size_t identity_len;
+	const uint8_t *version;         /*!< Dnstap version (can be NULL). */
+	size_t version_len;
+	Dnstap__Message__Type type;
+	const struct sockaddr *query_sa;    /*!< Can be NULL. */
+	const struct sockaddr *response_sa; /*!< Can be NULL. */
+	int protocol;                   /*!< IPPROTO_UDP or IPPROTO_TCP. */
+	const uint8_t *wire;            /*!< Query or response message. */
+	size_t wire_len;
+	const struct timespec *qtime;   /*!< Query time (can be NULL). */
+	const struct timespec *rtime;   /*!< Response time (can be NULL). */
+} dt_encode_msg_t;
+
+/*!
+ * \brief Get the size of the serialized frame.
+ */
+size_t dt_encode_size(const dt_encode_msg_t *msg);
+
+/*!
+ * \brief Serialize the message into the buffer.
+ *
+ * \param msg     Message fields.
+ * \param buf     Output buffer.
+ * \param maxlen  Output buffer size.
+ *
+ * \return Size of the frame, 0 if the buffer is too small.
+ */
+size_t dt_encode(const dt_encode_msg_t *msg, uint8_t *buf, size_t maxlen);
+
+/*! @} */
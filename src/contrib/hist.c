@@ -0,0 +1,97 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+
+#include "contrib/hist.h"
+
+/*! \brief Maps a value to a log-linear bucket. */
+static unsigned bucket_index(uint64_t value)
+{
+	if (value < (1 << HIST_SUB_BITS)) {
+		return value;
+	}
+
+	unsigned msb = 63 - __builtin_clzll(value);
+	unsigned shift = msb - HIST_SUB_BITS;
+	unsigned sub = (value >> shift) & ((1 << HIST_SUB_BITS) - 1);
+
+	return ((shift + 1) << HIST_SUB_BITS) + sub;
+}
+
+/*! \brief Returns the upper bound of the bucket values. */
+static uint64_t bucket_upper(unsigned index)
+{
+	unsigned row = index >> HIST_SUB_BITS;
+	uint64_t sub = index & ((1 << HIST_SUB_BITS) - 1);
+
+	if (row == 0) {
+		return sub;
+	}
+
+	uint64_t base = ((1 << HIST_SUB_BITS) + sub) << (row - 1);
+	return base + ((uint64_t)1 << (row - 1)) - 1;
+}
+
+void hist_record(hist_t *hist, uint64_t value)
+{
+	hist->count++;
+	hist->sum += value;
+	if (value > hist->max) {
+		hist->max = value;
+	}
+	hist->bucket[bucket_index(value)]++;
+}
+
+void hist_merge(hist_t *dst, const hist_t *src)
+{
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if (src->max > dst->max) {
+		dst->max = src->max;
+	}
+	for (unsigned i = 0; i < HIST_BUCKETS; i++) {
+		dst->bucket[i] += src->bucket[i];
+	}
+}
+
+uint64_t hist_percentile(const hist_t *hist, unsigned permille)
+{
+	if (hist == NULL || hist->count == 0) {
+		return 0;
+	}
+
+	/* Count of values at or below the percentile (rounded up). */
+	uint64_t total = 0;
+	for (unsigned i = 0; i < HIST_BUCKETS; i++) {
+		total += hist->bucket[i];
+	}
+	uint64_t limit = (total * permille + 999) / 1000;
+	if (limit == 0) {
+		limit = 1;
+	}
+
+	uint64_t seen = 0;
+	for (unsigned i = 0; i < HIST_BUCKETS; i++) {
+		seen += hist->bucket[i];
+		if (seen >= limit) {
+			uint64_t upper = bucket_upper(i);
+			return (upper < hist->max) ? upper : hist->max;
+		}
+	}
+
+	return hist->max;
+}
@@ -0,0 +1,64 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file
+ *
+ * \brief Log-linear histogram of 64-bit values (e.g. latencies).
+ *
+ * Values below 2^HIST_SUB_BITS have their own buckets, each higher
+ * power-of-two range is split into 2^HIST_SUB_BITS linear sub-buckets,
+ * so the relative error of any estimate is below 2^-HIST_SUB_BITS.
+ *
+ * \addtogroup contrib
+ * @{
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*! \brief Number of linear sub-buckets in each power-of-two bucket (log2). */
+#define HIST_SUB_BITS 4
+/*! \brief Number of histogram buckets covering the whole uint64_t range. */
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) << HIST_SUB_BITS)
+
+/*! \brief Histogram. */
+typedef struct {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint64_t bucket[HIST_BUCKETS];
+} hist_t;
+
+/*!
+ * \brief Records one value into the histogram.
+ */
+void hist_record(hist_t *hist, uint64_t value);
+
+/*!
+ * \brief Merges the source histogram into the destination one.
+ */
+void hist_merge(hist_t *dst, const hist_t *src);
+
+/*!
+ * \brief Returns the upper bound estimate of the given percentile.
+ *
+ * \param hist     Histogram.
+ * \param permille Requested percentile in permilles (e.g. 990 for p99).
+ */
+uint64_t hist_percentile(const hist_t *hist, unsigned permille);
+
+/*! @} */
@@ -82,3 +82,10 @@ void mm_ctx_mempool(knot_mm_t *mm, size_t chunk_size)
 	mm->alloc = (knot_mm_alloc_t)mp_alloc;
 	mm->free = mm_nofree;
 }
+
+void mm_ctx_mempool_huge(knot_mm_t *mm, size_t chunk_size)
+{
+	mm->ctx = mp_new_huge(chunk_size);
+	mm->alloc = (knot_mm_alloc_t)mp_alloc;
+	mm->free = mm_nofree;
+}
@@ -42,4 +42,7 @@ void mm_ctx_init(knot_mm_t *mm);
 /*! \brief Memory pool context. */
 void mm_ctx_mempool(knot_mm_t *mm, size_t chunk_size);
 
+/*! \brief Memory pool context backed by huge pages if possible. */
+void mm_ctx_mempool_huge(knot_mm_t *mm, size_t chunk_size);
+
 /*! @} */
@@ -535,6 +535,32 @@ ssize_t net_stream_recv(int sock, uint8_t *buffer, size_t size, int timeout_ms)
 	return net_recv(sock, buffer, size, NULL, timeout_ms);
 }
 
+ssize_t net_stream_send_nowait(int sock, const uint8_t *buffer, size_t size)
+{
+	if (sock < 0 || buffer == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	struct iovec iov = { 0 };
+	iov.iov_base = (void *)buffer;
+	iov.iov_len = size;
+
+	struct msghdr msg = { 0 };
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	ssize_t ret;
+	do {
+		ret = send_process(sock, &msg);
+	} while (ret == -1 && errno == EINTR);
+
+	if (ret == -1) {
+		return io_should_wait(errno) ? 0 : KNOT_ECONN;
+	}
+
+	return ret;
+}
+
 /* -- DNS specific I/O ----------------------------------------------------- */
 
 ssize_t net_dns_tcp_send(int sock, const uint8_t *buffer, size_t size, int timeout_ms)
@@ -162,6 +162,17 @@ ssize_t net_stream_send(int sock, const uint8_t *buffer, size_t size, int timeou
  */
 ssize_t net_stream_recv(int sock, uint8_t *buffer, size_t size, int timeout_ms);
 
+/*!
+ * \brief Send as much of the data as possible without blocking.
+ *
+ * \param sock    Connected SOCK_STREAM socket.
+ * \param buffer  Data to send.
+ * \param size    Size of the data.
+ *
+ * \return Number of bytes sent (0 if the socket isn't writable) or error.
+ */
+ssize_t net_stream_send_nowait(int sock, const uint8_t *buffer, size_t size);
+
 /*!
  * \brief Send a DNS message on a TCP socket.
  *
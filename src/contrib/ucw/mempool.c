@@ -20,6 +20,7 @@
 
 /** \todo This shouldn't be precalculated, but computed on load. */
 #define CPU_PAGE_SIZE 4096
+#define HUGE_PAGE_SIZE (2 << 20)
 
 /** Align an integer @s to the nearest higher multiple of @a (which should be a power of two) **/
 #define ALIGN_TO(s, a) (((s)+a-1)&~(a-1))
@@ -45,6 +46,37 @@ page_alloc(uint64_t len)
   return p;
 }
 
+/** Huge pages are used if reserved, transparent huge pages are requested otherwise. **/
+static void *
+page_alloc_huge(uint64_t len)
+{
+  if (!len || len > SIZE_MAX)
+    return NULL;
+  assert(!(len & (HUGE_PAGE_SIZE-1)));
+  uint8_t *p;
+#ifdef MAP_HUGETLB
+  p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON | MAP_HUGETLB, -1, 0);
+  if (p != (uint8_t*) MAP_FAILED)
+    return p;
+#endif
+#ifdef MADV_HUGEPAGE
+  /* Transparent huge pages need an aligned mapping, trim the surplus. */
+  p = mmap(NULL, len + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (p == (uint8_t*) MAP_FAILED)
+    return NULL;
+  size_t skip = ALIGN_TO((uintptr_t) p, HUGE_PAGE_SIZE) - (uintptr_t) p;
+  if (skip)
+    munmap(p, skip);
+  if (HUGE_PAGE_SIZE - skip)
+    munmap(p + skip + len, HUGE_PAGE_SIZE - skip);
+  p += skip;
+  madvise(p, len, MADV_HUGEPAGE);
+  return p;
+#else
+  return page_alloc(len);
+#endif
+}
+
 static void
 page_free(void *start, uint64_t len)
 {
@@ -101,10 +133,10 @@ mp_free_big_chunk(struct mempool_chunk *chunk)
 }
 
 static void *
-mp_new_chunk(unsigned size)
+mp_new_chunk(unsigned size, unsigned huge)
 {
 #ifdef CONFIG_UCW_POOL_IS_MMAP
-  uint8_t *data = page_alloc(size + MP_CHUNK_TAIL);
+  uint8_t *data = huge ? page_alloc_huge(size + MP_CHUNK_TAIL) : page_alloc(size + MP_CHUNK_TAIL);
   if (!data) {
     return NULL;
   }
@@ -129,11 +161,12 @@ mp_free_chunk(struct mempool_chunk *chunk)
 #endif
 }
 
-struct mempool *
-mp_new(unsigned chunk_size)
+static struct mempool *
+mp_new_pool(unsigned chunk_size, unsigned huge)
 {
-  chunk_size = mp_align_size(MAX(sizeof(struct mempool), chunk_size));
-  struct mempool_chunk *chunk = mp_new_chunk(chunk_size);
+  struct mempool_chunk *chunk = mp_new_chunk(chunk_size, huge);
+  if (!chunk)
+    return NULL;
   struct mempool *pool = (void *)chunk - chunk_size;
   ASAN_UNPOISON_MEMORY_REGION(pool, sizeof(*pool));
   DBG("Creating mempool %p with %u bytes long chunks", pool, chunk_size);
@@ -142,10 +175,28 @@ mp_new(unsigned chunk_size)
     .state = { .free = { chunk_size - sizeof(*pool) }, .last = { chunk } },
     .chunk_size = chunk_size,
     .threshold = chunk_size >> 1,
+    .huge = huge,
     .last_big = &pool->last_big };
   return pool;
 }
 
+struct mempool *
+mp_new(unsigned chunk_size)
+{
+  return mp_new_pool(mp_align_size(MAX(sizeof(struct mempool), chunk_size)), 0);
+}
+
+struct mempool *
+mp_new_huge(unsigned chunk_size)
+{
+#ifdef CONFIG_UCW_POOL_IS_MMAP
+  chunk_size = ALIGN_TO(MAX(sizeof(struct mempool), chunk_size) + MP_CHUNK_TAIL, HUGE_PAGE_SIZE) - MP_CHUNK_TAIL;
+  return mp_new_pool(chunk_size, 1);
+#else
+  return mp_new(chunk_size);
+#endif
+}
+
 static void
 mp_free_chain(struct mempool_chunk *chunk)
 {
@@ -238,7 +289,7 @@ mp_alloc_internal(struct mempool *pool, unsigned size)
 	  pool->unused = chunk->next;
 	}
       else
-	chunk = mp_new_chunk(pool->chunk_size);
+	chunk = mp_new_chunk(pool->chunk_size, pool->huge);
       chunk->next = pool->state.last[0];
       pool->state.last[0] = chunk;
       pool->state.free[0] = pool->chunk_size - size;
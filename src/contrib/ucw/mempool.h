@@ -38,7 +38,7 @@ struct mempool_state {
 struct mempool {
   struct mempool_state state;
   void *unused, *last_big;
-  unsigned chunk_size, threshold, idx;
+  unsigned chunk_size, threshold, idx, huge;
 };
 
 struct mempool_stats {			/** Mempool statistics. See @mp_stats(). **/
@@ -73,6 +73,14 @@ void mp_init(struct mempool *pool, unsigned chunk_size);
  **/
 struct mempool *mp_new(unsigned chunk_size);
 
+/**
+ * Allocate and initialize a new memory pool backed by huge pages.
+ * The @chunk_size is rounded up to a multiple of the huge page size.
+ * Reserved huge pages are used if available, transparent huge pages
+ * are requested otherwise.
+ **/
+struct mempool *mp_new_huge(unsigned chunk_size);
+
 /**
  * Cleanup mempool initialized by mp_init or mp_new.
  * Frees all the memory allocated by this mempool and,
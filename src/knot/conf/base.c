@@ -106,6 +106,81 @@ void conf_refresh_hostname(
 	}
 }
 
+static void free_acl_addr_ranges(
+	hattrie_t *acl_ranges)
+{
+	if (acl_ranges == NULL) {
+		return;
+	}
+
+	hattrie_iter_t *it = hattrie_iter_begin(acl_ranges, false);
+	for (; !hattrie_iter_finished(it); hattrie_iter_next(it)) {
+		addr_ranges_free(*hattrie_iter_val(it));
+	}
+	hattrie_iter_free(it);
+	hattrie_free(acl_ranges);
+}
+
+static hattrie_t *init_acl_addr_ranges(
+	conf_t *conf)
+{
+	hattrie_t *acl_ranges = hattrie_create();
+	if (acl_ranges == NULL) {
+		return NULL;
+	}
+
+	bool failed = false;
+	conf_iter_t iter = conf_iter(conf, C_ACL);
+	while (iter.code == KNOT_EOK && !failed) {
+		conf_val_t id = conf_iter_id(conf, &iter);
+		conf_val_t addr = conf_id_get(conf, C_ACL, C_ADDR, &id);
+
+		addr_ranges_t *ranges = NULL;
+		if (addr.code == KNOT_EOK) {
+			ranges = conf_addr_ranges(&addr);
+			failed = (ranges == NULL);
+		} else if (addr.code != KNOT_ENOENT) {
+			failed = true;
+		}
+
+		value_t *val = NULL;
+		if (!failed) {
+			conf_val(&id);
+			val = hattrie_get(acl_ranges, (const char *)id.data, id.len);
+			failed = (val == NULL);
+		}
+		if (failed) {
+			addr_ranges_free(ranges);
+		} else {
+			*val = ranges;
+		}
+
+		conf_iter_next(conf, &iter);
+	}
+	conf_iter_finish(conf, &iter);
+
+	// Fall back to the configuration database if incomplete.
+	if (failed) {
+		free_acl_addr_ranges(acl_ranges);
+		return NULL;
+	}
+
+	// Prepare for concurrent lookups.
+	hattrie_build_index(acl_ranges);
+
+	return acl_ranges;
+}
+
+static void free_cache(
+	conf_t *conf)
+{
+	addr_ranges_free(conf->cache.srv_rate_limit_whitelist);
+	conf->cache.srv_rate_limit_whitelist = NULL;
+
+	free_acl_addr_ranges(conf->cache.acl_addr_ranges);
+	conf->cache.acl_addr_ranges = NULL;
+}
+
 static void init_cache(
 	conf_t *conf)
 {
@@ -133,12 +208,23 @@ static void init_cache(
 	val = conf_get(conf, C_SRV, C_MAX_TCP_CLIENTS);
 	conf->cache.srv_max_tcp_clients = conf_int(&val);
 
+	val = conf_get(conf, C_SRV, C_TSIG_SIGN_INTERVAL);
+	conf->cache.srv_tsig_sign_interval = conf_int(&val);
+
 	val = conf_get(conf, C_SRV, C_RATE_LIMIT_SLIP);
 	conf->cache.srv_rate_limit_slip = conf_int(&val);
 
+	val = conf_get(conf, C_SRV, C_COOKIES);
+	conf->cache.srv_cookies = conf_bool(&val);
+
 	conf->cache.srv_nsid = conf_get(conf, C_SRV, C_NSID);
 
-	conf->cache.srv_rate_limit_whitelist = conf_get(conf, C_SRV, C_RATE_LIMIT_WHITELIST);
+	free_cache(conf);
+
+	val = conf_get(conf, C_SRV, C_RATE_LIMIT_WHITELIST);
+	conf->cache.srv_rate_limit_whitelist = conf_addr_ranges(&val);
+
+	conf->cache.acl_addr_ranges = init_acl_addr_ranges(conf);
 }
 
 int conf_new(
@@ -336,6 +422,7 @@ void conf_free(
 	conf->api->txn_abort(&conf->read_txn);
 	free(conf->filename);
 	free(conf->hostname);
+	free_cache(conf);
 
 	if (conf->io.txn != NULL) {
 		conf->api->txn_abort(conf->io.txn_stack);
@@ -27,6 +27,8 @@
 
 #include "libknot/libknot.h"
 #include "libknot/yparser/ypscheme.h"
+#include "contrib/addr_ranges.h"
+#include "contrib/hat-trie/hat-trie.h"
 #include "contrib/ucw/lists.h"
 
 /*! Default template identifier. */
@@ -97,9 +99,13 @@ typedef struct {
 		int32_t srv_tcp_idle_timeout;
 		int32_t srv_tcp_reply_timeout;
 		int32_t srv_max_tcp_clients;
+		int32_t srv_tsig_sign_interval;
 		int32_t srv_rate_limit_slip;
+		bool srv_cookies;
 		conf_val_t srv_nsid;
-		conf_val_t srv_rate_limit_whitelist;
+		addr_ranges_t *srv_rate_limit_whitelist;
+		/*! Compiled ACL address ranges (NULL if none) by ACL identifier. */
+		hattrie_t *acl_addr_ranges;
 	} cache;
 
 	/*! List of active query modules. */
@@ -710,6 +710,48 @@ bool conf_addr_range_match(
 	return false;
 }
 
+addr_ranges_t* conf_addr_ranges(
+	conf_val_t *range)
+{
+	if (range == NULL) {
+		return NULL;
+	}
+
+	addr_ranges_t *ranges = addr_ranges_new();
+	if (ranges == NULL) {
+		return NULL;
+	}
+
+	int ret = KNOT_EOK;
+	while (range->code == KNOT_EOK && ret == KNOT_EOK) {
+		int mask;
+		struct sockaddr_storage min, max;
+
+		min = conf_addr_range(range, &max, &mask);
+		if (max.ss_family == AF_UNSPEC) {
+			if (mask < 0) {
+				mask = (min.ss_family == AF_INET6) ? IPV6_PREFIXLEN :
+				                                     IPV4_PREFIXLEN;
+			}
+			ret = addr_ranges_add_net(ranges, (struct sockaddr *)&min, mask);
+		} else {
+			ret = addr_ranges_add_range(ranges, (struct sockaddr *)&min,
+			                            (struct sockaddr *)&max);
+		}
+
+		conf_val_next(range);
+	}
+
+	if (ret != KNOT_EOK) {
+		addr_ranges_free(ranges);
+		return NULL;
+	}
+
+	addr_ranges_build(ranges);
+
+	return ranges;
+}
+
 char* conf_abs_path(
 	conf_val_t *val,
 	const char *base_dir)
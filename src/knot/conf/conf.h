@@ -515,6 +515,19 @@ bool conf_addr_range_match(
 	const struct sockaddr_storage *addr
 );
 
+/*!
+ * Compiles the address ranges/network blocks for fast matching.
+ *
+ * \note The result must be freed with addr_ranges_free().
+ *
+ * \param[in] range  Address ranges/network blocks.
+ *
+ * \return Compiled ranges or NULL if failed.
+ */
+addr_ranges_t* conf_addr_ranges(
+	conf_val_t *range
+);
+
 /*!
  * Gets the absolute string value of the item.
  *
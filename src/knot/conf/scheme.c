@@ -28,7 +28,7 @@
 #include "dnssec/lib/dnssec/tsig.h"
 #include "dnssec/lib/dnssec/key.h"
 
-#include "knot/modules/synth_record.h"
+#include "knot/modules/synth_record/module.h"
 #include "knot/modules/dnsproxy.h"
 #include "knot/modules/online_sign/module.h"
 #ifdef HAVE_ROSEDB
@@ -104,10 +104,13 @@ static const yp_item_t desc_server[] = {
 	{ C_TCP_WORKERS,          YP_TINT,  YP_VINT = { 1, 255, YP_NIL } },
 	{ C_BG_WORKERS,           YP_TINT,  YP_VINT = { 1, 255, YP_NIL } },
 	{ C_ASYNC_START,          YP_TBOOL, YP_VNONE },
+	{ C_HUGE_PAGES,           YP_TBOOL, YP_VNONE },
 	{ C_TCP_HSHAKE_TIMEOUT,   YP_TINT,  YP_VINT = { 0, INT32_MAX, 5, YP_STIME } },
 	{ C_TCP_IDLE_TIMEOUT,     YP_TINT,  YP_VINT = { 0, INT32_MAX, 20, YP_STIME } },
 	{ C_TCP_REPLY_TIMEOUT,    YP_TINT,  YP_VINT = { 0, INT32_MAX, 10, YP_STIME } },
 	{ C_MAX_TCP_CLIENTS,      YP_TINT,  YP_VINT = { 0, INT32_MAX, 100 } },
+	{ C_TCP_FASTOPEN,         YP_TBOOL, YP_VNONE },
+	{ C_TSIG_SIGN_INTERVAL,   YP_TINT,  YP_VINT = { 1, 100, 1 } },
 	{ C_MAX_UDP_PAYLOAD,      YP_TINT,  YP_VINT = { KNOT_EDNS_MIN_UDP_PAYLOAD,
 	                                                KNOT_EDNS_MAX_UDP_PAYLOAD,
 	                                                4096, YP_SSIZE } },
@@ -122,6 +125,8 @@ static const yp_item_t desc_server[] = {
 	{ C_RATE_LIMIT_TBL_SIZE,  YP_TINT,  YP_VINT = { 1, INT32_MAX, 393241 } },
 	{ C_RATE_LIMIT_WHITELIST, YP_TDATA, YP_VDATA = { 0, NULL, addr_range_to_bin,
 	                                                 addr_range_to_txt }, YP_FMULTI },
+	{ C_COOKIES,              YP_TBOOL, YP_VNONE },
+	{ C_COOKIE_SECRET_LIFETIME, YP_TINT, YP_VINT = { 1, DAYS(30), HOURS(26), YP_STIME } },
 	{ C_LISTEN,               YP_TADDR, YP_VADDR = { 53 }, YP_FMULTI },
 	{ C_COMMENT,              YP_TSTR,  YP_VNONE },
 	{ NULL }
@@ -213,6 +218,7 @@ static const yp_item_t desc_remote[] = {
 	{ C_IXFR_DIFF,           YP_TBOOL, YP_VNONE }, \
 	{ C_MAX_JOURNAL_SIZE,    YP_TINT,  YP_VINT = { 0, INT64_MAX, INT64_MAX, YP_SSIZE } }, \
 	{ C_MAX_ZONE_SIZE,       YP_TINT,  YP_VINT = { 0, INT64_MAX, INT64_MAX, YP_SSIZE } }, \
+	{ C_NUMA_REPLICATE,      YP_TBOOL, YP_VNONE }, \
 	{ C_KASP_DB,             YP_TSTR,  YP_VSTR = { "keys" } }, \
 	{ C_DNSSEC_SIGNING,      YP_TBOOL, YP_VNONE }, \
 	{ C_DNSSEC_POLICY,       YP_TREF,  YP_VREF = { C_POLICY }, YP_FNONE, { check_ref_dflt } }, \
@@ -39,6 +39,8 @@
 #define C_COMMENT		"\x07""comment"
 #define C_CONFIG		"\x06""config"
 #define C_CTL			"\x07""control"
+#define C_COOKIE_SECRET_LIFETIME	"\x16""cookie-secret-lifetime"
+#define C_COOKIES		"\x07""cookies"
 #define C_DDNS_MASTER		"\x0B""ddns-master"
 #define C_DENY			"\x04""deny"
 #define C_DISABLE_ANY		"\x0B""disable-any"
@@ -48,6 +50,7 @@
 #define C_DOMAIN		"\x06""domain"
 #define C_FILE			"\x04""file"
 #define C_GLOBAL_MODULE		"\x0D""global-module"
+#define C_HUGE_PAGES		"\x0A""huge-pages"
 #define C_ID			"\x02""id"
 #define C_IDENT			"\x08""identity"
 #define C_INCL			"\x07""include"
@@ -73,6 +76,7 @@
 #define C_NSEC3_SALT_LEN	"\x11""nsec3-salt-length"
 #define C_NSEC3_SALT_LIFETIME	"\x13""nsec3-salt-lifetime"
 #define C_NSID			"\x04""nsid"
+#define C_NUMA_REPLICATE	"\x0E""numa-replicate"
 #define C_PIDFILE		"\x07""pidfile"
 #define C_POLICY		"\x06""policy"
 #define C_PROPAG_DELAY		"\x11""propagation-delay"
@@ -92,6 +96,7 @@
 #define C_SRV			"\x06""server"
 #define C_STORAGE		"\x07""storage"
 #define C_TARGET		"\x06""target"
+#define C_TCP_FASTOPEN		"\x0C""tcp-fastopen"
 #define C_TCP_HSHAKE_TIMEOUT	"\x15""tcp-handshake-timeout"
 #define C_TCP_IDLE_TIMEOUT	"\x10""tcp-idle-timeout"
 #define C_TCP_REPLY_TIMEOUT	"\x11""tcp-reply-timeout"
@@ -99,6 +104,7 @@
 #define C_TIMEOUT		"\x07""timeout"
 #define C_TIMER_DB		"\x08""timer-db"
 #define C_TPL			"\x08""template"
+#define C_TSIG_SIGN_INTERVAL	"\x12""tsig-sign-interval"
 #define C_UDP_WORKERS		"\x0B""udp-workers"
 #define C_USER			"\x04""user"
 #define C_VERSION		"\x07""version"
@@ -14,12 +14,16 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
 #include <urcu.h>
 
 #include "knot/common/log.h"
 #include "knot/conf/confio.h"
 #include "knot/ctl/commands.h"
+#include "knot/dnssec/key-cache.h"
+#include "knot/nameserver/query_timing.h"
 #include "knot/updates/zone-update.h"
 #include "libknot/libknot.h"
 #include "libknot/yparser/yptrafo.h"
@@ -309,6 +313,20 @@ static int zone_sign(zone_t *zone, ctl_args_t *args)
 	return KNOT_EOK;
 }
 
+static int zone_key_reload(zone_t *zone, ctl_args_t *args)
+{
+	UNUSED(args);
+
+	conf_val_t val = conf_zone_get(conf(), C_DNSSEC_SIGNING, zone->name);
+	if (!conf_bool(&val)) {
+		return KNOT_ENOTSUP;
+	}
+
+	kdnssec_cache_invalidate(zone->dnssec_cache);
+
+	return KNOT_EOK;
+}
+
 static int zone_txn_begin(zone_t *zone, ctl_args_t *args)
 {
 	UNUSED(args);
@@ -918,6 +936,8 @@ static int ctl_zone(ctl_args_t *args, ctl_cmd_t cmd)
 		return zones_apply(args, zone_flush);
 	case CTL_ZONE_SIGN:
 		return zones_apply(args, zone_sign);
+	case CTL_ZONE_KEY_RELOAD:
+		return zones_apply(args, zone_key_reload);
 	case CTL_ZONE_READ:
 		return zones_apply(args, zone_read);
 	case CTL_ZONE_BEGIN:
@@ -965,6 +985,82 @@ static int ctl_server(ctl_args_t *args, ctl_cmd_t cmd)
 	return ret;
 }
 
+static int send_stats_value(ctl_args_t *args, knot_ctl_data_t *data,
+                            knot_ctl_type_t type, const char *item, uint64_t value)
+{
+	char buff[32];
+	int ret = snprintf(buff, sizeof(buff), "%"PRIu64, value);
+	if (ret < 0 || ret >= sizeof(buff)) {
+		return KNOT_ESPACE;
+	}
+
+	(*data)[KNOT_CTL_IDX_ITEM] = item;
+	(*data)[KNOT_CTL_IDX_DATA] = buff;
+
+	return knot_ctl_send(args->ctl, type, data);
+}
+
+static int ctl_stats(ctl_args_t *args, ctl_cmd_t cmd)
+{
+	UNUSED(cmd);
+
+	query_timing_t *timing = malloc(sizeof(*timing));
+	if (timing == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = server_query_timing(args->server, timing);
+	if (ret != KNOT_EOK) {
+		send_error(args, knot_strerror(ret));
+		free(timing);
+		return ret;
+	}
+
+	static const struct {
+		const char *name;
+		unsigned permille;
+	} percentiles[] = {
+		{ "p50",  500 },
+		{ "p90",  900 },
+		{ "p99",  990 },
+		{ "p999", 999 },
+	};
+
+	for (unsigned i = 0; i < QTIME_STAGES && ret == KNOT_EOK; i++) {
+		const hist_t *hist = &timing->stage[i];
+		if (hist->count == 0) {
+			continue;
+		}
+
+		knot_ctl_data_t data = {
+			[KNOT_CTL_IDX_SECTION] = qtime_stage_name(i)
+		};
+
+		ret = send_stats_value(args, &data, KNOT_CTL_TYPE_DATA,
+		                       "count", hist->count);
+		if (ret == KNOT_EOK) {
+			ret = send_stats_value(args, &data, KNOT_CTL_TYPE_DATA,
+			                       "avg", hist->sum / hist->count);
+		}
+		for (unsigned j = 0; j < sizeof(percentiles) / sizeof(*percentiles); j++) {
+			if (ret != KNOT_EOK) {
+				break;
+			}
+			uint64_t value = hist_percentile(hist, percentiles[j].permille);
+			ret = send_stats_value(args, &data, KNOT_CTL_TYPE_DATA,
+			                       percentiles[j].name, value);
+		}
+		if (ret == KNOT_EOK) {
+			ret = send_stats_value(args, &data, KNOT_CTL_TYPE_DATA,
+			                       "max", hist->max);
+		}
+	}
+
+	free(timing);
+
+	return ret;
+}
+
 static int send_block_data(conf_io_t *io, knot_ctl_data_t *data)
 {
 	knot_ctl_t *ctl = (knot_ctl_t *)io->misc;
@@ -1233,6 +1329,7 @@ static const desc_t cmd_table[] = {
 	[CTL_STATUS]          = { "status",          ctl_server },
 	[CTL_STOP]            = { "stop",            ctl_server },
 	[CTL_RELOAD]          = { "reload",          ctl_server },
+	[CTL_STATS]           = { "stats",           ctl_stats },
 
 	[CTL_ZONE_STATUS]     = { "zone-status",     ctl_zone },
 	[CTL_ZONE_RELOAD]     = { "zone-reload",     ctl_zone },
@@ -1240,6 +1337,7 @@ static const desc_t cmd_table[] = {
 	[CTL_ZONE_RETRANSFER] = { "zone-retransfer", ctl_zone },
 	[CTL_ZONE_FLUSH]      = { "zone-flush",      ctl_zone },
 	[CTL_ZONE_SIGN]       = { "zone-sign",       ctl_zone },
+	[CTL_ZONE_KEY_RELOAD] = { "zone-key-reload", ctl_zone },
 
 	[CTL_ZONE_READ]       = { "zone-read",       ctl_zone },
 	[CTL_ZONE_BEGIN]      = { "zone-begin",      ctl_zone },
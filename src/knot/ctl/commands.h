@@ -38,6 +38,7 @@ typedef enum {
 	CTL_STATUS,
 	CTL_STOP,
 	CTL_RELOAD,
+	CTL_STATS,
 
 	CTL_ZONE_STATUS,
 	CTL_ZONE_RELOAD,
@@ -45,6 +46,7 @@ typedef enum {
 	CTL_ZONE_RETRANSFER,
 	CTL_ZONE_FLUSH,
 	CTL_ZONE_SIGN,
+	CTL_ZONE_KEY_RELOAD,
 
 	CTL_ZONE_READ,
 	CTL_ZONE_BEGIN,
@@ -223,6 +223,17 @@ void kdnssec_ctx_deinit(kdnssec_ctx_t *ctx)
 	memset(ctx, 0, sizeof(*ctx));
 }
 
+char *kdnssec_kasp_path(const knot_dname_t *zone_name)
+{
+	conf_val_t val = conf_zone_get(conf(), C_STORAGE, zone_name);
+	char *storage = conf_abs_path(&val, NULL);
+	val = conf_zone_get(conf(), C_KASP_DB, zone_name);
+	char *kasp_path = conf_abs_path(&val, storage);
+	free(storage);
+
+	return kasp_path;
+}
+
 int kdnssec_ctx_init(kdnssec_ctx_t *ctx, const knot_dname_t *zone_name)
 {
 	if (ctx == NULL || zone_name == NULL) {
@@ -242,12 +253,7 @@ int kdnssec_ctx_init(kdnssec_ctx_t *ctx, const knot_dname_t *zone_name)
 		return KNOT_ENOMEM;
 	}
 
-	val = conf_zone_get(conf(), C_STORAGE, zone_name);
-	char *storage = conf_abs_path(&val, NULL);
-	val = conf_zone_get(conf(), C_KASP_DB, zone_name);
-	char *kasp_path = conf_abs_path(&val, storage);
-	free(storage);
-
+	char *kasp_path = kdnssec_kasp_path(zone_name);
 	int r = kdnssec_kasp_init(&new_ctx, kasp_path, zone_str);
 	free(kasp_path);
 	if (r != KNOT_EOK) {
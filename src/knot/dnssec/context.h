@@ -54,6 +54,13 @@ int kdnssec_kasp(dnssec_kasp_t **kasp, bool legacy);
  */
 int kdnssec_kasp_init(kdnssec_ctx_t *ctx, const char *kasp_path, const char *zone_name);
 
+/*!
+ * \brief Get the configured KASP database path of the zone.
+ *
+ * \return Absolute path (to be freed by the caller) or NULL.
+ */
+char *kdnssec_kasp_path(const knot_dname_t *zone_name);
+
 /*!
  * \brief Initialize DNSSEC signing context.
  *
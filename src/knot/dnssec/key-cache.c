@@ -0,0 +1,259 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "libknot/libknot.h"
+#include "knot/dnssec/key-cache.h"
+#include "contrib/string.h"
+
+enum {
+	FILE_ZONE = 0,
+	FILE_POLICY,
+	FILE_KEYSTORE,
+	FILE_COUNT
+};
+
+/*! \brief KASP database file the cached data were loaded from. */
+typedef struct {
+	char *path;
+	bool exists;
+	time_t mtime;
+	off_t size;
+	ino_t ino;
+} cache_file_t;
+
+struct kdnssec_cache {
+	pthread_mutex_t lock;
+	bool valid;
+	kdnssec_ctx_t ctx;
+	zone_keyset_t keyset;
+	uint32_t dnskey_ttl;   /*!< Policy DNSKEY TTL before zone adjustments. */
+	time_t expires;        /*!< Next key timing event. */
+	cache_file_t files[FILE_COUNT];
+};
+
+static bool is_safe(char chr)
+{
+	return ('a' <= chr && chr <= 'z') ||
+	       ('0' <= chr && chr <= '9') ||
+	       (chr == '.' || chr == '-' || chr == '_');
+}
+
+/*!
+ * \brief Get path of a KASP directory entity (same naming as libdnssec uses).
+ */
+static char *entity_path(const char *dir, const char *type, const char *name)
+{
+	char escaped[4 * KNOT_DNAME_MAXLEN + 1];
+	size_t len = 0;
+	for (; *name != '\0' && len + 4 < sizeof(escaped); name++) {
+		char chr = *name;
+		if ('A' <= chr && chr <= 'Z') {
+			chr = chr - 'A' + 'a';
+		}
+		if (is_safe(chr)) {
+			escaped[len++] = chr;
+		} else {
+			len += snprintf(escaped + len, 5, "\\x%02x", (unsigned char)chr);
+		}
+	}
+	if (*name != '\0') {
+		return NULL;
+	}
+	escaped[len] = '\0';
+
+	return sprintf_alloc("%s/%s_%s.json", dir, type, escaped);
+}
+
+static void file_stat(cache_file_t *file, bool *changed)
+{
+	struct stat st;
+	bool exists = (file->path != NULL && stat(file->path, &st) == 0);
+
+	if (exists != file->exists ||
+	    (exists && (st.st_mtime != file->mtime || st.st_size != file->size ||
+	                st.st_ino != file->ino))) {
+		*changed = true;
+	}
+
+	file->exists = exists;
+	if (exists) {
+		file->mtime = st.st_mtime;
+		file->size = st.st_size;
+		file->ino = st.st_ino;
+	}
+}
+
+static void cache_clear(kdnssec_cache_t *cache)
+{
+	free_zone_keys(&cache->keyset);
+	kdnssec_ctx_deinit(&cache->ctx);
+
+	for (int i = 0; i < FILE_COUNT; i++) {
+		free(cache->files[i].path);
+	}
+	memset(cache->files, 0, sizeof(cache->files));
+
+	cache->valid = false;
+}
+
+static int cache_load(kdnssec_cache_t *cache, const knot_dname_t *zone_name)
+{
+	// Stat the files first so that concurrent modifications are noticed.
+	char *kasp_path = kdnssec_kasp_path(zone_name);
+	char zone_str[KNOT_DNAME_TXT_MAXLEN + 1];
+	if (kasp_path == NULL ||
+	    knot_dname_to_str(zone_str, zone_name, sizeof(zone_str)) == NULL) {
+		free(kasp_path);
+		return KNOT_ENOMEM;
+	}
+	size_t zone_len = strlen(zone_str);
+	if (zone_len > 0 && zone_str[zone_len - 1] == '.') {
+		zone_str[zone_len - 1] = '\0';
+	}
+
+	bool unused;
+	cache->files[FILE_ZONE].path = entity_path(kasp_path, "zone", zone_str);
+	file_stat(&cache->files[FILE_ZONE], &unused);
+
+	int ret = kdnssec_ctx_init(&cache->ctx, zone_name);
+	if (ret != KNOT_EOK) {
+		free(kasp_path);
+		return ret;
+	}
+
+	if (cache->ctx.legacy) {
+		cache->files[FILE_POLICY].path =
+			entity_path(kasp_path, "policy", cache->ctx.policy->name);
+		file_stat(&cache->files[FILE_POLICY], &unused);
+		cache->files[FILE_KEYSTORE].path =
+			entity_path(kasp_path, "keystore", cache->ctx.policy->keystore);
+		file_stat(&cache->files[FILE_KEYSTORE], &unused);
+	}
+	free(kasp_path);
+
+	ret = load_zone_keys(cache->ctx.zone, cache->ctx.keystore,
+	                     cache->ctx.policy->nsec3_enabled, cache->ctx.now,
+	                     &cache->keyset);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	cache->dnskey_ttl = cache->ctx.policy->dnskey_ttl;
+	cache->expires = knot_get_next_zone_key_event(&cache->keyset);
+	cache->valid = true;
+
+	return KNOT_EOK;
+}
+
+static bool cache_outdated(kdnssec_cache_t *cache, time_t now)
+{
+	if (!cache->valid || now >= cache->expires) {
+		return true;
+	}
+
+	bool changed = false;
+	for (int i = 0; i < FILE_COUNT; i++) {
+		if (cache->files[i].path != NULL) {
+			file_stat(&cache->files[i], &changed);
+		}
+	}
+
+	return changed;
+}
+
+kdnssec_cache_t *kdnssec_cache_new(void)
+{
+	kdnssec_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_init(&cache->lock, NULL);
+
+	return cache;
+}
+
+void kdnssec_cache_free(kdnssec_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	cache_clear(cache);
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
+
+void kdnssec_cache_invalidate(kdnssec_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	cache_clear(cache);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+int kdnssec_cache_get(kdnssec_cache_t *cache, const knot_dname_t *zone_name,
+                      kdnssec_ctx_t **ctx, zone_keyset_t **keyset)
+{
+	if (cache == NULL || zone_name == NULL || ctx == NULL || keyset == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+
+	time_t now = time(NULL);
+	if (cache_outdated(cache, now)) {
+		cache_clear(cache);
+		int ret = cache_load(cache, zone_name);
+		if (ret != KNOT_EOK) {
+			cache_clear(cache);
+			pthread_mutex_unlock(&cache->lock);
+			return ret;
+		}
+	}
+
+	cache->ctx.now = now;
+	cache->ctx.policy->dnskey_ttl = cache->dnskey_ttl;
+
+	*ctx = &cache->ctx;
+	*keyset = &cache->keyset;
+
+	return KNOT_EOK;
+}
+
+void kdnssec_cache_release(kdnssec_cache_t *cache, bool failed)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	if (failed) {
+		cache_clear(cache);
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,87 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*!
+ * \file
+ *
+ * \brief Per-zone cache of the signing context and zone keys.
+ *
+ * Keeps the KASP zone, policy, keystore and the imported zone keys with their
+ * signing contexts between signing runs, so that incremental signing doesn't
+ * parse the KASP database and import the private keys again.
+ *
+ * The cached data are reloaded when the cache is invalidated, when any of the
+ * zone KASP files (zone, and policy and keystore in legacy mode) is modified,
+ * or when a key timing event is reached. A configuration reload creates new
+ * zone instances and thus empty caches.
+ *
+ * \addtogroup dnssec
+ * @{
+ */
+
+#pragma once
+
+#include "libknot/dname.h"
+#include "knot/dnssec/context.h"
+#include "knot/dnssec/zone-keys.h"
+
+struct kdnssec_cache;
+typedef struct kdnssec_cache kdnssec_cache_t;
+
+/*!
+ * \brief Create an empty signing cache.
+ *
+ * \return Cache or NULL on error.
+ */
+kdnssec_cache_t *kdnssec_cache_new(void);
+
+/*!
+ * \brief Free the signing cache including the cached keys.
+ */
+void kdnssec_cache_free(kdnssec_cache_t *cache);
+
+/*!
+ * \brief Drop the cached data, the next signing run reloads them.
+ */
+void kdnssec_cache_invalidate(kdnssec_cache_t *cache);
+
+/*!
+ * \brief Lock the cache and get the up-to-date signing context and keys.
+ *
+ * The returned context and keyset are owned by the cache. The caller may
+ * update the per-run context parameters (time, serials, policy values derived
+ * from the zone contents) until the cache is released.
+ *
+ * \param cache      Signing cache.
+ * \param zone_name  Zone name.
+ * \param ctx        Cached signing context.
+ * \param keyset     Cached zone keys.
+ *
+ * \note On success, the cache must be released by kdnssec_cache_release().
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int kdnssec_cache_get(kdnssec_cache_t *cache, const knot_dname_t *zone_name,
+                      kdnssec_ctx_t **ctx, zone_keyset_t **keyset);
+
+/*!
+ * \brief Unlock the cache locked by kdnssec_cache_get().
+ *
+ * \param cache   Signing cache.
+ * \param failed  Drop the cached data (e.g. the signing run failed).
+ */
+void kdnssec_cache_release(kdnssec_cache_t *cache, bool failed);
+
+/*! @} */
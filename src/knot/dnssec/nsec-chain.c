@@ -16,11 +16,14 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include "knot/dnssec/nsec-chain.h"
 #include "knot/dnssec/rrset-sign.h"
 #include "knot/dnssec/zone-nsec.h"
 #include "knot/dnssec/zone-sign.h"
+#include "libknot/rrtype/nsec.h"
+#include "contrib/macros.h"
 
 /* - NSEC chain construction ------------------------------------------------ */
 
@@ -29,16 +32,16 @@
  *
  * \param rrset      RRSet to be initialized.
  * \param from       Node that should contain the new RRSet.
- * \param to         Node that should be pointed to from 'from'.
+ * \param next       Owner that should be pointed to from 'from'.
  * \param ttl        Record TTL (SOA's minimum TTL).
  *
  * \return Error code, KNOT_EOK if successful.
  */
 static int create_nsec_rrset(knot_rrset_t *rrset, const zone_node_t *from,
-                             const zone_node_t *to, uint32_t ttl)
+                             const knot_dname_t *next, uint32_t ttl)
 {
 	assert(from);
-	assert(to);
+	assert(next);
 	knot_rrset_init(rrset, from->owner, KNOT_RRTYPE_NSEC, KNOT_CLASS_IN);
 
 	// Create bitmap
@@ -55,19 +58,67 @@ static int create_nsec_rrset(knot_rrset_t *rrset, const zone_node_t *from,
 	}
 
 	// Create RDATA
-	assert(to->owner);
-	size_t next_owner_size = knot_dname_size(to->owner);
+	size_t next_owner_size = knot_dname_size(next);
 	size_t rdata_size = next_owner_size + dnssec_nsec_bitmap_size(rr_types);
 	uint8_t rdata[rdata_size];
 
 	// Fill RDATA
-	memcpy(rdata, to->owner, next_owner_size);
+	memcpy(rdata, next, next_owner_size);
 	dnssec_nsec_bitmap_write(rr_types, rdata + next_owner_size);
 	dnssec_nsec_bitmap_free(rr_types);
 
 	return knot_rrset_add_rdata(rrset, rdata, rdata_size, ttl, NULL);
 }
 
+/*!
+ * \brief Replace the NSEC in the node if it differs from the new one.
+ *
+ * \param node       Node the new NSEC belongs to.
+ * \param new_nsec   New NSEC, its content is freed.
+ * \param changeset  Changeset for the NSEC changes.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+static int replace_nsec(zone_node_t *node, knot_rrset_t *new_nsec,
+                        changeset_t *changeset)
+{
+	knot_rrset_t old_nsec = node_rrset(node, KNOT_RRTYPE_NSEC);
+
+	if (!knot_rrset_empty(&old_nsec)) {
+		/* Convert old NSEC to lowercase, just in case it's not. */
+		knot_rrset_t *old_nsec_lc = knot_rrset_copy(&old_nsec, NULL);
+		int ret = knot_rrset_rr_to_canonical(old_nsec_lc);
+		if (ret != KNOT_EOK) {
+			knot_rrset_free(&old_nsec_lc, NULL);
+			knot_rdataset_clear(&new_nsec->rrs, NULL);
+			return ret;
+		}
+
+		bool equal = knot_rrset_equal(new_nsec, old_nsec_lc,
+		                              KNOT_RRSET_COMPARE_WHOLE);
+		knot_rrset_free(&old_nsec_lc, NULL);
+
+		if (equal) {
+			// current NSEC is valid, do nothing
+			knot_rdataset_clear(&new_nsec->rrs, NULL);
+			return KNOT_EOK;
+		}
+
+		// Mark the node so that we do not sign this NSEC
+		node->flags |= NODE_FLAGS_REMOVED_NSEC;
+		ret = knot_nsec_changeset_remove(node, changeset);
+		if (ret != KNOT_EOK) {
+			knot_rdataset_clear(&new_nsec->rrs, NULL);
+			return ret;
+		}
+	}
+
+	// Add new NSEC to the changeset (no matter if old was removed)
+	int ret = changeset_add_addition(changeset, new_nsec, 0);
+	knot_rdataset_clear(&new_nsec->rrs, NULL);
+	return ret;
+}
+
 /*!
  * \brief Connect two nodes by adding a NSEC RR into the first node.
  *
@@ -109,45 +160,12 @@ static int connect_nsec_nodes(zone_node_t *a, zone_node_t *b,
 
 	// create new NSEC
 	knot_rrset_t new_nsec;
-	ret = create_nsec_rrset(&new_nsec, a, b, data->ttl);
+	ret = create_nsec_rrset(&new_nsec, a, b->owner, data->ttl);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
 
-	knot_rrset_t old_nsec = node_rrset(a, KNOT_RRTYPE_NSEC);
-
-	if (!knot_rrset_empty(&old_nsec)) {
-		/* Convert old NSEC to lowercase, just in case it's not. */
-		knot_rrset_t *old_nsec_lc = knot_rrset_copy(&old_nsec, NULL);
-		ret = knot_rrset_rr_to_canonical(old_nsec_lc);
-		if (ret != KNOT_EOK) {
-			knot_rrset_free(&old_nsec_lc, NULL);
-			return ret;
-		}
-
-		bool equal = knot_rrset_equal(&new_nsec, old_nsec_lc,
-		                              KNOT_RRSET_COMPARE_WHOLE);
-		knot_rrset_free(&old_nsec_lc, NULL);
-
-		if (equal) {
-			// current NSEC is valid, do nothing
-			knot_rdataset_clear(&new_nsec.rrs, NULL);
-			return KNOT_EOK;
-		}
-
-		// Mark the node so that we do not sign this NSEC
-		a->flags |= NODE_FLAGS_REMOVED_NSEC;
-		ret = knot_nsec_changeset_remove(a, data->changeset);
-		if (ret != KNOT_EOK) {
-			knot_rdataset_clear(&new_nsec.rrs, NULL);
-			return ret;
-		}
-	}
-
-	// Add new NSEC to the changeset (no matter if old was removed)
-	ret = changeset_add_addition(data->changeset, &new_nsec, 0);
-	knot_rdataset_clear(&new_nsec.rrs, NULL);
-	return ret;
+	return replace_nsec(a, &new_nsec, data->changeset);
 }
 
 /* - API - iterations ------------------------------------------------------- */
@@ -276,6 +294,371 @@ bool knot_nsec_empty_nsec_and_rrsigs_in_node(const zone_node_t *n)
 	return true;
 }
 
+/* - Incremental chain repair ----------------------------------------------- */
+
+/*!
+ * \brief Chain repair state.
+ */
+typedef struct {
+	const nsec_chain_change_t *changes;  // Affected owners, sorted
+	size_t count;
+	const knot_dname_t **added;          // Owners joining the chain, sorted
+	size_t added_count;
+	const nsec_chain_fix_ops_t *ops;
+} chain_fix_t;
+
+static int change_cmp(const void *a, const void *b)
+{
+	const nsec_chain_change_t *ca = a;
+	const nsec_chain_change_t *cb = b;
+	return knot_dname_cmp(ca->owner, cb->owner);
+}
+
+static int dname_ptr_cmp(const void *a, const void *b)
+{
+	return knot_dname_cmp(*(const knot_dname_t **)a,
+	                      *(const knot_dname_t **)b);
+}
+
+/*!
+ * \brief Get position of the first name greater than (or equal to) the owner.
+ */
+static size_t name_bound(const knot_dname_t **names, size_t count,
+                         const knot_dname_t *owner, bool equal)
+{
+	size_t lo = 0, hi = count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		int cmp = knot_dname_cmp(names[mid], owner);
+		if (cmp < 0 || (cmp == 0 && !equal)) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+static const nsec_chain_change_t *change_find(const chain_fix_t *fix,
+                                              const knot_dname_t *owner)
+{
+	nsec_chain_change_t key = { .owner = owner };
+	return bsearch(&key, fix->changes, fix->count, sizeof(key), change_cmp);
+}
+
+static bool is_removed(const chain_fix_t *fix, const knot_dname_t *owner)
+{
+	const nsec_chain_change_t *change = change_find(fix, owner);
+	return change != NULL && change->action == NSEC_CHAIN_REMOVE;
+}
+
+/*!
+ * \brief Get the closest added owner following the owner (circular).
+ */
+static const knot_dname_t *added_next(const chain_fix_t *fix,
+                                      const knot_dname_t *owner)
+{
+	if (fix->added_count == 0) {
+		return NULL;
+	}
+
+	size_t pos = name_bound(fix->added, fix->added_count, owner, false);
+	const knot_dname_t *next = fix->added[pos % fix->added_count];
+
+	return knot_dname_cmp(next, owner) != 0 ? next : NULL;
+}
+
+/*!
+ * \brief Get the closest added owner preceding the owner (circular).
+ */
+static const knot_dname_t *added_prev(const chain_fix_t *fix,
+                                      const knot_dname_t *owner)
+{
+	if (fix->added_count == 0) {
+		return NULL;
+	}
+
+	size_t pos = name_bound(fix->added, fix->added_count, owner, true);
+	pos = (pos + fix->added_count - 1) % fix->added_count;
+	const knot_dname_t *prev = fix->added[pos];
+
+	return knot_dname_cmp(prev, owner) != 0 ? prev : NULL;
+}
+
+/*!
+ * \brief Check if 'a' follows the owner closer than 'b' in the circular order.
+ */
+static bool closer_next(const knot_dname_t *owner, const knot_dname_t *a,
+                        const knot_dname_t *b)
+{
+	bool a_wraps = knot_dname_cmp(a, owner) <= 0;
+	bool b_wraps = knot_dname_cmp(b, owner) <= 0;
+	if (a_wraps != b_wraps) {
+		return b_wraps;
+	}
+
+	return knot_dname_cmp(a, b) < 0;
+}
+
+/*!
+ * \brief Check if 'a' precedes the owner closer than 'b' in the circular order.
+ */
+static bool closer_prev(const knot_dname_t *owner, const knot_dname_t *a,
+                        const knot_dname_t *b)
+{
+	bool a_wraps = knot_dname_cmp(a, owner) >= 0;
+	bool b_wraps = knot_dname_cmp(b, owner) >= 0;
+	if (a_wraps != b_wraps) {
+		return b_wraps;
+	}
+
+	return knot_dname_cmp(a, b) > 0;
+}
+
+/*!
+ * \brief Walk the current chain in one direction, skip the removed owners.
+ */
+static int walk_remaining(const chain_fix_t *fix, const knot_dname_t *owner,
+                          bool forward, knot_dname_t **result)
+{
+	const nsec_chain_fix_ops_t *ops = fix->ops;
+
+	knot_dname_t *cur = NULL;
+	int ret = forward ? ops->next(owner, &cur, ops->data) :
+	                    ops->prev(owner, &cur, ops->data);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	for (size_t i = 0; is_removed(fix, cur); i++) {
+		// All owners can't leave the chain, the apex always stays.
+		knot_dname_t *skip = cur;
+		ret = (i == fix->count) ? KNOT_EINVAL :
+		      forward ? ops->next(skip, &cur, ops->data) :
+		                ops->prev(skip, &cur, ops->data);
+		free(skip);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	*result = cur;
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Get the successor of the owner in the repaired chain.
+ */
+static int final_next(const chain_fix_t *fix, const knot_dname_t *owner,
+                      bool member, knot_dname_t **next)
+{
+	knot_dname_t *succ = NULL;
+	int ret = KNOT_EOK;
+	if (member) {
+		ret = walk_remaining(fix, owner, true, &succ);
+	} else {
+		knot_dname_t *prev = NULL;
+		ret = fix->ops->prev(owner, &prev, fix->ops->data);
+		if (ret == KNOT_EOK) {
+			ret = walk_remaining(fix, prev, true, &succ);
+			free(prev);
+		}
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	const knot_dname_t *added = added_next(fix, owner);
+	if (added != NULL && (knot_dname_cmp(succ, owner) == 0 ||
+	                      closer_next(owner, added, succ))) {
+		free(succ);
+		succ = knot_dname_copy(added, NULL);
+		if (succ == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	*next = succ;
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Get the predecessor of the owner in the repaired chain.
+ */
+static int final_prev(const chain_fix_t *fix, const knot_dname_t *owner,
+                      knot_dname_t **prev)
+{
+	knot_dname_t *pred = NULL;
+	int ret = walk_remaining(fix, owner, false, &pred);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	const knot_dname_t *added = added_prev(fix, owner);
+	if (added != NULL && (knot_dname_cmp(pred, owner) == 0 ||
+	                      closer_prev(owner, added, pred))) {
+		free(pred);
+		pred = knot_dname_copy(added, NULL);
+		if (pred == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	*prev = pred;
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Link the owner to its successor in the repaired chain.
+ */
+static int relink(const chain_fix_t *fix, const knot_dname_t *owner,
+                  const zone_node_t *node, bool member)
+{
+	knot_dname_t *next = NULL;
+	int ret = final_next(fix, owner, member, &next);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = fix->ops->link(owner, node, next, fix->ops->data);
+	free(next);
+
+	return ret;
+}
+
+int knot_nsec_chain_fix(nsec_chain_change_t *changes, size_t count,
+                        const nsec_chain_fix_ops_t *ops)
+{
+	assert(ops);
+
+	if (count == 0) {
+		return KNOT_EOK;
+	}
+
+	qsort(changes, count, sizeof(*changes), change_cmp);
+
+	chain_fix_t fix = {
+		.changes = changes,
+		.count = count,
+		.added = malloc(count * sizeof(*fix.added)),
+		.ops = ops
+	};
+	knot_dname_t **preds = malloc(count * sizeof(*preds));
+	size_t pred_count = 0;
+	if (fix.added == NULL || preds == NULL) {
+		free(fix.added);
+		free(preds);
+		return KNOT_ENOMEM;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (changes[i].action == NSEC_CHAIN_ADD) {
+			fix.added[fix.added_count++] = changes[i].owner;
+		}
+	}
+
+	// Find the unchanged owners pointing to the added or removed ones.
+	int ret = KNOT_EOK;
+	for (size_t i = 0; i < count && ret == KNOT_EOK; i++) {
+		if (changes[i].action == NSEC_CHAIN_UPDATE) {
+			continue;
+		}
+
+		knot_dname_t *prev = NULL;
+		ret = final_prev(&fix, changes[i].owner, &prev);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+		if (change_find(&fix, prev) == NULL) {
+			preds[pred_count++] = prev;
+		} else {
+			free(prev);
+		}
+	}
+
+	for (size_t i = 0; i < count && ret == KNOT_EOK; i++) {
+		if (changes[i].action != NSEC_CHAIN_REMOVE) {
+			ret = relink(&fix, changes[i].owner, changes[i].node,
+			             changes[i].action == NSEC_CHAIN_UPDATE);
+		}
+	}
+
+	qsort(preds, pred_count, sizeof(*preds), dname_ptr_cmp);
+	for (size_t i = 0; i < pred_count && ret == KNOT_EOK; i++) {
+		if (i == 0 || knot_dname_cmp(preds[i - 1], preds[i]) != 0) {
+			ret = relink(&fix, preds[i], NULL, true);
+		}
+	}
+
+	for (size_t i = 0; i < pred_count; i++) {
+		free(preds[i]);
+	}
+	free(preds);
+	free(fix.added);
+
+	return ret;
+}
+
+int knot_nsec_changed_owners(const changeset_t *update, const knot_dname_t *apex,
+                             const knot_dname_t ***owners, size_t *count)
+{
+	if (update == NULL || owners == NULL || count == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	changeset_iter_t itt;
+	int ret = changeset_iter_all(&itt, update, false);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	const knot_dname_t **names = NULL;
+	size_t size = 0, max = 0;
+
+	knot_rrset_t rr = changeset_iter_next(&itt);
+	while (!knot_rrset_empty(&rr)) {
+		const knot_dname_t *name = rr.owner;
+		for (;;) {
+			if (size == max) {
+				max = (max == 0) ? 64 : 2 * max;
+				const knot_dname_t **tmp = realloc(names, max * sizeof(*names));
+				if (tmp == NULL) {
+					changeset_iter_clear(&itt);
+					free(names);
+					return KNOT_ENOMEM;
+				}
+				names = tmp;
+			}
+			names[size++] = name;
+
+			if (apex == NULL || !knot_dname_is_sub(name, apex)) {
+				break;
+			}
+			name = knot_wire_next_label(name, NULL);
+		}
+		rr = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+
+	// Sort and merge duplicates.
+	if (size > 0) {
+		qsort(names, size, sizeof(*names), dname_ptr_cmp);
+		size_t unique = 1;
+		for (size_t i = 1; i < size; i++) {
+			if (knot_dname_cmp(names[unique - 1], names[i]) != 0) {
+				names[unique++] = names[i];
+			}
+		}
+		size = unique;
+	}
+
+	*owners = names;
+	*count = size;
+
+	return KNOT_EOK;
+}
+
 /* - API - Chain creation --------------------------------------------------- */
 
 /*!
@@ -293,3 +676,146 @@ int knot_nsec_create_chain(const zone_contents_t *zone, uint32_t ttl,
 	return knot_nsec_chain_iterate_create(zone->nodes,
 	                                      connect_nsec_nodes, &data);
 }
+
+/*!
+ * \brief Parameters for the NSEC chain repair callbacks.
+ */
+typedef struct {
+	const zone_contents_t *zone;
+	uint32_t ttl;
+	changeset_t *changeset;
+} nsec_fix_data_t;
+
+static int nsec_fix_prev(const knot_dname_t *owner, knot_dname_t **prev,
+                         void *data)
+{
+	nsec_fix_data_t *fix = data;
+
+	zone_node_t *found = NULL, *node = NULL;
+	int ret = zone_tree_get_less_or_equal(fix->zone->nodes, owner, &found,
+	                                      &node);
+	if (ret < 0) {
+		return ret;
+	}
+
+	// Nodes without NSEC (new or non-authoritative) are not in the chain.
+	const zone_node_t *start = node;
+	while (node != NULL && !node_rrtype_exists(node, KNOT_RRTYPE_NSEC)) {
+		node = node->prev;
+		if (node == start) {
+			return KNOT_EINVAL;
+		}
+	}
+	if (node == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	*prev = knot_dname_copy(node->owner, NULL);
+	return (*prev != NULL) ? KNOT_EOK : KNOT_ENOMEM;
+}
+
+static int nsec_fix_next(const knot_dname_t *member, knot_dname_t **next,
+                         void *data)
+{
+	nsec_fix_data_t *fix = data;
+
+	zone_node_t *node = NULL;
+	zone_tree_get(fix->zone->nodes, member, &node);
+	const knot_rdataset_t *nsec = node ? node_rdataset(node, KNOT_RRTYPE_NSEC) : NULL;
+	if (nsec == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	*next = knot_dname_copy(knot_nsec_next(nsec), NULL);
+	if (*next == NULL) {
+		return KNOT_ENOMEM;
+	}
+	knot_dname_to_lower(*next);
+
+	return KNOT_EOK;
+}
+
+static int nsec_fix_link(const knot_dname_t *owner, const zone_node_t *node,
+                         const knot_dname_t *next, void *data)
+{
+	UNUSED(node);
+	nsec_fix_data_t *fix = data;
+
+	zone_node_t *from = NULL;
+	zone_tree_get(fix->zone->nodes, owner, &from);
+	if (from == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	knot_rrset_t new_nsec;
+	int ret = create_nsec_rrset(&new_nsec, from, next, fix->ttl);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	return replace_nsec(from, &new_nsec, fix->changeset);
+}
+
+/*!
+ * \brief Repair NSEC chain after a zone change.
+ */
+int knot_nsec_fix_chain(const zone_contents_t *zone, const changeset_t *update,
+                        uint32_t ttl, changeset_t *changeset)
+{
+	assert(zone);
+	assert(update);
+	assert(changeset);
+
+	const knot_dname_t **owners = NULL;
+	size_t count = 0;
+	int ret = knot_nsec_changed_owners(update, NULL, &owners, &count);
+	if (ret != KNOT_EOK || count == 0) {
+		free(owners);
+		return ret;
+	}
+
+	nsec_chain_change_t *changes = malloc(count * sizeof(*changes));
+	if (changes == NULL) {
+		free(owners);
+		return KNOT_ENOMEM;
+	}
+
+	size_t changed = 0;
+	for (size_t i = 0; i < count && ret == KNOT_EOK; i++) {
+		zone_node_t *node = NULL;
+		zone_tree_get(zone->nodes, owners[i], &node);
+
+		bool in_chain = node && node_rrtype_exists(node, KNOT_RRTYPE_NSEC);
+		bool wanted = node && node->rrset_count > 0 &&
+		              !(node->flags & NODE_FLAGS_NONAUTH) &&
+		              !knot_nsec_empty_nsec_and_rrsigs_in_node(node);
+
+		nsec_chain_change_t *change = &changes[changed];
+		change->owner = owners[i];
+		change->node = node;
+		if (wanted) {
+			change->action = in_chain ? NSEC_CHAIN_UPDATE : NSEC_CHAIN_ADD;
+			changed++;
+		} else if (in_chain) {
+			change->action = NSEC_CHAIN_REMOVE;
+			changed++;
+			ret = knot_nsec_changeset_remove(node, changeset);
+		}
+	}
+
+	if (ret == KNOT_EOK) {
+		nsec_fix_data_t data = { zone, ttl, changeset };
+		nsec_chain_fix_ops_t ops = {
+			.prev = nsec_fix_prev,
+			.next = nsec_fix_next,
+			.link = nsec_fix_link,
+			.data = &data
+		};
+		ret = knot_nsec_chain_fix(changes, changed, &ops);
+	}
+
+	free(changes);
+	free(owners);
+
+	return ret;
+}
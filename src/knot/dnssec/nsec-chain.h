@@ -56,6 +56,38 @@ enum {
 typedef int (*chain_iterate_create_cb)(zone_node_t *, zone_node_t *,
                                        nsec_chain_iterate_data_t *);
 
+/*!
+ * \brief Role of a chain owner in an incremental chain repair.
+ */
+typedef enum {
+	NSEC_CHAIN_ADD = 0,  //!< Owner joins the chain.
+	NSEC_CHAIN_UPDATE,   //!< Owner stays in the chain, its record may change.
+	NSEC_CHAIN_REMOVE,   //!< Owner leaves the chain.
+} nsec_chain_action_t;
+
+/*!
+ * \brief Chain owner affected by a zone change.
+ */
+typedef struct {
+	const knot_dname_t *owner;     // Chain owner (hashed owner for NSEC3)
+	const zone_node_t *node;       // Zone node the record is made for
+	nsec_chain_action_t action;
+} nsec_chain_change_t;
+
+/*!
+ * \brief Access to the current chain and record creation for the repair.
+ */
+typedef struct {
+	/*! Get the current chain member preceding the owner (circular). */
+	int (*prev)(const knot_dname_t *owner, knot_dname_t **prev, void *data);
+	/*! Get the current chain member following the member. */
+	int (*next)(const knot_dname_t *member, knot_dname_t **next, void *data);
+	/*! Link the owner to the next owner, node is NULL if not changed. */
+	int (*link)(const knot_dname_t *owner, const zone_node_t *node,
+	            const knot_dname_t *next, void *data);
+	void *data;
+} nsec_chain_fix_ops_t;
+
 /*!
  * \brief Add all RR types from a node into the bitmap.
  */
@@ -120,6 +152,37 @@ int knot_nsec_changeset_remove(const zone_node_t *n,
  */
 bool knot_nsec_empty_nsec_and_rrsigs_in_node(const zone_node_t *n);
 
+/*!
+ * \brief Repair a chain by relinking only the owners around the changes.
+ *
+ * Each added or updated owner and the nearest remaining predecessor of each
+ * added or removed owner is linked to its successor in the resulting chain.
+ * The records of the removed owners must be dropped by the caller.
+ *
+ * \param changes  Affected owners, unique, sorted in place.
+ * \param count    Number of affected owners.
+ * \param ops      Chain access callbacks.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_nsec_chain_fix(nsec_chain_change_t *changes, size_t count,
+                        const nsec_chain_fix_ops_t *ops);
+
+/*!
+ * \brief Collect the owners of the changed records.
+ *
+ * \note The owners point into the changeset.
+ *
+ * \param update  Changes applied to the zone.
+ * \param apex    Zone apex, also collect all parents up to it if not NULL.
+ * \param owners  Output sorted array of unique owners, free with free().
+ * \param count   Output number of owners.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_nsec_changed_owners(const changeset_t *update, const knot_dname_t *apex,
+                             const knot_dname_t ***owners, size_t *count);
+
 /*!
  * \brief Create new NSEC chain, add differences from current into a changeset.
  *
@@ -131,3 +194,20 @@ bool knot_nsec_empty_nsec_and_rrsigs_in_node(const zone_node_t *n);
  */
 int knot_nsec_create_chain(const zone_contents_t *zone, uint32_t ttl,
                            changeset_t *changeset);
+
+/*!
+ * \brief Repair NSEC chain after a zone change, add the differences into
+ *        a changeset.
+ *
+ * Only the NSEC records of the changed nodes and of their neighbours in the
+ * chain are recreated.
+ *
+ * \param zone       Updated zone.
+ * \param update     Changes applied to the zone.
+ * \param ttl        TTL for created NSEC records.
+ * \param changeset  Changeset the differences will be put into.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_nsec_fix_chain(const zone_contents_t *zone, const changeset_t *update,
+                        uint32_t ttl, changeset_t *changeset);
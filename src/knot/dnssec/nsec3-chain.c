@@ -15,9 +15,11 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 
 #include "dnssec/nsec.h"
 #include "libknot/dname.h"
+#include "libknot/rrtype/nsec3.h"
 #include "knot/dnssec/nsec-chain.h"
 #include "knot/dnssec/nsec3-chain.h"
 #include "knot/dnssec/zone-sign.h"
@@ -302,6 +304,29 @@ static zone_node_t *create_nsec3_node(knot_dname_t *owner,
 	return new_node;
 }
 
+/*!
+ * \brief Create NSEC3 type bitmap for given regular node.
+ */
+static dnssec_nsec_bitmap_t *create_nsec3_bitmap(const zone_node_t *node,
+                                                 const zone_node_t *apex)
+{
+	dnssec_nsec_bitmap_t *rr_types = dnssec_nsec_bitmap_new();
+	if (!rr_types) {
+		return NULL;
+	}
+
+	bitmap_add_node_rrsets(rr_types, KNOT_RRTYPE_NSEC3, node);
+	if (node->rrset_count > 0 && node_should_be_signed_nsec3(node)) {
+		dnssec_nsec_bitmap_add(rr_types, KNOT_RRTYPE_RRSIG);
+	}
+	if (node == apex) {
+		dnssec_nsec_bitmap_add(rr_types, KNOT_RRTYPE_DNSKEY);
+		dnssec_nsec_bitmap_add(rr_types, KNOT_RRTYPE_NSEC3PARAM);
+	}
+
+	return rr_types;
+}
+
 /*!
  * \brief Create new NSEC3 node for given regular node.
  *
@@ -327,20 +352,11 @@ static zone_node_t *create_nsec3_node_for_node(zone_node_t *node,
 		return NULL;
 	}
 
-	dnssec_nsec_bitmap_t *rr_types = dnssec_nsec_bitmap_new();
+	dnssec_nsec_bitmap_t *rr_types = create_nsec3_bitmap(node, apex);
 	if (!rr_types) {
 		return NULL;
 	}
 
-	bitmap_add_node_rrsets(rr_types, KNOT_RRTYPE_NSEC3, node);
-	if (node->rrset_count > 0 && node_should_be_signed_nsec3(node)) {
-		dnssec_nsec_bitmap_add(rr_types, KNOT_RRTYPE_RRSIG);
-	}
-	if (node == apex) {
-		dnssec_nsec_bitmap_add(rr_types, KNOT_RRTYPE_DNSKEY);
-		dnssec_nsec_bitmap_add(rr_types, KNOT_RRTYPE_NSEC3PARAM);
-	}
-
 	zone_node_t *nsec3_node;
 	nsec3_node = create_nsec3_node(nsec3_owner, params, apex, rr_types, ttl);
 	dnssec_nsec_bitmap_free(rr_types);
@@ -548,6 +564,174 @@ static int nsec3_reset(zone_node_t **node_p, void *data)
 	return KNOT_EOK;
 }
 
+/* - NSEC3 chain repair ----------------------------------------------------- */
+
+/*!
+ * \brief Parameters for the NSEC3 chain repair callbacks.
+ */
+typedef struct {
+	const zone_contents_t *zone;
+	const dnssec_nsec3_params_t *params;
+	uint32_t ttl;
+	changeset_t *changeset;
+} nsec3_fix_data_t;
+
+/*!
+ * \brief Checks if NSEC3 should exist for the node, i.e. if the node or any
+ *        of its descendants contains other RRSets than NSEC and RRSIGs.
+ */
+static bool nsec3_is_wanted(const zone_contents_t *zone, const zone_node_t *node)
+{
+	if (node->flags & NODE_FLAGS_NONAUTH) {
+		return false;
+	}
+
+	if (!knot_nsec_empty_nsec_and_rrsigs_in_node(node)) {
+		return true;
+	}
+
+	if (node->children == 0) {
+		return false;
+	}
+
+	// The key sorts after all names below the node.
+	uint8_t key[2 * KNOT_DNAME_MAXLEN];
+	knot_dname_lf(key, node->owner, NULL);
+	size_t key_len = key[0];
+	memset(key + 1 + key_len, 0xff, KNOT_DNAME_MAXLEN);
+	key_len += KNOT_DNAME_MAXLEN;
+
+	value_t *val = NULL;
+	hattrie_find_leq(zone->nodes, (char *)key + 1, key_len, &val);
+
+	// Non-authoritative descendants are skipped, their delegation is not.
+	const zone_node_t *desc = (val != NULL) ? *val : NULL;
+	while (desc != NULL && knot_dname_is_sub(desc->owner, node->owner)) {
+		if (!(desc->flags & NODE_FLAGS_NONAUTH) &&
+		    !knot_nsec_empty_nsec_and_rrsigs_in_node(desc)) {
+			return true;
+		}
+		desc = desc->prev;
+	}
+
+	return false;
+}
+
+static int nsec3_fix_prev(const knot_dname_t *owner, knot_dname_t **prev,
+                          void *data)
+{
+	nsec3_fix_data_t *fix = data;
+
+	zone_node_t *found = NULL, *node = NULL;
+	int ret = zone_tree_get_less_or_equal(fix->zone->nsec3_nodes, owner,
+	                                      &found, &node);
+	if (ret < 0) {
+		return ret;
+	}
+	if (node == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	*prev = knot_dname_copy(node->owner, NULL);
+	return (*prev != NULL) ? KNOT_EOK : KNOT_ENOMEM;
+}
+
+static int nsec3_fix_next(const knot_dname_t *member, knot_dname_t **next,
+                          void *data)
+{
+	nsec3_fix_data_t *fix = data;
+
+	zone_node_t *node = NULL;
+	zone_tree_get(fix->zone->nsec3_nodes, member, &node);
+	const knot_rdataset_t *nsec3 = node ? node_rdataset(node, KNOT_RRTYPE_NSEC3) : NULL;
+	if (nsec3 == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	uint8_t *raw_hash = NULL;
+	uint8_t raw_length = 0;
+	knot_nsec3_next_hashed(nsec3, 0, &raw_hash, &raw_length);
+	if (raw_hash == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	*next = knot_nsec3_hash_to_dname(raw_hash, raw_length,
+	                                 fix->zone->apex->owner);
+	return (*next != NULL) ? KNOT_EOK : KNOT_ENOMEM;
+}
+
+static int nsec3_fix_link(const knot_dname_t *owner, const zone_node_t *node,
+                          const knot_dname_t *next, void *data)
+{
+	nsec3_fix_data_t *fix = data;
+
+	uint8_t hash[KNOT_DNAME_MAXLEN];
+	size_t hash_length = dnssec_nsec3_hash_length(fix->params->algorithm);
+	int32_t written = base32hex_decode(next + 1, *next, hash, sizeof(hash));
+	if (written != (int32_t)hash_length) {
+		return KNOT_EINVAL;
+	}
+
+	zone_node_t *nsec3_node = NULL;
+	zone_tree_get(fix->zone->nsec3_nodes, owner, &nsec3_node);
+	knot_rrset_t old_nsec3 = node_rrset(nsec3_node, KNOT_RRTYPE_NSEC3);
+
+	knot_rrset_t new_nsec3;
+	int ret = KNOT_EOK;
+	if (node != NULL) {
+		dnssec_nsec_bitmap_t *rr_types = create_nsec3_bitmap(node,
+		                                                     fix->zone->apex);
+		if (rr_types == NULL) {
+			return KNOT_ENOMEM;
+		}
+		ret = create_nsec3_rrset(&new_nsec3, (knot_dname_t *)owner,
+		                         fix->params, rr_types, hash, fix->ttl);
+		dnssec_nsec_bitmap_free(rr_types);
+	} else {
+		// Unchanged node, only the next hash is updated.
+		if (knot_rrset_empty(&old_nsec3) || old_nsec3.rrs.rr_count != 1) {
+			return KNOT_EINVAL;
+		}
+		knot_rrset_init(&new_nsec3, old_nsec3.owner, KNOT_RRTYPE_NSEC3,
+		                KNOT_CLASS_IN);
+		ret = knot_rdataset_copy(&new_nsec3.rrs, &old_nsec3.rrs, NULL);
+		if (ret == KNOT_EOK) {
+			uint8_t *raw_hash = NULL;
+			uint8_t raw_length = 0;
+			knot_nsec3_next_hashed(&new_nsec3.rrs, 0, &raw_hash, &raw_length);
+			if (raw_length == hash_length) {
+				memcpy(raw_hash, hash, hash_length);
+			} else {
+				ret = KNOT_EINVAL;
+			}
+		}
+	}
+	if (ret != KNOT_EOK) {
+		knot_rdataset_clear(&new_nsec3.rrs, NULL);
+		return ret;
+	}
+
+	if (!knot_rrset_empty(&old_nsec3)) {
+		if (knot_rrset_equal(&new_nsec3, &old_nsec3, KNOT_RRSET_COMPARE_WHOLE)) {
+			// current NSEC3 is valid, do nothing
+			knot_rdataset_clear(&new_nsec3.rrs, NULL);
+			return KNOT_EOK;
+		}
+
+		// Mark the node so that we do not sign this NSEC3
+		nsec3_node->flags |= NODE_FLAGS_REMOVED_NSEC;
+		ret = knot_nsec_changeset_remove(nsec3_node, fix->changeset);
+		if (ret != KNOT_EOK) {
+			knot_rdataset_clear(&new_nsec3.rrs, NULL);
+			return ret;
+		}
+	}
+
+	ret = changeset_add_addition(fix->changeset, &new_nsec3, 0);
+	knot_rdataset_clear(&new_nsec3.rrs, NULL);
+	return ret;
+}
+
 /* - Public API ------------------------------------------------------------- */
 
 /*!
@@ -615,3 +799,89 @@ int knot_nsec3_create_chain(const zone_contents_t *zone,
 
 	return result;
 }
+
+/*!
+ * \brief Repair NSEC3 chain after a zone change.
+ */
+int knot_nsec3_fix_chain(const zone_contents_t *zone,
+                         const changeset_t *update,
+                         const dnssec_nsec3_params_t *params,
+                         uint32_t ttl,
+                         changeset_t *changeset)
+{
+	assert(zone);
+	assert(update);
+	assert(params);
+	assert(changeset);
+
+	// Emptiness of the parents may change with their descendants.
+	const knot_dname_t *apex = zone->apex->owner;
+	const knot_dname_t **owners = NULL;
+	size_t count = 0;
+	int ret = knot_nsec_changed_owners(update, apex, &owners, &count);
+	if (ret != KNOT_EOK || count == 0) {
+		free(owners);
+		return ret;
+	}
+
+	nsec_chain_change_t *changes = malloc(count * sizeof(*changes));
+	if (changes == NULL) {
+		free(owners);
+		return KNOT_ENOMEM;
+	}
+
+	size_t changed = 0;
+	for (size_t i = 0; i < count && ret == KNOT_EOK; i++) {
+		if (!knot_dname_in(apex, owners[i])) {
+			continue;
+		}
+
+		zone_node_t *node = NULL;
+		zone_tree_get(zone->nodes, owners[i], &node);
+		bool wanted = node && nsec3_is_wanted(zone, node);
+
+		knot_dname_t *nsec3_owner = knot_create_nsec3_owner(owners[i], apex,
+		                                                    params);
+		if (nsec3_owner == NULL) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+
+		zone_node_t *nsec3_node = NULL;
+		zone_tree_get(zone->nsec3_nodes, nsec3_owner, &nsec3_node);
+		bool in_chain = nsec3_node != NULL;
+
+		nsec_chain_change_t *change = &changes[changed];
+		change->owner = nsec3_owner;
+		change->node = node;
+		if (wanted) {
+			change->action = in_chain ? NSEC_CHAIN_UPDATE : NSEC_CHAIN_ADD;
+			changed++;
+		} else if (in_chain) {
+			change->action = NSEC_CHAIN_REMOVE;
+			changed++;
+			ret = knot_nsec_changeset_remove(nsec3_node, changeset);
+		} else {
+			knot_dname_free(&nsec3_owner, NULL);
+		}
+	}
+
+	if (ret == KNOT_EOK) {
+		nsec3_fix_data_t data = { zone, params, ttl, changeset };
+		nsec_chain_fix_ops_t ops = {
+			.prev = nsec3_fix_prev,
+			.next = nsec3_fix_next,
+			.link = nsec3_fix_link,
+			.data = &data
+		};
+		ret = knot_nsec_chain_fix(changes, changed, &ops);
+	}
+
+	for (size_t i = 0; i < changed; i++) {
+		free((knot_dname_t *)changes[i].owner);
+	}
+	free(changes);
+	free(owners);
+
+	return ret;
+}
@@ -35,3 +35,24 @@ int knot_nsec3_create_chain(const zone_contents_t *zone,
                             const dnssec_nsec3_params_t *params,
                             uint32_t ttl,
                             changeset_t *changeset);
+
+/*!
+ * \brief Repairs NSEC3 chain after a zone change, add differences into
+ *        a changeset.
+ *
+ * Only the NSEC3 records of the changed nodes, their parents and of their
+ * neighbours in the chain are recreated.
+ *
+ * \param zone       Updated zone.
+ * \param update     Changes applied to the zone.
+ * \param params     NSEC3 parameters.
+ * \param ttl        TTL for new records.
+ * \param changeset  Changeset to store changes into.
+ *
+ * \return KNOT_E*
+ */
+int knot_nsec3_fix_chain(const zone_contents_t *zone,
+                         const changeset_t *update,
+                         const dnssec_nsec3_params_t *params,
+                         uint32_t ttl,
+                         changeset_t *changeset);
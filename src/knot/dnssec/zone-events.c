@@ -24,6 +24,7 @@
 #include "knot/conf/conf.h"
 #include "knot/common/log.h"
 #include "knot/dnssec/context.h"
+#include "knot/dnssec/key-cache.h"
 #include "knot/dnssec/policy.h"
 #include "knot/dnssec/zone-events.h"
 #include "knot/dnssec/zone-keys.h"
@@ -31,18 +32,12 @@
 #include "knot/dnssec/zone-sign.h"
 #include "knot/zone/serial.h"
 
-static int sign_init(const zone_contents_t *zone, int flags, kdnssec_ctx_t *ctx)
+static void sign_init_params(const zone_contents_t *zone, int flags,
+                             kdnssec_ctx_t *ctx)
 {
 	assert(zone);
 	assert(ctx);
 
-	const knot_dname_t *zone_name = zone->apex->owner;
-
-	int r = kdnssec_ctx_init(ctx, zone_name);
-	if (r != KNOT_EOK) {
-		return r;
-	}
-
 	// update policy based on the zone content
 
 	update_policy_from_zone(ctx->policy, zone);
@@ -57,9 +52,23 @@ static int sign_init(const zone_contents_t *zone, int flags, kdnssec_ctx_t *ctx)
 	if (flags & ZONE_SIGN_KEEP_SOA_SERIAL) {
 		ctx->new_serial = ctx->old_serial;
 	} else {
-		conf_val_t val = conf_zone_get(conf(), C_SERIAL_POLICY, zone_name);
+		conf_val_t val = conf_zone_get(conf(), C_SERIAL_POLICY,
+		                               zone->apex->owner);
 		ctx->new_serial = serial_next(ctx->old_serial, conf_opt(&val));
 	}
+}
+
+static int sign_init(const zone_contents_t *zone, int flags, kdnssec_ctx_t *ctx)
+{
+	assert(zone);
+	assert(ctx);
+
+	int r = kdnssec_ctx_init(ctx, zone->apex->owner);
+	if (r != KNOT_EOK) {
+		return r;
+	}
+
+	sign_init_params(zone, flags, ctx);
 
 	return KNOT_EOK;
 }
@@ -146,7 +155,8 @@ static uint32_t schedule_next(kdnssec_ctx_t *kctx, const zone_keyset_t *keyset,
 }
 
 int knot_dnssec_zone_sign(zone_contents_t *zone, changeset_t *out_ch,
-                          zone_sign_flags_t flags, uint32_t *refresh_at)
+                          zone_sign_flags_t flags, uint32_t *refresh_at,
+                          kdnssec_cache_t *cache)
 {
 	if (!zone || !out_ch || !refresh_at) {
 		return KNOT_EINVAL;
@@ -224,13 +234,17 @@ done:
 	free_zone_keys(&keyset);
 	kdnssec_ctx_deinit(&ctx);
 
+	// key events may have modified the keys
+	kdnssec_cache_invalidate(cache);
+
 	return result;
 }
 
 int knot_dnssec_sign_changeset(const zone_contents_t *zone,
                                const changeset_t *in_ch,
                                changeset_t *out_ch,
-                               uint32_t *refresh_at)
+                               uint32_t *refresh_at,
+                               kdnssec_cache_t *cache)
 {
 	if (zone == NULL || in_ch == NULL || out_ch == NULL || refresh_at == NULL) {
 		return KNOT_EINVAL;
@@ -238,42 +252,54 @@ int knot_dnssec_sign_changeset(const zone_contents_t *zone,
 
 	int result = KNOT_ERROR;
 	const knot_dname_t *zone_name = zone->apex->owner;
-	kdnssec_ctx_t ctx = { 0 };
-	zone_keyset_t keyset = { 0 };
+	kdnssec_ctx_t local_ctx = { 0 };
+	zone_keyset_t local_keyset = { 0 };
+	kdnssec_ctx_t *ctx = &local_ctx;
+	zone_keyset_t *keyset = &local_keyset;
 
 	// signing pipeline
 
-	result = sign_init(zone, ZONE_SIGN_KEEP_SOA_SERIAL, &ctx);
-	if (result != KNOT_EOK) {
-		log_zone_error(zone_name, "DNSSEC, failed to initialize (%s)",
-		               knot_strerror(result));
-		goto done;
-	}
+	if (cache != NULL) {
+		result = kdnssec_cache_get(cache, zone_name, &ctx, &keyset);
+		if (result != KNOT_EOK) {
+			log_zone_error(zone_name, "DNSSEC, failed to load keys (%s)",
+			               knot_strerror(result));
+			return KNOT_EOK;
+		}
+		sign_init_params(zone, ZONE_SIGN_KEEP_SOA_SERIAL, ctx);
+	} else {
+		result = sign_init(zone, ZONE_SIGN_KEEP_SOA_SERIAL, ctx);
+		if (result != KNOT_EOK) {
+			log_zone_error(zone_name, "DNSSEC, failed to initialize (%s)",
+			               knot_strerror(result));
+			goto done;
+		}
 
-	result = load_zone_keys(ctx.zone, ctx.keystore,
-	                        ctx.policy->nsec3_enabled, ctx.now, &keyset);
-	if (result != KNOT_EOK) {
-		log_zone_error(zone_name, "DNSSEC, failed to load keys (%s)",
-		               knot_strerror(result));
-		goto done;
+		result = load_zone_keys(ctx->zone, ctx->keystore,
+		                        ctx->policy->nsec3_enabled, ctx->now, keyset);
+		if (result != KNOT_EOK) {
+			log_zone_error(zone_name, "DNSSEC, failed to load keys (%s)",
+			               knot_strerror(result));
+			goto done;
+		}
 	}
 
-	result = knot_zone_sign_changeset(zone, in_ch, out_ch, &keyset, &ctx);
+	result = knot_zone_sign_changeset(zone, in_ch, out_ch, keyset, ctx);
 	if (result != KNOT_EOK) {
 		log_zone_error(zone_name, "DNSSEC, failed to sign changeset (%s)",
 		               knot_strerror(result));
 		goto done;
 	}
 
-	result = knot_zone_create_nsec_chain(zone, out_ch, &keyset, &ctx);
+	result = knot_zone_fix_nsec_chain(zone, in_ch, out_ch, keyset, ctx);
 	if (result != KNOT_EOK) {
-		log_zone_error(zone_name, "DNSSEC, failed to create NSEC%s chain (%s)",
-		               ctx.policy->nsec3_enabled ? "3" : "",
+		log_zone_error(zone_name, "DNSSEC, failed to fix NSEC%s chain (%s)",
+		               ctx->policy->nsec3_enabled ? "3" : "",
 		               knot_strerror(result));
 		goto done;
 	}
 
-	result = knot_zone_sign_nsecs_in_changeset(&keyset, &ctx, out_ch);
+	result = knot_zone_sign_nsecs_in_changeset(keyset, ctx, out_ch);
 	if (result != KNOT_EOK) {
 		log_zone_error(zone_name, "DNSSEC, failed to sign changeset (%s)",
 		               knot_strerror(result));
@@ -282,7 +308,7 @@ int knot_dnssec_sign_changeset(const zone_contents_t *zone,
 
 	// update SOA
 
-	result = sign_update_soa(zone, out_ch, &ctx, &keyset);
+	result = sign_update_soa(zone, out_ch, ctx, keyset);
 	if (result != KNOT_EOK) {
 		log_zone_error(zone_name, "DNSSEC, failed to update SOA record (%s)",
 		               knot_strerror(result));
@@ -291,12 +317,16 @@ int knot_dnssec_sign_changeset(const zone_contents_t *zone,
 
 	// schedule next resigning (only new signatures are made)
 
-	*refresh_at = ctx.now + ctx.policy->rrsig_lifetime - ctx.policy->rrsig_refresh_before;
+	*refresh_at = ctx->now + ctx->policy->rrsig_lifetime - ctx->policy->rrsig_refresh_before;
 	assert(refresh_at > 0);
 
 done:
-	free_zone_keys(&keyset);
-	kdnssec_ctx_deinit(&ctx);
+	if (cache != NULL) {
+		kdnssec_cache_release(cache, result != KNOT_EOK);
+	} else {
+		free_zone_keys(keyset);
+		kdnssec_ctx_deinit(ctx);
+	}
 
 	return KNOT_EOK;
 }
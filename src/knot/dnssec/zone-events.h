@@ -30,6 +30,7 @@
 
 #include "knot/zone/zone.h"
 #include "knot/updates/changesets.h"
+#include "knot/dnssec/key-cache.h"
 
 enum zone_sign_flags {
 	ZONE_SIGN_NONE = 0,
@@ -47,11 +48,13 @@ typedef enum zone_sign_flags zone_sign_flags_t;
  * \param out_ch       New records will be added to this changeset.
  * \param flags        Zone signing flags.
  * \param refresh_at   Signature refresh time of the oldest signature in zone.
+ * \param cache        Zone signing cache to be invalidated (can be NULL).
  *
  * \return Error code, KNOT_EOK if successful.
  */
 int knot_dnssec_zone_sign(zone_contents_t *zone, changeset_t *out_ch,
-                          zone_sign_flags_t flags, uint32_t *refresh_at);
+                          zone_sign_flags_t flags, uint32_t *refresh_at,
+                          kdnssec_cache_t *cache);
 
 /*!
  * \brief Sign changeset created by DDNS or zone-diff.
@@ -60,12 +63,14 @@ int knot_dnssec_zone_sign(zone_contents_t *zone, changeset_t *out_ch,
  * \param in_ch           Changeset created bvy DDNS or zone-diff
  * \param out_ch          New records will be added to this changeset.
  * \param refresh_at      Signature refresh time of the new signatures.
+ * \param cache           Zone signing cache (can be NULL).
  *
  * \return Error code, KNOT_EOK if successful.
  */
 int knot_dnssec_sign_changeset(const zone_contents_t *zone,
                                const changeset_t *in_ch,
                                changeset_t *out_ch,
-                               uint32_t *refresh_at);
+                               uint32_t *refresh_at,
+                               kdnssec_cache_t *cache);
 
 /*! @} */
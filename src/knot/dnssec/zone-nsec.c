@@ -406,3 +406,93 @@ int knot_zone_create_nsec_chain(const zone_contents_t *zone,
 	// Sign newly created records right away.
 	return knot_zone_sign_nsecs_in_changeset(zone_keys, ctx, changeset);
 }
+
+/*!
+ * \brief Check if the current chain can be repaired after the update.
+ *
+ * Delegation changes and changes of the records maintained by the signing
+ * require a full chain recreation.
+ */
+static bool nsec_chain_fixable(const zone_contents_t *zone,
+                               const changeset_t *update,
+                               const dnssec_nsec3_params_t *params)
+{
+	bool apex_nsec = node_rrtype_exists(zone->apex, KNOT_RRTYPE_NSEC);
+	knot_rdataset_t *nsec3param = node_rdataset(zone->apex, KNOT_RRTYPE_NSEC3PARAM);
+
+	if (params->algorithm != 0) {
+		if (apex_nsec || nsec3param == NULL ||
+		    !nsec3param_valid(nsec3param, params) ||
+		    zone_tree_is_empty(zone->nsec3_nodes)) {
+			return false;
+		}
+	} else {
+		if (!apex_nsec || nsec3param != NULL ||
+		    !zone_tree_is_empty(zone->nsec3_nodes)) {
+			return false;
+		}
+	}
+
+	changeset_iter_t itt;
+	if (changeset_iter_all(&itt, update, false) != KNOT_EOK) {
+		return false;
+	}
+
+	bool fixable = true;
+	knot_rrset_t rr = changeset_iter_next(&itt);
+	while (fixable && !knot_rrset_empty(&rr)) {
+		switch (rr.type) {
+		case KNOT_RRTYPE_NS:
+			fixable = knot_dname_is_equal(rr.owner, zone->apex->owner);
+			break;
+		case KNOT_RRTYPE_DNSKEY:
+		case KNOT_RRTYPE_NSEC:
+		case KNOT_RRTYPE_NSEC3:
+		case KNOT_RRTYPE_NSEC3PARAM:
+			fixable = false;
+			break;
+		default:
+			break;
+		}
+		rr = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+
+	return fixable;
+}
+
+int knot_zone_fix_nsec_chain(const zone_contents_t *zone,
+                             const changeset_t *update,
+                             changeset_t *changeset,
+                             const zone_keyset_t *zone_keys,
+                             const kdnssec_ctx_t *ctx)
+{
+	if (zone == NULL || update == NULL || changeset == NULL || ctx == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	const knot_rdataset_t *soa = node_rdataset(zone->apex, KNOT_RRTYPE_SOA);
+	if (soa == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	uint32_t nsec_ttl = knot_soa_minimum(soa);
+	dnssec_nsec3_params_t params = nsec3param_init(ctx->policy, ctx->zone);
+
+	if (!nsec_chain_fixable(zone, update, &params)) {
+		return knot_zone_create_nsec_chain(zone, changeset, zone_keys, ctx);
+	}
+
+	int ret = KNOT_EOK;
+	if (ctx->policy->nsec3_enabled) {
+		ret = knot_nsec3_fix_chain(zone, update, &params, nsec_ttl, changeset);
+	} else {
+		ret = knot_nsec_fix_chain(zone, update, nsec_ttl, changeset);
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	// Sign newly created records right away.
+	return knot_zone_sign_nsecs_in_changeset(zone_keys, ctx, changeset);
+}
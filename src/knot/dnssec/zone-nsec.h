@@ -80,4 +80,25 @@ int knot_zone_create_nsec_chain(const zone_contents_t *zone,
                                 const zone_keyset_t *zone_keys,
                                 const kdnssec_ctx_t *dnssec_ctx);
 
+/*!
+ * \brief Fix NSEC or NSEC3 chain in the zone after an update.
+ *
+ * Only the records around the changed names are recreated. The whole chain
+ * is recreated if the update changes delegations or DNSSEC records, or if
+ * the current chain doesn't match the policy.
+ *
+ * \param zone        Updated zone.
+ * \param update      Changes applied to the zone.
+ * \param changeset   Changeset into which the changes will be added.
+ * \param zone_keys   Zone keys used for NSEC(3) creation.
+ * \param dnssec_ctx  DNSSEC signing context.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_zone_fix_nsec_chain(const zone_contents_t *zone,
+                             const changeset_t *update,
+                             changeset_t *changeset,
+                             const zone_keyset_t *zone_keys,
+                             const kdnssec_ctx_t *dnssec_ctx);
+
 /*! @} */
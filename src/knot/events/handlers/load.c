@@ -74,6 +74,7 @@ int event_load(conf_t *conf, zone_t *zone)
 	}
 
 	/* Everything went alright, switch the contents. */
+	zone_replicate_contents(conf, zone, contents);
 	zone->flags &= ~ZONE_EXPIRED;
 	zone->zonefile.exists = true;
 	zone_contents_t *old = zone_switch_contents(zone, contents);
@@ -14,10 +14,9 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "knot/query/requestor.h"
+#include "knot/query/forward.h"
 #include "knot/common/log.h"
 #include "knot/modules/dnsproxy.h"
-#include "knot/query/capture.h"
 #include "knot/nameserver/process_query.h"
 #include "contrib/mempattern.h"
 #include "contrib/net.h"
@@ -49,50 +48,84 @@ int check_mod_dnsproxy(conf_check_t *args)
 struct dnsproxy {
 	conf_remote_t remote;
 	bool catch_nxdomain;
+	knot_forwarder_t *fwd;
 };
 
+/*! \brief Put the deferred upstream response into the answer. */
+static int dnsproxy_finish(knot_pkt_t *pkt, struct query_data *qdata,
+                           query_defer_t *deferred)
+{
+	deferred->owner = NULL;
+
+	if (deferred->data == NULL) {
+		qdata->rcode = KNOT_RCODE_SERVFAIL;
+		return KNOT_STATE_FAIL; /* Forwarding failed, SERVFAIL. */
+	}
+
+	int ret = KNOT_ENOMEM;
+	knot_pkt_t *resp = knot_pkt_new(deferred->data, deferred->data_len, &pkt->mm);
+	if (resp != NULL) {
+		ret = knot_pkt_copy(pkt, resp);
+		knot_pkt_free(&resp);
+	}
+	if (ret != KNOT_EOK) {
+		qdata->rcode = KNOT_RCODE_SERVFAIL;
+		return KNOT_STATE_FAIL;
+	}
+
+	return KNOT_STATE_DONE;
+}
+
 static int dnsproxy_fwd(int state, knot_pkt_t *pkt, struct query_data *qdata, void *ctx)
 {
 	if (pkt == NULL || qdata == NULL || ctx == NULL) {
 		return KNOT_STATE_FAIL;
 	}
 
-	/* Forward only queries ending with REFUSED (no zone) or NXDOMAIN (if configured) */
+	/* Finish the answer deferred by this instance. */
 	struct dnsproxy *proxy = ctx;
-	if (!(qdata->rcode == KNOT_RCODE_REFUSED ||
-	     (qdata->rcode == KNOT_RCODE_NXDOMAIN && proxy->catch_nxdomain))) {
-		return state;
+	query_defer_t *deferred = qdata->param->deferred;
+	if (deferred != NULL) {
+		if (deferred->owner != proxy->fwd) {
+			return state;
+		}
+		return dnsproxy_finish(pkt, qdata, deferred);
 	}
 
-	/* Capture layer context. */
-	const knot_layer_api_t *capture = query_capture_api();
-	struct capture_param capture_param = {
-		.sink = pkt
-	};
-
-	/* Create a forwarding request. */
-	struct knot_requestor re;
-	int ret = knot_requestor_init(&re, capture, &capture_param, qdata->mm);
-	if (ret != KNOT_EOK) {
-		return state; /* Ignore, not enough memory. */
+	/* Already deferred by another instance. */
+	if (qdata->flags & QUERY_DEFERRED) {
+		return state;
 	}
 
-	bool is_tcp = net_is_stream(qdata->param->socket);
-	const struct sockaddr *dst = (const struct sockaddr *)&proxy->remote.addr;
-	const struct sockaddr *src = (const struct sockaddr *)&proxy->remote.via;
-	struct knot_request *req = knot_request_make(re.mm, dst, src, qdata->query,
-	                                             is_tcp ? 0 : KNOT_RQ_UDP);
-	if (req == NULL) {
-		knot_requestor_clear(&re);
-		return state; /* Ignore, not enough memory. */
+	/* Forward only queries ending with REFUSED (no zone) or NXDOMAIN (if configured) */
+	if (!(qdata->rcode == KNOT_RCODE_REFUSED ||
+	     (qdata->rcode == KNOT_RCODE_NXDOMAIN && proxy->catch_nxdomain))) {
+		return state;
 	}
 
-	/* Forward request. */
+	/* Forward request, in-line if the answer can't be deferred. */
 	int timeout = 1000 * conf()->cache.srv_tcp_reply_timeout;
-	ret = knot_requestor_exec(&re, req, timeout);
-
-	knot_request_free(req, re.mm);
-	knot_requestor_clear(&re);
+	int ret;
+	if (net_is_stream(qdata->param->socket) || qdata->param->defer == NULL) {
+		ret = knot_forwarder_tcp(proxy->fwd, qdata->query, pkt, timeout);
+	} else {
+		/* The upstream response is put into the answer once received. */
+		query_defer_t *defer = query_defer_new(qdata->param->defer, proxy->fwd,
+		                                       qdata->query, qdata->param->socket,
+		                                       qdata->param->remote);
+		if (defer == NULL) {
+			qdata->rcode = KNOT_RCODE_SERVFAIL;
+			return KNOT_STATE_FAIL;
+		}
+		defer->query_flags = qdata->flags;
+		ret = knot_forwarder_udp(proxy->fwd, qdata->query, defer, timeout);
+		if (ret == KNOT_EOK) {
+			qdata->flags |= QUERY_DEFERRED;
+			pkt->size = 0;
+			return KNOT_STATE_NOOP;
+		}
+		query_defer_free(defer);
+	}
 
 	/* Check result. */
 	if (ret != KNOT_EOK) {
@@ -122,6 +155,13 @@ int dnsproxy_load(struct query_plan *plan, struct query_module *self,
 	val = conf_mod_get(self->config, MOD_CATCH_NXDOMAIN, self->id);
 	proxy->catch_nxdomain = conf_bool(&val);
 
+	proxy->fwd = knot_forwarder_new((struct sockaddr *)&proxy->remote.addr,
+	                                (struct sockaddr *)&proxy->remote.via);
+	if (proxy->fwd == NULL) {
+		mm_free(self->mm, proxy);
+		return KNOT_ENOMEM;
+	}
+
 	self->ctx = proxy;
 
 	return query_plan_step(plan, QPLAN_END, dnsproxy_fwd, self->ctx);
@@ -133,6 +173,8 @@ int dnsproxy_unload(struct query_module *self)
 		return KNOT_EINVAL;
 	}
 
-	mm_free(self->mm, self->ctx);
+	struct dnsproxy *proxy = self->ctx;
+	knot_forwarder_free(proxy->fwd);
+	mm_free(self->mm, proxy);
 	return KNOT_EOK;
 }
@@ -15,13 +15,14 @@
  */
 
 #include <sys/stat.h>
+#include <time.h>
 
 #include "knot/common/log.h"
 #include "knot/modules/dnstap.h"
 #include "knot/nameserver/process_query.h"
 #include "contrib/dnstap/dnstap.pb-c.h"
 #include "contrib/dnstap/writer.h"
-#include "contrib/dnstap/message.h"
+#include "contrib/dnstap/encoder.h"
 #include "contrib/dnstap/dnstap.h"
 #include "contrib/mempattern.h"
 #include "libknot/libknot.h"
@@ -30,13 +31,19 @@
 #define MOD_SINK	"\x04""sink"
 #define MOD_IDENTITY	"\x08""identity"
 #define MOD_VERSION	"\x07""version"
+#define MOD_QUERIES	"\x0B""log-queries"
+#define MOD_RESPONSES	"\x0D""log-responses"
+#define MOD_SAMPLE	"\x0B""sample-rate"
 
 const yp_item_t scheme_mod_dnstap[] = {
-	{ C_ID,         YP_TSTR, YP_VNONE },
-	{ MOD_SINK,     YP_TSTR, YP_VNONE },
-	{ MOD_IDENTITY, YP_TSTR, YP_VNONE },
-	{ MOD_VERSION,  YP_TSTR, YP_VSTR = { "Knot DNS " PACKAGE_VERSION } },
-	{ C_COMMENT,    YP_TSTR, YP_VNONE },
+	{ C_ID,          YP_TSTR,  YP_VNONE },
+	{ MOD_SINK,      YP_TSTR,  YP_VNONE },
+	{ MOD_IDENTITY,  YP_TSTR,  YP_VNONE },
+	{ MOD_VERSION,   YP_TSTR,  YP_VSTR = { "Knot DNS " PACKAGE_VERSION } },
+	{ MOD_QUERIES,   YP_TBOOL, YP_VBOOL = { true } },
+	{ MOD_RESPONSES, YP_TBOOL, YP_VBOOL = { true } },
+	{ MOD_SAMPLE,    YP_TINT,  YP_VINT = { 1, UINT32_MAX, 1 } },
+	{ C_COMMENT,     YP_TSTR,  YP_VNONE },
 	{ NULL }
 };
 
@@ -49,32 +56,86 @@ int check_mod_dnstap(conf_check_t *args)
 		return KNOT_EINVAL;
 	}
 
+	conf_val_t queries = conf_rawid_get_txn(args->conf, args->txn, C_MOD_DNSTAP,
+	                                        MOD_QUERIES, args->id, args->id_len);
+	conf_val_t responses = conf_rawid_get_txn(args->conf, args->txn, C_MOD_DNSTAP,
+	                                          MOD_RESPONSES, args->id, args->id_len);
+	if (!conf_bool(&queries) && !conf_bool(&responses)) {
+		args->err_str = "neither queries nor responses are logged";
+		return KNOT_EINVAL;
+	}
+
 	return KNOT_EOK;
 }
 
+/*! \brief Frame arena slot size, fits most of the messages. */
+#define FRAME_SIZE	4096
+/*! \brief Number of frame arena slots per worker. */
+#define FRAME_COUNT	64
+
+/*! \brief Frame arena slot, released by the I/O thread once written. */
+typedef struct {
+	int busy;
+	uint8_t data[FRAME_SIZE];
+} frame_t;
+
+/*! \brief Per-worker logging state, accessed only from the worker thread. */
+typedef struct {
+	struct fstrm_iothr_queue *ioq;
+	frame_t *frames;
+	unsigned next_frame;
+	uint32_t sample_count;
+	struct timespec time;   /*!< Current query time. */
+} dnstap_thread_t;
+
 typedef struct {
 	struct fstrm_iothr *iothread;
 	char *identity;
 	size_t identity_len;
 	char *version;
 	size_t version_len;
+	bool log_queries;
+	bool log_responses;
+	uint32_t sample_rate;
+	dnstap_thread_t *threads;
+	size_t thread_count;
 } dnstap_ctx_t;
 
-static int log_message(int state, const knot_pkt_t *pkt, struct query_data *qdata,
-                       dnstap_ctx_t *ctx)
+static frame_t *frame_acquire(dnstap_thread_t *thr)
 {
-	if (pkt == NULL || qdata == NULL || ctx == NULL) {
-		return KNOT_STATE_FAIL;
+	for (unsigned i = 0; i < FRAME_COUNT; i++) {
+		frame_t *frame = &thr->frames[thr->next_frame];
+		thr->next_frame = (thr->next_frame + 1) % FRAME_COUNT;
+		if (__sync_bool_compare_and_swap(&frame->busy, 0, 1)) {
+			return frame;
+		}
 	}
 
-	int ret = KNOT_ERROR;
-	struct fstrm_iothr_queue *ioq =
-		fstrm_iothr_get_input_queue_idx(ctx->iothread, qdata->param->thread_id);
+	return NULL;
+}
 
-	/* Unless we want to measure the time it takes to process each query,
-	 * we can treat Q/R times the same. */
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
+/*! \brief Frame release callback, called from the I/O thread. */
+static void frame_release(void *buf, void *frame)
+{
+	__sync_lock_release(&((frame_t *)frame)->busy);
+}
+
+/*! \brief Get the current time, coarse precision is sufficient. */
+static void clock_now(struct timespec *time)
+{
+#ifdef CLOCK_REALTIME_COARSE
+	clock_gettime(CLOCK_REALTIME_COARSE, time);
+#else
+	clock_gettime(CLOCK_REALTIME, time);
+#endif
+}
+
+static int log_message(int state, const knot_pkt_t *pkt, struct query_data *qdata,
+                       dnstap_ctx_t *ctx, dnstap_thread_t *thr)
+{
+	if (pkt == NULL) {
+		return KNOT_STATE_FAIL;
+	}
 
 	/* Determine query / response. */
 	Dnstap__Message__Type msgtype = DNSTAP__MESSAGE__TYPE__AUTH_QUERY;
@@ -88,67 +149,167 @@ static int log_message(int state, const knot_pkt_t *pkt, struct query_data *qdat
 		protocol = IPPROTO_UDP;
 	}
 
-	/* Create a dnstap message. */
-	Dnstap__Message msg;
-	ret = dt_message_fill(&msg, msgtype,
-	                      (const struct sockaddr *)qdata->param->remote,
-	                      NULL, /* todo: fill me! */
-	                      protocol,
-	                      pkt->wire, pkt->size, &tv, &tv);
-	if (ret != KNOT_EOK) {
-		return KNOT_STATE_FAIL;
-	}
-	Dnstap__Dnstap dnstap = DNSTAP__DNSTAP__INIT;
-	dnstap.type = DNSTAP__DNSTAP__TYPE__MESSAGE;
-	dnstap.message = (Dnstap__Message *)&msg;
-
-	/* Set message version and identity. */
-	if (ctx->identity_len > 0) {
-		dnstap.identity.data = (uint8_t *)ctx->identity;
-		dnstap.identity.len = ctx->identity_len;
-		dnstap.has_identity = 1;
-	}
-	if (ctx->version_len > 0) {
-		dnstap.version.data = (uint8_t *)ctx->version;
-		dnstap.version.len = ctx->version_len;
-		dnstap.has_version = 1;
+	/* Unless we want to measure the time it takes to process each query,
+	 * we can treat Q/R times the same. */
+	dt_encode_msg_t msg = {
+		.identity = (uint8_t *)ctx->identity,
+		.identity_len = ctx->identity_len,
+		.version = (uint8_t *)ctx->version,
+		.version_len = ctx->version_len,
+		.type = msgtype,
+		.query_sa = (const struct sockaddr *)qdata->param->remote,
+		.response_sa = NULL, /* todo: fill me! */
+		.protocol = protocol,
+		.wire = pkt->wire,
+		.wire_len = pkt->size,
+		.qtime = &thr->time,
+		.rtime = &thr->time
+	};
+
+	/* Encode into a frame from the arena, allocate only large frames. */
+	size_t size = dt_encode_size(&msg);
+	frame_t *frame = (size <= FRAME_SIZE) ? frame_acquire(thr) : NULL;
+	uint8_t *buf = NULL;
+	void (*free_cb)(void *, void *) = NULL;
+	if (frame != NULL) {
+		buf = frame->data;
+		free_cb = frame_release;
+	} else {
+		buf = malloc(size);
+		if (buf == NULL) {
+			return KNOT_STATE_FAIL;
+		}
+		free_cb = fstrm_free_wrapper;
 	}
 
-	/* Pack the message. */
-	uint8_t *frame = NULL;
-	size_t size = 0;
-	dt_pack(&dnstap, &frame, &size);
-	if (frame == NULL) {
-		return KNOT_STATE_FAIL;
-	}
+	dt_encode(&msg, buf, size);
 
 	/* Submit a request. */
-	fstrm_res res = fstrm_iothr_submit(ctx->iothread, ioq, frame, size,
-	                                   fstrm_free_wrapper, NULL);
+	fstrm_res res = fstrm_iothr_submit(ctx->iothread, thr->ioq, buf, size,
+	                                   free_cb, frame);
 	if (res != fstrm_res_success) {
-		free(frame);
+		free_cb(buf, frame);
 		state = KNOT_STATE_FAIL;
 	}
 
 	return state;
 }
 
+static dnstap_thread_t *get_thread(dnstap_ctx_t *ctx, struct query_data *qdata)
+{
+	unsigned thread_id = qdata->param->thread_id;
+	return (thread_id < ctx->thread_count) ? &ctx->threads[thread_id] : NULL;
+}
+
+/*!
+ * \brief Decide on logging of the query and its response, log the query.
+ *
+ * The decision is kept in the query flags, so it holds for all messages of
+ * the answer, including the deferred one.
+ */
+static int sample_query(int state, struct query_data *qdata, dnstap_ctx_t *ctx,
+                        dnstap_thread_t *thr)
+{
+	if (qdata->flags & QUERY_LOG_DECIDED) {
+		return state;
+	}
+	qdata->flags |= QUERY_LOG_DECIDED;
+
+	thr->sample_count += 1;
+	if (thr->sample_count < ctx->sample_rate) {
+		return state;
+	}
+	thr->sample_count = 0;
+	qdata->flags |= QUERY_LOG;
+	clock_now(&thr->time);
+
+	if (!ctx->log_queries) {
+		return state;
+	}
+
+	return log_message(state, qdata->query, qdata, ctx, thr);
+}
+
 /*! \brief Submit message - query. */
 static int dnstap_message_log_query(int state, knot_pkt_t *pkt, struct query_data *qdata,
                                     void *ctx)
 {
-	if (qdata == NULL) {
+	if (qdata == NULL || ctx == NULL) {
 		return KNOT_STATE_FAIL;
 	}
 
-	return log_message(state, qdata->query, qdata, ctx);
+	dnstap_ctx_t *dnstap = ctx;
+	dnstap_thread_t *thr = get_thread(dnstap, qdata);
+	if (thr == NULL) {
+		return state;
+	}
+
+	return sample_query(state, qdata, dnstap, thr);
 }
 
 /*! \brief Submit message - response. */
 static int dnstap_message_log_response(int state, knot_pkt_t *pkt, struct query_data *qdata,
                                        void *ctx)
 {
-	return log_message(state, pkt, qdata, ctx);
+	if (qdata == NULL || ctx == NULL) {
+		return KNOT_STATE_FAIL;
+	}
+
+	dnstap_ctx_t *dnstap = ctx;
+	dnstap_thread_t *thr = get_thread(dnstap, qdata);
+	if (thr == NULL) {
+		return state;
+	}
+
+	/* The query step is skipped for early limited or malformed queries. */
+	(void)sample_query(state, qdata, dnstap, thr);
+	if (!(qdata->flags & QUERY_LOG)) {
+		return state;
+	}
+
+	/* No response is sent now (deferred or dropped). */
+	if (state == KNOT_STATE_NOOP || pkt->size == 0) {
+		return state;
+	}
+	if (qdata->param->deferred != NULL) {
+		clock_now(&thr->time);
+	}
+
+	return log_message(state, pkt, qdata, dnstap, thr);
+}
+
+static void threads_free(dnstap_ctx_t *ctx)
+{
+	if (ctx->threads == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < ctx->thread_count; i++) {
+		free(ctx->threads[i].frames);
+	}
+	free(ctx->threads);
+	ctx->threads = NULL;
+}
+
+static int threads_init(dnstap_ctx_t *ctx, size_t count)
+{
+	ctx->threads = calloc(count, sizeof(dnstap_thread_t));
+	if (ctx->threads == NULL) {
+		return KNOT_ENOMEM;
+	}
+	ctx->thread_count = count;
+
+	for (size_t i = 0; i < count; i++) {
+		dnstap_thread_t *thr = &ctx->threads[i];
+		thr->ioq = fstrm_iothr_get_input_queue_idx(ctx->iothread, i);
+		thr->frames = calloc(FRAME_COUNT, sizeof(frame_t));
+		if (thr->ioq == NULL || thr->frames == NULL) {
+			threads_free(ctx);
+			return KNOT_ENOMEM;
+		}
+	}
+
+	return KNOT_EOK;
 }
 
 /*! \brief Create a UNIX socket sink. */
@@ -231,6 +392,7 @@ int dnstap_load(struct query_plan *plan, struct query_module *self,
 	if (ctx == NULL) {
 		return KNOT_ENOMEM;
 	}
+	memset(ctx, 0, sizeof(*ctx));
 
 	conf_val_t val;
 
@@ -248,6 +410,14 @@ int dnstap_load(struct query_plan *plan, struct query_module *self,
 	ctx->version = strdup(conf_str(&val));
 	ctx->version_len = strlen(ctx->version);
 
+	// Set logging scope.
+	val = conf_mod_get(self->config, MOD_QUERIES, self->id);
+	ctx->log_queries = conf_bool(&val);
+	val = conf_mod_get(self->config, MOD_RESPONSES, self->id);
+	ctx->log_responses = conf_bool(&val);
+	val = conf_mod_get(self->config, MOD_SAMPLE, self->id);
+	ctx->sample_rate = conf_int(&val);
+
 	val = conf_mod_get(self->config, MOD_SINK, self->id);
 	const char *sink = conf_str(&val);
 
@@ -276,11 +446,19 @@ int dnstap_load(struct query_plan *plan, struct query_module *self,
 		goto fail;
 	}
 
+	/* Initialize per-worker state. */
+	if (threads_init(ctx, qcount) != KNOT_EOK) {
+		fstrm_iothr_destroy(&ctx->iothread);
+		goto fail;
+	}
+
 	self->ctx = ctx;
 
-	/* Hook to the query plan. */
+	/* Hook to the query plan, the response step samples the queries it missed. */
 	query_plan_step(plan, QPLAN_BEGIN, dnstap_message_log_query, self->ctx);
-	query_plan_step(plan, QPLAN_END, dnstap_message_log_response, self->ctx);
+	if (ctx->log_responses) {
+		query_plan_step(plan, QPLAN_END, dnstap_message_log_response, self->ctx);
+	}
 
 	return KNOT_EOK;
 fail:
@@ -301,7 +479,9 @@ int dnstap_unload(struct query_module *self)
 
 	dnstap_ctx_t *ctx = self->ctx;
 
+	/* Pending frames are released while the I/O thread terminates. */
 	fstrm_iothr_destroy(&ctx->iothread);
+	threads_free(ctx);
 	free(ctx->identity);
 	free(ctx->version);
 	mm_free(self->mm, ctx);
@@ -169,8 +169,8 @@ static dnssec_nsec_bitmap_t *synth_bitmap(knot_pkt_t *pkt, const struct query_da
 
 	uint16_t qtype = knot_pkt_qtype(qdata->query);
 	bool is_apex = qdata->zone
-	               && qdata->zone->contents
-	               && qdata->node == qdata->zone->contents->apex;
+	               && qdata->contents
+	               && qdata->node == qdata->contents->apex;
 
 	bitmap_add_synth(map, is_apex);
 
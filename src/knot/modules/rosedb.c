@@ -14,6 +14,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <assert.h>
 #include <lmdb.h>
 
 #include "dnssec/random.h"
@@ -21,6 +22,7 @@
 #include "knot/modules/rosedb.h"
 #include "knot/nameserver/process_query.h"
 #include "libknot/libknot.h"
+#include "contrib/macros.h"
 #include "contrib/mempattern.h"
 #include "contrib/net.h"
 #include "contrib/wire.h"
@@ -54,12 +56,32 @@ int check_mod_rosedb(conf_check_t *args)
  */
 
 #define LMDB_MAPSIZE (100 * 1024 * 1024)
+#define LMDB_MAXREADERS 1024
+
+/*! \brief Database format version, increased on incompatible key changes. */
+#define FORMAT_VERSION 2
+
+/*!
+ * \brief Format version key.
+ *
+ * The empty first label makes it an invalid name key, which sorts after the
+ * root key and before the other ones, so it's never a suffix of a name.
+ */
+static const uint8_t VERSION_KEY[] = "\0\0version";
+
+/*! \brief Worker read transaction, reset between queries and renewed. */
+struct reader {
+	MDB_txn *txn;
+	MDB_cursor *cur;
+};
 
 struct cache
 {
 	MDB_dbi dbi;
 	MDB_env *env;
 	knot_mm_t *pool;
+	struct reader *readers;
+	size_t reader_count;
 };
 
 struct rdentry {
@@ -101,7 +123,14 @@ static int dbase_open(struct cache *cache, const char *handle)
 		return ret;
 	}
 
-	ret = mdb_env_open(cache->env, handle, 0, 0644);
+	ret = mdb_env_set_maxreaders(cache->env, LMDB_MAXREADERS);
+	if (ret != 0) {
+		mdb_env_close(cache->env);
+		return ret;
+	}
+
+	/* Read transactions are bound to workers, not to threads. */
+	ret = mdb_env_open(cache->env, handle, MDB_NOTLS, 0644);
 	if (ret != 0) {
 		mdb_env_close(cache->env);
 		return ret;
@@ -155,6 +184,57 @@ static void cursor_release(MDB_cursor *cursor)
 	mdb_cursor_close(cursor);
 }
 
+static struct reader *reader_begin(struct cache *cache, unsigned thread_id)
+{
+	if (thread_id >= cache->reader_count) {
+		return NULL;
+	}
+
+	struct reader *reader = &cache->readers[thread_id];
+	if (reader->txn == NULL) {
+		if (mdb_txn_begin(cache->env, NULL, MDB_RDONLY, &reader->txn) != 0) {
+			reader->txn = NULL;
+			return NULL;
+		}
+		if (mdb_cursor_open(reader->txn, cache->dbi, &reader->cur) != 0) {
+			mdb_txn_abort(reader->txn);
+			reader->txn = NULL;
+			return NULL;
+		}
+	} else {
+		if (mdb_txn_renew(reader->txn) != 0) {
+			return NULL;
+		}
+		if (mdb_cursor_renew(reader->txn, reader->cur) != 0) {
+			mdb_txn_reset(reader->txn);
+			return NULL;
+		}
+	}
+
+	return reader;
+}
+
+static void reader_end(struct reader *reader)
+{
+	/* Release the snapshot, keep the transaction handle. */
+	mdb_txn_reset(reader->txn);
+}
+
+static void readers_free(struct cache *cache)
+{
+	for (size_t i = 0; i < cache->reader_count; i++) {
+		struct reader *reader = &cache->readers[i];
+		if (reader->txn != NULL) {
+			mdb_cursor_close(reader->cur);
+			mdb_txn_abort(reader->txn);
+		}
+	}
+
+	mm_free(cache->pool, cache->readers);
+	cache->readers = NULL;
+	cache->reader_count = 0;
+}
+
 /*                       data serialization                                   */
 
 #define ENTRY_MAXLEN 65535
@@ -186,12 +266,106 @@ static inline void *unpack_bin(char **stream, uint32_t *len) {
 	return ret;
 }
 
-static MDB_val pack_key(const knot_dname_t *name)
+/*!
+ * \brief Convert the name to a database key.
+ *
+ * The key is the lookup format of the name (lowercase labels from the rightmost
+ * one, each terminated by a zero byte) prefixed with a zero byte, so that
+ * the key of any suffix of the name is a prefix of the name key.
+ *
+ * \param buf   Key storage of at least KNOT_DNAME_MAXLEN bytes.
+ * \param name  Uncompressed name.
+ */
+static MDB_val pack_key(uint8_t *buf, const knot_dname_t *name)
+{
+	MDB_val key = { 0, buf };
+	if (knot_dname_lf(buf, name, NULL) == KNOT_EOK) {
+		/* The root name has a special single-label lookup format. */
+		key.mv_size = (*name == '\0') ? 1 : buf[0] + 1;
+		buf[0] = '\0';
+	}
+
+	return key;
+}
+
+static int unpack_key(const MDB_val *key, knot_dname_t *name)
+{
+	const uint8_t *data = key->mv_data;
+	if (key->mv_size < 1 || key->mv_size > KNOT_DNAME_MAXLEN || data[0] != '\0') {
+		return KNOT_EMALF;
+	}
+
+	/* Key and wire format are of the same size, fill it from the end. */
+	uint8_t *pos = name + key->mv_size;
+	*--pos = '\0';
+	size_t begin = 1;
+	for (size_t i = 1; i < key->mv_size; i++) {
+		if (data[i] != '\0') {
+			continue;
+		}
+		size_t label_len = i - begin;
+		if (label_len == 0 || label_len > KNOT_DNAME_MAXLABELLEN) {
+			return KNOT_EMALF;
+		}
+		pos -= label_len;
+		memcpy(pos, data + begin, label_len);
+		*--pos = label_len;
+		begin = i + 1;
+	}
+
+	return (pos == name) ? KNOT_EOK : KNOT_EMALF;
+}
+
+static MDB_val version_key(void)
 {
-	MDB_val key = { knot_dname_size(name), (void *)name };
+	MDB_val key = { sizeof(VERSION_KEY) - 1, (void *)VERSION_KEY };
 	return key;
 }
 
+static bool is_version_key(const MDB_val *key)
+{
+	return key->mv_size == sizeof(VERSION_KEY) - 1 &&
+	       memcmp(key->mv_data, VERSION_KEY, key->mv_size) == 0;
+}
+
+/*!
+ * \brief Check the database format version.
+ *
+ * \retval KNOT_EOK      Current format.
+ * \retval KNOT_ENOENT   Empty database without the version.
+ * \retval KNOT_ENOTSUP  Old or unknown format.
+ */
+static int cache_check_version(MDB_txn *txn, MDB_dbi dbi)
+{
+	MDB_val key = version_key();
+	MDB_val data;
+	int ret = mdb_get(txn, dbi, &key, &data);
+	if (ret == MDB_NOTFOUND) {
+		MDB_stat stat;
+		if (mdb_stat(txn, dbi, &stat) != 0) {
+			return KNOT_ERROR;
+		}
+		return (stat.ms_entries == 0) ? KNOT_ENOENT : KNOT_ENOTSUP;
+	} else if (ret != 0) {
+		return KNOT_ERROR;
+	}
+
+	if (data.mv_size != 1 || *(uint8_t *)data.mv_data != FORMAT_VERSION) {
+		return KNOT_ENOTSUP;
+	}
+
+	return KNOT_EOK;
+}
+
+static int cache_set_version(MDB_txn *txn, MDB_dbi dbi)
+{
+	MDB_val key = version_key();
+	uint8_t version = FORMAT_VERSION;
+	MDB_val data = { sizeof(version), &version };
+
+	return (mdb_put(txn, dbi, &key, &data, 0) == 0) ? KNOT_EOK : KNOT_ERROR;
+}
+
 static int pack_entry(MDB_val *data, struct entry *entry)
 {
 	char *stream = data->mv_data;
@@ -264,13 +438,15 @@ void cache_close(struct cache *cache)
 		return;
 	}
 
+	readers_free(cache);
 	dbase_close(cache);
 	mm_free(cache->pool, cache);
 }
 
 static int cache_iter_begin(struct iter *it, const knot_dname_t *name)
 {
-	it->key = pack_key(name);
+	uint8_t buf[KNOT_DNAME_MAXLEN];
+	it->key = pack_key(buf, name);
 	it->val.mv_data = NULL;
 	it->val.mv_size = 0;
 
@@ -282,6 +458,11 @@ static int cache_iter_next(struct iter *it)
 	return mdb_cursor_get(it->cur, &it->key, &it->val, MDB_NEXT_DUP);
 }
 
+static int cache_iter_rewind(struct iter *it)
+{
+	return mdb_cursor_get(it->cur, &it->key, &it->val, MDB_FIRST_DUP);
+}
+
 static int cache_iter_val(struct iter *it, struct entry *entry)
 {
 	return unpack_entry(&it->val, entry);
@@ -309,6 +490,63 @@ int cache_query_fetch(MDB_txn *txn, MDB_dbi dbi, struct iter *it, const knot_dna
 	return KNOT_EOK;
 }
 
+/*! \brief Get the length of the common key prefix ending at a label boundary. */
+static size_t key_common_len(const MDB_val *a, const MDB_val *b)
+{
+	const uint8_t *a_data = a->mv_data;
+	const uint8_t *b_data = b->mv_data;
+	size_t len = MIN(a->mv_size, b->mv_size);
+
+	size_t common = 0;
+	for (size_t i = 0; i < len && a_data[i] == b_data[i]; i++) {
+		if (a_data[i] == '\0') {
+			common = i + 1;
+		}
+	}
+
+	return common;
+}
+
+/*!
+ * \brief Position the iterator at the longest stored suffix of the name.
+ *
+ * All stored suffixes of the name sort before the name key. The cursor is
+ * moved to the name key or to the closest preceding key. If that isn't
+ * a suffix of the name, the search repeats with the common suffix of both,
+ * which is strictly shorter, so a miss takes just a few cursor moves.
+ */
+int cache_query_suffix(struct iter *it, const knot_dname_t *name)
+{
+	uint8_t buf[KNOT_DNAME_MAXLEN];
+	MDB_val target = pack_key(buf, name);
+	if (target.mv_size == 0) {
+		return KNOT_EINVAL;
+	}
+
+	while (true) {
+		it->key = target;
+		int ret = mdb_cursor_get(it->cur, &it->key, &it->val, MDB_SET_RANGE);
+		if (ret == 0 && it->key.mv_size == target.mv_size &&
+		    memcmp(it->key.mv_data, target.mv_data, target.mv_size) == 0) {
+			return KNOT_EOK;
+		}
+
+		/* Closest preceding key (the last one if none follows). */
+		ret = mdb_cursor_get(it->cur, &it->key, &it->val,
+		                     (ret == 0) ? MDB_PREV_NODUP : MDB_LAST);
+		if (ret != 0) {
+			return KNOT_ENOENT;
+		}
+
+		size_t common = key_common_len(&it->key, &target);
+		if (common == it->key.mv_size) {
+			return (cache_iter_rewind(it) == 0) ? KNOT_EOK : KNOT_ENOENT;
+		}
+		assert(common < target.mv_size);
+		target.mv_size = common;
+	}
+}
+
 int cache_insert(MDB_txn *txn, MDB_dbi dbi, const knot_dname_t *name, struct entry *entry)
 {
 	MDB_cursor *cursor = cursor_acquire(txn, dbi);
@@ -316,7 +554,8 @@ int cache_insert(MDB_txn *txn, MDB_dbi dbi, const knot_dname_t *name, struct ent
 		return KNOT_ERROR;
 	}
 
-	MDB_val key = pack_key(name);
+	uint8_t buf[KNOT_DNAME_MAXLEN];
+	MDB_val key = pack_key(buf, name);
 	MDB_val data = { 0, malloc(ENTRY_MAXLEN) };
 
 	int ret = pack_entry(&data, entry);
@@ -506,8 +745,7 @@ static int rosedb_synth_rr(knot_pkt_t *pkt, struct entry *entry, uint16_t qtype)
 	return ret;
 }
 
-static int rosedb_synth(knot_pkt_t *pkt, const knot_dname_t *key, struct iter *it,
-                        struct query_data *qdata)
+static int rosedb_synth(knot_pkt_t *pkt, struct iter *it, struct query_data *qdata)
 {
 	struct entry entry;
 	int ret = KNOT_EOK;
@@ -527,7 +765,7 @@ static int rosedb_synth(knot_pkt_t *pkt, const knot_dname_t *key, struct iter *i
 	knot_pkt_begin(pkt, KNOT_AUTHORITY);
 
 	/* Not found (zone cut if records exist). */
-	ret = cache_iter_begin(it, key);
+	ret = cache_iter_rewind(it);
 	while (ret == KNOT_EOK) {
 		if (cache_iter_val(it, &entry) == 0) {
 			ret = rosedb_synth_rr(pkt, &entry, KNOT_RRTYPE_NS);
@@ -560,32 +798,18 @@ static int rosedb_synth(knot_pkt_t *pkt, const knot_dname_t *key, struct iter *i
 	return ret;
 }
 
-static int rosedb_query_txn(MDB_txn *txn, MDB_dbi dbi, knot_pkt_t *pkt, struct query_data *qdata)
+static int rosedb_query_txn(MDB_cursor *cur, knot_pkt_t *pkt, struct query_data *qdata)
 {
-	struct iter it;
-	int ret = KNOT_EOK;
-
-	/* Find suffix for QNAME. */
-	const knot_dname_t *qname = knot_pkt_qname(qdata->query);
-	const knot_dname_t *key = qname;
-	while (key) {
-		ret = cache_query_fetch(txn, dbi, &it, key);
-		if (ret == 0) { /* Found */
-			break;
-		}
+	struct iter it = { cur };
 
-		if (*key == '\0') { /* Last label, not found. */
-			return KNOT_ENOENT;
-		}
-
-		key = knot_wire_next_label(key, qdata->query->wire);
+	/* Find the longest suffix of QNAME. */
+	int ret = cache_query_suffix(&it, knot_pkt_qname(qdata->query));
+	if (ret != KNOT_EOK) {
+		return ret;
 	}
 
 	/* Synthetize record to response. */
-	ret = rosedb_synth(pkt, key, &it, qdata);
-
-	cache_iter_free(&it);
-	return ret;
+	return rosedb_synth(pkt, &it, qdata);
 }
 
 static int rosedb_query(int state, knot_pkt_t *pkt, struct query_data *qdata, void *ctx)
@@ -596,19 +820,33 @@ static int rosedb_query(int state, knot_pkt_t *pkt, struct query_data *qdata, vo
 
 	struct cache *cache = ctx;
 
-	MDB_txn *txn = NULL;
-	int ret = mdb_txn_begin(cache->env, NULL, MDB_RDONLY, &txn);
-	if (ret != 0) { /* Can't start transaction, ignore. */
-		return state;
+	/* Use the worker transaction, or a temporary one for unknown workers. */
+	struct reader tmp = { NULL };
+	struct reader *reader = reader_begin(cache, qdata->param->thread_id);
+	if (reader == NULL) {
+		if (mdb_txn_begin(cache->env, NULL, MDB_RDONLY, &tmp.txn) != 0) {
+			return state; /* Can't start transaction, ignore. */
+		}
+		tmp.cur = cursor_acquire(tmp.txn, cache->dbi);
+		if (tmp.cur == NULL) {
+			mdb_txn_abort(tmp.txn);
+			return state;
+		}
+		reader = &tmp;
 	}
 
-	ret = rosedb_query_txn(txn, cache->dbi, pkt, qdata);
-	if (ret != 0) { /* Can't find matching zone, ignore. */
-		mdb_txn_abort(txn);
-		return state;
+	int ret = rosedb_query_txn(reader->cur, pkt, qdata);
+
+	if (reader == &tmp) {
+		cursor_release(tmp.cur);
+		mdb_txn_abort(tmp.txn);
+	} else {
+		reader_end(reader);
 	}
 
-	mdb_txn_abort(txn);
+	if (ret != KNOT_EOK) { /* Can't find matching zone, ignore. */
+		return state;
+	}
 
 	return KNOT_STATE_DONE;
 }
@@ -627,6 +865,36 @@ int rosedb_load(struct query_plan *plan, struct query_module *self,
 		return KNOT_ENOMEM;
 	}
 
+	/* Lookups in a database of another format would silently miss. */
+	MDB_txn *txn = NULL;
+	int ret = mdb_txn_begin(cache->env, NULL, MDB_RDONLY, &txn);
+	if (ret == 0) {
+		ret = cache_check_version(txn, cache->dbi);
+		mdb_txn_abort(txn);
+	} else {
+		ret = KNOT_ERROR;
+	}
+	if (ret == KNOT_ENOTSUP) {
+		MODULE_ERR(C_MOD_ROSEDB, "unsupported format of db '%s', "
+		           "recreate it with rosedb_tool", conf_str(&val));
+		cache_close(cache);
+		return ret;
+	} else if (ret != KNOT_EOK && ret != KNOT_ENOENT) {
+		MODULE_ERR(C_MOD_ROSEDB, "failed to read db '%s'", conf_str(&val));
+		cache_close(cache);
+		return ret;
+	}
+
+	/* Worker identifiers cover both UDP and TCP handlers. */
+	size_t count = conf_udp_threads(self->config) + conf_tcp_threads(self->config);
+	cache->readers = mm_alloc(self->mm, count * sizeof(struct reader));
+	if (cache->readers == NULL) {
+		cache_close(cache);
+		return KNOT_ENOMEM;
+	}
+	memset(cache->readers, 0, count * sizeof(struct reader));
+	cache->reader_count = count;
+
 	self->ctx = cache;
 
 	return query_plan_step(plan, QPLAN_BEGIN, rosedb_query, self->ctx);
@@ -135,12 +135,28 @@ int main(int argc, char *argv[])
 			found = true;
 
 			MDB_txn *txn = NULL;
-			int ret = mdb_txn_begin(cache->env, NULL, 0, &txn);
+			ret = mdb_txn_begin(cache->env, NULL, 0, &txn);
 			if (ret != MDB_SUCCESS) {
 				fprintf(stderr, "failed to open transaction, aborting\n");
 				break;
 			}
 
+			/* Check the format, an empty database gets the current one. */
+			ret = cache_check_version(txn, cache->dbi);
+			if (ret == KNOT_ENOENT) {
+				ret = cache_set_version(txn, cache->dbi);
+			}
+			if (ret == KNOT_ENOTSUP) {
+				fprintf(stderr, "unsupported database format, "
+				        "it needs to be recreated\n");
+				mdb_txn_abort(txn);
+				break;
+			} else if (ret != KNOT_EOK) {
+				fprintf(stderr, "failed to read database, aborting\n");
+				mdb_txn_abort(txn);
+				break;
+			}
+
 			/* Execute operation handler. */
 			ret = ta->func(cache, txn, argc, argv);
 			if (ret != 0) {
@@ -163,7 +179,7 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	return ret;
+	return (ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 static int parse_rdata(struct entry *entry, const char *owner, const char *rrtype, const char *rdata,
@@ -262,14 +278,23 @@ static int rosedb_list(struct cache *cache, MDB_txn *txn, int argc, char *argv[]
 {
 	MDB_cursor *cursor = cursor_acquire(txn, cache->dbi);
 	MDB_val key, data;
-	char dname_str[KNOT_DNAME_MAXLEN] = {'\0'};
+	knot_dname_t dname[KNOT_DNAME_MAXLEN];
+	char dname_str[KNOT_DNAME_TXT_MAXLEN + 1] = {'\0'};
 	char type_str[16] = { '\0' };
 
 	int ret = mdb_cursor_get(cursor, &key, &data, MDB_FIRST);
 	while (ret == 0) {
+		if (is_version_key(&key)) {
+			ret = mdb_cursor_get(cursor, &key, &data, MDB_NEXT);
+			continue;
+		}
 		struct entry entry;
 		unpack_entry(&data, &entry);
-		knot_dname_to_str(dname_str, key.mv_data, sizeof(dname_str));
+		if (unpack_key(&key, dname) != KNOT_EOK) {
+			fprintf(stderr, "malformed key, database needs to be rebuilt\n");
+			break;
+		}
+		knot_dname_to_str(dname_str, dname, sizeof(dname_str));
 		knot_rrtype_to_string(entry.data.type, type_str, sizeof(type_str));
 		printf("%s\t%s RDATA=%zuB\t%s\t%s\n", dname_str, type_str,
 		       knot_rdataset_size(&entry.data.rrs), entry.threat_code, entry.syslog_ip);
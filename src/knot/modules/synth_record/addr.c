@@ -0,0 +1,292 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "knot/modules/synth_record/addr.h"
+#include "libknot/consts.h"
+#include "libknot/errcode.h"
+#include "libknot/packet/wire.h"
+#include "contrib/tolower.h"
+
+#define ARPA_ZONE_LABELS 2
+#define IPV4_ADDR_LABELS 4
+#define IPV6_ADDR_LABELS 32
+#define IPV4_ADDR_LEN 4
+
+/* Longest address text is the expanded IPv6 (8 groups, 7 separators). */
+#define ADDR_TXTLEN 39
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/*! \brief Return hexadecimal digit value or -1. */
+static int hex_value(uint8_t c)
+{
+	if (c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	c = knot_tolower(c);
+	if (c >= 'a' && c <= 'f') {
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+/*!
+ * \brief Parse decimal address byte without leading zeros.
+ *
+ * \return Number of consumed characters or 0 on error.
+ */
+static size_t parse_dec_byte(const uint8_t *str, size_t len, uint8_t *out)
+{
+	unsigned value = 0;
+	size_t i = 0;
+	for (; i < len && i < 3 && str[i] >= '0' && str[i] <= '9'; i++) {
+		if (i > 0 && value == 0) {
+			return 0; /* Leading zero. */
+		}
+		value = value * 10 + (str[i] - '0');
+	}
+	if (i == 0 || value > UINT8_MAX) {
+		return 0;
+	}
+
+	*out = value;
+	return i;
+}
+
+/*! \brief Write decimal address byte. */
+static uint8_t *write_dec_byte(uint8_t *dst, uint8_t value)
+{
+	if (value >= 100) {
+		*dst++ = '0' + value / 100;
+	}
+	if (value >= 10) {
+		*dst++ = '0' + (value / 10) % 10;
+	}
+	*dst++ = '0' + value % 10;
+	return dst;
+}
+
+/*! \brief Parse dash-separated IPv4 address (f.e. 192-0-2-1). */
+static bool parse_dashed_ipv4(const uint8_t *str, size_t len, uint8_t *addr)
+{
+	const uint8_t *end = str + len;
+	for (int i = 0; i < IPV4_ADDR_LEN; i++) {
+		if (i > 0) {
+			if (str == end || *str != '-') {
+				return false;
+			}
+			str++;
+		}
+		size_t used = parse_dec_byte(str, end - str, &addr[i]);
+		if (used == 0) {
+			return false;
+		}
+		str += used;
+	}
+
+	return str == end;
+}
+
+/*! \brief Parse dash-separated IPv6 address (f.e. 2001-db8--1). */
+static bool parse_dashed_ipv6(const uint8_t *str, size_t len, uint8_t *addr)
+{
+	const uint8_t *end = str + len;
+	int gap = -1;
+	int groups = 0;
+
+	memset(addr, 0, SYNTH_ADDR_MAXLEN);
+
+	/* Leading compression must be a double dash. */
+	if (str < end && *str == '-') {
+		if (end - str < 2 || str[1] != '-') {
+			return false;
+		}
+		gap = 0;
+		str += 2;
+	}
+
+	while (str < end) {
+		if (groups == 8) {
+			return false;
+		}
+
+		/* Read up to 4 hexadecimal digits. */
+		unsigned value = 0;
+		int digits = 0;
+		int digit;
+		while (str < end && digits < 4 && (digit = hex_value(*str)) >= 0) {
+			value = (value << 4) | digit;
+			digits++;
+			str++;
+		}
+		if (digits == 0) {
+			return false;
+		}
+		addr[2 * groups] = value >> 8;
+		addr[2 * groups + 1] = value & 0xff;
+		groups++;
+
+		if (str == end) {
+			break;
+		}
+		if (*str++ != '-') {
+			return false;
+		}
+		if (str < end && *str == '-') {
+			if (gap >= 0) {
+				return false; /* Multiple compressions. */
+			}
+			gap = groups;
+			str++;
+		} else if (str == end) {
+			return false; /* Trailing single dash. */
+		}
+	}
+
+	if (gap < 0) {
+		return groups == 8;
+	}
+	if (groups == 8) {
+		return false; /* Nothing to compress. */
+	}
+
+	/* Move the groups after the compression to the end. */
+	int tail = groups - gap;
+	memmove(addr + SYNTH_ADDR_MAXLEN - 2 * tail, addr + 2 * gap, 2 * tail);
+	memset(addr + 2 * gap, 0, SYNTH_ADDR_MAXLEN - 2 * groups);
+
+	return true;
+}
+
+int synth_addr_forward(const uint8_t *label, const char *prefix, size_t prefix_len,
+                       bool ipv4, bool ipv6, synth_addr_t *out)
+{
+	/* Mismatch if label shorter/equal than prefix or prefix differs. */
+	if (label == NULL || out == NULL || label[0] <= prefix_len) {
+		return KNOT_EINVAL;
+	}
+	for (size_t i = 0; i < prefix_len; i++) {
+		if (knot_tolower(label[1 + i]) != knot_tolower(prefix[i])) {
+			return KNOT_EINVAL;
+		}
+	}
+
+	const uint8_t *addr = label + 1 + prefix_len;
+	size_t addr_len = label[0] - prefix_len;
+
+	if (ipv4 && parse_dashed_ipv4(addr, addr_len, out->addr)) {
+		out->family = AF_INET;
+		return KNOT_EOK;
+	}
+	if (ipv6 && parse_dashed_ipv6(addr, addr_len, out->addr)) {
+		out->family = AF_INET6;
+		return KNOT_EOK;
+	}
+
+	return KNOT_EINVAL;
+}
+
+int synth_addr_reverse(const knot_dname_t *name, const uint8_t *wire,
+                       synth_addr_t *out)
+{
+	/* Name required format is [address].[in-addr|ip6].arpa
+	 * f.e.  [1.0...0].[h.g.f.e.0.0.0.0.d.c.b.a].ip6.arpa represents
+	 *       [abcd:0:efgh::1] */
+	if (name == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	/* Collect address labels, the least significant part first. */
+	const uint8_t *labels[IPV6_ADDR_LABELS];
+	int label_count = knot_dname_labels(name, wire) - ARPA_ZONE_LABELS;
+	if (label_count != IPV4_ADDR_LABELS && label_count != IPV6_ADDR_LABELS) {
+		return KNOT_EINVAL;
+	}
+	const knot_dname_t *label = name;
+	for (int i = 0; i < label_count; i++) {
+		labels[i] = label;
+		label = knot_wire_next_label(label, wire);
+	}
+
+	if (label_count == IPV4_ADDR_LABELS) {
+		out->family = AF_INET;
+		for (int i = 0; i < IPV4_ADDR_LABELS; i++) {
+			label = labels[IPV4_ADDR_LABELS - 1 - i];
+			if (parse_dec_byte(label + 1, label[0], &out->addr[i]) != label[0]) {
+				return KNOT_EINVAL;
+			}
+		}
+	} else {
+		out->family = AF_INET6;
+		for (int i = 0; i < IPV6_ADDR_LABELS; i++) {
+			label = labels[IPV6_ADDR_LABELS - 1 - i];
+			int nibble = (label[0] == 1) ? hex_value(label[1]) : -1;
+			if (nibble < 0) {
+				return KNOT_EINVAL;
+			}
+			if (i % 2 == 0) {
+				out->addr[i / 2] = nibble << 4;
+			} else {
+				out->addr[i / 2] |= nibble;
+			}
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+int synth_addr_label(const synth_addr_t *addr, const char *prefix,
+                     size_t prefix_len, uint8_t *label)
+{
+	if (addr == NULL || label == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	/* Write address with parts separated by '-'. */
+	uint8_t text[ADDR_TXTLEN];
+	uint8_t *dst = text;
+	if (addr->family == AF_INET) {
+		for (int i = 0; i < IPV4_ADDR_LEN; i++) {
+			if (i > 0) {
+				*dst++ = '-';
+			}
+			dst = write_dec_byte(dst, addr->addr[i]);
+		}
+	} else {
+		for (int i = 0; i < SYNTH_ADDR_MAXLEN; i++) {
+			if (i > 0 && i % 2 == 0) {
+				*dst++ = '-';
+			}
+			*dst++ = hex_digits[addr->addr[i] >> 4];
+			*dst++ = hex_digits[addr->addr[i] & 0x0f];
+		}
+	}
+
+	size_t text_len = dst - text;
+	if (prefix_len + text_len > KNOT_DNAME_MAXLABELLEN) {
+		return KNOT_ESPACE;
+	}
+
+	label[0] = prefix_len + text_len;
+	memcpy(label + 1, prefix, prefix_len);
+	memcpy(label + 1 + prefix_len, text, text_len);
+
+	return KNOT_EOK;
+}
@@ -0,0 +1,74 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libknot/dname.h"
+
+/*! \brief Maximum binary address length. */
+#define SYNTH_ADDR_MAXLEN 16
+
+/*! \brief Address parsed from a query name. */
+typedef struct {
+	int family;
+	uint8_t addr[SYNTH_ADDR_MAXLEN];
+} synth_addr_t;
+
+/*!
+ * \brief Parse the address from a forward name label ([prefix][address]).
+ *
+ * The address parts are separated by dashes, f.e. 192-0-2-1 or 2001-db8--1.
+ *
+ * \param label       Label in wire format (length byte first).
+ * \param prefix      Expected label prefix (compared case-insensitively).
+ * \param prefix_len  Prefix length.
+ * \param ipv4        Accept IPv4 addresses.
+ * \param ipv6        Accept IPv6 addresses.
+ * \param out         Parsed address.
+ *
+ * \return KNOT_EOK if parsed, KNOT_EINVAL otherwise.
+ */
+int synth_addr_forward(const uint8_t *label, const char *prefix, size_t prefix_len,
+                       bool ipv4, bool ipv6, synth_addr_t *out);
+
+/*!
+ * \brief Parse the address from a reverse name (in-addr.arpa or ip6.arpa).
+ *
+ * \param name  Reverse name, possibly compressed.
+ * \param wire  Packet wire the name is in (NULL if not compressed).
+ * \param out   Parsed address.
+ *
+ * \return KNOT_EOK if parsed, KNOT_EINVAL otherwise.
+ */
+int synth_addr_reverse(const knot_dname_t *name, const uint8_t *wire,
+                       synth_addr_t *out);
+
+/*!
+ * \brief Write the forward name label [prefix][address] in wire format.
+ *
+ * \param addr        Address.
+ * \param prefix      Label prefix.
+ * \param prefix_len  Prefix length.
+ * \param label       Output buffer of at least 1 + KNOT_DNAME_MAXLABELLEN bytes.
+ *
+ * \return KNOT_EOK, KNOT_ESPACE if the label would be too long.
+ */
+int synth_addr_label(const synth_addr_t *addr, const char *prefix,
+                     size_t prefix_len, uint8_t *label);
@@ -14,13 +14,16 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include "knot/modules/synth_record.h"
+#include <stdlib.h>
+
+#include "knot/modules/synth_record/addr.h"
+#include "knot/modules/synth_record/module.h"
 #include "knot/nameserver/process_query.h"
 #include "knot/nameserver/internet.h"
 #include "knot/common/log.h"
 #include "libknot/descriptor.h"
+#include "contrib/addr_ranges.h"
 #include "contrib/mempattern.h"
-#include "contrib/net.h"
 #include "contrib/sockaddr.h"
 
 /* Module configuration scheme. */
@@ -98,42 +101,26 @@ int check_mod_synth_record(conf_check_t *args)
 	return KNOT_EOK;
 }
 
-/* Defines. */
-#define ARPA_ZONE_LABELS 2
-
 /*!
  * \brief Synthetic response template.
+ *
+ * All configured networks are compiled into address ranges
+ * and the origin is stored in wire format during the module load,
+ * so that no conversions through strings are needed at query time.
  */
 typedef struct synth_template {
-	node_t node;
 	enum synth_template_type type;
 	char *prefix;
-	char *zone;
+	size_t prefix_len;
+	knot_dname_t *zone;
+	size_t zone_size;
 	uint32_t ttl;
-	struct sockaddr_storage addr;
-	struct sockaddr_storage addr_max;
-	int mask;
+	addr_ranges_t *ranges;
+	uint8_t *rdata;          /*!< Answer RDATA buffers, one per worker. */
+	size_t rdata_size;       /*!< Size of a buffer. */
+	size_t rdata_count;      /*!< Number of the buffers. */
 } synth_template_t;
 
-/*! \brief Substitute all occurrences of given character. */
-static void str_subst(char *str, size_t len, char from, char to)
-{
-	for (int i = 0; i < len; ++i) {
-		if (str[i] == from) {
-			str[i] = to;
-		}
-	}
-}
-
-/*! \brief Separator character for address family. */
-static char str_separator(int addr_family)
-{
-	if (addr_family == AF_INET6) {
-		return ':';
-	}
-	return '.';
-}
-
 /*! \brief Return true if query type is satisfied with provided address family. */
 static bool query_satisfied_by_family(uint16_t qtype, int family)
 {
@@ -145,73 +132,7 @@ static bool query_satisfied_by_family(uint16_t qtype, int family)
 	}
 }
 
-/*! \brief Parse address from reverse query QNAME and return address family. */
-static int reverse_addr_parse(struct query_data *qdata, synth_template_t *tpl, char *addr_str)
-{
-	/* QNAME required format is [address].[subnet/zone]
-	 * f.e.  [1.0...0].[h.g.f.e.0.0.0.0.d.c.b.a.ip6.arpa] represents
-	 *       [abcd:0:efgh::1] */
-	const knot_dname_t* label = qdata->name;
-	const uint8_t *query_wire = qdata->query->wire;
-
-	/* Push labels on stack for reverse walkthrough. */
-	const uint8_t* label_stack[KNOT_DNAME_MAXLABELS];
-	const uint8_t** sp = label_stack;
-	int label_count = knot_dname_labels(label, query_wire);
-	while(label_count > ARPA_ZONE_LABELS) {
-		*sp++ = label;
-		label = knot_wire_next_label(label, query_wire);
-		--label_count;
-	}
-
-	/* Write formatted address string. */
-	char sep = str_separator(tpl->addr.ss_family);
-	int sep_frequency = 1;
-	if (sep == ':') {
-		sep_frequency = 4; /* Separator per 4 hexdigits. */
-	}
-
-	char *dst = addr_str;
-	label_count = 0;
-	while(sp != label_stack) {
-		label = *--sp;
-		/* Write separator for each Nth label. */
-		if (label_count == sep_frequency) {
-			*dst = sep;
-			dst += 1;
-			label_count = 0;
-		}
-		/* Write label */
-		memcpy(dst, label + 1, label[0]);
-		dst += label[0];
-		label_count += 1;
-	}
-
-	return KNOT_EOK;
-}
-
-static int forward_addr_parse(struct query_data *qdata, synth_template_t *tpl, char *addr_str)
-{
-	/* Find prefix label count (additive to prefix length). */
-	const knot_dname_t *addr_label = qdata->name;
-
-	/* Mismatch if label shorter/equal than prefix. */
-	int prefix_len = strlen(tpl->prefix);
-	if (addr_label == NULL || addr_label[0] <= prefix_len) {
-		return KNOT_EINVAL;
-	}
-
-	int addr_len = *addr_label - prefix_len;
-	memcpy(addr_str, addr_label + 1 + prefix_len, addr_len);
-
-	/* Restore correct address format. */
-	char sep = str_separator(tpl->addr.ss_family);
-	str_subst(addr_str, addr_len, '-', sep);
-
-	return KNOT_EOK;
-}
-
-static int addr_parse(struct query_data *qdata, synth_template_t *tpl, char *addr_str)
+static int addr_parse(struct query_data *qdata, synth_template_t *tpl, synth_addr_t *out)
 {
 	/* Check if we have at least 1 label below zone. */
 	int zone_labels = knot_dname_labels(qdata->zone->name, NULL);
@@ -221,142 +142,119 @@ static int addr_parse(struct query_data *qdata, synth_template_t *tpl, char *add
 	}
 
 	switch (tpl->type) {
-	case SYNTH_REVERSE: return reverse_addr_parse(qdata, tpl, addr_str);
-	case SYNTH_FORWARD: return forward_addr_parse(qdata, tpl, addr_str);
-	default:            return KNOT_EINVAL;
+	case SYNTH_REVERSE:
+		return synth_addr_reverse(qdata->name, qdata->query->wire, out);
+	case SYNTH_FORWARD:
+		return synth_addr_forward(qdata->name, tpl->prefix, tpl->prefix_len,
+		                          tpl->ranges->ipv4.count > 0,
+		                          tpl->ranges->ipv6.count > 0, out);
+	default:
+		return KNOT_EINVAL;
 	}
 }
 
-static knot_dname_t *synth_ptrname(const char *addr_str, synth_template_t *tpl)
+static bool template_addr_match(synth_template_t *tpl, const synth_addr_t *addr)
 {
-	/* PTR right-hand value is [prefix][address][zone] */
-	char ptrname[KNOT_DNAME_MAXLEN] = {'\0'};
-	int prefix_len = strlen(tpl->prefix);
-	int addr_len = strlen(addr_str);
-	int zone_len = strlen(tpl->zone);
-
-	/* Check required space (zone requires extra leading dot). */
-	if (prefix_len + addr_len + zone_len + 1 >= KNOT_DNAME_MAXLEN) {
-		return NULL;
-	}
-
-	/* Write prefix string. */
-	memcpy(ptrname, tpl->prefix, prefix_len);
-	int written = prefix_len;
-
-	/* Write address with substituted separator to '-'. */
-	char sep = str_separator(tpl->addr.ss_family);
-	memcpy(ptrname + written, addr_str, addr_len);
-	str_subst(ptrname + written, addr_len, sep, '-');
-	written += addr_len;
-
-	/* Write zone name. */
-	ptrname[written] = '.';
-	written += 1;
-	memcpy(ptrname + written, tpl->zone, zone_len);
-
-	/* Convert to domain name. */
-	return knot_dname_from_str_alloc(ptrname);
+	return addr_ranges_match_raw(tpl->ranges, addr->family, addr->addr);
 }
 
-static int reverse_rr(char *addr_str, synth_template_t *tpl, knot_pkt_t *pkt, knot_rrset_t *rr)
+/*! \brief Write PTR target [prefix][address].[zone] in wire format. */
+static int synth_ptrname(const synth_addr_t *addr, synth_template_t *tpl,
+                         uint8_t *out, size_t *out_size)
 {
-	/* Synthetize PTR record data. */
-	knot_dname_t *ptrname = synth_ptrname(addr_str, tpl);
-	if (ptrname == NULL) {
-		return KNOT_ENOMEM;
+	uint8_t label[1 + KNOT_DNAME_MAXLABELLEN];
+	int ret = synth_addr_label(addr, tpl->prefix, tpl->prefix_len, label);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	size_t label_size = 1 + label[0];
+	if (label_size + tpl->zone_size > KNOT_DNAME_MAXLEN) {
+		return KNOT_ESPACE;
 	}
 
-	rr->type = KNOT_RRTYPE_PTR;
-	knot_rrset_add_rdata(rr, ptrname, knot_dname_size(ptrname), tpl->ttl, &pkt->mm);
-	knot_dname_free(&ptrname, NULL);
+	/* Append zone name. */
+	memcpy(out, label, label_size);
+	memcpy(out + label_size, tpl->zone, tpl->zone_size);
+	*out_size = label_size + tpl->zone_size;
 
 	return KNOT_EOK;
 }
 
-static int forward_rr(char *addr_str, synth_template_t *tpl, knot_pkt_t *pkt, knot_rrset_t *rr)
+/*!
+ * \brief Synthesize the answer record.
+ *
+ * Nothing is allocated, the owner is the current name and the RDATA is
+ * written into the buffer of the worker. The buffer is reused by the next
+ * answer of the worker, when the packet with this one is already written.
+ */
+static int synth_rr(const synth_addr_t *addr, synth_template_t *tpl,
+                    struct query_data *qdata, knot_rrset_t *rr)
 {
-	struct sockaddr_storage query_addr = {'\0'};
-	sockaddr_set(&query_addr, tpl->addr.ss_family, addr_str, 0);
-
-	/* Specify address type and data. */
-	if (tpl->addr.ss_family == AF_INET6) {
-		rr->type = KNOT_RRTYPE_AAAA;
-		const struct sockaddr_in6* ip = (const struct sockaddr_in6*)&query_addr;
-		knot_rrset_add_rdata(rr, (const uint8_t *)&ip->sin6_addr, sizeof(struct in6_addr),
-		                  tpl->ttl, &pkt->mm);
-	} else if (tpl->addr.ss_family == AF_INET) {
-		rr->type = KNOT_RRTYPE_A;
-		const struct sockaddr_in* ip = (const struct sockaddr_in*)&query_addr;
-		knot_rrset_add_rdata(rr, (const uint8_t *)&ip->sin_addr, sizeof(struct in_addr),
-		                  tpl->ttl, &pkt->mm);
-	} else {
+	unsigned thread_id = qdata->param->thread_id;
+	if (thread_id >= tpl->rdata_count) {
 		return KNOT_EINVAL;
 	}
+	knot_rdata_t *buf = tpl->rdata + thread_id * tpl->rdata_size;
 
-	return KNOT_EOK;
-}
-
-static knot_rrset_t *synth_rr(char *addr_str, synth_template_t *tpl, knot_pkt_t *pkt, struct query_data *qdata)
-{
-	knot_rrset_t *rr = knot_rrset_new(qdata->name, 0, KNOT_CLASS_IN,
-	                                  &pkt->mm);
-	if (rr == NULL) {
-		return NULL;
-	}
+	uint8_t *rdata = knot_rdata_data(buf);
+	size_t rdata_len = 0;
+	uint16_t type = 0;
+	int ret;
 
 	/* Fill in the specific data. */
-	int ret = KNOT_ERROR;
 	switch (tpl->type) {
-	case SYNTH_REVERSE: ret = reverse_rr(addr_str, tpl, pkt, rr); break;
-	case SYNTH_FORWARD: ret = forward_rr(addr_str, tpl, pkt, rr); break;
-	default: break;
+	case SYNTH_REVERSE:
+		type = KNOT_RRTYPE_PTR;
+		ret = synth_ptrname(addr, tpl, rdata, &rdata_len);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		break;
+	case SYNTH_FORWARD:
+		if (addr->family == AF_INET6) {
+			type = KNOT_RRTYPE_AAAA;
+			rdata_len = sizeof(struct in6_addr);
+		} else {
+			type = KNOT_RRTYPE_A;
+			rdata_len = sizeof(struct in_addr);
+		}
+		memcpy(rdata, addr->addr, rdata_len);
+		break;
+	default:
+		return KNOT_EINVAL;
 	}
 
-	if (ret != KNOT_EOK) {
-		knot_rrset_free(&rr, &pkt->mm);
-		return NULL;
-	}
+	knot_rdata_set_rdlen(buf, rdata_len);
+	knot_rdata_set_ttl(buf, tpl->ttl);
+
+	knot_rrset_init(rr, (knot_dname_t *)qdata->name, type, KNOT_CLASS_IN);
+	rr->rrs.rr_count = 1;
+	rr->rrs.data = buf;
 
-	return rr;
+	return KNOT_EOK;
 }
 
 /*! \brief Check if query fits the template requirements. */
 static int template_match(int state, synth_template_t *tpl, knot_pkt_t *pkt, struct query_data *qdata)
 {
 	/* Parse address from query name. */
-	char addr_str[SOCKADDR_STRLEN] = { '\0' };
-	int ret = addr_parse(qdata, tpl, addr_str);
+	synth_addr_t addr;
+	int ret = addr_parse(qdata, tpl, &addr);
 	if (ret != KNOT_EOK) {
 		return state; /* Can't identify addr in QNAME, not applicable. */
 	}
 
-	/* Match against template netblock. */
-	struct sockaddr_storage query_addr = { '\0' };
-	int provided_af = tpl->addr.ss_family;
-	ret = sockaddr_set(&query_addr, provided_af, addr_str, 0);
-	if (ret != KNOT_EOK) {
-		return state;
-	}
-	if (tpl->addr_max.ss_family == AF_UNSPEC) {
-		if (!sockaddr_net_match((struct sockaddr *)&query_addr,
-		                        (struct sockaddr *)&tpl->addr,
-		                        tpl->mask)) {
-			return state; /* Out of our netblock, not applicable. */
-		}
-	} else {
-		if (!sockaddr_range_match((struct sockaddr *)&query_addr,
-		                          (struct sockaddr *)&tpl->addr,
-		                          (struct sockaddr *)&tpl->addr_max)) {
-			return state; /* Out of our netblock, not applicable. */
-		}
+	/* Match against template netblocks. */
+	if (!template_addr_match(tpl, &addr)) {
+		return state; /* Out of our netblocks, not applicable. */
 	}
 
 	/* Check if the request is for an available query type. */
 	uint16_t qtype = knot_pkt_qtype(qdata->query);
 	switch (tpl->type) {
 	case SYNTH_FORWARD:
-		if (!query_satisfied_by_family(qtype, provided_af)) {
+		if (!query_satisfied_by_family(qtype, addr.family)) {
 			qdata->rcode = KNOT_RCODE_NOERROR;
 			return NODATA;
 		}
@@ -372,14 +270,21 @@ static int template_match(int state, synth_template_t *tpl, knot_pkt_t *pkt, str
 	}
 
 	/* Synthetise record from template. */
-	knot_rrset_t *rr = synth_rr(addr_str, tpl, pkt, qdata);
-	if (rr == NULL) {
+	knot_rrset_t rr;
+	ret = synth_rr(&addr, tpl, qdata, &rr);
+	if (ret != KNOT_EOK) {
 		qdata->rcode = KNOT_RCODE_SERVFAIL;
 		return ERROR;
 	}
 
+	/* Owner is QNAME unless answering a CNAME target. */
+	uint16_t compr_hint = KNOT_COMPR_HINT_NONE;
+	if (qdata->name == knot_pkt_qname(qdata->query)) {
+		compr_hint = KNOT_COMPR_HINT_QNAME;
+	}
+
 	/* Insert synthetic response into packet. */
-	if (knot_pkt_put(pkt, 0, rr, KNOT_PF_FREE) != KNOT_EOK) {
+	if (knot_pkt_put(pkt, compr_hint, &rr, 0) != KNOT_EOK) {
 		return ERROR;
 	}
 
@@ -404,6 +309,15 @@ static int solve_synth_record(int state, knot_pkt_t *pkt, struct query_data *qda
 	return template_match(state, (synth_template_t *)ctx, pkt, qdata);
 }
 
+static void template_free(synth_template_t *tpl, knot_mm_t *mm)
+{
+	addr_ranges_free(tpl->ranges);
+	mm_free(mm, tpl->rdata);
+	knot_dname_free(&tpl->zone, NULL);
+	free(tpl->prefix);
+	mm_free(mm, tpl);
+}
+
 int synth_record_load(struct query_plan *plan, struct query_module *self,
                       const knot_dname_t *zone)
 {
@@ -416,6 +330,7 @@ int synth_record_load(struct query_plan *plan, struct query_module *self,
 	if (tpl == NULL) {
 		return KNOT_ENOMEM;
 	}
+	memset(tpl, 0, sizeof(*tpl));
 
 	conf_val_t val;
 
@@ -426,25 +341,44 @@ int synth_record_load(struct query_plan *plan, struct query_module *self,
 	/* Set prefix. */
 	val = conf_mod_get(self->config, MOD_PREFIX, self->id);
 	tpl->prefix = strdup(conf_str(&val));
+	if (tpl->prefix == NULL) {
+		template_free(tpl, self->mm);
+		return KNOT_ENOMEM;
+	}
+	tpl->prefix_len = strlen(tpl->prefix);
 
 	/* Set origin if generating reverse record. */
 	if (tpl->type == SYNTH_REVERSE) {
 		val = conf_mod_get(self->config, MOD_ORIGIN, self->id);
-		tpl->zone = knot_dname_to_str_alloc(conf_dname(&val));
+		tpl->zone = knot_dname_copy(conf_dname(&val), NULL);
 		if (tpl->zone == NULL) {
-			free(tpl->prefix);
-			mm_free(self->mm, tpl);
+			template_free(tpl, self->mm);
 			return KNOT_ENOMEM;
 		}
+		tpl->zone_size = knot_dname_size(tpl->zone);
 	}
 
 	/* Set ttl. */
 	val = conf_mod_get(self->config, MOD_TTL, self->id);
 	tpl->ttl = conf_int(&val);
 
-	/* Set address. */
+	/* Set addresses. */
 	val = conf_mod_get(self->config, MOD_NET, self->id);
-	tpl->addr = conf_addr_range(&val, &tpl->addr_max, &tpl->mask);
+	tpl->ranges = conf_addr_ranges(&val);
+	if (tpl->ranges == NULL) {
+		template_free(tpl, self->mm);
+		return KNOT_ENOMEM;
+	}
+
+	/* Worker identifiers cover both UDP and TCP handlers. */
+	tpl->rdata_count = conf_udp_threads(self->config) +
+	                   conf_tcp_threads(self->config);
+	tpl->rdata_size = knot_rdata_array_size(KNOT_DNAME_MAXLEN);
+	tpl->rdata = mm_alloc(self->mm, tpl->rdata_count * tpl->rdata_size);
+	if (tpl->rdata == NULL) {
+		template_free(tpl, self->mm);
+		return KNOT_ENOMEM;
+	}
 
 	self->ctx = tpl;
 
@@ -457,9 +391,6 @@ int synth_record_unload(struct query_module *self)
 		return KNOT_EINVAL;
 	}
 
-	synth_template_t *tpl = (synth_template_t *)self->ctx;
-	free(tpl->zone);
-	free(tpl->prefix);
-	mm_free(self->mm, tpl);
+	template_free((synth_template_t *)self->ctx, self->mm);
 	return KNOT_EOK;
 }
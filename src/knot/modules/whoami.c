@@ -35,7 +35,7 @@ static int whoami_query(int state, knot_pkt_t *pkt, struct query_data *qdata, vo
 	    qdata->query == NULL ||
 	    qdata->param == NULL || qdata->param->remote == NULL ||
 	    qdata->zone == NULL || qdata->zone->name == NULL ||
-	    qdata->zone->contents == NULL || qdata->zone->contents->apex == NULL)
+	    qdata->contents == NULL || qdata->contents->apex == NULL)
 	{
 		return ERROR;
 	}
@@ -102,7 +102,7 @@ static int whoami_query(int state, knot_pkt_t *pkt, struct query_data *qdata, vo
 
 	/* TTL is taken from the TTL of the SOA record. */
 	uint32_t ttl = 0;
-	const zone_node_t *apex = qdata->zone->contents->apex;
+	const zone_node_t *apex = qdata->contents->apex;
 	for (uint16_t i = 0; apex != NULL && i < apex->rrset_count; i++) {
 		const struct rr_data *rr_data = &apex->rrs[i];
 		if (rr_data->type == KNOT_RRTYPE_SOA) {
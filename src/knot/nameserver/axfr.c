@@ -100,9 +100,6 @@ static void axfr_query_cleanup(struct query_data *qdata)
 	hattrie_iter_free(axfr->i);
 	ptrlist_free(&axfr->proc.nodes, qdata->mm);
 	mm_free(qdata->mm, axfr);
-
-	/* Allow zone changes (finished). */
-	rcu_read_unlock();
 }
 
 static int axfr_query_check(struct query_data *qdata)
@@ -143,6 +140,7 @@ static int axfr_query_init(struct query_data *qdata)
 
 	/* Put data to process. */
 	gettimeofday(&axfr->proc.tstamp, NULL);
+	xfr_contents_init(&axfr->proc, qdata);
 	ptrlist_add(&axfr->proc.nodes, zone->nodes, mm);
 	/* Put NSEC3 data if exists. */
 	if (!zone_tree_is_empty(zone->nsec3_nodes)) {
@@ -153,13 +151,26 @@ static int axfr_query_init(struct query_data *qdata)
 	qdata->ext = axfr;
 	qdata->ext_cleanup = &axfr_query_cleanup;
 
-	/* No zone changes during multipacket answer
-	   (unlocked in axfr_answer_cleanup) */
-	rcu_read_lock();
-
 	return KNOT_EOK;
 }
 
+void xfr_contents_init(struct xfr_proc *xfer, struct query_data *qdata)
+{
+	xfer->contents = qdata->zone->contents;
+	xfer->generation = xfer->contents->generation;
+}
+
+bool xfr_contents_current(const struct xfr_proc *xfer, struct query_data *qdata)
+{
+	/* The read lock is held only while producing a message, so the
+	 * contents may have been switched and freed while the transfer was
+	 * waiting for the client. A matching pointer is still alive, the
+	 * generation tells apart new contents allocated at the same address. */
+	return qdata->zone != NULL &&
+	       qdata->zone->contents == xfer->contents &&
+	       xfer->contents->generation == xfer->generation;
+}
+
 int xfr_process_list(knot_pkt_t *pkt, xfr_put_cb process_item,
                      struct query_data *qdata)
 {
@@ -236,11 +247,16 @@ int axfr_process_query(knot_pkt_t *pkt, struct query_data *qdata)
 		}
 	}
 
-	/* Reserve space for TSIG. */
-	knot_pkt_reserve(pkt, knot_tsig_wire_maxsize(&qdata->sign.tsig_key));
-
 	/* Answer current packet (or continue). */
 	struct axfr_proc *axfr = (struct axfr_proc *)qdata->ext;
+	if (!xfr_contents_current(&axfr->proc, qdata)) {
+		AXFROUT_LOG(LOG_WARNING, "failed (zone changed)");
+		qdata->rcode = KNOT_RCODE_SERVFAIL;
+		return KNOT_STATE_FAIL;
+	}
+
+	/* Reserve space for TSIG. */
+	knot_pkt_reserve(pkt, knot_tsig_wire_maxsize(&qdata->sign.tsig_key));
 	ret = xfr_process_list(pkt, &axfr_process_node_tree, qdata);
 	switch(ret) {
 	case KNOT_ESPACE: /* Couldn't write more, send packet and continue. */
@@ -259,6 +275,14 @@ int axfr_process_query(knot_pkt_t *pkt, struct query_data *qdata)
 	}
 }
 
+/*! \brief AXFR-in processing context. */
+struct axfrin_proc {
+	struct xfr_proc proc;
+	zcreator_t zc;                          /*!< Zone creator for the transfer. */
+	uint8_t rdata[KNOT_RR_VIEW_RDATA_SIZE]; /*!< Current RR RDATA buffer. */
+	uint8_t owner[KNOT_DNAME_MAXLEN];       /*!< Current RR owner buffer. */
+};
+
 static void axfr_answer_cleanup(struct answer_data *data)
 {
 	assert(data != NULL);
@@ -283,16 +307,20 @@ static int axfr_answer_init(struct answer_data *data)
 	}
 
 	/* Create new processing context. */
-	struct xfr_proc *proc = mm_alloc(data->mm, sizeof(struct xfr_proc));
-	if (proc == NULL) {
+	struct axfrin_proc *axfr = mm_alloc(data->mm, sizeof(struct axfrin_proc));
+	if (axfr == NULL) {
 		zone_contents_deep_free(&new_contents);
 		return KNOT_ENOMEM;
 	}
 
+	struct xfr_proc *proc = &axfr->proc;
 	memset(proc, 0, sizeof(struct xfr_proc));
 	proc->contents = new_contents;
 	gettimeofday(&proc->tstamp, NULL);
 
+	memset(&axfr->zc, 0, sizeof(axfr->zc));
+	axfr->zc.z = new_contents;
+
 	/* Set up cleanup callback. */
 	data->ext = proc;
 	data->ext_cleanup = &axfr_answer_cleanup;
@@ -317,7 +345,7 @@ static int axfr_answer_finalize(struct answer_data *adata)
 
 	err_handler_logger_t handler;
 	handler._cb.cb = err_handler_logger;
-	rc = zone_do_sem_checks(proc->contents, false, &handler._cb);
+	rc = zone_do_sem_checks(proc->contents, false, &handler._cb, 1);
 
 	if (rc != KNOT_EOK) {
 		return rc;
@@ -334,6 +362,7 @@ static int axfr_answer_finalize(struct answer_data *adata)
 
 	/* Switch contents. */
 	zone_t *zone = adata->param->zone;
+	zone_replicate_contents(adata->param->conf, zone, proc->contents);
 	zone_contents_t *old_contents =
 	                zone_switch_contents(zone, proc->contents);
 	zone->flags &= ~ZONE_EXPIRED;
@@ -364,9 +393,10 @@ static int axfr_answer_finalize(struct answer_data *adata)
 static int axfr_answer_packet(knot_pkt_t *pkt, struct answer_data *adata)
 {
 	assert(adata != NULL);
-	struct xfr_proc *proc = adata->ext;
+	struct axfrin_proc *axfr = adata->ext;
 	assert(pkt != NULL);
-	assert(proc != NULL);
+	assert(axfr != NULL);
+	struct xfr_proc *proc = &axfr->proc;
 
 	/* Update counters. */
 	proc->npkts  += 1;
@@ -376,22 +406,33 @@ static int axfr_answer_packet(knot_pkt_t *pkt, struct answer_data *adata)
 	                               proc->contents->apex->owner);
 	int64_t size_limit = conf_int(&val);
 
-	/* Init zone creator. */
-	zcreator_t zc = {.z = proc->contents, .master = false, .ret = KNOT_EOK };
+	zcreator_t *zc = &axfr->zc;
+
+	/* Read the answer RRs directly from the wire, the answer section
+	 * isn't parsed into the packet (see KNOT_RQ_NOANSWER). */
+	size_t pos = KNOT_WIRE_HEADER_SIZE + knot_pkt_question_size(pkt);
+	uint16_t count = knot_wire_get_ancount(pkt->wire);
+	for (uint16_t i = 0; i < count; ++i) {
+		knot_rr_view_t view;
+		int ret = knot_rr_view_parse(pkt->wire, &pos, pkt->size, &view);
+		if (ret != KNOT_EOK) {
+			return KNOT_STATE_FAIL;
+		}
 
-	const knot_pktsection_t *answer = knot_pkt_section(pkt, KNOT_ANSWER);
-	const knot_rrset_t *answer_rr = knot_pkt_rr(answer, 0);
-	for (uint16_t i = 0; i < answer->count; ++i) {
-		if (answer_rr[i].type == KNOT_RRTYPE_SOA &&
-		    node_rrtype_exists(zc.z->apex, KNOT_RRTYPE_SOA)) {
+		if (view.type == KNOT_RRTYPE_SOA &&
+		    node_rrtype_exists(zc->z->apex, KNOT_RRTYPE_SOA)) {
 			return KNOT_STATE_DONE;
-		} else {
-			int ret = zcreator_step(&zc, &answer_rr[i]);
-			if (ret != KNOT_EOK) {
-				return KNOT_STATE_FAIL;
-			}
 		}
-		proc->contents->size += knot_rrset_size(&answer_rr[i]);
+
+		knot_rrset_t rr;
+		ret = knot_rr_view_expand(&view, &rr, axfr->owner, axfr->rdata, true);
+		if (ret == KNOT_EOK) {
+			ret = zcreator_step(zc, &rr);
+		}
+		if (ret != KNOT_EOK) {
+			return KNOT_STATE_FAIL;
+		}
+		proc->contents->size += knot_rrset_size(&rr);
 		if (proc->contents->size > size_limit) {
 			AXFRIN_LOG(LOG_WARNING, "zone size exceeded");
 			return KNOT_STATE_FAIL;
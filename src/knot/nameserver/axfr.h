@@ -60,6 +60,7 @@ struct xfr_proc {
 	unsigned nbytes; /* Bytes processed. */
 	struct timeval tstamp; /* Start time. */
 	zone_contents_t *contents; /* Processed zone. */
+	uint64_t generation;       /* Generation of the outgoing contents. */
 };
 
 /*! \brief Generic transfer processing (reused for IXFR).
@@ -72,6 +73,17 @@ typedef int (*xfr_put_cb)(knot_pkt_t *pkt, const void *item, struct xfr_proc *xf
  */
 int xfr_process_list(knot_pkt_t *pkt, xfr_put_cb put, struct query_data *qdata);
 
+/*! \brief Start an outgoing transfer of the current zone contents.
+ *  \note The contents aren't locked between the messages, the transfer is
+ *        only valid while xfr_contents_current() holds.
+ */
+void xfr_contents_init(struct xfr_proc *xfer, struct query_data *qdata);
+
+/*! \brief Check that the transferred contents are still those of the zone.
+ *  \note Must be called under the RCU read lock before each message.
+ */
+bool xfr_contents_current(const struct xfr_proc *xfer, struct query_data *qdata);
+
 /*!
  * \brief Process an AXFR query message.
  *
@@ -131,7 +131,7 @@ static bool dname_cname_cannot_synth(const knot_rrset_t *rrset, const knot_dname
 static bool have_dnssec(struct query_data *qdata)
 {
 	return knot_pkt_has_dnssec(qdata->query) &&
-	       zone_contents_is_signed(qdata->zone->contents);
+	       zone_contents_is_signed(qdata->contents);
 }
 
 /*! \brief Synthesize RRSIG for given parameters, store in 'qdata' for later use */
@@ -445,7 +445,7 @@ static int name_not_found(knot_pkt_t *pkt, struct query_data *qdata)
 		/* Find wildcard child in the zone. */
 		const zone_node_t *wildcard_node =
 		                zone_contents_find_wildcard_child(
-		                        qdata->zone->contents, qdata->encloser);
+		                        qdata->contents, qdata->encloser);
 
 		qdata->node = wildcard_node;
 		assert(qdata->node != NULL);
@@ -479,7 +479,7 @@ static int name_not_found(knot_pkt_t *pkt, struct query_data *qdata)
 
 static int solve_name(int state, knot_pkt_t *pkt, struct query_data *qdata)
 {
-	int ret = zone_contents_find_dname(qdata->zone->contents, qdata->name,
+	int ret = zone_contents_find_dname(qdata->contents, qdata->name,
 	                                        &qdata->node, &qdata->encloser,
 	                                        &qdata->previous);
 
@@ -533,7 +533,7 @@ static int solve_answer_dnssec(int state, knot_pkt_t *pkt, struct query_data *qd
 static int solve_authority(int state, knot_pkt_t *pkt, struct query_data *qdata, void *ctx)
 {
 	int ret = KNOT_ERROR;
-	const zone_contents_t *zone_contents = qdata->zone->contents;
+	const zone_contents_t *zone_contents = qdata->contents;
 
 	switch (state) {
 	case HIT:    /* Positive response. */
@@ -750,6 +750,7 @@ static int answer_query(struct query_plan *plan, knot_pkt_t *response, struct qu
 	}
 
 	/* Resolve ANSWER. */
+	QTIME_START(stage_time);
 	knot_pkt_begin(response, KNOT_ANSWER);
 	if (global_plan != NULL) {
 		WALK_LIST(step, global_plan->stage[QPLAN_ANSWER]) {
@@ -764,6 +765,8 @@ static int answer_query(struct query_plan *plan, knot_pkt_t *response, struct qu
 		}
 	}
 
+	QTIME_LAP(qdata->param->timing, QTIME_ANSWER, stage_time);
+
 	/* Resolve AUTHORITY. */
 	knot_pkt_begin(response, KNOT_AUTHORITY);
 	if (global_plan != NULL) {
@@ -779,6 +782,8 @@ static int answer_query(struct query_plan *plan, knot_pkt_t *response, struct qu
 		}
 	}
 
+	QTIME_LAP(qdata->param->timing, QTIME_AUTHORITY, stage_time);
+
 	/* Resolve ADDITIONAL. */
 	knot_pkt_begin(response, KNOT_ADDITIONAL);
 	if (global_plan != NULL) {
@@ -793,6 +798,7 @@ static int answer_query(struct query_plan *plan, knot_pkt_t *response, struct qu
 			SOLVE_STEP(step->process, state, step->ctx);
 		}
 	}
+	QTIME_STOP(qdata->param->timing, QTIME_ADDITIONAL, stage_time);
 
 	/* After query processing code. */
 	if (plan != NULL) {
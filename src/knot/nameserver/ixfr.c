@@ -223,9 +223,6 @@ static void ixfr_answer_cleanup(struct query_data *qdata)
 	changeset_iter_clear(&ixfr->cur);
 	changesets_free(&ixfr->changesets);
 	mm_free(mm, qdata->ext);
-
-	/* Allow zone changes (finished). */
-	rcu_read_unlock();
 }
 
 /*! \brief Inits ixfr processing context. */
@@ -260,6 +257,7 @@ static int ixfr_answer_init(struct query_data *qdata)
 	}
 	memset(xfer, 0, sizeof(struct ixfr_proc));
 	gettimeofday(&xfer->proc.tstamp, NULL);
+	xfr_contents_init(&xfer->proc, qdata);
 	xfer->state = IXFR_SOA_DEL;
 	init_list(&xfer->proc.nodes);
 	init_list(&xfer->changesets);
@@ -284,9 +282,6 @@ static int ixfr_answer_init(struct query_data *qdata)
 	qdata->ext = xfer;
 	qdata->ext_cleanup = &ixfr_answer_cleanup;
 
-	/* No zone changes during multipacket answer (unlocked in axfr_answer_cleanup) */
-	rcu_read_lock();
-
 	return KNOT_EOK;
 }
 
@@ -385,7 +380,7 @@ static int ixfrin_finalize(struct answer_data *adata)
 
 	err_handler_logger_t handler;
 	handler._cb.cb = err_handler_logger;
-	ret = zone_do_sem_checks(new_contents, false, &handler._cb);
+	ret = zone_do_sem_checks(new_contents, false, &handler._cb, 1);
 
 	if (ret != KNOT_EOK) {
 		IXFRIN_LOG(LOG_WARNING, "failed to apply changes to zone (%s)",
@@ -417,6 +412,7 @@ static int ixfrin_finalize(struct answer_data *adata)
 	}
 
 	/* Switch zone contents. */
+	zone_replicate_contents(adata->param->conf, ixfr->zone, new_contents);
 	zone_contents_t *old_contents = zone_switch_contents(ixfr->zone, new_contents);
 	ixfr->zone->flags &= ~ZONE_EXPIRED;
 	synchronize_rcu();
@@ -688,6 +684,13 @@ int ixfr_process_query(knot_pkt_t *pkt, struct query_data *qdata)
 		}
 	}
 
+	/* The zone may have changed since the previous message. */
+	if (!xfr_contents_current(&ixfr->proc, qdata)) {
+		IXFROUT_LOG(LOG_WARNING, "failed (zone changed)");
+		qdata->rcode = KNOT_RCODE_SERVFAIL;
+		return KNOT_STATE_FAIL;
+	}
+
 	/* Reserve space for TSIG. */
 	knot_pkt_reserve(pkt, knot_tsig_wire_maxsize(&qdata->sign.tsig_key));
 
@@ -612,7 +612,7 @@ static int put_nodata(const zone_node_t *node,
 
 int nsec_prove_wildcards(knot_pkt_t *pkt, struct query_data *qdata)
 {
-	if (qdata->zone->contents == NULL) {
+	if (qdata->contents == NULL) {
 		return KNOT_EINVAL;
 	}
 
@@ -624,7 +624,7 @@ int nsec_prove_wildcards(knot_pkt_t *pkt, struct query_data *qdata)
 			return KNOT_EINVAL;
 		}
 		ret = put_wildcard_answer(item->node, item->prev,
-		                          qdata->zone->contents,
+		                          qdata->contents,
 		                          item->sname, qdata, pkt);
 		if (ret != KNOT_EOK) {
 			break;
@@ -636,21 +636,21 @@ int nsec_prove_wildcards(knot_pkt_t *pkt, struct query_data *qdata)
 
 int nsec_prove_nodata(knot_pkt_t *pkt, struct query_data *qdata)
 {
-	if (qdata->zone->contents == NULL || qdata->node == NULL) {
+	if (qdata->contents == NULL || qdata->node == NULL) {
 		return KNOT_EINVAL;
 	}
 
 	return put_nodata(qdata->node, qdata->encloser, qdata->previous,
-	                  qdata->zone->contents, qdata->name, qdata, pkt);
+	                  qdata->contents, qdata->name, qdata, pkt);
 }
 
 int nsec_prove_nxdomain(knot_pkt_t *pkt, struct query_data *qdata)
 {
-	if (qdata->zone->contents == NULL) {
+	if (qdata->contents == NULL) {
 		return KNOT_EINVAL;
 	}
 
-	return put_nxdomain(qdata->zone->contents,
+	return put_nxdomain(qdata->contents,
 	                    qdata->previous, qdata->encloser,
 	                    qdata->name, qdata, pkt);
 }
@@ -658,7 +658,7 @@ int nsec_prove_nxdomain(knot_pkt_t *pkt, struct query_data *qdata)
 int nsec_prove_dp_security(knot_pkt_t *pkt, struct query_data *qdata)
 {
 	if (qdata->node == NULL || qdata->encloser == NULL ||
-	    qdata->zone->contents == NULL) {
+	    qdata->contents == NULL) {
 		return KNOT_EINVAL;
 	}
 
@@ -673,7 +673,7 @@ int nsec_prove_dp_security(knot_pkt_t *pkt, struct query_data *qdata)
 	// Alternatively prove that DS doesn't exist.
 
 	return put_nodata(qdata->node, qdata->encloser, qdata->previous,
-	                  qdata->zone->contents, qdata->name, qdata, pkt);
+	                  qdata->contents, qdata->name, qdata, pkt);
 }
 
 int nsec_append_rrsigs(knot_pkt_t *pkt, struct query_data *qdata, bool optional)
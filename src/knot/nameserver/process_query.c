@@ -28,12 +28,15 @@
 #include "knot/nameserver/nsec_proofs.h"
 #include "knot/nameserver/notify.h"
 #include "libknot/libknot.h"
+#include "libknot/rrtype/opt-cookie.h"
 #include "contrib/macros.h"
 #include "contrib/mempattern.h"
 
 /*! \brief Accessor to query-specific data. */
 #define QUERY_DATA(ctx) ((struct query_data *)(ctx)->data)
 
+static int sign_response(knot_pkt_t *pkt, struct query_data *qdata, bool more);
+
 /*! \brief Reinitialize query data structure. */
 static void query_data_init(knot_layer_t *ctx, void *module_param)
 {
@@ -73,6 +76,7 @@ static int process_query_reset(knot_layer_t *ctx)
 	ptrlist_free(&qdata->wildcards, qdata->mm);
 	nsec_clear_rrsigs(qdata);
 	knot_rrset_clear(&qdata->opt_rr, qdata->mm);
+	knot_tsig_stream_free(qdata->tsig_stream);
 	if (qdata->ext_cleanup != NULL) {
 		qdata->ext_cleanup(qdata);
 	}
@@ -221,6 +225,45 @@ static int answer_edns_reserve(knot_pkt_t *resp, struct query_data *qdata)
 	return knot_pkt_reserve(resp, knot_edns_wire_size(&qdata->opt_rr));
 }
 
+/*! \brief Validate the received server cookie and issue a fresh one. */
+static int answer_edns_cookie(const knot_pkt_t *query, struct query_data *qdata)
+{
+	uint8_t *opt = knot_edns_get_option(query->opt_rr, KNOT_EDNS_OPTION_COOKIE);
+	if (opt == NULL) {
+		return KNOT_EOK;
+	}
+
+	struct knot_dns_cookies cookies = { 0 };
+	int ret = knot_edns_opt_cookie_parse(knot_edns_opt_get_data(opt),
+	                                     knot_edns_opt_get_length(opt),
+	                                     &cookies.cc, &cookies.cc_len,
+	                                     &cookies.sc, &cookies.sc_len);
+	if (ret != KNOT_EOK) {
+		qdata->rcode = KNOT_RCODE_FORMERR;
+		return KNOT_EOK;
+	}
+
+	const cookie_secrets_t *secrets = &qdata->param->server->cookies;
+	const struct sockaddr *remote = (const struct sockaddr *)qdata->param->remote;
+	if (cookies.sc_len > 0) {
+		qdata->cookie_valid = cookie_check(secrets, remote, &cookies);
+	}
+
+	/* Answer with the client cookie and a server cookie for the next query. */
+	uint8_t sc[KNOT_OPT_COOKIE_SRVR_MAX];
+	uint16_t sc_len = cookie_server_write(secrets, remote, cookies.cc,
+	                                      cookies.cc_len, sc);
+	uint8_t data[KNOT_OPT_COOKIE_CLNT + KNOT_OPT_COOKIE_SRVR_MAX];
+	uint16_t data_len = knot_edns_opt_cookie_write(cookies.cc, cookies.cc_len,
+	                                               sc, sc_len, data, sizeof(data));
+	if (data_len == 0) {
+		return KNOT_ERROR;
+	}
+
+	return knot_edns_add_option(&qdata->opt_rr, KNOT_EDNS_OPTION_COOKIE,
+	                            data_len, data, qdata->mm);
+}
+
 static int answer_edns_init(const knot_pkt_t *query, knot_pkt_t *resp,
                             struct query_data *qdata)
 {
@@ -282,6 +325,14 @@ static int answer_edns_init(const knot_pkt_t *query, knot_pkt_t *resp,
 		}
 	}
 
+	/* Check and issue DNS cookies if enabled. */
+	if (conf()->cache.srv_cookies) {
+		ret = answer_edns_cookie(query, qdata);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
 	return answer_edns_reserve(resp, qdata);
 }
 
@@ -338,7 +389,13 @@ static int prepare_answer(const knot_pkt_t *query, knot_pkt_t *resp, knot_layer_
 		return ret;
 	}
 	/* Find zone for QNAME. */
+	QTIME_START(zone_time);
 	qdata->zone = answer_zone_find(query, server->zone_db);
+	QTIME_STOP(qdata->param->timing, QTIME_ZONE_FIND, zone_time);
+	if (qdata->zone != NULL) {
+		qdata->contents = zone_contents_local(qdata->zone->contents,
+		                                      qdata->param->numa_node);
+	}
 
 	/* Setup EDNS. */
 	ret = answer_edns_init(query, resp, qdata);
@@ -424,37 +481,38 @@ static int process_query_err(knot_layer_t *ctx, knot_pkt_t *pkt)
 	return KNOT_STATE_DONE;
 }
 
-/*!
- * \brief Apply rate limit.
- */
-static int ratelimit_apply(int state, knot_pkt_t *pkt, knot_layer_t *ctx)
+/*! \brief Check if rate limiting applies to the query. */
+static bool ratelimit_enabled(struct query_data *qdata)
 {
-	/* Check if rate limiting applies. */
-	struct query_data *qdata = QUERY_DATA(ctx);
 	server_t *server = qdata->param->server;
 	if (server->rrl == NULL) {
-		return state;
+		return false;
 	}
 
-	/* Exempt clients. */
-	conf_val_t *whitelist = &conf()->cache.srv_rate_limit_whitelist;
-	if (conf_addr_range_match(whitelist, qdata->param->remote)) {
-		return state;
+	/* Source address verified by a server cookie can't be spoofed. */
+	if (qdata->cookie_valid) {
+		return false;
 	}
 
-	rrl_req_t rrl_rq = {0};
-	rrl_rq.w = pkt->wire;
-	rrl_rq.query = qdata->query;
-	if (!EMPTY_LIST(qdata->wildcards)) {
-		rrl_rq.flags = RRL_WILDCARD;
-	}
-	if (rrl_query(server->rrl, qdata->param->remote,
-	              &rrl_rq, qdata->zone) == KNOT_EOK) {
-		/* Rate limiting not applied. */
-		return state;
+	/* Exempt clients, from the configuration if not compiled (no memory). */
+	const addr_ranges_t *whitelist = conf()->cache.srv_rate_limit_whitelist;
+	if (whitelist != NULL) {
+		if (addr_ranges_match(whitelist, (struct sockaddr *)qdata->param->remote)) {
+			return false;
+		}
+	} else {
+		conf_val_t val = conf_get(conf(), C_SRV, C_RATE_LIMIT_WHITELIST);
+		if (conf_addr_range_match(&val, qdata->param->remote)) {
+			return false;
+		}
 	}
 
-	/* Now it is slip or drop. */
+	return true;
+}
+
+/*! \brief Slip or drop the limited response. */
+static int ratelimit_limit(knot_pkt_t *pkt, knot_layer_t *ctx)
+{
 	int slip = conf()->cache.srv_rate_limit_slip;
 	if (slip > 0 && rrl_slip_roll(slip)) {
 		/* Answer slips. */
@@ -470,10 +528,70 @@ static int ratelimit_apply(int state, knot_pkt_t *pkt, knot_layer_t *ctx)
 	return KNOT_STATE_DONE;
 }
 
+/*!
+ * \brief Apply rate limit before answering if the source is limited already.
+ *
+ * The response is accounted once built in ratelimit_apply(), unless limited.
+ *
+ * \param pkt Response.
+ * \param ctx Query processing context.
+ *
+ * \return KNOT_STATE_PRODUCE to answer the query, final state otherwise.
+ */
+static int ratelimit_apply_early(knot_pkt_t *pkt, knot_layer_t *ctx)
+{
+	struct query_data *qdata = QUERY_DATA(ctx);
+	if (!ratelimit_enabled(qdata)) {
+		return KNOT_STATE_PRODUCE;
+	}
+
+	int ret = rrl_query_early(qdata->param->server->rrl, qdata->param->remote,
+	                          qdata->query);
+	if (ret != KNOT_ELIMIT) {
+		return KNOT_STATE_PRODUCE;
+	}
+
+	/* Now it is slip or drop. */
+	return ratelimit_limit(pkt, ctx);
+}
+
+/*!
+ * \brief Apply rate limit.
+ */
+static int ratelimit_apply(int state, knot_pkt_t *pkt, knot_layer_t *ctx)
+{
+	/* Check if rate limiting applies. */
+	struct query_data *qdata = QUERY_DATA(ctx);
+	if (!ratelimit_enabled(qdata)) {
+		return state;
+	}
+
+	QTIME_START(rrl_time);
+	rrl_req_t rrl_rq = {0};
+	rrl_rq.w = pkt->wire;
+	rrl_rq.query = qdata->query;
+	if (!EMPTY_LIST(qdata->wildcards)) {
+		rrl_rq.flags = RRL_WILDCARD;
+	}
+	int ret = rrl_query(qdata->param->server->rrl, qdata->param->remote,
+	                    &rrl_rq, qdata->zone);
+	QTIME_STOP(qdata->param->timing, QTIME_RRL, rrl_time);
+	if (ret == KNOT_EOK) {
+		/* Rate limiting not applied. */
+		return state;
+	}
+
+	/* Now it is slip or drop. */
+	return ratelimit_limit(pkt, ctx);
+}
+
 static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 {
 	assert(pkt && ctx);
 
+	QTIME_START(total_time);
+	QTIME_START(stage_time);
+
 	rcu_read_lock();
 
 	struct query_data *qdata = QUERY_DATA(ctx);
@@ -483,6 +601,7 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 	/* Check parse state. */
 	knot_pkt_t *query = qdata->query;
 	int next_state = KNOT_STATE_PRODUCE;
+	bool rrl_checked = !(qdata->param->proc_flags & NS_QUERY_LIMIT_RATE);
 	if (query->parsed < query->size) {
 		knot_pkt_clear(pkt);
 		qdata->rcode = KNOT_RCODE_FORMERR;
@@ -498,12 +617,37 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 		next_state = KNOT_STATE_FAIL;
 		goto finish;
 	}
+	QTIME_LAP(qdata->param->timing, QTIME_PREPARE, stage_time);
+
+	/* Deferred answer is put into the response by its module. */
+	if (qdata->param->deferred != NULL) {
+		qdata->flags = qdata->param->deferred->query_flags;
+		next_state = KNOT_STATE_DONE;
+		/* The zone query plan ends before the global one. */
+		if (qdata->zone != NULL && qdata->zone->query_plan != NULL) {
+			WALK_LIST(step, qdata->zone->query_plan->stage[QPLAN_END]) {
+				next_state = step->process(next_state, pkt, qdata, step->ctx);
+			}
+		}
+		goto finish;
+	}
+
+	/* Drop or slip before answering if the source is limited already. */
+	if (!rrl_checked) {
+		next_state = ratelimit_apply_early(pkt, ctx);
+		QTIME_LAP(qdata->param->timing, QTIME_RRL, stage_time);
+		if (next_state != KNOT_STATE_PRODUCE) {
+			rrl_checked = true;
+			goto limited;
+		}
+	}
 
 	/* Before query processing code. */
 	if (plan) {
 		WALK_LIST(step, plan->stage[QPLAN_BEGIN]) {
 			next_state = step->process(next_state, pkt, qdata, step->ctx);
 		}
+		QTIME_LAP(qdata->param->timing, QTIME_PLAN_BEGIN, stage_time);
 	}
 
 	/* Answer based on qclass. */
@@ -523,6 +667,13 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 		}
 	}
 
+	/* No response now if a zone module deferred the answer. */
+	if (qdata->flags & QUERY_DEFERRED) {
+		pkt->size = 0;
+		next_state = KNOT_STATE_NOOP;
+		goto limited;
+	}
+
 	/*
 	 * Postprocessing.
 	 */
@@ -543,9 +694,12 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 		}
 
 		/* Transaction security (if applicable). */
-		if (process_query_sign_response(pkt, qdata) != KNOT_EOK) {
+		QTIME_START(tsig_time);
+		bool more = (next_state == KNOT_STATE_PRODUCE);
+		if (sign_response(pkt, qdata, more) != KNOT_EOK) {
 			next_state = KNOT_STATE_FAIL;
 		}
+		QTIME_STOP(qdata->param->timing, QTIME_TSIG, tsig_time);
 	}
 
 finish:
@@ -562,18 +716,30 @@ finish:
 	}
 	/* In case of NS_PROC_FAIL, RCODE is set in the error-processing function. */
 
+limited:
 	/* After query processing code. */
 	if (plan) {
+		QTIME_START(end_time);
 		WALK_LIST(step, plan->stage[QPLAN_END]) {
 			next_state = step->process(next_state, pkt, qdata, step->ctx);
 		}
+		QTIME_STOP(qdata->param->timing, QTIME_PLAN_END, end_time);
 	}
 
-	/* Rate limits (if applicable). */
-	if (qdata->param->proc_flags & NS_QUERY_LIMIT_RATE) {
+	/* Drop the deferred answer if its module is gone (reloaded). */
+	if (qdata->param->deferred != NULL && qdata->param->deferred->owner != NULL) {
+		pkt->size = 0;
+		next_state = KNOT_STATE_NOOP;
+	}
+
+	/* Rate limits (if applicable and not applied before answering),
+	 * the answer is checked once finished if deferred. */
+	if (!rrl_checked && next_state != KNOT_STATE_NOOP) {
 		next_state = ratelimit_apply(next_state, pkt, ctx);
 	}
 
+	QTIME_STOP(qdata->param->timing, QTIME_TOTAL, total_time);
+
 	rcu_read_unlock();
 
 	return next_state;
@@ -676,7 +842,11 @@ int process_query_verify(struct query_data *qdata)
 	return ret;
 }
 
-int process_query_sign_response(knot_pkt_t *pkt, struct query_data *qdata)
+/*!
+ * \brief Sign the response, or only add it to the digest of the next signed
+ *        one if more responses follow (see tsig-sign-interval).
+ */
+static int sign_response(knot_pkt_t *pkt, struct query_data *qdata, bool more)
 {
 	if (pkt->size == 0) {
 		// Nothing to sign.
@@ -690,6 +860,15 @@ int process_query_sign_response(knot_pkt_t *pkt, struct query_data *qdata)
 	/* KEY provided and verified TSIG or BADTIME allows signing. */
 	if (ctx->tsig_key.name != NULL && knot_tsig_can_sign(qdata->rcode_tsig)) {
 
+		/* Running digest for the next responses in the session. */
+		if (ctx->pkt_count > 0 && qdata->tsig_stream == NULL) {
+			qdata->tsig_stream = knot_tsig_stream_new();
+			if (qdata->tsig_stream == NULL) {
+				ret = KNOT_ENOMEM;
+				goto fail;
+			}
+		}
+
 		/* Sign query response. */
 		size_t new_digest_len = dnssec_tsig_algorithm_size(ctx->tsig_key.algorithm);
 		if (ctx->pkt_count == 0) {
@@ -698,12 +877,17 @@ int process_query_sign_response(knot_pkt_t *pkt, struct query_data *qdata)
 			                     ctx->tsig_digest, &new_digest_len,
 			                     &ctx->tsig_key, qdata->rcode_tsig,
 			                     ctx->tsig_time_signed);
+		} else if (more && knot_tsig_stream_pending(qdata->tsig_stream) + 1 <
+		                   conf()->cache.srv_tsig_sign_interval) {
+			ret = knot_tsig_stream_add(qdata->tsig_stream, &ctx->tsig_key,
+			                           ctx->tsig_digest, ctx->tsig_digestlen,
+			                           pkt->wire, pkt->size);
 		} else {
-			ret = knot_tsig_sign_next(pkt->wire, &pkt->size, pkt->max_size,
-			                          ctx->tsig_digest, ctx->tsig_digestlen,
-			                          ctx->tsig_digest, &new_digest_len,
-			                          &ctx->tsig_key,
-			                          pkt->wire, pkt->size);
+			ret = knot_tsig_sign_next_stream(qdata->tsig_stream,
+			                                 pkt->wire, &pkt->size, pkt->max_size,
+			                                 ctx->tsig_digest, ctx->tsig_digestlen,
+			                                 ctx->tsig_digest, &new_digest_len,
+			                                 &ctx->tsig_key);
 		}
 		if (ret != KNOT_EOK) {
 			goto fail; /* Failed to sign. */
@@ -730,6 +914,11 @@ fail:
 	return ret;
 }
 
+int process_query_sign_response(knot_pkt_t *pkt, struct query_data *qdata)
+{
+	return sign_response(pkt, qdata, false);
+}
+
 void process_query_qname_case_restore(struct query_data *qdata, knot_pkt_t *pkt)
 {
 	/* If original QNAME is empty, Query is either unparsed or for root domain.
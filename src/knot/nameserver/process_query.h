@@ -24,6 +24,8 @@
 
 #pragma once
 
+#include "knot/nameserver/query_timing.h"
+#include "knot/query/defer.h"
 #include "knot/query/layer.h"
 #include "knot/server/server.h"
 #include "knot/updates/acl.h"
@@ -41,6 +43,13 @@ enum process_query_flag {
 	NS_QUERY_LIMIT_SIZE = 1 << 4  /* Apply UDP size limit. */
 };
 
+/* Per-query flags set by the query modules, kept with a deferred answer. */
+enum query_flag {
+	QUERY_LOG_DECIDED = 1 << 0, /* Logging of the query was decided. */
+	QUERY_LOG         = 1 << 1, /* Query and its response are logged. */
+	QUERY_DEFERRED    = 1 << 2  /* Answer deferred by a module (no response now). */
+};
+
 /* Module load parameters. */
 struct process_query_param {
 	uint16_t   proc_flags;
@@ -48,6 +57,10 @@ struct process_query_param {
 	int        socket;
 	const struct sockaddr_storage *remote;
 	unsigned   thread_id;
+	unsigned   numa_node;
+	query_timing_t *timing;
+	query_defer_queue_t *defer;  /*!< Deferred answers queue (UDP, optional). */
+	query_defer_t *deferred;     /*!< Deferred answer being finished. */
 };
 
 /*! \brief Query processing intermediate data. */
@@ -57,6 +70,7 @@ struct query_data {
 	uint16_t packet_type; /*!< Resolved packet type. */
 	knot_pkt_t *query;    /*!< Query to be solved. */
 	const zone_t *zone;   /*!< Zone from which is answered. */
+	const zone_contents_t *contents; /*!< Zone contents (replica local to the thread). */
 	list_t wildcards;     /*!< Visited wildcards. */
 	list_t rrsigs;        /*!< Section RRSIGs. */
 
@@ -70,11 +84,14 @@ struct query_data {
 	/* EDNS */
 	knot_rrset_t opt_rr;
 	uint8_t *opt_rr_pos;  /*!< Place of the OPT RR in wire. */
+	bool cookie_valid;    /*!< Query carries a valid server cookie. */
 
 	/* Extensions. */
 	void *ext;
 	void (*ext_cleanup)(struct query_data*); /*!< Extensions cleanup callback. */
 	knot_sign_context_t sign;            /*!< Signing context. */
+	knot_tsig_stream_t *tsig_stream;     /*!< Running digest of unsigned responses. */
+	unsigned flags;                      /*!< Query flags (enum query_flag). */
 
 	/* Everything below should be kept on reset. */
 	struct process_query_param *param; /*!< Module parameters. */
@@ -20,7 +20,7 @@
 #include "contrib/openbsd/strlcpy.h"
 
 /* Compiled-in module headers. */
-#include "knot/modules/synth_record.h"
+#include "knot/modules/synth_record/module.h"
 #include "knot/modules/dnsproxy.h"
 #include "knot/modules/online_sign/module.h"
 #ifdef HAVE_ROSEDB
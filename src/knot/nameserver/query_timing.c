@@ -0,0 +1,75 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+
+#include "knot/nameserver/query_timing.h"
+#include "contrib/time.h"
+
+static const char *stage_names[QTIME_STAGES] = {
+	[QTIME_ZONE_FIND]  = "zone-find",
+	[QTIME_PREPARE]    = "prepare",
+	[QTIME_PLAN_BEGIN] = "plan-begin",
+	[QTIME_ANSWER]     = "answer",
+	[QTIME_AUTHORITY]  = "authority",
+	[QTIME_ADDITIONAL] = "additional",
+	[QTIME_PLAN_END]   = "plan-end",
+	[QTIME_TSIG]       = "tsig",
+	[QTIME_RRL]        = "rrl",
+	[QTIME_TOTAL]      = "total",
+	[QTIME_SEND]       = "send",
+};
+
+const char *qtime_stage_name(enum qtime_stage stage)
+{
+	if (stage >= QTIME_STAGES) {
+		return NULL;
+	}
+
+	return stage_names[stage];
+}
+
+uint64_t qtime_now(void)
+{
+	timev_t now;
+	time_now(&now);
+#ifdef HAVE_CLOCK_GETTIME
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#else
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_usec * 1000;
+#endif
+}
+
+void qtime_record(query_timing_t *timing, enum qtime_stage stage, uint64_t ns)
+{
+	if (timing == NULL) {
+		return;
+	}
+
+	assert(stage < QTIME_STAGES);
+	hist_record(&timing->stage[stage], ns);
+}
+
+void qtime_merge(query_timing_t *dst, const query_timing_t *src)
+{
+	if (dst == NULL || src == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < QTIME_STAGES; i++) {
+		hist_merge(&dst->stage[i], &src->stage[i]);
+	}
+}
@@ -0,0 +1,104 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file
+ *
+ * \brief Per-stage query processing timing.
+ *
+ * Each I/O thread owns one set of latency histograms (one per
+ * processing stage), so that recording never needs any synchronization.
+ * The histograms are aggregated over all threads only when dumped.
+ *
+ * The instrumentation is compiled in only if configured with
+ * --enable-query-timing, otherwise the QTIME_* macros expand to nothing.
+ *
+ * \addtogroup query_processing
+ * @{
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "contrib/hist.h"
+
+/*! \brief Timed query processing stages. */
+enum qtime_stage {
+	QTIME_ZONE_FIND = 0, /*!< Zone lookup in answer_zone_find(). */
+	QTIME_PREPARE,       /*!< Response initialization including EDNS. */
+	QTIME_PLAN_BEGIN,    /*!< Global query modules QPLAN_BEGIN steps. */
+	QTIME_ANSWER,        /*!< Answer section (solvers and modules). */
+	QTIME_AUTHORITY,     /*!< Authority section (solvers and modules). */
+	QTIME_ADDITIONAL,    /*!< Additional section (solvers and modules). */
+	QTIME_PLAN_END,      /*!< Global query modules QPLAN_END steps. */
+	QTIME_TSIG,          /*!< Response signing. */
+	QTIME_RRL,           /*!< Response rate limiting. */
+	QTIME_TOTAL,         /*!< Whole response production. */
+	QTIME_SEND,          /*!< Response send (per batch for UDP). */
+	QTIME_STAGES
+};
+
+/*! \brief Set of histograms owned by a single I/O thread. */
+typedef struct query_timing {
+	hist_t stage[QTIME_STAGES];
+} query_timing_t;
+
+/*!
+ * \brief Returns a stage name.
+ */
+const char *qtime_stage_name(enum qtime_stage stage);
+
+/*!
+ * \brief Returns a monotonic timestamp in nanoseconds.
+ */
+uint64_t qtime_now(void);
+
+/*!
+ * \brief Records one stage duration into the thread histograms.
+ *
+ * \param timing  Thread histograms (may be NULL).
+ * \param stage   Measured stage.
+ * \param ns      Duration in nanoseconds.
+ */
+void qtime_record(query_timing_t *timing, enum qtime_stage stage, uint64_t ns);
+
+/*!
+ * \brief Merges the source histograms into the destination ones.
+ *
+ * \note The source may be concurrently updated by its owner thread, so the
+ *       result is a (slightly inconsistent) snapshot.
+ */
+void qtime_merge(query_timing_t *dst, const query_timing_t *src);
+
+#ifdef ENABLE_QUERY_TIMING
+  /*! \brief Starts a measurement stored in a local variable. */
+  #define QTIME_START(t) uint64_t t = qtime_now()
+  /*! \brief Records the time since the last mark and restarts the mark. */
+  #define QTIME_LAP(timing, stage, t) { \
+	uint64_t _now = qtime_now(); \
+	qtime_record((timing), (stage), _now - (t)); \
+	(t) = _now; \
+  }
+  /*! \brief Records the time since the mark. */
+  #define QTIME_STOP(timing, stage, t) \
+	qtime_record((timing), (stage), qtime_now() - (t))
+#else
+  #define QTIME_START(t)
+  #define QTIME_LAP(timing, stage, t)
+  #define QTIME_STOP(timing, stage, t)
+#endif
+
+/*! @} */
@@ -19,11 +19,6 @@
 #include "knot/nameserver/tsig_ctx.h"
 #include "libknot/libknot.h"
 
-/*!
- * Maximal total size for unsigned messages.
- */
-static const size_t TSIG_BUFFER_MAX_SIZE = (UINT16_MAX * 100);
-
 void tsig_init(tsig_ctx_t *ctx, const knot_tsig_key_t *key)
 {
 	if (!ctx) {
@@ -40,7 +35,7 @@ void tsig_cleanup(tsig_ctx_t *ctx)
 		return;
 	}
 
-	free(ctx->buffer);
+	knot_tsig_stream_free(ctx->stream);
 	memset(ctx, 0, sizeof(*ctx));
 }
 
@@ -86,36 +81,6 @@ static int update_ctx_after_verify(tsig_ctx_t *ctx, knot_rrset_t *tsig_rr)
 	memcpy(ctx->digest, knot_tsig_rdata_mac(tsig_rr), ctx->digest_size);
 	ctx->prev_signed_time = knot_tsig_rdata_time_signed(tsig_rr);
 	ctx->unsigned_count = 0;
-	ctx->buffer_used = 0;
-
-	return KNOT_EOK;
-}
-
-static int buffer_add_packet(tsig_ctx_t *ctx, knot_pkt_t *packet)
-{
-	size_t need = ctx->buffer_used + packet->size;
-
-	// Inflate the buffer if necessary.
-
-	if (need > TSIG_BUFFER_MAX_SIZE) {
-		return KNOT_ENOMEM;
-	}
-
-	if (need > ctx->buffer_size) {
-		uint8_t *buffer = realloc(ctx->buffer, need);
-		if (!buffer) {
-			return KNOT_ENOMEM;
-		}
-
-		ctx->buffer = buffer;
-		ctx->buffer_size = need;
-	}
-
-	// Buffer the packet.
-
-	uint8_t *write = ctx->buffer + ctx->buffer_used;
-	memcpy(write, packet->wire, packet->size);
-	ctx->buffer_used = need;
 
 	return KNOT_EOK;
 }
@@ -130,14 +95,25 @@ int tsig_verify_packet(tsig_ctx_t *ctx, knot_pkt_t *packet)
 		return KNOT_EOK;
 	}
 
-	int ret = buffer_add_packet(ctx, packet);
-	if (ret != KNOT_EOK) {
-		return ret;
+	if (ctx->stream == NULL) {
+		ctx->stream = knot_tsig_stream_new();
+		if (ctx->stream == NULL) {
+			return KNOT_ENOMEM;
+		}
 	}
 
-	// Unsigned packet.
+	int ret = KNOT_EOK;
+
+	// Unsigned packet, added to the digest of the next signed one.
 
 	if (packet->tsig_rr == NULL) {
+		ret = knot_tsig_stream_add(ctx->stream, ctx->key, ctx->digest,
+		                           ctx->digest_size, packet->wire,
+		                           packet->size);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+
 		ctx->unsigned_count += 1;
 		return KNOT_EOK;
 	}
@@ -145,14 +121,15 @@ int tsig_verify_packet(tsig_ctx_t *ctx, knot_pkt_t *packet)
 	// Signed packet.
 
 	if (ctx->prev_signed_time == 0) {
-		ret = knot_tsig_client_check(packet->tsig_rr, ctx->buffer,
-		                             ctx->buffer_used, ctx->digest,
-		                             ctx->digest_size, ctx->key, 0);
+		ret = knot_tsig_client_check_stream(ctx->stream, packet->tsig_rr,
+		                                    packet->wire, packet->size,
+		                                    ctx->digest, ctx->digest_size,
+		                                    ctx->key, 0);
 	} else {
-		ret = knot_tsig_client_check_next(packet->tsig_rr, ctx->buffer,
-		                                  ctx->buffer_used, ctx->digest,
-		                                  ctx->digest_size, ctx->key,
-		                                  ctx->prev_signed_time);
+		ret = knot_tsig_client_check_next_stream(ctx->stream, packet->tsig_rr,
+		                                         packet->wire, packet->size,
+		                                         ctx->digest, ctx->digest_size,
+		                                         ctx->key, ctx->prev_signed_time);
 	}
 
 	if (ret != KNOT_EOK) {
@@ -19,7 +19,7 @@
 #include <stdint.h>
 
 #include "libknot/packet/pkt.h"
-#include "libknot/tsig.h"
+#include "libknot/tsig-op.h"
 
 #define TSIG_MAX_DIGEST_SIZE 64
 
@@ -35,9 +35,7 @@ typedef struct tsig_ctx {
 
 	/* Unsigned packets handling. */
 	unsigned unsigned_count;
-	uint8_t *buffer;
-	size_t buffer_used;
-	size_t buffer_size;
+	knot_tsig_stream_t *stream;
 } tsig_ctx_t;
 
 /*!
@@ -0,0 +1,185 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "knot/query/defer.h"
+
+static void defer_data_free(query_defer_t *defer)
+{
+	free(defer->data);
+	free(defer);
+}
+
+static void queue_destroy(ref_t *ref)
+{
+	query_defer_queue_t *queue = (query_defer_queue_t *)ref;
+
+	query_defer_t *defer = NULL, *next = NULL;
+	WALK_LIST_DELSAFE(defer, next, queue->done) {
+		defer_data_free(defer);
+	}
+
+	close(queue->pipe[0]);
+	close(queue->pipe[1]);
+	pthread_mutex_destroy(&queue->lock);
+	free(queue);
+}
+
+static int set_nonblocking(int fd)
+{
+	int flags = fcntl(fd, F_GETFL, 0);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 ||
+	    fcntl(fd, F_SETFD, FD_CLOEXEC) < 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+query_defer_queue_t *query_defer_queue_new(void)
+{
+	query_defer_queue_t *queue = malloc(sizeof(*queue));
+	if (queue == NULL) {
+		return NULL;
+	}
+	memset(queue, 0, sizeof(*queue));
+
+	if (pipe(queue->pipe) != 0) {
+		free(queue);
+		return NULL;
+	}
+	if (set_nonblocking(queue->pipe[0]) != 0 ||
+	    set_nonblocking(queue->pipe[1]) != 0) {
+		close(queue->pipe[0]);
+		close(queue->pipe[1]);
+		free(queue);
+		return NULL;
+	}
+
+	pthread_mutex_init(&queue->lock, NULL);
+	init_list(&queue->done);
+	ref_init(&queue->ref, queue_destroy);
+	ref_retain(&queue->ref);
+
+	return queue;
+}
+
+void query_defer_queue_free(query_defer_queue_t *queue)
+{
+	if (queue == NULL) {
+		return;
+	}
+
+	ref_release(&queue->ref);
+}
+
+query_defer_t *query_defer_queue_pop(query_defer_queue_t *queue)
+{
+	if (queue == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&queue->lock);
+
+	/* Consume the wake-ups before checking the answers, the wake-up of an
+	 * answer finished later is written under the lock, so it isn't lost. */
+	uint8_t buf[64];
+	while (read(queue->pipe[0], buf, sizeof(buf)) > 0);
+
+	query_defer_t *defer = NULL;
+	if (!EMPTY_LIST(queue->done)) {
+		defer = HEAD(queue->done);
+		rem_node(&defer->n);
+	}
+	pthread_mutex_unlock(&queue->lock);
+
+	return defer;
+}
+
+query_defer_t *query_defer_new(query_defer_queue_t *queue, const void *owner,
+                               const knot_pkt_t *query, int fd,
+                               const struct sockaddr_storage *remote)
+{
+	if (queue == NULL || query == NULL || remote == NULL) {
+		return NULL;
+	}
+
+	/* The query is stored right after the structure. */
+	query_defer_t *defer = malloc(sizeof(*defer) + query->size);
+	if (defer == NULL) {
+		return NULL;
+	}
+	memset(defer, 0, sizeof(*defer));
+
+	defer->query = (uint8_t *)(defer + 1);
+	defer->query_len = query->size;
+	memcpy(defer->query, query->wire, query->size);
+	memcpy(&defer->remote, remote, sizeof(*remote));
+	defer->fd = fd;
+	defer->owner = owner;
+
+	ref_retain(&queue->ref);
+	defer->queue = queue;
+	defer->generation = queue->generation;
+
+	return defer;
+}
+
+void query_defer_finish(query_defer_t *defer, const uint8_t *data, size_t len)
+{
+	if (defer == NULL || defer->queue == NULL) {
+		return;
+	}
+
+	/* Answer fails if there is no memory for the data. */
+	if (data != NULL) {
+		defer->data = malloc(len);
+		if (defer->data != NULL) {
+			memcpy(defer->data, data, len);
+			defer->data_len = len;
+		}
+	}
+
+	/* The worker owns the answer from now on. */
+	query_defer_queue_t *queue = defer->queue;
+	defer->queue = NULL;
+
+	pthread_mutex_lock(&queue->lock);
+	if (EMPTY_LIST(queue->done)) {
+		(void)write(queue->pipe[1], "", 1);
+	}
+	add_tail(&queue->done, &defer->n);
+	pthread_mutex_unlock(&queue->lock);
+
+	ref_release(&queue->ref);
+}
+
+void query_defer_free(query_defer_t *defer)
+{
+	if (defer == NULL) {
+		return;
+	}
+
+	if (defer->queue != NULL) {
+		ref_release(&defer->queue->ref);
+	}
+
+	defer_data_free(defer);
+}
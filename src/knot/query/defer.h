@@ -0,0 +1,122 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file
+ *
+ * \brief Deferred UDP answers.
+ *
+ * A query module can defer a UDP answer until its data are available (e.g.
+ * a forwarded query is answered by the upstream). The finished answer data
+ * are queued back to the worker which received the query. The worker then
+ * processes the query again, but only through the end of the query plans
+ * (of the zone and the global one), where the module puts the data into
+ * the response. So the answer passes
+ * the rate limiting and the other end of the plan steps as any other one.
+ *
+ * The worker drops the deferred answers received before an interface
+ * reload, as the socket they should be sent from may not exist anymore.
+ *
+ * \addtogroup query_processing
+ * @{
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "knot/common/ref.h"
+#include "libknot/packet/pkt.h"
+#include "contrib/ucw/lists.h"
+
+/*! \brief Queue of deferred answers finished for a worker. */
+typedef struct query_defer_queue {
+	ref_t ref;                   /*!< Held by the worker and the unfinished answers. */
+	pthread_mutex_t lock;        /*!< Finished answers lock. */
+	list_t done;                 /*!< Finished answers. */
+	int pipe[2];                 /*!< Wake-up pipe, the worker polls pipe[0]. */
+	unsigned generation;         /*!< Worker sockets generation. */
+} query_defer_queue_t;
+
+/*! \brief Deferred answer. */
+typedef struct query_defer {
+	node_t n;
+	query_defer_queue_t *queue;      /*!< Worker queue (if unfinished). */
+	unsigned generation;             /*!< Worker sockets generation. */
+	const void *owner;               /*!< Instance which finishes the answer. */
+	int fd;                          /*!< Socket the query was received on. */
+	struct sockaddr_storage remote;  /*!< Client address. */
+	uint8_t *query;                  /*!< Original query. */
+	size_t query_len;
+	unsigned query_flags;            /*!< Flags of the original query. */
+	uint8_t *data;                   /*!< Answer data, NULL if failed. */
+	size_t data_len;
+} query_defer_t;
+
+/*!
+ * \brief Creates a queue of deferred answers for a worker.
+ *
+ * \return Queue or NULL on error.
+ */
+query_defer_queue_t *query_defer_queue_new(void);
+
+/*!
+ * \brief Releases the worker reference to the queue.
+ *
+ * The queue is freed once all the deferred answers are finished or freed.
+ */
+void query_defer_queue_free(query_defer_queue_t *queue);
+
+/*!
+ * \brief Takes a finished answer from the queue.
+ *
+ * \note Called from the worker only, empties the wake-up pipe first.
+ *
+ * \return Finished answer (to be freed by the caller) or NULL.
+ */
+query_defer_t *query_defer_queue_pop(query_defer_queue_t *queue);
+
+/*!
+ * \brief Defers the answer to a query received by the queue worker.
+ *
+ * \param queue   Worker queue.
+ * \param owner   Instance which will finish the answer.
+ * \param query   Query message.
+ * \param fd      Socket the query was received on.
+ * \param remote  Client address.
+ *
+ * \return Deferred answer or NULL on error.
+ */
+query_defer_t *query_defer_new(query_defer_queue_t *queue, const void *owner,
+                               const knot_pkt_t *query, int fd,
+                               const struct sockaddr_storage *remote);
+
+/*!
+ * \brief Stores the answer data and passes the answer to the worker.
+ *
+ * \param defer  Deferred answer.
+ * \param data   Answer data, NULL if the answer failed.
+ * \param len    Answer data length.
+ */
+void query_defer_finish(query_defer_t *defer, const uint8_t *data, size_t len);
+
+/*!
+ * \brief Frees the deferred answer, the unfinished one is dropped.
+ */
+void query_defer_free(query_defer_t *defer);
+
+/*! @} */
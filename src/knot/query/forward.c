@@ -0,0 +1,464 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "knot/query/forward.h"
+#include "libknot/errcode.h"
+#include "dnssec/random.h"
+#include "contrib/mempattern.h"
+#include "contrib/net.h"
+#include "contrib/sockaddr.h"
+#include "contrib/time.h"
+#include "contrib/tolower.h"
+#include "contrib/ucw/lists.h"
+
+/*! \brief Number of persistent upstream UDP sockets. */
+#define FWD_UDP_SOCKETS 4
+/*! \brief Maximum number of pending UDP queries. */
+#define FWD_MAX_PENDING 4096
+/*! \brief Maximum number of idle upstream TCP connections. */
+#define FWD_TCP_POOL 8
+/*! \brief Engine poll timeout without pending queries. */
+#define FWD_IDLE_TIMEOUT 200
+
+/*! \brief Question section size limit (QNAME, QTYPE, QCLASS). */
+#define QUESTION_MAXLEN (KNOT_DNAME_MAXLEN + 2 * sizeof(uint16_t))
+
+/*! \brief Pending UDP query. */
+typedef struct {
+	node_t n;                         /*!< Pending or free list node. */
+	uint64_t deadline;                /*!< Timeout timestamp in ms. */
+	query_defer_t *defer;             /*!< Deferred answer. */
+	uint16_t id;                      /*!< Upstream message ID. */
+	uint8_t sock;                     /*!< Upstream socket index. */
+	uint16_t question_len;            /*!< Question section length. */
+	uint8_t header[KNOT_WIRE_HEADER_SIZE]; /*!< Original query header. */
+	uint8_t question[QUESTION_MAXLEN];     /*!< Original question. */
+} fwd_slot_t;
+
+struct knot_forwarder {
+	struct sockaddr_storage remote;   /*!< Upstream address. */
+	struct sockaddr_storage via;      /*!< Source address. */
+
+	pthread_mutex_t lock;             /*!< Pending table lock. */
+	int udp[FWD_UDP_SOCKETS];         /*!< Connected upstream UDP sockets. */
+	uint16_t *id_map[FWD_UDP_SOCKETS];/*!< Message ID -> slot index + 1. */
+	unsigned next_sock;               /*!< Round-robin socket selector. */
+	fwd_slot_t *slots;                /*!< Pending table storage. */
+	list_t pending;                   /*!< Pending queries in submit order. */
+	list_t free;                      /*!< Unused slots. */
+
+	pthread_mutex_t tcp_lock;         /*!< TCP pool lock. */
+	int tcp_pool[FWD_TCP_POOL];       /*!< Idle upstream TCP connections. */
+	unsigned tcp_idle;                /*!< Number of idle connections. */
+
+	uint8_t *wire;                    /*!< Engine receive buffer. */
+	pthread_t thread;                 /*!< Engine thread. */
+	volatile bool stop;               /*!< Engine stop request. */
+};
+
+static uint64_t now_ms(void)
+{
+	timev_t now;
+	time_now(&now);
+#ifdef HAVE_CLOCK_GETTIME
+	return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#else
+	return (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+#endif
+}
+
+/*! \brief Return slot to the free list (lock must be held). */
+static void slot_release(knot_forwarder_t *fwd, fwd_slot_t *slot)
+{
+	fwd->id_map[slot->sock][slot->id] = 0;
+	rem_node(&slot->n);
+	add_tail(&fwd->free, &slot->n);
+}
+
+/*! \brief Compare question sections, the QNAME case-insensitively. */
+static bool question_match(const fwd_slot_t *slot, const uint8_t *question)
+{
+	size_t qname_len = slot->question_len - 2 * sizeof(uint16_t);
+	for (size_t i = 0; i < qname_len; i++) {
+		if (knot_tolower(slot->question[i]) != knot_tolower(question[i])) {
+			return false;
+		}
+	}
+
+	return memcmp(slot->question + qname_len, question + qname_len,
+	              2 * sizeof(uint16_t)) == 0;
+}
+
+static void relay_response(knot_forwarder_t *fwd, unsigned sock,
+                           uint8_t *wire, size_t len)
+{
+	if (len < KNOT_WIRE_HEADER_SIZE || !knot_wire_get_qr(wire) ||
+	    knot_wire_get_qdcount(wire) != 1) {
+		return;
+	}
+
+	pthread_mutex_lock(&fwd->lock);
+
+	uint16_t idx = fwd->id_map[sock][knot_wire_get_id(wire)];
+	if (idx == 0) {
+		pthread_mutex_unlock(&fwd->lock);
+		return; /* Late or unsolicited response. */
+	}
+
+	fwd_slot_t *slot = &fwd->slots[idx - 1];
+	if (len < KNOT_WIRE_HEADER_SIZE + slot->question_len ||
+	    !question_match(slot, wire + KNOT_WIRE_HEADER_SIZE)) {
+		pthread_mutex_unlock(&fwd->lock);
+		return; /* Not a response to the pending query. */
+	}
+
+	query_defer_t *defer = slot->defer;
+	knot_wire_set_id(wire, knot_wire_get_id(slot->header));
+	slot_release(fwd, slot);
+
+	pthread_mutex_unlock(&fwd->lock);
+
+	query_defer_finish(defer, wire, len);
+}
+
+/*! \brief Fail expired queries, return time to next expiry. */
+static int expire_pending(knot_forwarder_t *fwd)
+{
+	for (;;) {
+		pthread_mutex_lock(&fwd->lock);
+
+		if (EMPTY_LIST(fwd->pending)) {
+			pthread_mutex_unlock(&fwd->lock);
+			return FWD_IDLE_TIMEOUT;
+		}
+
+		fwd_slot_t *slot = HEAD(fwd->pending);
+		uint64_t now = now_ms();
+		if (slot->deadline > now) {
+			uint64_t wait = slot->deadline - now;
+			pthread_mutex_unlock(&fwd->lock);
+			return (wait < FWD_IDLE_TIMEOUT) ? wait : FWD_IDLE_TIMEOUT;
+		}
+
+		query_defer_t *defer = slot->defer;
+		slot_release(fwd, slot);
+
+		pthread_mutex_unlock(&fwd->lock);
+
+		query_defer_finish(defer, NULL, 0);
+	}
+}
+
+static void *engine_thread(void *arg)
+{
+	knot_forwarder_t *fwd = arg;
+
+	struct pollfd fds[FWD_UDP_SOCKETS];
+	for (unsigned i = 0; i < FWD_UDP_SOCKETS; i++) {
+		fds[i].fd = fwd->udp[i];
+		fds[i].events = POLLIN;
+	}
+
+	uint8_t *wire = fwd->wire;
+	int timeout = FWD_IDLE_TIMEOUT;
+	while (!fwd->stop) {
+		int events = poll(fds, FWD_UDP_SOCKETS, timeout);
+		for (unsigned i = 0; i < FWD_UDP_SOCKETS && events > 0; i++) {
+			if (fds[i].revents == 0) {
+				continue;
+			}
+			events -= 1;
+
+			/* Drain the socket. */
+			ssize_t len;
+			while ((len = recv(fds[i].fd, wire, KNOT_WIRE_MAX_PKTSIZE,
+			                   MSG_DONTWAIT)) > 0) {
+				relay_response(fwd, i, wire, len);
+			}
+		}
+
+		timeout = expire_pending(fwd);
+	}
+
+	return NULL;
+}
+
+static void forwarder_close(knot_forwarder_t *fwd)
+{
+	fwd_slot_t *slot = NULL;
+	WALK_LIST(slot, fwd->pending) {
+		query_defer_free(slot->defer);
+	}
+
+	for (unsigned i = 0; i < FWD_UDP_SOCKETS; i++) {
+		if (fwd->udp[i] >= 0) {
+			close(fwd->udp[i]);
+		}
+		free(fwd->id_map[i]);
+	}
+	for (unsigned i = 0; i < fwd->tcp_idle; i++) {
+		close(fwd->tcp_pool[i]);
+	}
+	free(fwd->slots);
+	free(fwd->wire);
+	pthread_mutex_destroy(&fwd->lock);
+	pthread_mutex_destroy(&fwd->tcp_lock);
+	free(fwd);
+}
+
+knot_forwarder_t *knot_forwarder_new(const struct sockaddr *remote,
+                                     const struct sockaddr *via)
+{
+	if (remote == NULL) {
+		return NULL;
+	}
+
+	knot_forwarder_t *fwd = malloc(sizeof(*fwd));
+	if (fwd == NULL) {
+		return NULL;
+	}
+	memset(fwd, 0, sizeof(*fwd));
+
+	memcpy(&fwd->remote, remote, sockaddr_len(remote));
+	if (via != NULL && via->sa_family != AF_UNSPEC) {
+		memcpy(&fwd->via, via, sockaddr_len(via));
+	}
+	pthread_mutex_init(&fwd->lock, NULL);
+	pthread_mutex_init(&fwd->tcp_lock, NULL);
+	init_list(&fwd->pending);
+	init_list(&fwd->free);
+
+	/* Open persistent upstream sockets. */
+	bool failed = false;
+	for (unsigned i = 0; i < FWD_UDP_SOCKETS; i++) {
+		fwd->udp[i] = net_connected_socket(SOCK_DGRAM,
+		                                   (struct sockaddr *)&fwd->remote,
+		                                   (struct sockaddr *)&fwd->via);
+		fwd->id_map[i] = calloc(UINT16_MAX + 1, sizeof(uint16_t));
+		if (fwd->udp[i] < 0 || fwd->id_map[i] == NULL) {
+			failed = true;
+		}
+	}
+
+	/* Create the pending table. */
+	fwd->slots = calloc(FWD_MAX_PENDING, sizeof(fwd_slot_t));
+	fwd->wire = malloc(KNOT_WIRE_MAX_PKTSIZE);
+	if (failed || fwd->slots == NULL || fwd->wire == NULL) {
+		forwarder_close(fwd);
+		return NULL;
+	}
+	for (unsigned i = 0; i < FWD_MAX_PENDING; i++) {
+		add_tail(&fwd->free, &fwd->slots[i].n);
+	}
+
+	if (pthread_create(&fwd->thread, NULL, engine_thread, fwd) != 0) {
+		forwarder_close(fwd);
+		return NULL;
+	}
+
+	return fwd;
+}
+
+void knot_forwarder_free(knot_forwarder_t *fwd)
+{
+	if (fwd == NULL) {
+		return;
+	}
+
+	fwd->stop = true;
+	pthread_join(fwd->thread, NULL);
+
+	forwarder_close(fwd);
+}
+
+int knot_forwarder_udp(knot_forwarder_t *fwd, const knot_pkt_t *query,
+                       query_defer_t *defer, int timeout_ms)
+{
+	if (fwd == NULL || query == NULL || defer == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	uint16_t question_len = knot_pkt_question_size(query);
+	if (query->size < KNOT_WIRE_HEADER_SIZE + question_len ||
+	    query->qname_size == 0) {
+		return KNOT_EMALF;
+	}
+
+	/* Register the query in the pending table. */
+	pthread_mutex_lock(&fwd->lock);
+
+	if (EMPTY_LIST(fwd->free)) {
+		pthread_mutex_unlock(&fwd->lock);
+		return KNOT_ELIMIT;
+	}
+
+	fwd_slot_t *slot = HEAD(fwd->free);
+	slot->sock = fwd->next_sock++ % FWD_UDP_SOCKETS;
+	uint16_t *id_map = fwd->id_map[slot->sock];
+	uint16_t id = dnssec_random_uint16_t();
+	while (id_map[id] != 0) {
+		id++; /* Always terminates, there are fewer slots than IDs. */
+	}
+	id_map[id] = slot - fwd->slots + 1;
+
+	slot->id = id;
+	slot->deadline = now_ms() + timeout_ms;
+	slot->defer = defer;
+	memcpy(slot->header, query->wire, KNOT_WIRE_HEADER_SIZE);
+	memcpy(slot->question, query->wire + KNOT_WIRE_HEADER_SIZE, question_len);
+	slot->question_len = question_len;
+
+	rem_node(&slot->n);
+	add_tail(&fwd->pending, &slot->n);
+
+	int fd = fwd->udp[slot->sock];
+
+	pthread_mutex_unlock(&fwd->lock);
+
+	/* Send the query with the upstream ID, the rest is unchanged. */
+	uint8_t header[KNOT_WIRE_HEADER_SIZE];
+	memcpy(header, query->wire, sizeof(header));
+	knot_wire_set_id(header, id);
+
+	struct iovec iov[2] = {
+		{ header, sizeof(header) },
+		{ query->wire + sizeof(header), query->size - sizeof(header) }
+	};
+	struct msghdr msg = {
+		.msg_iov = iov,
+		.msg_iovlen = 2
+	};
+
+	if (sendmsg(fd, &msg, MSG_DONTWAIT) < 0) {
+		int ret = knot_map_errno();
+		pthread_mutex_lock(&fwd->lock);
+		/* The slot may have already expired, check the ownership. */
+		if (id_map[id] == slot - fwd->slots + 1 && slot->defer == defer) {
+			slot_release(fwd, slot);
+		} else {
+			ret = KNOT_EOK; /* Already failed by the engine. */
+		}
+		pthread_mutex_unlock(&fwd->lock);
+		return ret;
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Take an idle upstream connection or open a new one. */
+static int tcp_acquire(knot_forwarder_t *fwd, bool *reused)
+{
+	pthread_mutex_lock(&fwd->tcp_lock);
+	if (fwd->tcp_idle > 0) {
+		int fd = fwd->tcp_pool[--fwd->tcp_idle];
+		pthread_mutex_unlock(&fwd->tcp_lock);
+		*reused = true;
+		return fd;
+	}
+	pthread_mutex_unlock(&fwd->tcp_lock);
+
+	*reused = false;
+	return net_connected_socket(SOCK_STREAM, (struct sockaddr *)&fwd->remote,
+	                            (struct sockaddr *)&fwd->via);
+}
+
+/*! \brief Return a connection to the idle pool. */
+static void tcp_release(knot_forwarder_t *fwd, int fd)
+{
+	pthread_mutex_lock(&fwd->tcp_lock);
+	if (fwd->tcp_idle < FWD_TCP_POOL) {
+		fwd->tcp_pool[fwd->tcp_idle++] = fd;
+		fd = -1;
+	}
+	pthread_mutex_unlock(&fwd->tcp_lock);
+
+	if (fd >= 0) {
+		close(fd);
+	}
+}
+
+int knot_forwarder_tcp(knot_forwarder_t *fwd, const knot_pkt_t *query,
+                       knot_pkt_t *answer, int timeout_ms)
+{
+	if (fwd == NULL || query == NULL || answer == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	knot_mm_t *mm = &answer->mm;
+	uint8_t *wire = mm_alloc(mm, KNOT_WIRE_MAX_PKTSIZE);
+	if (wire == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	uint16_t id = dnssec_random_uint16_t();
+	ssize_t len = KNOT_ECONN;
+	for (;;) {
+		bool reused = false;
+		int fd = tcp_acquire(fwd, &reused);
+		if (fd < 0) {
+			len = fd;
+			break;
+		}
+
+		memcpy(wire, query->wire, query->size);
+		knot_wire_set_id(wire, id);
+
+		len = net_dns_tcp_send(fd, wire, query->size, timeout_ms);
+		if (len >= 0) {
+			len = net_dns_tcp_recv(fd, wire, KNOT_WIRE_MAX_PKTSIZE, timeout_ms);
+		}
+		if (len >= KNOT_WIRE_HEADER_SIZE && knot_wire_get_id(wire) == id) {
+			tcp_release(fwd, fd);
+			break;
+		}
+		close(fd);
+
+		/* An idle connection may have been closed by the upstream. */
+		if (!reused) {
+			if (len >= 0) {
+				len = KNOT_EMALF;
+			}
+			break;
+		}
+	}
+
+	if (len < 0) {
+		mm_free(mm, wire);
+		return len;
+	}
+
+	/* Restore the original ID and store the response. */
+	knot_wire_set_id(wire, knot_wire_get_id(query->wire));
+
+	int ret = KNOT_ENOMEM;
+	knot_pkt_t *resp = knot_pkt_new(wire, len, mm);
+	if (resp != NULL) {
+		ret = knot_pkt_copy(answer, resp);
+		knot_pkt_free(&resp);
+	}
+	mm_free(mm, wire);
+
+	return ret;
+}
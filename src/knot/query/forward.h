@@ -0,0 +1,97 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file
+ *
+ * \brief Query forwarding engine.
+ *
+ * UDP queries are forwarded asynchronously. The query is sent over one of
+ * several persistent upstream sockets with a fresh message ID, its deferred
+ * answer is stored in a pending table indexed by the upstream socket and ID,
+ * and the submitting thread returns immediately. An engine thread receives
+ * the upstream responses and passes them back to the workers through the
+ * deferred answers, or fails the answers when the upstream doesn't reply
+ * in time.
+ *
+ * TCP queries are forwarded synchronously over pooled persistent upstream
+ * connections.
+ *
+ * \addtogroup query_processing
+ * @{
+ */
+
+#pragma once
+
+#include <sys/socket.h>
+
+#include "knot/query/defer.h"
+#include "libknot/packet/pkt.h"
+
+struct knot_forwarder;
+typedef struct knot_forwarder knot_forwarder_t;
+
+/*!
+ * \brief Creates a forwarder and starts its engine thread.
+ *
+ * \param remote  Upstream server address.
+ * \param via     Source address (can be NULL or AF_UNSPEC).
+ *
+ * \return Forwarder or NULL on error.
+ */
+knot_forwarder_t *knot_forwarder_new(const struct sockaddr *remote,
+                                     const struct sockaddr *via);
+
+/*!
+ * \brief Stops the engine thread and frees the forwarder.
+ *
+ * Pending UDP queries are dropped without an answer.
+ */
+void knot_forwarder_free(knot_forwarder_t *fwd);
+
+/*!
+ * \brief Forwards a UDP query asynchronously.
+ *
+ * The deferred answer is finished with the upstream response, which has
+ * the original message ID, or with no data if the upstream doesn't reply
+ * in time.
+ *
+ * \param fwd         Forwarder.
+ * \param query       Query message.
+ * \param defer       Deferred answer, owned by the forwarder on success.
+ * \param timeout_ms  Upstream response timeout.
+ *
+ * \retval KNOT_EOK if the query was sent upstream.
+ * \retval KNOT_ELIMIT if too many queries are pending.
+ * \return Other error code if the query couldn't be forwarded.
+ */
+int knot_forwarder_udp(knot_forwarder_t *fwd, const knot_pkt_t *query,
+                       query_defer_t *defer, int timeout_ms);
+
+/*!
+ * \brief Forwards a TCP query over a pooled upstream connection and waits
+ *        for the response.
+ *
+ * \param fwd         Forwarder.
+ * \param query       Query message.
+ * \param answer      Response destination.
+ * \param timeout_ms  Upstream I/O timeout.
+ *
+ * \return KNOT_E*
+ */
+int knot_forwarder_tcp(knot_forwarder_t *fwd, const knot_pkt_t *query,
+                       knot_pkt_t *answer, int timeout_ms);
+
+/*! @} */
@@ -274,7 +274,8 @@ static int prepare_edns(conf_t *conf, zone_t *zone, knot_pkt_t *pkt,
 
 /*! \brief Process query using requestor. */
 static int zone_query_request(knot_pkt_t *query, const conf_remote_t *remote,
-                              struct process_answer_param *param, knot_mm_t *mm)
+                              struct process_answer_param *param, knot_mm_t *mm,
+                              unsigned flags)
 {
 	/* Create requestor instance. */
 	const knot_layer_api_t *api = process_answer_layer();
@@ -287,7 +288,7 @@ static int zone_query_request(knot_pkt_t *query, const conf_remote_t *remote,
 	/* Create a request. */
 	const struct sockaddr *dst = (const struct sockaddr *)&remote->addr;
 	const struct sockaddr *src = (const struct sockaddr *)&remote->via;
-	struct knot_request *req = knot_request_make(re.mm, dst, src, query, 0);
+	struct knot_request *req = knot_request_make(re.mm, dst, src, query, flags);
 	if (req == NULL) {
 		knot_requestor_clear(&re);
 		return KNOT_ENOMEM;
@@ -352,8 +353,9 @@ int zone_query_execute(conf_t *conf, zone_t *zone, uint16_t pkt_type,
 		return ret;
 	}
 
-	/* Process the query. */
-	ret = zone_query_request(query, remote, &param, &mm);
+	/* Process the query, AXFR answer RRs are read directly from the wire. */
+	unsigned flags = (pkt_type == KNOT_QUERY_AXFR) ? KNOT_RQ_NOANSWER : 0;
+	ret = zone_query_request(query, remote, &param, &mm, flags);
 
 	/* Cleanup. */
 	tsig_cleanup(&param.tsig_ctx);
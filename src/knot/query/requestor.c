@@ -208,7 +208,8 @@ static int request_io(struct knot_requestor *req, struct knot_request *last,
 			return ret;
 		}
 
-		(void) knot_pkt_parse(resp, 0);
+		unsigned flags = (last->flags & KNOT_RQ_NOANSWER) ? KNOT_PF_NOANSWER : 0;
+		(void) knot_pkt_parse(resp, flags);
 		knot_layer_consume(&req->layer, resp);
 	}
 
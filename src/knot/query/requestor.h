@@ -27,7 +27,8 @@ struct knot_request;
 
 /* Requestor flags. */
 enum {
-	KNOT_RQ_UDP = 1 << 0  /* Use UDP for requests. */
+	KNOT_RQ_UDP      = 1 << 0, /* Use UDP for requests. */
+	KNOT_RQ_NOANSWER = 1 << 1  /* Don't parse answer RRs (see KNOT_PF_NOANSWER). */
 };
 
 /*! \brief Requestor structure.
@@ -0,0 +1,109 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "dnssec/error.h"
+#include "dnssec/random.h"
+#include "knot/server/cookies.h"
+#include "libknot/cookies/alg-fnv64.h"
+#include "libknot/errcode.h"
+#include "libknot/rrtype/opt-cookie.h"
+
+/*! \brief Server cookie algorithm. */
+#define COOKIE_ALG (&knot_sc_alg_fnv64)
+
+int cookie_secrets_init(cookie_secrets_t *secrets)
+{
+	if (secrets == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	memset(secrets, 0, sizeof(*secrets));
+
+	int ret = dnssec_random_buffer((uint8_t *)secrets->secret,
+	                               sizeof(secrets->secret));
+	if (ret != DNSSEC_EOK) {
+		return KNOT_ERROR;
+	}
+
+	return KNOT_EOK;
+}
+
+int cookie_secrets_rotate(cookie_secrets_t *secrets)
+{
+	if (secrets == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	/* Write the unused slot, then publish it. */
+	unsigned next = (secrets->current + 1) % COOKIE_SECRET_SLOTS;
+	int ret = dnssec_random_buffer(secrets->secret[next], COOKIE_SECRET_LEN);
+	if (ret != DNSSEC_EOK) {
+		return KNOT_ERROR;
+	}
+
+	__sync_synchronize();
+	secrets->current = next;
+
+	return KNOT_EOK;
+}
+
+bool cookie_check(const cookie_secrets_t *secrets, const struct sockaddr *remote,
+                  const struct knot_dns_cookies *cookies)
+{
+	if (secrets == NULL || remote == NULL || cookies == NULL) {
+		return false;
+	}
+
+	/* Try the current secret, then the previous one. */
+	unsigned slot = secrets->current;
+	for (int i = 0; i < 2; i++) {
+		struct knot_sc_private srvr_data = {
+			.clnt_sockaddr = remote,
+			.secret_data = secrets->secret[slot],
+			.secret_len = COOKIE_SECRET_LEN
+		};
+		if (knot_sc_check(0, cookies, &srvr_data, COOKIE_ALG) == KNOT_EOK) {
+			return true;
+		}
+		slot = (slot + COOKIE_SECRET_SLOTS - 1) % COOKIE_SECRET_SLOTS;
+	}
+
+	return false;
+}
+
+uint16_t cookie_server_write(const cookie_secrets_t *secrets,
+                             const struct sockaddr *remote,
+                             const uint8_t *cc, uint16_t cc_len, uint8_t *sc)
+{
+	if (secrets == NULL || remote == NULL || sc == NULL) {
+		return 0;
+	}
+
+	struct knot_sc_private srvr_data = {
+		.clnt_sockaddr = remote,
+		.secret_data = secrets->secret[secrets->current],
+		.secret_len = COOKIE_SECRET_LEN
+	};
+	struct knot_sc_input input = {
+		.cc = cc,
+		.cc_len = cc_len,
+		.srvr_data = &srvr_data
+	};
+
+	return COOKIE_ALG->hash_func(&input, sc, KNOT_OPT_COOKIE_SRVR_MAX);
+}
@@ -0,0 +1,102 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file
+ *
+ * \brief Server side of DNS Cookies (RFC 7873).
+ *
+ * The server cookie is computed from the client address, the client cookie
+ * and a server secret. The secret is periodically replaced by a new one,
+ * cookies computed with the previous secret remain valid until the next
+ * rotation.
+ *
+ * \addtogroup server
+ * @{
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "libknot/cookies/server.h"
+
+/*! \brief Server secret length. */
+#define COOKIE_SECRET_LEN	16
+
+/*!
+ * \brief Number of secret slots.
+ *
+ * The current and the previous secrets are in use, the remaining slot is
+ * written on rotation so the readers never see a partially written secret.
+ */
+#define COOKIE_SECRET_SLOTS	3
+
+/*! \brief Server cookie secrets. */
+typedef struct {
+	uint8_t secret[COOKIE_SECRET_SLOTS][COOKIE_SECRET_LEN];
+	volatile unsigned current; /*!< Slot of the current secret. */
+} cookie_secrets_t;
+
+/*!
+ * \brief Initialize the secrets with random data.
+ *
+ * \param secrets  Secrets to initialize.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int cookie_secrets_init(cookie_secrets_t *secrets);
+
+/*!
+ * \brief Generate a new current secret, keep the previous one.
+ *
+ * \note Concurrent rotations are not allowed.
+ *
+ * \param secrets  Secrets to rotate.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int cookie_secrets_rotate(cookie_secrets_t *secrets);
+
+/*!
+ * \brief Check the server cookie against the current and previous secrets.
+ *
+ * \param secrets  Server secrets.
+ * \param remote   Client address.
+ * \param cookies  Received client and server cookies.
+ *
+ * \return True if the server cookie is valid.
+ */
+bool cookie_check(const cookie_secrets_t *secrets, const struct sockaddr *remote,
+                  const struct knot_dns_cookies *cookies);
+
+/*!
+ * \brief Compute the server cookie with the current secret.
+ *
+ * \param secrets  Server secrets.
+ * \param remote   Client address.
+ * \param cc       Client cookie.
+ * \param cc_len   Client cookie length.
+ * \param sc       Output buffer (at least KNOT_OPT_COOKIE_SRVR_MAX long).
+ *
+ * \return Server cookie length, 0 if failed.
+ */
+uint16_t cookie_server_write(const cookie_secrets_t *secrets,
+                             const struct sockaddr *remote,
+                             const uint8_t *cc, uint16_t cc_len, uint8_t *sc);
+
+/*! @} */
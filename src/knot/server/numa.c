@@ -0,0 +1,186 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "knot/server/dthreads.h"
+#include "knot/server/numa.h"
+
+#define SYSFS_NODE_DIR	"/sys/devices/system/node"
+
+/*! \brief CPUs grouped by nodes, the CPUs of node N are cpus[offset[N]..offset[N+1]). */
+static struct {
+	unsigned nodes;
+	unsigned cpu_count;
+	unsigned cpus[NUMA_MAX_CPUS];
+	unsigned offset[NUMA_MAX_NODES + 1];
+} topo;
+
+static pthread_once_t topo_once = PTHREAD_ONCE_INIT;
+
+int numa_parse_list(const char *str, unsigned *out, size_t max)
+{
+	if (str == NULL || out == NULL) {
+		return -1;
+	}
+
+	size_t count = 0;
+	const char *pos = str;
+	while (*pos != '\0' && *pos != '\n') {
+		unsigned long first, last;
+		char *end;
+
+		if (!isdigit((unsigned char)*pos)) {
+			return -1;
+		}
+		first = last = strtoul(pos, &end, 10);
+		pos = end;
+
+		if (*pos == '-') {
+			pos++;
+			if (!isdigit((unsigned char)*pos)) {
+				return -1;
+			}
+			last = strtoul(pos, &end, 10);
+			pos = end;
+		}
+		if (last < first || last > UINT_MAX) {
+			return -1;
+		}
+
+		for (unsigned long i = first; i <= last && count < max; i++) {
+			out[count++] = i;
+		}
+
+		if (*pos == ',') {
+			pos++;
+			if (!isdigit((unsigned char)*pos)) {
+				return -1;
+			}
+		} else if (*pos != '\0' && *pos != '\n') {
+			return -1;
+		}
+	}
+
+	return count;
+}
+
+/*!
+ * \brief Read a sysfs list of numbers.
+ *
+ * \return Number of items stored, -1 on error.
+ */
+static int read_list(const char *path, unsigned *out, size_t max)
+{
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		return -1;
+	}
+
+	char line[4096];
+	if (fgets(line, sizeof(line), file) == NULL) {
+		line[0] = '\0';
+	}
+	fclose(file);
+
+	return numa_parse_list(line, out, max);
+}
+
+static bool load_sysfs(void)
+{
+	unsigned nodes[NUMA_MAX_NODES];
+	int node_count = read_list(SYSFS_NODE_DIR "/online", nodes, NUMA_MAX_NODES);
+	if (node_count <= 0) {
+		return false;
+	}
+
+	for (int i = 0; i < node_count; i++) {
+		char path[64];
+		snprintf(path, sizeof(path), SYSFS_NODE_DIR "/node%u/cpulist", nodes[i]);
+		int ret = read_list(path, topo.cpus + topo.cpu_count,
+		                    NUMA_MAX_CPUS - topo.cpu_count);
+		if (ret < 0) {
+			return false;
+		}
+		/* Skip nodes with memory only. */
+		if (ret == 0) {
+			continue;
+		}
+		topo.offset[topo.nodes] = topo.cpu_count;
+		topo.cpu_count += ret;
+		topo.nodes += 1;
+	}
+	topo.offset[topo.nodes] = topo.cpu_count;
+
+	return topo.nodes > 0;
+}
+
+static void load_topology(void)
+{
+	if (load_sysfs()) {
+		return;
+	}
+
+	/* Single node with all online CPUs. */
+	int cpus = dt_online_cpus();
+	if (cpus < 1) {
+		cpus = 1;
+	} else if (cpus > NUMA_MAX_CPUS) {
+		cpus = NUMA_MAX_CPUS;
+	}
+	for (int i = 0; i < cpus; i++) {
+		topo.cpus[i] = i;
+	}
+	topo.nodes = 1;
+	topo.cpu_count = cpus;
+	topo.offset[0] = 0;
+	topo.offset[1] = cpus;
+}
+
+unsigned numa_nodes(void)
+{
+	pthread_once(&topo_once, load_topology);
+
+	return topo.nodes;
+}
+
+size_t numa_node_cpus(unsigned node, const unsigned **cpus)
+{
+	if (node >= numa_nodes() || cpus == NULL) {
+		return 0;
+	}
+
+	*cpus = topo.cpus + topo.offset[node];
+	return topo.offset[node + 1] - topo.offset[node];
+}
+
+unsigned numa_thread_node(unsigned thread_id)
+{
+	return thread_id % numa_nodes();
+}
+
+unsigned numa_thread_cpu(unsigned thread_id)
+{
+	const unsigned *cpus = NULL;
+	size_t count = numa_node_cpus(numa_thread_node(thread_id), &cpus);
+
+	return cpus[(thread_id / numa_nodes()) % count];
+}
@@ -0,0 +1,89 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file
+ *
+ * \brief Memory node (NUMA) topology.
+ *
+ * The topology is read once from the Linux sysfs. If it is not available,
+ * all online CPUs are reported as a single node. Worker threads are spread
+ * over the nodes by their identifiers and bound to the CPUs of their node,
+ * so the memory they allocate afterwards is placed on the local node by the
+ * kernel first-touch policy.
+ *
+ * \addtogroup server
+ * @{
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/*! \brief Maximum number of recognized memory nodes. */
+#define NUMA_MAX_NODES	64
+
+/*! \brief Maximum number of recognized CPUs. */
+#define NUMA_MAX_CPUS	1024
+
+/*!
+ * \brief Parse a sysfs list of numbers (e.g. "0-3,8-11").
+ *
+ * \param str  List string, may be terminated with a new line.
+ * \param out  Output array of the numbers.
+ * \param max  Size of the output array, the other numbers are skipped.
+ *
+ * \return Number of items stored, -1 if the list is malformed.
+ */
+int numa_parse_list(const char *str, unsigned *out, size_t max);
+
+/*!
+ * \brief Get the number of memory nodes.
+ *
+ * \return Number of nodes, at least 1.
+ */
+unsigned numa_nodes(void);
+
+/*!
+ * \brief Get the CPUs of a memory node.
+ *
+ * \param node  Node index (0 to numa_nodes() - 1).
+ * \param cpus  Output array of the node CPUs.
+ *
+ * \return Number of CPUs, 0 if the node is not valid.
+ */
+size_t numa_node_cpus(unsigned node, const unsigned **cpus);
+
+/*!
+ * \brief Get the memory node of a worker thread.
+ *
+ * \param thread_id  Worker thread identifier.
+ *
+ * \return Node index.
+ */
+unsigned numa_thread_node(unsigned thread_id);
+
+/*!
+ * \brief Get a CPU for a worker thread.
+ *
+ * Consecutive threads of the same node get consecutive CPUs of the node.
+ *
+ * \param thread_id  Worker thread identifier.
+ *
+ * \return CPU identifier.
+ */
+unsigned numa_thread_cpu(unsigned thread_id);
+
+/*! @} */
@@ -25,10 +25,8 @@
 #include "contrib/murmurhash3/murmurhash3.h"
 #include "contrib/sockaddr.h"
 
-/* Hopscotch defines. */
-#define HOP_LEN (sizeof(unsigned)*8)
-/* Limits */
-#define RRL_CLSBLK_MAXLEN (4 + 8 + 1 + 256)
+/* Number of buckets searched for a key. */
+#define RRL_PROBE_LEN 16
 /* CIDR block prefix lengths for v4/v6 */
 #define RRL_V4_PREFIX ((uint32_t)0x00ffffff)         /* /24 */
 #define RRL_V6_PREFIX ((uint64_t)0x00ffffffffffffff) /* /56 */
@@ -134,8 +132,8 @@ static uint8_t rrl_clsid(rrl_req_t *p)
 	return ret;
 }
 
-static int rrl_clsname(char *dst, size_t maxlen, uint8_t cls,
-                       rrl_req_t *req, const zone_t *zone)
+static const knot_dname_t *rrl_clsname(uint8_t cls, rrl_req_t *req,
+                                       const zone_t *zone)
 {
 	/* Fallback zone (for errors etc.) */
 	const knot_dname_t *dn = (const knot_dname_t *)"\x00";
@@ -158,130 +156,63 @@ static int rrl_clsname(char *dst, size_t maxlen, uint8_t cls,
 		break;
 	}
 
-	/* Write to wire */
-	return knot_dname_to_wire((uint8_t *)dst, dn, maxlen);
+	return dn;
 }
 
-static int rrl_classify(char *dst, size_t maxlen, const struct sockaddr_storage *a,
-                        rrl_req_t *p, const zone_t *z, uint32_t seed)
+static uint64_t rrl_netblk(const struct sockaddr_storage *a)
 {
-	if (!dst || !p || !a || maxlen == 0) {
-		return KNOT_EINVAL;
-	}
-
-	/* Class */
-	uint8_t cls = rrl_clsid(p);
-	*dst = cls;
-	int blklen = sizeof(cls);
-
 	/* Address (in network byteorder, adjust masks). */
-	uint64_t nb = 0;
 	if (a->ss_family == AF_INET6) {
 		struct sockaddr_in6 *ipv6 = (struct sockaddr_in6 *)a;
-		nb = *((uint64_t *)(&ipv6->sin6_addr)) & RRL_V6_PREFIX;
+		return *((uint64_t *)(&ipv6->sin6_addr)) & RRL_V6_PREFIX;
 	} else {
 		struct sockaddr_in *ipv4 = (struct sockaddr_in *)a;
-		nb = ((uint32_t)ipv4->sin_addr.s_addr) & RRL_V4_PREFIX;
-	}
-	if (blklen + sizeof(nb) > maxlen) {
-		return KNOT_ESPACE;
-	}
-	memcpy(dst + blklen, (void *)&nb, sizeof(nb));
-	blklen += sizeof(nb);
-
-	/* Name */
-	uint16_t *nlen = (uint16_t *)(dst + blklen);
-	blklen += sizeof(uint16_t);
-	int len = rrl_clsname(dst + blklen, maxlen - blklen, cls, p, z);
-	if (len < 0) {
-		return len;
-	}
-	*nlen = len;
-	blklen += len;
-
-	/* Seed. */
-	if (blklen + sizeof(seed) > maxlen) {
-		return KNOT_ESPACE;
+		return ((uint32_t)ipv4->sin_addr.s_addr) & RRL_V4_PREFIX;
 	}
-	memcpy(dst + blklen, (void *)&seed, sizeof(seed));
-	blklen += sizeof(seed);
-
-	return blklen;
 }
 
-static int bucket_free(rrl_item_t *b, uint32_t now) {
-	return b->cls == CLS_NULL || (b->time + 1 < now);
+static uint32_t rrl_namehash(const knot_dname_t *dn)
+{
+	return hash((const char *)dn, knot_dname_size(dn));
 }
 
-static int bucket_match(rrl_item_t *b, rrl_item_t *m)
+/*!
+ * \brief Fill the bucket key (class, netblock and name hash) for the request.
+ */
+static void rrl_classify(rrl_item_t *key, const struct sockaddr_storage *a,
+                         rrl_req_t *p, const zone_t *z)
 {
-	return b->cls    == m->cls &&
-	       b->netblk == m->netblk &&
-	       b->qname  == m->qname;
+	key->cls = rrl_clsid(p);
+	key->netblk = rrl_netblk(a);
+	key->qname = rrl_namehash(rrl_clsname(key->cls, p, z));
 }
 
-static int find_free(rrl_table_t *t, unsigned i, uint32_t now)
+/*! \brief Finalization mix of the 64-bit MurmurHash3. */
+static inline uint64_t mix64(uint64_t h)
 {
-	rrl_item_t *np = t->arr + t->size;
-	rrl_item_t *b = NULL;
-	for (b = t->arr + i; b != np; ++b) {
-		if (bucket_free(b, now)) {
-			return b - (t->arr + i);
-		}
-	}
-	np = t->arr + i;
-	for (b = t->arr; b != np; ++b) {
-		if (bucket_free(b, now)) {
-			return (b - t->arr) + (t->size - i);
-		}
-	}
-
-	/* this happens if table is full... force vacate current elm */
-	return i;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
 }
 
-static inline unsigned find_match(rrl_table_t *t, uint32_t id, rrl_item_t *m)
+static uint64_t rrl_key_hash(const rrl_item_t *key, uint32_t seed)
 {
-	unsigned f = 0;
-	unsigned d = 0;
-	unsigned match = t->arr[id].hop;
-	while (match != 0) {
-		d = __builtin_ctz(match);
-		f = (id + d) % t->size;
-		if (bucket_match(t->arr + f, m)) {
-			return d;
-		} else {
-			match &= ~(1<<d); /* clear potential match */
-		}
-	}
+	uint64_t h = mix64(key->netblk ^ seed);
+	return mix64(h ^ ((uint64_t)key->qname << 8 | key->cls));
+}
 
-	return HOP_LEN + 1;
+static int bucket_free(rrl_item_t *b, uint32_t now) {
+	return b->cls == CLS_NULL || (b->time + 1 < now);
 }
 
-static inline unsigned reduce_dist(rrl_table_t *t, unsigned id, unsigned d, unsigned *f)
+static int bucket_match(const rrl_item_t *b, const rrl_item_t *m)
 {
-	unsigned rd = HOP_LEN - 1;
-	while (rd > 0) {
-		unsigned s = (t->size + *f - rd) % t->size; /* bucket to be vacated */
-		unsigned o = __builtin_ctz(t->arr[s].hop); /* offset of first valid bucket */
-		if (t->arr[s].hop != 0 && o < rd) {        /* only offsets in <s, f> are interesting */
-			unsigned e = (s + o) % t->size;    /* this item will be displaced to [f] */
-			unsigned keep_hop = t->arr[*f].hop; /* unpredictable padding */
-			memcpy(t->arr + *f, t->arr + e, sizeof(rrl_item_t));
-			t->arr[*f].hop = keep_hop;
-			t->arr[e].cls = CLS_NULL;
-			t->arr[s].hop &= ~(1<<o);
-			t->arr[s].hop |= 1<<rd;
-			*f = e;
-			return d - (rd - o);
-		}
-		--rd;
-	}
-
-	assert(rd == 0); /* this happens with p=1/fact(HOP_LEN) */
-	*f = id;
-	d = 0; /* force vacate initial element */
-	return d;
+	return b->cls    == m->cls &&
+	       b->netblk == m->netblk &&
+	       b->qname  == m->qname;
 }
 
 static void rrl_log_state(const struct sockaddr_storage *ss, uint16_t flags, uint8_t cls)
@@ -342,10 +273,6 @@ int rrl_setlocks(rrl_table_t *rrl, unsigned granularity)
 	assert(!rrl->lk); /* Cannot change while locks are used. */
 	assert(granularity <= rrl->size / 10); /* Due to int. division err. */
 
-	if (pthread_mutex_init(&rrl->ll, NULL) < 0) {
-		return KNOT_ENOMEM;
-	}
-
 	/* Alloc new locks. */
 	rrl->lk = malloc(granularity * sizeof(pthread_mutex_t));
 	if (!rrl->lk) {
@@ -374,86 +301,99 @@ int rrl_setlocks(rrl_table_t *rrl, unsigned granularity)
 	return KNOT_EOK;
 }
 
-rrl_item_t *rrl_hash(rrl_table_t *t, const struct sockaddr_storage *a, rrl_req_t *p,
-                     const zone_t *zone, uint32_t stamp, int *lock)
+/*!
+ * \brief Replace the bucket contents, keep the count of limited buckets.
+ */
+static void bucket_reset(rrl_table_t *t, rrl_item_t *b, const rrl_item_t *m)
 {
-	char buf[RRL_CLSBLK_MAXLEN];
-	int len = rrl_classify(buf, sizeof(buf), a, p, zone, t->seed);
-	if (len < 0) {
-		return NULL;
+	if (b->flags & RRL_BF_ELIMIT) {
+		__sync_sub_and_fetch(&t->limited, 1);
 	}
+	*b = *m;
+}
 
-	uint32_t id = hash(buf, len) % t->size;
-
-	/* Lock for lookup. */
-	pthread_mutex_lock(&t->ll);
-
-	/* Find an exact match in <id, id + HOP_LEN). */
-	uint16_t *qname = (uint16_t *)(buf + sizeof(uint8_t) + sizeof(uint64_t));
-	rrl_item_t match = {
-	        0, *((uint64_t *)(buf + 1)), t->rate,    /* hop, netblk, ntok */
-	        buf[0], RRL_BF_NULL,                     /* cls, flags */
-	        hash((char *)(qname + 1), *qname), stamp /* qname, time */
-	};
-
-	unsigned d = find_match(t, id, &match);
-	if (d > HOP_LEN) { /* not an exact match, find free element [f] */
-		d = find_free(t, id, stamp);
+/*!
+ * \brief Find the bucket for the key, lock its table region.
+ *
+ * If there is no bucket for the key and \a insert is set, a free or the least
+ * recently used bucket is assigned. Otherwise NULL is returned and no lock
+ * is held.
+ */
+static rrl_item_t *bucket_find(rrl_table_t *t, const rrl_item_t *match,
+                               uint32_t stamp, int *lock, bool insert)
+{
+	/* Lock the table region the key belongs to. */
+	uint64_t h = rrl_key_hash(match, t->seed);
+	unsigned regions = 1;
+	*lock = -1;
+	if (t->lk_count > 0) {
+		regions = t->lk_count;
+		*lock = h % regions;
+		rrl_lock(t, *lock);
+	}
+	size_t region_size = t->size / regions;
+	rrl_item_t *region = t->arr + (h % regions) * region_size;
+	size_t id = (h / regions) % region_size;
+
+	/* Find an exact match in the probe window, remember the first free
+	 * and the least recently used bucket. Buckets are never emptied
+	 * individually, so an empty bucket ends the search. */
+	rrl_item_t *vacant = NULL;
+	rrl_item_t *oldest = NULL;
+	size_t probe_len = (region_size < RRL_PROBE_LEN) ? region_size : RRL_PROBE_LEN;
+	for (size_t i = 0; i < probe_len; ++i) {
+		rrl_item_t *b = region + (id + i) % region_size;
+		if (b->cls == CLS_NULL) {
+			if (vacant == NULL) {
+				vacant = b;
+			}
+			break;
+		}
+		if (bucket_match(b, match)) {
+			return b;
+		}
+		if (vacant == NULL && bucket_free(b, stamp)) {
+			vacant = b;
+		}
+		if (oldest == NULL || b->time < oldest->time) {
+			oldest = b;
+		}
 	}
 
-	/* Reduce distance to fit <id, id + HOP_LEN) */
-	unsigned f = (id + d) % t->size;
-	while (d >= HOP_LEN) {
-		d = reduce_dist(t, id, d, &f);
+	if (!insert) {
+		if (*lock > -1) {
+			rrl_unlock(t, *lock);
+			*lock = -1;
+		}
+		return NULL;
 	}
 
-	/* Assign granular lock and unlock lookup. */
-	*lock = f % t->lk_count;
-	rrl_lock(t, *lock);
-	pthread_mutex_unlock(&t->ll);
-
-	/* found free elm 'k' which is in <id, id + HOP_LEN) */
-	t->arr[id].hop |= (1 << d);
-	rrl_item_t *b = t->arr + f;
-	assert(f == (id+d) % t->size);
-
-	/* Inspect bucket state. */
-	unsigned hop = b->hop;
-	if (b->cls == CLS_NULL) {
-		memcpy(b, &match, sizeof(rrl_item_t));
-		b->hop = hop;
+	/* Take a free bucket. */
+	if (vacant != NULL) {
+		bucket_reset(t, vacant, match);
+		return vacant;
 	}
-	/* Check for collisions. */
-	if (!bucket_match(b, &match)) {
-		if (!(b->flags & RRL_BF_SSTART)) {
-			memcpy(b, &match, sizeof(rrl_item_t));
-			b->hop = hop;
-			b->ntok = t->rate + t->rate / RRL_SSTART;
-			b->flags |= RRL_BF_SSTART;
-		}
+
+	/* Collision, reset the bucket unless it is in slow-start already. */
+	if (!(oldest->flags & RRL_BF_SSTART)) {
+		bucket_reset(t, oldest, match);
+		oldest->ntok = t->rate + t->rate / RRL_SSTART;
+		oldest->flags |= RRL_BF_SSTART;
 	}
 
-	return b;
+	return oldest;
 }
 
-int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *a, rrl_req_t *req,
-              const zone_t *zone)
+/*!
+ * \brief Account a response in the bucket.
+ *
+ * \retval KNOT_EOK if passed.
+ * \retval KNOT_ELIMIT when the limit is reached.
+ */
+static int bucket_visit(rrl_table_t *rrl, rrl_item_t *b,
+                        const struct sockaddr_storage *a, uint32_t now)
 {
-	if (!rrl || !req || !a) {
-		return KNOT_EINVAL;
-	}
-
-	/* Calculate hash and fetch */
 	int ret = KNOT_EOK;
-	int lock = -1;
-	uint32_t now = time(NULL);
-	rrl_item_t *b = rrl_hash(rrl, a, req, zone, now, &lock);
-	if (!b) {
-		if (lock > -1) {
-			rrl_unlock(rrl, lock);
-		}
-		return KNOT_ERROR;
-	}
 
 	/* Calculate rate for dT */
 	uint32_t dt = now - b->time;
@@ -467,6 +407,7 @@ int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *a, rrl_req_t *req
 		/* Check state change. */
 		if ((b->ntok > 0 || dt > 1) && (b->flags & RRL_BF_ELIMIT)) {
 			b->flags &= ~RRL_BF_ELIMIT;
+			__sync_sub_and_fetch(&rrl->limited, 1);
 			rrl_log_state(a, b->flags, b->cls);
 		}
 
@@ -484,6 +425,7 @@ int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *a, rrl_req_t *req
 	/* Last item taken. */
 	if (b->ntok == 1 && !(b->flags & RRL_BF_ELIMIT)) {
 		b->flags |= RRL_BF_ELIMIT;
+		__sync_add_and_fetch(&rrl->limited, 1);
 		rrl_log_state(a, b->flags, b->cls);
 	}
 
@@ -494,9 +436,92 @@ int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *a, rrl_req_t *req
 		ret = KNOT_ELIMIT;
 	}
 
+	return ret;
+}
+
+rrl_item_t *rrl_hash(rrl_table_t *t, const struct sockaddr_storage *a, rrl_req_t *p,
+                     const zone_t *zone, uint32_t stamp, int *lock)
+{
+	rrl_item_t match = {
+		.ntok = t->rate,
+		.flags = RRL_BF_NULL,
+		.time = stamp
+	};
+	rrl_classify(&match, a, p, zone);
+
+	return bucket_find(t, &match, stamp, lock, true);
+}
+
+int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *a, rrl_req_t *req,
+              const zone_t *zone)
+{
+	if (!rrl || !req || !a) {
+		return KNOT_EINVAL;
+	}
+
+	/* Calculate hash and fetch */
+	int lock = -1;
+	uint32_t now = time(NULL);
+	rrl_item_t *b = rrl_hash(rrl, a, req, zone, now, &lock);
+	if (!b) {
+		if (lock > -1) {
+			rrl_unlock(rrl, lock);
+		}
+		return KNOT_ERROR;
+	}
+
+	int ret = bucket_visit(rrl, b, a, now);
+
+	if (lock > -1) {
+		rrl_unlock(rrl, lock);
+	}
+	return ret;
+}
+
+int rrl_query_early(rrl_table_t *rrl, const struct sockaddr_storage *a,
+                    knot_pkt_t *query)
+{
+	if (!rrl || !query || !a) {
+		return KNOT_EINVAL;
+	}
+
+	/* Nothing is limited. A stale value only postpones the early check. */
+	if (rrl->limited == 0 || knot_pkt_qname(query) == NULL) {
+		return KNOT_ENOENT;
+	}
+
+	/* Only the classes given by QTYPE are checked, see rrl_clsid(). The
+	 * other ones depend on the answer and some are keyed by the zone, so
+	 * a limited bucket could belong to another response. */
+	rrl_item_t match = { .netblk = rrl_netblk(a) };
+	switch (knot_pkt_qtype(query)) {
+	case KNOT_RRTYPE_ANY:
+		match.cls = CLS_ANY;
+		break;
+	case KNOT_RRTYPE_DNSKEY:
+	case KNOT_RRTYPE_RRSIG:
+	case KNOT_RRTYPE_DS:
+		match.cls = CLS_DNSSEC;
+		break;
+	default:
+		return KNOT_ENOENT;
+	}
+	match.qname = rrl_namehash(knot_pkt_qname(query));
+
+	/* The bucket isn't visited, the response is accounted by rrl_query().
+	 * An empty bucket in the current window would be limited by it too. */
+	int ret = KNOT_ENOENT;
+	int lock = -1;
+	uint32_t now = time(NULL);
+	rrl_item_t *b = bucket_find(rrl, &match, now, &lock, false);
+	if (b != NULL && (b->flags & RRL_BF_ELIMIT) && b->time == now &&
+	    b->ntok == 0) {
+		ret = KNOT_ELIMIT;
+	}
 	if (lock > -1) {
 		rrl_unlock(rrl, lock);
 	}
+
 	return ret;
 }
 
@@ -513,9 +538,6 @@ bool rrl_slip_roll(int n_slip)
 int rrl_destroy(rrl_table_t *rrl)
 {
 	if (rrl) {
-		if (rrl->lk_count > 0) {
-			pthread_mutex_destroy(&rrl->ll);
-		}
 		for (size_t i = 0; i < rrl->lk_count; ++i) {
 			pthread_mutex_destroy(rrl->lk + i);
 		}
@@ -529,21 +551,16 @@ int rrl_destroy(rrl_table_t *rrl)
 int rrl_reseed(rrl_table_t *rrl)
 {
 	/* Lock entire table. */
-	if (rrl->lk_count > 0) {
-		pthread_mutex_lock(&rrl->ll);
-		for (unsigned i = 0; i < rrl->lk_count; ++i) {
-			rrl_lock(rrl, i);
-		}
+	for (unsigned i = 0; i < rrl->lk_count; ++i) {
+		rrl_lock(rrl, i);
 	}
 
 	memset(rrl->arr, 0, rrl->size * sizeof(rrl_item_t));
+	rrl->limited = 0;
 	rrl->seed = dnssec_random_uint32_t();
 
-	if (rrl->lk_count > 0) {
-		for (unsigned i = 0; i < rrl->lk_count; ++i) {
-			rrl_unlock(rrl, i);
-		}
-		pthread_mutex_unlock(&rrl->ll);
+	for (unsigned i = 0; i < rrl->lk_count; ++i) {
+		rrl_unlock(rrl, i);
 	}
 
 	return KNOT_EOK;
@@ -47,7 +47,6 @@ struct zone;
  * \brief RRL hash bucket.
  */
 typedef struct rrl_item {
-	unsigned hop;        /* Hop bitmap. */
 	uint64_t netblk;     /* Prefix associated. */
 	uint16_t ntok;       /* Tokens available */
 	uint8_t  cls;        /* Bucket class */
@@ -64,14 +63,15 @@ typedef struct rrl_item {
  * When a bucket is in a slow-start mode, it cannot reset again for the time
  * period.
  *
- * To avoid lock contention, N locks are created and distributed amongst buckets.
- * As of now lock K for bucket N is calculated as K = N % (num_buckets).
+ * To avoid lock contention, the table is split into N regions, each guarded
+ * by its own lock. The key hash selects the region and the buckets searched
+ * never leave it, so a lookup takes just the lock of the region.
  */
 
 typedef struct rrl_table {
 	uint32_t rate;       /* Configured RRL limit */
 	uint32_t seed;       /* Pseudorandom seed for hashing. */
-	pthread_mutex_t ll;
+	uint32_t limited;    /* Number of buckets in the limited state. */
 	pthread_mutex_t *lk;      /* Table locks. */
 	unsigned lk_count;   /* Table lock count (granularity). */
 	size_t size;         /* Number of buckets */
@@ -130,7 +130,7 @@ int rrl_setlocks(rrl_table_t *rrl, unsigned granularity);
  * \param p RRL request.
  * \param zone Relate zone.
  * \param stamp Timestamp (current time).
- * \param lock Held lock.
+ * \param lock Held lock (-1 if the table has no locks).
  * \return assigned bucket
  */
 rrl_item_t* rrl_hash(rrl_table_t *t, const struct sockaddr_storage *a, rrl_req_t *p,
@@ -149,6 +149,22 @@ rrl_item_t* rrl_hash(rrl_table_t *t, const struct sockaddr_storage *a, rrl_req_t
 int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *a, rrl_req_t *req,
               const struct zone *zone);
 
+/*!
+ * \brief Query the RRL table before the response is built.
+ *
+ * Only the buckets of ANY and DNSSEC responses are looked up, their class is
+ * given by QTYPE. The bucket isn't accounted, the response is to be checked
+ * by rrl_query() once it is built, unless it is dropped early.
+ *
+ * \param rrl RRL table.
+ * \param a Source address.
+ * \param query Query with the lowercased QNAME.
+ * \retval KNOT_ELIMIT if rrl_query() would limit the response.
+ * \retval KNOT_ENOENT if the response is to be checked once built.
+ */
+int rrl_query_early(rrl_table_t *rrl, const struct sockaddr_storage *a,
+                    knot_pkt_t *query);
+
 /*!
  * \brief Roll a dice whether answer slips or not.
  * \param n_slip Number represents every Nth answer that is slipped.
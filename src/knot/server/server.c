@@ -18,10 +18,13 @@
 
 #include <stdlib.h>
 #include <assert.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <urcu.h>
 
 #include "libknot/errcode.h"
 #include "knot/common/log.h"
+#include "knot/nameserver/query_timing.h"
 #include "knot/server/server.h"
 #include "knot/server/udp-handler.h"
 #include "knot/server/tcp-handler.h"
@@ -52,9 +55,12 @@ static void server_deinit_iface(iface_t *iface)
 	free(iface->fd_udp);
 
 	/* Free TCP handler. */
-	if (iface->fd_tcp > -1) {
-		close(iface->fd_tcp);
+	for (int i = 0; i < iface->fd_tcp_count; i++) {
+		if (iface->fd_tcp[i] > -1) {
+			close(iface->fd_tcp[i]);
+		}
 	}
+	free(iface->fd_tcp);
 
 	memset(iface, 0, sizeof(*iface));
 }
@@ -128,18 +134,35 @@ static bool enable_pktinfo(int sock, int family)
 	return setsockopt(sock, level, option, &on, sizeof(on)) == 0;
 }
 
+/*!
+ * \brief Enable TCP Fast Open on a listening socket.
+ */
+static bool enable_fastopen(int sock, int backlog)
+{
+#if defined(TCP_FASTOPEN)
+	return setsockopt(sock, IPPROTO_TCP, TCP_FASTOPEN, &backlog, sizeof(backlog)) == 0;
+#else
+	return false;
+#endif
+}
+
 /*!
  * \brief Initialize new interface from config value.
  *
  * Both TCP and UDP sockets will be created for the interface.
  *
- * \param new_if Allocated memory for the interface.
- * \param cfg_if Interface template from config.
+ * \param new_if            Allocated memory for the interface.
+ * \param addr              Interface address.
+ * \param udp_thread_count  Number of UDP threads.
+ * \param tcp_thread_count  Number of TCP threads.
+ * \param tcp_fastopen      Enable TCP Fast Open.
  *
  * \retval 0 if successful (EOK).
  * \retval <0 on errors (EACCES, EINVAL, ENOMEM, EADDRINUSE).
  */
-static int server_init_iface(iface_t *new_if, struct sockaddr_storage *addr, int udp_thread_count)
+static int server_init_iface(iface_t *new_if, struct sockaddr_storage *addr,
+                             int udp_thread_count, int tcp_thread_count,
+                             bool tcp_fastopen)
 {
 	/* Initialize interface. */
 	int ret = 0;
@@ -151,23 +174,29 @@ static int server_init_iface(iface_t *new_if, struct sockaddr_storage *addr, int
 	sockaddr_tostr(addr_str, sizeof(addr_str), (struct sockaddr *)addr);
 
 	int udp_socket_count = 1;
+	int tcp_socket_count = 1;
 	int bind_flags = 0;
 
 #ifdef ENABLE_REUSEPORT
 	udp_socket_count = udp_thread_count;
+	tcp_socket_count = tcp_thread_count;
 	bind_flags |= NET_BIND_MULTIPLE;
 #endif
 
 	new_if->fd_udp = malloc(udp_socket_count * sizeof(int));
-	if (!new_if->fd_udp) {
+	new_if->fd_tcp = malloc(tcp_socket_count * sizeof(int));
+	if (!new_if->fd_udp || !new_if->fd_tcp) {
+		server_deinit_iface(new_if);
 		return KNOT_ENOMEM;
 	}
 
 	/* Initialize the sockets to ensure safe early deinitialization. */
 	for (int i = 0; i < udp_socket_count; i++) {
-		new_if->fd_udp[new_if->fd_udp_count] = -1;
-	};
-	new_if->fd_tcp = -1;
+		new_if->fd_udp[i] = -1;
+	}
+	for (int i = 0; i < tcp_socket_count; i++) {
+		new_if->fd_tcp[i] = -1;
+	}
 
 	bool warn_bind = false;
 	bool warn_bufsize = false;
@@ -205,27 +234,41 @@ static int server_init_iface(iface_t *new_if, struct sockaddr_storage *addr, int
 		new_if->fd_udp_count += 1;
 	}
 
-	/* Create bound TCP socket. */
-	int sock = net_bound_socket(SOCK_STREAM, (struct sockaddr *)addr, bind_flags);
-	if (sock < 0) {
-		log_error("cannot bind address '%s' (%s)", addr_str,
-		          knot_strerror(sock));
-		server_deinit_iface(new_if);
-		return sock;
-	}
+	warn_bufsize = false;
+	bool warn_fastopen = false;
 
-	if (!enlarge_net_buffers(sock, TCP_MIN_RCVSIZE, TCP_MIN_SNDSIZE)) {
-		log_warning("failed to set network buffer sizes for TCP");
-	}
+	/* Create bound TCP sockets. */
+	for (int i = 0; i < tcp_socket_count; i++) {
+		int sock = net_bound_socket(SOCK_STREAM, (struct sockaddr *)addr, bind_flags);
+		if (sock < 0) {
+			log_error("cannot bind address '%s' (%s)", addr_str,
+			          knot_strerror(sock));
+			server_deinit_iface(new_if);
+			return sock;
+		}
 
-	new_if->fd_tcp = sock;
+		new_if->fd_tcp[new_if->fd_tcp_count] = sock;
+		new_if->fd_tcp_count += 1;
 
-	/* Listen for incoming connections. */
-	ret = listen(sock, TCP_BACKLOG_SIZE);
-	if (ret < 0) {
-		log_error("failed to listen on TCP interface '%s'", addr_str);
-		server_deinit_iface(new_if);
-		return KNOT_ERROR;
+		if (!enlarge_net_buffers(sock, TCP_MIN_RCVSIZE, TCP_MIN_SNDSIZE) &&
+		    !warn_bufsize) {
+			log_warning("failed to set network buffer sizes for TCP");
+			warn_bufsize = true;
+		}
+
+		if (tcp_fastopen && !enable_fastopen(sock, TCP_BACKLOG_SIZE) &&
+		    !warn_fastopen) {
+			log_warning("failed to enable TCP Fast Open");
+			warn_fastopen = true;
+		}
+
+		/* Listen for incoming connections. */
+		ret = listen(sock, TCP_BACKLOG_SIZE);
+		if (ret < 0) {
+			log_error("failed to listen on TCP interface '%s'", addr_str);
+			server_deinit_iface(new_if);
+			return KNOT_ERROR;
+		}
 	}
 
 	return KNOT_EOK;
@@ -277,6 +320,8 @@ static int reconfigure_sockets(conf_t *conf, server_t *s)
 	conf_val_t listen_val = conf_get(conf, C_SRV, C_LISTEN);
 	conf_val_t rundir_val = conf_get(conf, C_SRV, C_RUNDIR);
 	char *rundir = conf_abs_path(&rundir_val, NULL);
+	conf_val_t fastopen_val = conf_get(conf, C_SRV, C_TCP_FASTOPEN);
+	bool tcp_fastopen = conf_bool(&fastopen_val);
 	while (listen_val.code == KNOT_EOK) {
 		iface_t *m = NULL;
 
@@ -304,8 +349,10 @@ static int reconfigure_sockets(conf_t *conf, server_t *s)
 
 			/* Create new interface. */
 			m = malloc(sizeof(iface_t));
-			unsigned size = s->handlers[IO_UDP].handler.unit->size;
-			if (server_init_iface(m, &addr, size) < 0) {
+			unsigned udp_size = s->handlers[IO_UDP].handler.unit->size;
+			unsigned tcp_size = s->handlers[IO_TCP].handler.unit->size;
+			if (server_init_iface(m, &addr, udp_size, tcp_size,
+			                      tcp_fastopen) < 0) {
 				free(m);
 				m = 0;
 			}
@@ -356,6 +403,23 @@ static int reconfigure_sockets(conf_t *conf, server_t *s)
 	return bound;
 }
 
+/*! \brief Replace the DNS Cookies secret and plan the next rotation. */
+static void rotate_cookie_secret(event_t *event)
+{
+	server_t *server = event->data;
+
+	int ret = cookie_secrets_rotate(&server->cookies);
+	if (ret != KNOT_EOK) {
+		log_error("DNS cookies, failed to rotate server secret (%s)",
+		          knot_strerror(ret));
+	}
+
+	uint32_t lifetime = server->cookie_lifetime;
+	if (lifetime > 0) {
+		evsched_schedule(event, lifetime * 1000);
+	}
+}
+
 int server_init(server_t *server, int bg_workers)
 {
 	if (server == NULL) {
@@ -376,6 +440,17 @@ int server_init(server_t *server, int bg_workers)
 		return KNOT_ENOMEM;
 	}
 
+	/* Initialize DNS Cookies secrets. */
+	server->cookie_rotation = evsched_event_create(&server->sched,
+	                                               rotate_cookie_secret, server);
+	if (server->cookie_rotation == NULL ||
+	    cookie_secrets_init(&server->cookies) != KNOT_EOK) {
+		evsched_event_free(server->cookie_rotation);
+		worker_pool_destroy(server->workers);
+		evsched_deinit(&server->sched);
+		return KNOT_ENOMEM;
+	}
+
 	return KNOT_EOK;
 }
 
@@ -404,6 +479,8 @@ void server_deinit(server_t *server)
 	knot_zonedb_deep_free(&server->zone_db);
 
 	/* Free remaining events. */
+	evsched_cancel(server->cookie_rotation);
+	evsched_event_free(server->cookie_rotation);
 	evsched_deinit(&server->sched);
 
 	/* Close persistent timers database. */
@@ -438,6 +515,16 @@ static int server_init_handler(server_t *server, int index, int thread_count,
 		return KNOT_ENOMEM;
 	}
 
+#ifdef ENABLE_QUERY_TIMING
+	h->timing = calloc(thread_count, sizeof(query_timing_t));
+	if (h->timing == NULL) {
+		free(h->thread_id);
+		free(h->thread_state);
+		dt_delete(&h->unit);
+		return KNOT_ENOMEM;
+	}
+#endif
+
 	return KNOT_EOK;
 }
 
@@ -457,6 +544,7 @@ static void server_free_handler(iohandler_t *h)
 	dt_delete(&h->unit);
 	free(h->thread_state);
 	free(h->thread_id);
+	free(h->timing);
 	memset(h, 0, sizeof(iohandler_t));
 }
 
@@ -647,6 +735,29 @@ static int reconfigure_rate_limits(conf_t *conf, server_t *server)
 	return KNOT_EOK;
 }
 
+static int reconfigure_cookies(conf_t *conf, server_t *server)
+{
+	uint32_t lifetime = 0;
+	if (conf->cache.srv_cookies) {
+		conf_val_t val = conf_get(conf, C_SRV, C_COOKIE_SECRET_LIFETIME);
+		lifetime = conf_int(&val);
+	}
+
+	/* Keep the running rotation if not changed. */
+	if (lifetime == server->cookie_lifetime) {
+		return KNOT_EOK;
+	}
+	server->cookie_lifetime = lifetime;
+
+	if (lifetime == 0) {
+		log_info("DNS cookies, disabled");
+		return evsched_cancel(server->cookie_rotation);
+	}
+
+	log_info("DNS cookies, enabled with secret lifetime %u seconds", lifetime);
+	return evsched_schedule(server->cookie_rotation, lifetime * 1000);
+}
+
 void server_reconfigure(conf_t *conf, server_t *server)
 {
 	if (conf == NULL || server == NULL) {
@@ -665,6 +776,12 @@ void server_reconfigure(conf_t *conf, server_t *server)
 		          knot_strerror(ret));
 	}
 
+	/* Reconfigure DNS Cookies. */
+	if ((ret = reconfigure_cookies(conf, server)) < 0) {
+		log_error("failed to reconfigure DNS cookies (%s)",
+		          knot_strerror(ret));
+	}
+
 	/* Reconfigure server threads. */
 	if ((ret = reconfigure_threads(conf, server)) < 0) {
 		log_error("failed to reconfigure server threads (%s)",
@@ -741,12 +858,14 @@ ref_t *server_set_ifaces(server_t *server, fdset_t *fds, int index, int thread_i
 	WALK_LIST(i, server->ifaces->l) {
 #ifdef ENABLE_REUSEPORT
 		int udp_id = thread_id % i->fd_udp_count;
+		int tcp_id = thread_id % i->fd_tcp_count;
 #else
 		int udp_id = 0;
+		int tcp_id = 0;
 #endif
 		switch(index) {
 		case IO_TCP:
-			fdset_add(fds, i->fd_tcp, POLLIN, NULL);
+			fdset_add(fds, i->fd_tcp[tcp_id], POLLIN, NULL);
 			break;
 		case IO_UDP:
 			fdset_add(fds, i->fd_udp[udp_id], POLLIN, NULL);
@@ -759,3 +878,28 @@ ref_t *server_set_ifaces(server_t *server, fdset_t *fds, int index, int thread_i
 
 	return &server->ifaces->ref;
 }
+
+int server_query_timing(server_t *server, query_timing_t *timing)
+{
+	if (server == NULL || timing == NULL) {
+		return KNOT_EINVAL;
+	}
+
+#ifdef ENABLE_QUERY_TIMING
+	memset(timing, 0, sizeof(*timing));
+
+	for (unsigned proto = IO_UDP; proto <= IO_TCP; ++proto) {
+		iohandler_t *h = &server->handlers[proto].handler;
+		if (h->unit == NULL || h->timing == NULL) {
+			continue;
+		}
+		for (unsigned i = 0; i < h->unit->size; ++i) {
+			qtime_merge(timing, &h->timing[i]);
+		}
+	}
+
+	return KNOT_EOK;
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
@@ -34,6 +34,7 @@
 #include "knot/common/fdset.h"
 #include "knot/server/dthreads.h"
 #include "knot/common/ref.h"
+#include "knot/server/cookies.h"
 #include "knot/server/rrl.h"
 #include "knot/worker/pool.h"
 #include "knot/zone/zonedb.h"
@@ -41,6 +42,7 @@
 
 /* Forwad declarations. */
 struct server;
+struct query_timing;
 
 /*! \brief I/O handler structure.
   */
@@ -50,6 +52,7 @@ typedef struct iohandler {
 	dt_unit_t          *unit;   /*!< Threading unit */
 	unsigned           *thread_state; /*!< Thread state */
 	unsigned           *thread_id; /*!< Thread identifier. */
+	struct query_timing *timing; /*!< Per-thread query timing (optional). */
 } iohandler_t;
 
 /*! \brief Server state flags.
@@ -67,7 +70,8 @@ typedef struct iface {
 	struct node n;
 	int *fd_udp;
 	int fd_udp_count;
-	int fd_tcp;
+	int *fd_tcp;
+	int fd_tcp_count;
 	struct sockaddr_storage addr;
 } iface_t;
 
@@ -115,6 +119,11 @@ typedef struct server {
 	/*! \brief Rate limiting. */
 	rrl_table_t *rrl;
 
+	/*! \brief DNS Cookies secrets and their rotation. */
+	cookie_secrets_t cookies;
+	event_t *cookie_rotation;
+	uint32_t cookie_lifetime; /*!< Secret lifetime in seconds, 0 if disabled. */
+
 } server_t;
 
 /*!
@@ -194,4 +203,15 @@ void server_update_zones(conf_t *conf, server_t *server);
  */
 ref_t *server_set_ifaces(server_t *server, fdset_t *fds, int index, int thread_id);
 
+/*!
+ * \brief Aggregate query timing histograms of all I/O threads.
+ *
+ * \param server  Server.
+ * \param timing  Output histograms.
+ *
+ * \retval KNOT_EOK on success.
+ * \retval KNOT_ENOTSUP if compiled without query timing support.
+ */
+int server_query_timing(server_t *server, struct query_timing *timing);
+
 /*! @} */
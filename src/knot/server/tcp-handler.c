@@ -38,12 +38,14 @@
 #include "knot/common/log.h"
 #include "knot/nameserver/process_query.h"
 #include "knot/query/layer.h"
+#include "knot/server/numa.h"
 #include "contrib/macros.h"
 #include "contrib/mempattern.h"
 #include "contrib/net.h"
 #include "contrib/sockaddr.h"
 #include "contrib/time.h"
 #include "contrib/ucw/mempool.h"
+#include "contrib/wire.h"
 
 /*! \brief TCP context data. */
 typedef struct tcp_context {
@@ -54,75 +56,245 @@ typedef struct tcp_context {
 	timev_t last_poll_time;     /*!< Time of the last socket poll. */
 	timev_t throttle_end;       /*!< End of accept() throttling. */
 	fdset_t set;                /*!< Set of server/client sockets. */
+	unsigned max_clients;       /*!< Maximum number of clients in the set. */
 	unsigned thread_id;         /*!< Thread identifier. */
+	unsigned numa_node;         /*!< Memory node of the thread. */
+	query_timing_t *timing;     /*!< Thread query timing (optional). */
 } tcp_context_t;
 
+/*!
+ * \brief Outgoing zone transfer in progress.
+ *
+ * The transfer has its own processing layer and memory, so it can be
+ * suspended whenever the client socket isn't writable. No RCU read lock is
+ * held while suspended, the transfer fails if the zone changes meanwhile.
+ */
+typedef struct tcp_xfr {
+	knot_mm_t mm;               /*!< Transfer memory pool. */
+	knot_layer_t layer;         /*!< Query processing layer. */
+	knot_pkt_t *query;          /*!< Transfer query. */
+	knot_pkt_t *ans;            /*!< Answer packet, written after the length. */
+	uint8_t *tx;                /*!< Output buffer (length-prefixed message). */
+	size_t tx_len;              /*!< Length of the pending output. */
+	size_t tx_off;              /*!< Pending output already sent. */
+	unsigned sent;              /*!< Messages completed since the last wakeup. */
+} tcp_xfr_t;
+
+/*! \brief TCP client connection data, kept for the connection lifetime. */
+typedef struct tcp_client {
+	struct sockaddr_storage addr;       /*!< Remote address. */
+	struct process_query_param param;   /*!< Query processing parameters. */
+	int reply_timeout;                  /*!< Reply timeout (milliseconds). */
+	int idle_timeout;                   /*!< Idle timeout (seconds). */
+	tcp_xfr_t *xfr;                     /*!< Running zone transfer (optional). */
+} tcp_client_t;
+
 /*
  * Forward decls.
  */
 #define TCP_THROTTLE_LO 0 /*!< Minimum recovery time on errors. */
 #define TCP_THROTTLE_HI 2 /*!< Maximum recovery time on errors. */
+#define TCP_ACCEPT_MAX 16 /*!< Maximum connections accepted per wakeup. */
+#define TCP_XFR_BATCH 8 /*!< Maximum transfer messages produced per wakeup. */
 
 /*! \brief Calculate TCP throttle time (random). */
 static inline int tcp_throttle(void) {
 	return TCP_THROTTLE_LO + (dnssec_random_uint16_t() % TCP_THROTTLE_HI);
 }
 
+/*! \brief Abort or finish the zone transfer and free its data. */
+static void tcp_xfr_free(tcp_client_t *client)
+{
+	tcp_xfr_t *xfr = client->xfr;
+	if (xfr == NULL) {
+		return;
+	}
+
+	knot_layer_finish(&xfr->layer);
+	mp_delete(xfr->mm.ctx);
+	free(xfr);
+	client->xfr = NULL;
+}
+
+/*! \brief Close client connection and free its data. */
+static void tcp_client_close(fdset_t *set, unsigned i)
+{
+	close(set->pfd[i].fd);
+	tcp_xfr_free(set->ctx[i]);
+	free(set->ctx[i]);
+	set->ctx[i] = NULL;
+}
+
+/*! \brief Close all client connections. */
+static void tcp_clients_close(tcp_context_t *tcp)
+{
+	for (unsigned i = tcp->client_threshold; i < tcp->set.n; ++i) {
+		tcp_client_close(&tcp->set, i);
+	}
+}
+
+/*! \brief Close client connections, move the running transfers to another set. */
+static void tcp_clients_suspend(tcp_context_t *tcp, fdset_t *xfrs)
+{
+	fdset_init(xfrs, FDSET_INIT_SIZE);
+	for (unsigned i = tcp->client_threshold; i < tcp->set.n; ++i) {
+		tcp_client_t *client = tcp->set.ctx[i];
+		if (client->xfr != NULL) {
+			int id = fdset_add(xfrs, tcp->set.pfd[i].fd, POLLOUT, client);
+			if (id >= 0) {
+				xfrs->timeout[id] = tcp->set.timeout[i];
+				continue;
+			}
+		}
+		tcp_client_close(&tcp->set, i);
+	}
+}
+
+/*! \brief Continue the suspended transfers. */
+static void tcp_clients_resume(tcp_context_t *tcp, fdset_t *xfrs)
+{
+	for (unsigned i = 0; i < xfrs->n; ++i) {
+		int id = fdset_add(&tcp->set, xfrs->pfd[i].fd, POLLOUT, xfrs->ctx[i]);
+		if (id < 0) {
+			tcp_client_close(xfrs, i);
+			continue;
+		}
+		tcp->set.timeout[id] = xfrs->timeout[i];
+	}
+	fdset_clear(xfrs);
+}
+
 /*! \brief Sweep TCP connection. */
 static enum fdset_sweep_state tcp_sweep(fdset_t *set, int i, void *data)
 {
 	UNUSED(data);
 	assert(set && i < set->n && i >= 0);
-	int fd = set->pfd[i].fd;
-
-	/* Best-effort, name and shame. */
-	struct sockaddr_storage ss;
-	socklen_t len = sizeof(struct sockaddr_storage);
-	if (getpeername(fd, (struct sockaddr*)&ss, &len) == 0) {
-		char addr_str[SOCKADDR_STRLEN] = {0};
-		sockaddr_tostr(addr_str, sizeof(addr_str), (struct sockaddr *)&ss);
-		log_notice("TCP, terminated inactive client, address '%s'", addr_str);
-	}
+	tcp_client_t *client = set->ctx[i];
 
-	close(fd);
+	/* Name and shame. */
+	char addr_str[SOCKADDR_STRLEN] = {0};
+	sockaddr_tostr(addr_str, sizeof(addr_str), (struct sockaddr *)&client->addr);
+	log_notice("TCP, terminated inactive client, address '%s'", addr_str);
+
+	tcp_client_close(set, i);
 
 	return FDSET_SWEEP;
 }
 
+/*! \brief Check if the query is a zone transfer request. */
+static bool tcp_is_xfr(const knot_pkt_t *query)
+{
+	uint16_t qtype = knot_pkt_qtype(query);
+	return qtype == KNOT_RRTYPE_AXFR || qtype == KNOT_RRTYPE_IXFR;
+}
+
+/*!
+ * \brief Prepare the zone transfer, the answer is sent by tcp_xfr_send().
+ */
+static int tcp_xfr_start(tcp_client_t *client, const uint8_t *wire, size_t len)
+{
+	tcp_xfr_t *xfr = malloc(sizeof(tcp_xfr_t));
+	if (xfr == NULL) {
+		return KNOT_ENOMEM;
+	}
+	memset(xfr, 0, sizeof(*xfr));
+
+	mm_ctx_mempool(&xfr->mm, 16 * MM_DEFAULT_BLKSIZE);
+	uint8_t *rx = mm_alloc(&xfr->mm, len);
+	xfr->tx = mm_alloc(&xfr->mm, sizeof(uint16_t) + KNOT_WIRE_MAX_PKTSIZE);
+	if (rx == NULL || xfr->tx == NULL) {
+		mp_delete(xfr->mm.ctx);
+		free(xfr);
+		return KNOT_ENOMEM;
+	}
+	memcpy(rx, wire, len);
+
+	xfr->query = knot_pkt_new(rx, len, &xfr->mm);
+	xfr->ans = knot_pkt_new(xfr->tx + sizeof(uint16_t), KNOT_WIRE_MAX_PKTSIZE,
+	                        &xfr->mm);
+	if (xfr->query == NULL || xfr->ans == NULL) {
+		mp_delete(xfr->mm.ctx);
+		free(xfr);
+		return KNOT_ENOMEM;
+	}
+
+	knot_layer_init(&xfr->layer, &xfr->mm, process_query_layer());
+	client->xfr = xfr;
+
+	/* Input packet. */
+	knot_layer_begin(&xfr->layer, &client->param);
+	(void) knot_pkt_parse(xfr->query, 0);
+	knot_layer_consume(&xfr->layer, xfr->query);
+
+	return KNOT_EOK;
+}
+
+/*! \brief Check if the whole transfer answer was sent. */
+static bool tcp_xfr_done(const tcp_xfr_t *xfr)
+{
+	return xfr->tx_off == xfr->tx_len &&
+	       !(xfr->layer.state & (KNOT_STATE_PRODUCE|KNOT_STATE_FAIL));
+}
+
+/*!
+ * \brief Continue the zone transfer until the socket isn't writable.
+ *
+ * At most TCP_XFR_BATCH messages are produced at once so that other clients
+ * of the thread aren't delayed by fast transfers.
+ */
+static int tcp_xfr_send(int fd, tcp_xfr_t *xfr)
+{
+	unsigned produced = 0;
+	while (!tcp_xfr_done(xfr)) {
+		/* Send the pending message. */
+		if (xfr->tx_off < xfr->tx_len) {
+			ssize_t ret = net_stream_send_nowait(fd, xfr->tx + xfr->tx_off,
+			                                     xfr->tx_len - xfr->tx_off);
+			if (ret < 0) {
+				return KNOT_ECONNREFUSED;
+			} else if (ret == 0) {
+				break; /* Wait until writable. */
+			}
+			xfr->tx_off += ret;
+			if (xfr->tx_off == xfr->tx_len) {
+				xfr->sent += 1;
+			}
+			continue;
+		}
+
+		if (produced++ == TCP_XFR_BATCH) {
+			break;
+		}
+
+		/* Produce the next message. */
+		int state = knot_layer_produce(&xfr->layer, xfr->ans);
+		if (xfr->ans->size > 0 && !(state & (KNOT_STATE_FAIL|KNOT_STATE_NOOP))) {
+			wire_write_u16(xfr->tx, xfr->ans->size);
+			xfr->tx_len = sizeof(uint16_t) + xfr->ans->size;
+			xfr->tx_off = 0;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
 /*!
  * \brief TCP event handler function.
  */
-static int tcp_handle(tcp_context_t *tcp, int fd,
+static int tcp_handle(tcp_context_t *tcp, int fd, tcp_client_t *client,
                       struct iovec *rx, struct iovec *tx)
 {
-	/* Create query processing parameter. */
-	struct sockaddr_storage ss;
-	memset(&ss, 0, sizeof(struct sockaddr_storage));
-	struct process_query_param param = {0};
-	param.socket = fd;
-	param.remote = &ss;
-	param.server = tcp->server;
-	param.thread_id = tcp->thread_id;
 	rx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
 	tx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
-
-	/* Receive peer name. */
-	socklen_t addrlen = sizeof(struct sockaddr_storage);
-	if (getpeername(fd, (struct sockaddr *)&ss, &addrlen) < 0) {
-		;
-	}
-
-	/* Timeout. */
-	rcu_read_lock();
-	int timeout = 1000 * conf()->cache.srv_tcp_reply_timeout;
-	rcu_read_unlock();
+	int timeout = client->reply_timeout;
 
 	/* Receive data. */
 	int ret = net_dns_tcp_recv(fd, rx->iov_base, rx->iov_len, timeout);
 	if (ret <= 0) {
 		if (ret == KNOT_EAGAIN) {
 			char addr_str[SOCKADDR_STRLEN] = {0};
-			sockaddr_tostr(addr_str, sizeof(addr_str), (struct sockaddr *)&ss);
+			sockaddr_tostr(addr_str, sizeof(addr_str),
+			               (struct sockaddr *)&client->addr);
 			log_warning("TCP, connection timed out, address '%s'",
 			            addr_str);
 		}
@@ -131,16 +303,22 @@ static int tcp_handle(tcp_context_t *tcp, int fd,
 		rx->iov_len = ret;
 	}
 
-	/* Initialize processing layer. */
-
-	tcp->layer.state = knot_layer_begin(&tcp->layer, &param);
-
 	/* Create packets. */
 	knot_pkt_t *ans = knot_pkt_new(tx->iov_base, tx->iov_len, tcp->layer.mm);
 	knot_pkt_t *query = knot_pkt_new(rx->iov_base, rx->iov_len, tcp->layer.mm);
+	(void) knot_pkt_parse(query, 0);
+
+	/* Zone transfers are answered as the client reads them. */
+	if (tcp_is_xfr(query)) {
+		knot_pkt_free(&query);
+		knot_pkt_free(&ans);
+		return tcp_xfr_start(client, rx->iov_base, rx->iov_len);
+	}
+
+	/* Initialize processing layer. */
+	tcp->layer.state = knot_layer_begin(&tcp->layer, &client->param);
 
 	/* Input packet. */
-	(void) knot_pkt_parse(query, 0);
 	int state = knot_layer_consume(&tcp->layer, query);
 
 	/* Resolve until NOOP or finished. */
@@ -150,10 +328,12 @@ static int tcp_handle(tcp_context_t *tcp, int fd,
 
 		/* Send, if response generation passed and wasn't ignored. */
 		if (ans->size > 0 && !(state & (KNOT_STATE_FAIL|KNOT_STATE_NOOP))) {
+			QTIME_START(send_time);
 			if (net_dns_tcp_send(fd, ans->wire, ans->size, timeout) != ans->size) {
 				ret = KNOT_ECONNREFUSED;
 				break;
 			}
+			QTIME_STOP(tcp->timing, QTIME_SEND, send_time);
 		}
 	}
 
@@ -167,10 +347,10 @@ static int tcp_handle(tcp_context_t *tcp, int fd,
 	return ret;
 }
 
-int tcp_accept(int fd)
+int tcp_accept(int fd, struct sockaddr_storage *addr)
 {
 	/* Accept incoming connection. */
-	int incoming = net_accept(fd, NULL);
+	int incoming = net_accept(fd, addr);
 
 	/* Evaluate connection. */
 	if (incoming >= 0) {
@@ -193,47 +373,116 @@ int tcp_accept(int fd)
 static int tcp_event_accept(tcp_context_t *tcp, unsigned i)
 {
 	/* Accept client. */
+	struct sockaddr_storage addr = { 0 };
 	int fd = tcp->set.pfd[i].fd;
-	int client = tcp_accept(fd);
-	if (client >= 0) {
-		/* Assign to fdset. */
-		int next_id = fdset_add(&tcp->set, client, POLLIN, NULL);
-		if (next_id < 0) {
-			close(client);
-			return next_id; /* Contains errno. */
-		}
+	int client_fd = tcp_accept(fd, &addr);
+	if (client_fd < 0) {
+		return client_fd;
+	}
 
-		/* Update watchdog timer. */
-		rcu_read_lock();
-		int timeout = conf()->cache.srv_tcp_hshake_timeout;
-		fdset_set_watchdog(&tcp->set, next_id, timeout);
-		rcu_read_unlock();
+	tcp_client_t *client = malloc(sizeof(tcp_client_t));
+	if (client == NULL) {
+		close(client_fd);
+		return KNOT_ENOMEM;
+	}
+
+	/* Prepare the connection data, used for all its queries. */
+	memcpy(&client->addr, &addr, sizeof(addr));
+	client->param = (struct process_query_param) {
+		.socket = client_fd,
+		.remote = &client->addr,
+		.server = tcp->server,
+		.thread_id = tcp->thread_id,
+		.numa_node = tcp->numa_node,
+		.timing = tcp->timing
+	};
+
+	rcu_read_lock();
+	client->reply_timeout = 1000 * conf()->cache.srv_tcp_reply_timeout;
+	client->idle_timeout = conf()->cache.srv_tcp_idle_timeout;
+	int hshake_timeout = conf()->cache.srv_tcp_hshake_timeout;
+	rcu_read_unlock();
+
+	/* Assign to fdset. */
+	int next_id = fdset_add(&tcp->set, client_fd, POLLIN, client);
+	if (next_id < 0) {
+		close(client_fd);
+		free(client);
+		return next_id; /* Contains errno. */
+	}
 
-		return KNOT_EOK;
+	/* Update watchdog timer. */
+	fdset_set_watchdog(&tcp->set, next_id, hshake_timeout);
+
+	return KNOT_EOK;
+}
+
+/*! \brief Switch the client between receiving queries and sending a transfer. */
+static void tcp_client_update(tcp_context_t *tcp, unsigned i)
+{
+	tcp_client_t *client = tcp->set.ctx[i];
+
+	if (client->xfr != NULL && tcp_xfr_done(client->xfr)) {
+		tcp_xfr_free(client);
 	}
 
-	return client;
+	/* Update socket events and activity timer. */
+	if (client->xfr != NULL) {
+		/* Each message must be sent within the reply timeout, a client
+		 * accepting only partial writes doesn't extend it. */
+		if (tcp->set.pfd[i].events != POLLOUT || client->xfr->sent > 0) {
+			fdset_set_watchdog(&tcp->set, i, client->reply_timeout / 1000);
+		}
+		client->xfr->sent = 0;
+		tcp->set.pfd[i].events = POLLOUT;
+	} else {
+		tcp->set.pfd[i].events = POLLIN;
+		fdset_set_watchdog(&tcp->set, i, client->idle_timeout);
+	}
 }
 
 static int tcp_event_serve(tcp_context_t *tcp, unsigned i)
 {
 	int fd = tcp->set.pfd[i].fd;
-	int ret = tcp_handle(tcp, fd, &tcp->iov[0], &tcp->iov[1]);
+	tcp_client_t *client = tcp->set.ctx[i];
 
-	/* Flush per-query memory. */
-	mp_flush(tcp->layer.mm->ctx);
+	int ret = KNOT_EOK;
+	if (client->xfr != NULL) {
+		/* Continue the running transfer. */
+		ret = tcp_xfr_send(fd, client->xfr);
+	} else {
+		ret = tcp_handle(tcp, fd, client, &tcp->iov[0], &tcp->iov[1]);
+
+		/* Flush per-query memory. */
+		mp_flush(tcp->layer.mm->ctx);
+	}
 
 	if (ret == KNOT_EOK) {
-		/* Update socket activity timer. */
-		rcu_read_lock();
-		int timeout = conf()->cache.srv_tcp_idle_timeout;
-		fdset_set_watchdog(&tcp->set, i, timeout);
-		rcu_read_unlock();
+		tcp_client_update(tcp, i);
 	}
 
 	return ret;
 }
 
+/*! \brief Accept pending connections until the backlog is drained. */
+static int tcp_event_accept_batch(tcp_context_t *tcp, unsigned i)
+{
+	int ret = KNOT_EOK;
+	for (unsigned n = 0; n < TCP_ACCEPT_MAX; n++) {
+		unsigned clients = tcp->set.n - tcp->client_threshold;
+		if (clients >= tcp->max_clients) {
+			break;
+		}
+
+		ret = tcp_event_accept(tcp, i);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+	}
+
+	return (ret == KNOT_EAGAIN) ? KNOT_EOK : ret;
+}
+
 static int tcp_wait_for_events(tcp_context_t *tcp)
 {
 	/* Wait for events. */
@@ -247,24 +496,23 @@ static int tcp_wait_for_events(tcp_context_t *tcp)
 		/* Configuration limit, infer maximal pool size. */
 		rcu_read_lock();
 		int clients = conf()->cache.srv_max_tcp_clients;
-		unsigned max_per_set = MAX(clients / conf_tcp_threads(conf()), 1);
+		tcp->max_clients = MAX(clients / conf_tcp_threads(conf()), 1);
 		rcu_read_unlock();
 		/* Subtract master sockets check limits. */
-		is_throttled = (set->n - tcp->client_threshold) >= max_per_set;
+		is_throttled = (set->n - tcp->client_threshold) >= tcp->max_clients;
 	}
 
 	/* Process events. */
 	unsigned i = 0;
 	while (nfds > 0 && i < set->n) {
 		bool should_close = false;
-		int fd = set->pfd[i].fd;
 		if (set->pfd[i].revents & (POLLERR|POLLHUP|POLLNVAL)) {
 			should_close = (i >= tcp->client_threshold);
 			--nfds;
-		} else if (set->pfd[i].revents & (POLLIN)) {
+		} else if (set->pfd[i].revents & (POLLIN|POLLOUT)) {
 			/* Master sockets */
 			if (i < tcp->client_threshold) {
-				if (!is_throttled && tcp_event_accept(tcp, i) == KNOT_EBUSY) {
+				if (!is_throttled && tcp_event_accept_batch(tcp, i) == KNOT_EBUSY) {
 					time_now(&tcp->throttle_end);
 					tcp->throttle_end.tv_sec += tcp_throttle();
 				}
@@ -279,8 +527,8 @@ static int tcp_wait_for_events(tcp_context_t *tcp)
 
 		/* Evaluate */
 		if (should_close) {
+			tcp_client_close(set, i);
 			fdset_remove(set, i);
-			close(fd);
 		} else {
 			++i;
 		}
@@ -303,17 +551,36 @@ int tcp_master(dthread_t *thread)
 	tcp_context_t tcp;
 	memset(&tcp, 0, sizeof(tcp_context_t));
 
+	/* Bind to the CPUs of the thread node before allocating any memory. */
+	tcp.thread_id = handler->thread_id[dt_get_id(thread)];
+	tcp.numa_node = numa_thread_node(tcp.thread_id);
+	if (numa_nodes() > 1) {
+		const unsigned *cpus = NULL;
+		size_t cpu_count = numa_node_cpus(tcp.numa_node, &cpus);
+		dt_setaffinity(thread, (unsigned *)cpus, cpu_count);
+	}
+
 	/* Create big enough memory cushion. */
 	knot_mm_t mm = { 0 };
-	mm_ctx_mempool(&mm, 16 * MM_DEFAULT_BLKSIZE);
+	rcu_read_lock();
+	conf_val_t val = conf_get(conf(), C_SRV, C_HUGE_PAGES);
+	bool huge_pages = conf_bool(&val);
+	rcu_read_unlock();
+	if (huge_pages) {
+		mm_ctx_mempool_huge(&mm, 16 * MM_DEFAULT_BLKSIZE);
+	} else {
+		mm_ctx_mempool(&mm, 16 * MM_DEFAULT_BLKSIZE);
+	}
 
 	/* Create TCP answering context. */
 	tcp.server = handler->server;
-	tcp.thread_id = handler->thread_id[dt_get_id(thread)];
+	if (handler->timing != NULL) {
+		tcp.timing = &handler->timing[dt_get_id(thread)];
+	}
 	knot_layer_init(&tcp.layer, &mm, process_query_layer());
 
 	/* Prepare structures for bound sockets. */
-	conf_val_t val = conf_get(conf(), C_SRV, C_LISTEN);
+	val = conf_get(conf(), C_SRV, C_LISTEN);
 	fdset_init(&tcp.set, conf_val_count(&val) + CONF_XFERS);
 
 	/* Create iovec abstraction. */
@@ -337,18 +604,20 @@ int tcp_master(dthread_t *thread)
 		if (unlikely(*iostate & ServerReload)) {
 			*iostate &= ~ServerReload;
 
-			/* Cancel client connections. */
-			for (unsigned i = tcp.client_threshold; i < tcp.set.n; ++i) {
-				close(tcp.set.pfd[i].fd);
-			}
+			/* Cancel client connections, keep running transfers. */
+			fdset_t xfrs;
+			tcp_clients_suspend(&tcp, &xfrs);
+
+			/* Listening sockets are selected by the thread identifier. */
+			tcp.thread_id = handler->thread_id[dt_get_id(thread)];
 
 			ref_release(ref);
 			ref = server_set_ifaces(handler->server, &tcp.set, IO_TCP, tcp.thread_id);
-			if (tcp.set.n == 0) {
+			tcp.client_threshold = tcp.set.n;
+			tcp_clients_resume(&tcp, &xfrs);
+			if (tcp.client_threshold == 0) {
 				break; /* Terminate on zero interfaces. */
 			}
-
-			tcp.client_threshold = tcp.set.n;
 		}
 
 		/* Check for cancellation. */
@@ -368,6 +637,7 @@ int tcp_master(dthread_t *thread)
 	}
 
 finish:
+	tcp_clients_close(&tcp);
 	free(tcp.iov[0].iov_base);
 	free(tcp.iov[1].iov_base);
 	mp_delete(mm.ctx);
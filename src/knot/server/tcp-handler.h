@@ -30,19 +30,22 @@
 
 #pragma once
 
+#include <sys/socket.h>
+
 #include "knot/server/dthreads.h"
 
 #define TCP_SWEEP_INTERVAL 2 /*!< [secs] granularity of connection sweeping. */
-#define TCP_BACKLOG_SIZE  10 /*!< TCP listen backlog size. */
+#define TCP_BACKLOG_SIZE 128 /*!< TCP listen backlog size. */
 
 /*!
  * \brief Accept a TCP connection.
  * \param fd Associated socket.
+ * \param addr Remote address (can be NULL).
  *
  * \retval Created connection fd if success.
  * \retval <0 on error.
  */
-int tcp_accept(int fd);
+int tcp_accept(int fd, struct sockaddr_storage *addr);
 
 /*!
  * \brief TCP handler thread runnable.
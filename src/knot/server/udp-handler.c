@@ -38,7 +38,9 @@
 #include "contrib/sockaddr.h"
 #include "contrib/ucw/mempool.h"
 #include "knot/nameserver/process_query.h"
+#include "knot/query/defer.h"
 #include "knot/query/layer.h"
+#include "knot/server/numa.h"
 #include "knot/server/server.h"
 #include "knot/server/udp-handler.h"
 
@@ -54,10 +56,13 @@ typedef struct udp_context {
 	struct knot_layer layer;     /*!< Query processing layer. */
 	server_t *server;            /*!< Name server structure. */
 	unsigned thread_id;          /*!< Thread identifier. */
+	unsigned numa_node;          /*!< Memory node of the thread. */
+	query_timing_t *timing;      /*!< Thread query timing (optional). */
+	query_defer_queue_t *defer;  /*!< Deferred answers of the thread. */
 } udp_context_t;
 
 static void udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
-                       struct iovec *rx, struct iovec *tx)
+                       struct iovec *rx, struct iovec *tx, query_defer_t *deferred)
 {
 	/* Create query processing parameter. */
 	struct process_query_param param = {0};
@@ -68,6 +73,10 @@ static void udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
 	param.socket = fd;
 	param.server = udp->server;
 	param.thread_id = udp->thread_id;
+	param.numa_node = udp->numa_node;
+	param.timing = udp->timing;
+	param.defer = udp->defer;
+	param.deferred = deferred;
 
 	/* Rate limit is applied? */
 	if (unlikely(udp->server->rrl != NULL) && udp->server->rrl->rate > 0) {
@@ -218,7 +227,7 @@ static int udp_recvfrom_handle(udp_context_t *ctx, void *d)
 	udp_pktinfo_handle(&rq->msg[RX], &rq->msg[TX]);
 
 	/* Process received pkt. */
-	udp_handle(ctx, rq->fd, &rq->addr, &rq->iov[RX], &rq->iov[TX]);
+	udp_handle(ctx, rq->fd, &rq->addr, &rq->iov[RX], &rq->iov[TX], NULL);
 
 	return KNOT_EOK;
 }
@@ -359,7 +368,7 @@ static int udp_recvmmsg_handle(udp_context_t *ctx, void *d)
 
 		udp_pktinfo_handle(&rq->msgs[RX][i].msg_hdr,&rq->msgs[TX][i].msg_hdr);
 
-		udp_handle(ctx, rq->fd, rq->addrs + i, rx, tx);
+		udp_handle(ctx, rq->fd, rq->addrs + i, rx, tx, NULL);
 		rq->msgs[TX][i].msg_len = tx->iov_len;
 		rq->msgs[TX][i].msg_hdr.msg_namelen = 0;
 		if (tx->iov_len > 0) {
@@ -444,19 +453,20 @@ static void forget_ifaces(ifacelist_t *ifaces, struct pollfd **fds_ptr)
 /*!
  * \brief Make a set of watched descriptors based on the interface list.
  *
- * \param[in]   ifaces  New interface list.
- * \param[in]   thrid   Thread ID.
- * \param[out]  fds_ptr Allocated set of descriptors.
+ * \param[in]   ifaces   New interface list.
+ * \param[in]   thrid    Thread ID.
+ * \param[in]   defer_fd Deferred answers descriptor, watched last.
+ * \param[out]  fds_ptr  Allocated set of descriptors.
  *
  * \return Number of watched descriptors, zero on error.
  */
-static nfds_t track_ifaces(const ifacelist_t *ifaces, int thrid,
+static nfds_t track_ifaces(const ifacelist_t *ifaces, int thrid, int defer_fd,
                            struct pollfd **fds_ptr)
 {
 	assert(ifaces && fds_ptr);
 
 	nfds_t nfds = list_size(&ifaces->l);
-	struct pollfd *fds = malloc(nfds * sizeof(*fds));
+	struct pollfd *fds = malloc((nfds + 1) * sizeof(*fds));
 	if (!fds) {
 		*fds_ptr = NULL;
 		return 0;
@@ -472,16 +482,61 @@ static nfds_t track_ifaces(const ifacelist_t *ifaces, int thrid,
 	}
 	assert(i == nfds);
 
+	fds[nfds].fd = defer_fd;
+	fds[nfds].events = POLLIN;
+	fds[nfds].revents = 0;
+
 	*fds_ptr = fds;
-	return nfds;
+	return nfds + 1;
+}
+
+/*!
+ * \brief Send the deferred answers finished for the thread.
+ *
+ * The query is processed again to pass the answer through the end of the
+ * query plan and the rate limiting. Answers deferred before the last
+ * interface reload are dropped, their socket may be closed already.
+ */
+static void udp_handle_deferred(udp_context_t *udp, knot_mm_t *mm)
+{
+	query_defer_t *defer = NULL;
+	while ((defer = query_defer_queue_pop(udp->defer)) != NULL) {
+		if (defer->generation != udp->defer->generation) {
+			query_defer_free(defer);
+			continue;
+		}
+
+		struct iovec rx = { defer->query, defer->query_len };
+		struct iovec tx = { mm->alloc(mm->ctx, KNOT_WIRE_MAX_PKTSIZE),
+		                    KNOT_WIRE_MAX_PKTSIZE };
+		if (tx.iov_base != NULL) {
+			udp_handle(udp, defer->fd, &defer->remote, &rx, &tx, defer);
+			if (tx.iov_len > 0) {
+				QTIME_START(send_time);
+				(void)sendto(defer->fd, tx.iov_base, tx.iov_len, 0,
+				             (struct sockaddr *)&defer->remote,
+				             sockaddr_len((struct sockaddr *)&defer->remote));
+				QTIME_STOP(udp->timing, QTIME_SEND, send_time);
+			}
+		}
+
+		query_defer_free(defer);
+		mp_flush(mm->ctx);
+	}
 }
 
 int udp_master(dthread_t *thread)
 {
-	unsigned cpu = dt_online_cpus();
-	if (cpu > 1) {
-		unsigned cpu_mask = (dt_get_id(thread) % cpu);
-		dt_setaffinity(thread, &cpu_mask, 1);
+	/* Prepare structures for bound sockets. */
+	unsigned thr_id = dt_get_id(thread);
+	iohandler_t *handler = (iohandler_t *)thread->data;
+	unsigned *iostate = &handler->thread_state[thr_id];
+
+	/* Bind to a CPU of the thread node before allocating any memory. */
+	unsigned thread_id = handler->thread_id[thr_id];
+	if (dt_online_cpus() > 1) {
+		unsigned cpu = numa_thread_cpu(thread_id);
+		dt_setaffinity(thread, &cpu, 1);
 	}
 
 	/* Drop all capabilities on all workers. */
@@ -492,24 +547,40 @@ int udp_master(dthread_t *thread)
         }
 #endif /* HAVE_CAP_NG_H */
 
-	/* Prepare structures for bound sockets. */
-	unsigned thr_id = dt_get_id(thread);
-	iohandler_t *handler = (iohandler_t *)thread->data;
-	unsigned *iostate = &handler->thread_state[thr_id];
 	void *rq = _udp_init();
 	ifacelist_t *ref = NULL;
 
 	/* Create big enough memory cushion. */
 	knot_mm_t mm;
-	mm_ctx_mempool(&mm, 16 * MM_DEFAULT_BLKSIZE);
+	rcu_read_lock();
+	conf_val_t val = conf_get(conf(), C_SRV, C_HUGE_PAGES);
+	bool huge_pages = conf_bool(&val);
+	rcu_read_unlock();
+	if (huge_pages) {
+		mm_ctx_mempool_huge(&mm, 16 * MM_DEFAULT_BLKSIZE);
+	} else {
+		mm_ctx_mempool(&mm, 16 * MM_DEFAULT_BLKSIZE);
+	}
 
 	/* Create UDP answering context. */
 	udp_context_t udp;
 	memset(&udp, 0, sizeof(udp_context_t));
 	udp.server = handler->server;
-	udp.thread_id = handler->thread_id[thr_id];
+	udp.thread_id = thread_id;
+	udp.numa_node = numa_thread_node(thread_id);
+	if (handler->timing != NULL) {
+		udp.timing = &handler->timing[thr_id];
+	}
 	knot_layer_init(&udp.layer, &mm, process_query_layer());
 
+	/* Answers deferred by the query modules. */
+	udp.defer = query_defer_queue_new();
+	if (udp.defer == NULL) {
+		_udp_deinit(rq);
+		mp_delete(mm.ctx);
+		return KNOT_ENOMEM;
+	}
+
 	/* Event source. */
 	struct pollfd *fds = NULL;
 	nfds_t nfds = 0;
@@ -525,9 +596,10 @@ int udp_master(dthread_t *thread)
 			rcu_read_lock();
 			forget_ifaces(ref, &fds);
 			ref = handler->server->ifaces;
-			nfds = track_ifaces(ref, udp.thread_id, &fds);
+			nfds = track_ifaces(ref, udp.thread_id, udp.defer->pipe[0], &fds);
 			rcu_read_unlock();
-			if (nfds == 0) {
+			udp.defer->generation += 1;
+			if (nfds <= 1) {
 				break;
 			}
 		}
@@ -550,18 +622,25 @@ int udp_master(dthread_t *thread)
 				continue;
 			}
 			events -= 1;
+			if (i == nfds - 1) {
+				udp_handle_deferred(&udp, &mm);
+				continue;
+			}
 			int rcvd = 0;
 			if ((rcvd = _udp_recv(fds[i].fd, rq)) > 0) {
 				_udp_handle(&udp, rq);
 				/* Flush allocated memory. */
 				mp_flush(mm.ctx);
+				QTIME_START(send_time);
 				_udp_send(rq);
+				QTIME_STOP(udp.timing, QTIME_SEND, send_time);
 			}
 		}
 	}
 
 	_udp_deinit(rq);
 	forget_ifaces(ref, &fds);
+	query_defer_queue_free(udp.defer);
 	mp_delete(mm.ctx);
 	return KNOT_EOK;
 }
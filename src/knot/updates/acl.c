@@ -16,6 +16,24 @@
 
 #include "knot/updates/acl.h"
 
+static bool addr_allowed(conf_t *conf, conf_val_t *acl,
+                         const struct sockaddr_storage *addr)
+{
+	/* Use the compiled address ranges if available. */
+	if (conf->cache.acl_addr_ranges != NULL) {
+		conf_val(acl);
+		value_t *ranges = hattrie_tryget(conf->cache.acl_addr_ranges,
+		                                 (const char *)acl->data, acl->len);
+		if (ranges != NULL) {
+			return *ranges == NULL ||
+			       addr_ranges_match(*ranges, (struct sockaddr *)addr);
+		}
+	}
+
+	conf_val_t val = conf_id_get(conf, C_ACL, C_ADDR, acl);
+	return val.code == KNOT_ENOENT || conf_addr_range_match(&val, addr);
+}
+
 bool acl_allowed(conf_t *conf, conf_val_t *acl, acl_action_t action,
                  const struct sockaddr_storage *addr, knot_tsig_key_t *tsig)
 {
@@ -25,8 +43,7 @@ bool acl_allowed(conf_t *conf, conf_val_t *acl, acl_action_t action,
 
 	while (acl->code == KNOT_EOK) {
 		/* Check if the address matches the current acl address list. */
-		conf_val_t val = conf_id_get(conf, C_ACL, C_ADDR, acl);
-		if (val.code != KNOT_ENOENT && !conf_addr_range_match(&val, addr)) {
+		if (!addr_allowed(conf, acl, addr)) {
 			goto next_acl;
 		}
 
@@ -63,6 +80,7 @@ bool acl_allowed(conf_t *conf, conf_val_t *acl, acl_action_t action,
 		}
 
 		/* Check if the action is allowed. */
+		conf_val_t val;
 		if (action != ACL_ACTION_NONE) {
 			val = conf_id_get(conf, C_ACL, C_ACTION, acl);
 			while (val.code == KNOT_EOK) {
@@ -558,6 +558,8 @@ void update_free_zone(zone_contents_t **contents)
 		return;
 	}
 
+	zone_contents_free_replicas(*contents);
+
 	zone_tree_apply((*contents)->nodes, free_additional, NULL);
 	zone_tree_deep_free(&(*contents)->nodes);
 	zone_tree_deep_free(&(*contents)->nsec3_nodes);
@@ -412,11 +412,12 @@ static int sign_update(zone_update_t *update,
 	if (full_sign) {
 		ret = knot_dnssec_zone_sign(new_contents, &sec_ch,
 		                            ZONE_SIGN_KEEP_SOA_SERIAL,
-		                            &refresh_at);
+		                            &refresh_at, update->zone->dnssec_cache);
 	} else {
 		/* Sign the created changeset */
 		ret = knot_dnssec_sign_changeset(new_contents, &update->change,
-		                                 &sec_ch, &refresh_at);
+		                                 &sec_ch, &refresh_at,
+		                                 update->zone->dnssec_cache);
 	}
 	if (ret != KNOT_EOK) {
 		changeset_clear(&sec_ch);
@@ -614,6 +615,7 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 	/* If there is anything to change */
 	if (new_contents != NULL) {
 		/* Switch zone contents. */
+		zone_replicate_contents(conf, update->zone, new_contents);
 		zone_contents_t *old_contents = zone_switch_contents(update->zone,
 		                                                     new_contents);
 
@@ -23,6 +23,11 @@
 #include "libknot/libknot.h"
 #include "contrib/hat-trie/hat-trie.h"
 #include "contrib/macros.h"
+#include "contrib/mempattern.h"
+#include "contrib/ucw/mempool.h"
+
+/*! \brief Chunk size of the arena of a read-only copy. */
+#define CONTENTS_ARENA_CHUNK	(2 * 1024 * 1024)
 
 typedef struct {
 	zone_contents_apply_cb_t func;
@@ -123,9 +128,9 @@ static int discover_additionals(struct rr_data *rr_data, zone_contents_t *zone)
 	/* Create new additional nodes. */
 	uint16_t rdcount = rrs->rr_count;
 	if (rr_data->additional) {
-		free(rr_data->additional);
+		mm_free(zone->mm, rr_data->additional);
 	}
-	rr_data->additional = malloc(rdcount * sizeof(zone_node_t *));
+	rr_data->additional = mm_alloc(zone->mm, rdcount * sizeof(zone_node_t *));
 	if (rr_data->additional == NULL) {
 		return KNOT_ENOMEM;
 	}
@@ -367,7 +372,7 @@ static bool nsec3_params_match(const knot_rdataset_t *rrs,
 		          params->salt.size) == 0);
 }
 
-zone_contents_t *zone_contents_new(const knot_dname_t *apex_name)
+static zone_contents_t *contents_new(const knot_dname_t *apex_name, knot_mm_t *mm)
 {
 	if (apex_name == NULL) {
 		return NULL;
@@ -379,7 +384,8 @@ zone_contents_t *zone_contents_new(const knot_dname_t *apex_name)
 	}
 
 	memset(contents, 0, sizeof(zone_contents_t));
-	contents->apex = node_new(apex_name, NULL);
+	contents->mm = mm;
+	contents->apex = node_new(apex_name, mm);
 	if (contents->apex == NULL) {
 		goto cleanup;
 	}
@@ -402,6 +408,11 @@ cleanup:
 	return NULL;
 }
 
+zone_contents_t *zone_contents_new(const knot_dname_t *apex_name)
+{
+	return contents_new(apex_name, NULL);
+}
+
 static zone_node_t *get_node(const zone_contents_t *zone, const knot_dname_t *name)
 {
 	if (zone == NULL || name == NULL) {
@@ -417,7 +428,25 @@ static zone_node_t *get_node(const zone_contents_t *zone, const knot_dname_t *na
 	return n;
 }
 
-static int add_node(zone_contents_t *zone, zone_node_t *node, bool create_parents)
+/*!
+ * \brief Find the closest existing parent of a node being added.
+ *
+ * \param zone      Zone contents.
+ * \param name      Parent name.
+ * \param ancestor  Closest existing ancestor of the node if known, NULL otherwise.
+ */
+static zone_node_t *get_parent(const zone_contents_t *zone, const knot_dname_t *name,
+                               zone_node_t *ancestor)
+{
+	if (ancestor == NULL) {
+		return get_node(zone, name);
+	}
+
+	return knot_dname_is_equal(name, ancestor->owner) ? ancestor : NULL;
+}
+
+static int add_node(zone_contents_t *zone, zone_node_t *node, bool create_parents,
+                    zone_node_t *ancestor)
 {
 	if (zone == NULL || node == NULL) {
 		return KNOT_EINVAL;
@@ -453,10 +482,10 @@ static int add_node(zone_contents_t *zone, zone_node_t *node, bool create_parent
 			zone->apex->flags |= NODE_FLAGS_WILDCARD_CHILD;
 		}
 	} else {
-		while (parent != NULL && !(next_node = get_node(zone, parent))) {
+		while (parent != NULL && !(next_node = get_parent(zone, parent, ancestor))) {
 
 			/* Create a new node. */
-			next_node = node_new(parent, NULL);
+			next_node = node_new(parent, zone->mm);
 			if (next_node == NULL) {
 				return KNOT_ENOMEM;
 			}
@@ -464,7 +493,7 @@ static int add_node(zone_contents_t *zone, zone_node_t *node, bool create_parent
 			/* Insert node to a tree. */
 			ret = zone_tree_insert(zone->nodes, next_node);
 			if (ret != KNOT_EOK) {
-				node_free(&next_node, NULL);
+				node_free(&next_node, zone->mm);
 				return ret;
 			}
 
@@ -555,18 +584,118 @@ static int insert_rr(zone_contents_t *z, const knot_rrset_t *rr,
 		*n = nsec3 ? get_nsec3_node(z, rr->owner) : get_node(z, rr->owner);
 		if (*n == NULL) {
 			// Create new, insert
-			*n = node_new(rr->owner, NULL);
+			*n = node_new(rr->owner, z->mm);
 			if (*n == NULL) {
 				return KNOT_ENOMEM;
 			}
-			ret = nsec3 ? add_nsec3_node(z, *n) : add_node(z, *n, true);
+			ret = nsec3 ? add_nsec3_node(z, *n) : add_node(z, *n, true, NULL);
 			if (ret != KNOT_EOK) {
-				node_free(n, NULL);
+				node_free(n, z->mm);
 			}
 		}
 	}
 
-	return node_add_rrset(*n, rr, NULL);
+	return node_add_rrset(*n, rr, z->mm);
+}
+
+/*!
+ * \brief Get the deepest node on the path from the last added node to the apex
+ *        which is an ancestor of the name.
+ *
+ * If the input is sorted, all existing ancestors of a new name are on this
+ * path, because the names between a node and its descendant in the canonical
+ * order are all descendants of the node too.
+ */
+static zone_node_t *last_ancestor(zone_node_t *last, const knot_dname_t *name)
+{
+	while (last != NULL && !knot_dname_is_sub(name, last->owner)) {
+		last = last->parent;
+	}
+
+	return last;
+}
+
+static int build_rr(zone_contents_t *z, zone_contents_build_t *build,
+                    const knot_rrset_t *rr, zone_node_t **n, bool nsec3)
+{
+	if (knot_rrset_empty(rr)) {
+		return KNOT_EINVAL;
+	}
+
+	// check if the RRSet belongs to the zone
+	if (!knot_dname_is_sub(rr->owner, z->apex->owner) &&
+	    !knot_dname_is_equal(rr->owner, z->apex->owner)) {
+		return KNOT_EOUTOFZONE;
+	}
+
+	zone_node_t **last = nsec3 ? &build->last_nsec3 : &build->last;
+	uint8_t *last_lf = nsec3 ? build->last_nsec3_lf : build->last_lf;
+	bool *unsorted = nsec3 ? &build->unsorted_nsec3 : &build->unsorted;
+
+	if (*last == NULL && !*unsorted) {
+		// Nothing but the apex may be in the tree for the order to matter.
+		zone_tree_t *tree = nsec3 ? z->nsec3_nodes : z->nodes;
+		size_t weight = (tree != NULL) ? zone_tree_weight(tree) : 0;
+		if (!nsec3 && weight == 1) {
+			*last = z->apex;
+			knot_dname_lf(last_lf, z->apex->owner, NULL);
+		} else if (weight > 0) {
+			*unsorted = true;
+		}
+	}
+
+	// Compare with the last owner, lower owner breaks the order for good.
+	int cmp = 1;
+	uint8_t lf[KNOT_DNAME_MAXLEN];
+	if (*unsorted) {
+		if (*last != NULL && knot_dname_is_equal(rr->owner, (*last)->owner)) {
+			cmp = 0;
+		}
+	} else {
+		int ret = knot_dname_lf(lf, rr->owner, NULL);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		if (*last != NULL) {
+			cmp = memcmp(lf + 1, last_lf + 1, MIN(*lf, *last_lf));
+			if (cmp == 0) {
+				cmp = (int)*lf - (int)*last_lf;
+			}
+		}
+		if (cmp < 0) {
+			*unsorted = true;
+		}
+	}
+
+	zone_node_t *node = NULL;
+	if (cmp == 0) {
+		node = *last;
+	} else {
+		if (*unsorted) {
+			node = nsec3 ? get_nsec3_node(z, rr->owner) : get_node(z, rr->owner);
+		}
+		if (node == NULL) {
+			node = node_new(rr->owner, z->mm);
+			if (node == NULL) {
+				return KNOT_ENOMEM;
+			}
+			zone_node_t *ancestor = *unsorted ? NULL :
+			                        last_ancestor(*last, node->owner);
+			int ret = nsec3 ? add_nsec3_node(z, node) :
+			                  add_node(z, node, true, ancestor);
+			if (ret != KNOT_EOK) {
+				node_free(&node, z->mm);
+				return ret;
+			}
+		}
+		*last = node;
+		if (!*unsorted) {
+			memcpy(last_lf, lf, *lf + 1);
+		}
+	}
+
+	*n = node;
+	return node_add_rrset(node, rr, z->mm);
 }
 
 static int remove_rr(zone_contents_t *z, const knot_rrset_t *rr,
@@ -652,7 +781,7 @@ static int recreate_normal_tree(const zone_contents_t *z, zone_contents_t *out)
 			return KNOT_ENOMEM;
 		}
 
-		int ret = add_node(out, to_add, true);
+		int ret = add_node(out, to_add, true, NULL);
 		if (ret != KNOT_EOK) {
 			node_free(&to_add, NULL);
 			hattrie_iter_free(itt);
@@ -714,6 +843,16 @@ int zone_contents_add_rr(zone_contents_t *z, const knot_rrset_t *rr,
 	return insert_rr(z, rr, n, knot_rrset_is_nsec3rel(rr));
 }
 
+int zone_contents_build_rr(zone_contents_t *z, zone_contents_build_t *build,
+                           const knot_rrset_t *rr, zone_node_t **n)
+{
+	if (z == NULL || build == NULL || rr == NULL || n == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return build_rr(z, build, rr, n, knot_rrset_is_nsec3rel(rr));
+}
+
 int zone_contents_remove_rr(zone_contents_t *z, const knot_rrset_t *rr,
                             zone_node_t **n)
 {
@@ -735,7 +874,7 @@ zone_node_t *zone_contents_get_node_for_rr(zone_contents_t *zone, const knot_rrs
 	                            get_node(zone, rrset->owner);
 	if (node == NULL) {
 		node = node_new(rrset->owner, NULL);
-		int ret = nsec3 ? add_nsec3_node(zone, node) : add_node(zone, node, true);
+		int ret = nsec3 ? add_nsec3_node(zone, node) : add_node(zone, node, true, NULL);
 		if (ret != KNOT_EOK) {
 			node_free(&node, NULL);
 			return NULL;
@@ -1070,12 +1209,109 @@ int zone_contents_shallow_copy(const zone_contents_t *from, zone_contents_t **to
 	return KNOT_EOK;
 }
 
+typedef struct {
+	zone_contents_t *to;
+	zone_contents_build_t build;
+} copy_ctx_t;
+
+static int copy_node(zone_node_t *node, void *data)
+{
+	copy_ctx_t *ctx = data;
+
+	for (uint16_t i = 0; i < node->rrset_count; ++i) {
+		knot_rrset_t rr = node_rrset_at(node, i);
+		zone_node_t *n = NULL;
+		int ret = zone_contents_build_rr(ctx->to, &ctx->build, &rr, &n);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+int zone_contents_deep_copy(const zone_contents_t *from, zone_contents_t **to,
+                            bool huge_pages)
+{
+	if (from == NULL || from->apex == NULL || to == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	/* The copy is read-only, so all its nodes can be put in one arena. */
+	knot_mm_t *mm = malloc(sizeof(*mm));
+	if (mm == NULL) {
+		return KNOT_ENOMEM;
+	}
+	if (huge_pages) {
+		mm_ctx_mempool_huge(mm, CONTENTS_ARENA_CHUNK);
+	} else {
+		mm_ctx_mempool(mm, CONTENTS_ARENA_CHUNK);
+	}
+	if (mm->ctx == NULL) {
+		free(mm);
+		return KNOT_ENOMEM;
+	}
+
+	copy_ctx_t ctx = {
+		.to = contents_new(from->apex->owner, mm)
+	};
+	if (ctx.to == NULL) {
+		mp_delete(mm->ctx);
+		free(mm);
+		return KNOT_ENOMEM;
+	}
+
+	/* Both trees are walked in canonical order, the fast path applies. */
+	zone_contents_t *src = (zone_contents_t *)from;
+	int ret = zone_contents_tree_apply_inorder(src, copy_node, &ctx);
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_nsec3_apply_inorder(src, copy_node, &ctx);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_adjust_full(ctx.to);
+	}
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(&ctx.to);
+		return ret;
+	}
+
+	*to = ctx.to;
+	return KNOT_EOK;
+}
+
+const zone_contents_t *zone_contents_local(const zone_contents_t *contents,
+                                           unsigned node)
+{
+	if (contents == NULL || node >= contents->replica_count ||
+	    contents->replicas[node] == NULL) {
+		return contents;
+	}
+
+	return contents->replicas[node];
+}
+
+void zone_contents_free_replicas(zone_contents_t *contents)
+{
+	if (contents == NULL || contents->replicas == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < contents->replica_count; i++) {
+		zone_contents_deep_free(&contents->replicas[i]);
+	}
+	free(contents->replicas);
+	contents->replicas = NULL;
+	contents->replica_count = 0;
+}
+
 void zone_contents_free(zone_contents_t **contents)
 {
 	if (contents == NULL || *contents == NULL) {
 		return;
 	}
 
+	zone_contents_free_replicas(*contents);
+
 	// free the zone tree, but only the structure
 	zone_tree_free(&(*contents)->nodes);
 	zone_tree_free(&(*contents)->nsec3_nodes);
@@ -1092,6 +1328,15 @@ void zone_contents_deep_free(zone_contents_t **contents)
 		return;
 	}
 
+	// Nodes in an arena are freed all at once
+	knot_mm_t *mm = (*contents)->mm;
+	if (mm != NULL) {
+		zone_contents_free(contents);
+		mp_delete(mm->ctx);
+		free(mm);
+		return;
+	}
+
 	if (*contents != NULL) {
 		// Delete NSEC3 tree
 		zone_tree_apply((*contents)->nsec3_nodes, destroy_node_rrsets_from_tree, NULL);
@@ -25,6 +25,7 @@
 #pragma once
 
 #include "dnssec/nsec.h"
+#include "libknot/consts.h"
 #include "libknot/rrtype/nsec3param.h"
 #include "knot/zone/node.h"
 #include "knot/zone/zone-tree.h"
@@ -42,8 +43,36 @@ typedef struct zone_contents {
 
 	dnssec_nsec3_params_t nsec3_params;
 	size_t size;
+
+	/*! \brief Arena of the nodes and their data, NULL if allocated one by one. */
+	knot_mm_t *mm;
+
+	/*! \brief Read-only copies placed on each memory node (optional). */
+	struct zone_contents **replicas;
+	unsigned replica_count;
+
+	/*! \brief Unique number assigned when switched into a zone. */
+	uint64_t generation;
 } zone_contents_t;
 
+/*!
+ * \brief Insertion state for building contents from a stream of RRs.
+ *
+ * Zone files and zone transfers are usually in canonical order. As long as
+ * the owners don't decrease, the RRs of the last owner are added to its node
+ * directly, a new owner is known not to be in the tree yet and its parents are
+ * found on the path from the last node. Unsorted input falls back to tree
+ * lookups. The state must be zeroed before the first RR.
+ */
+typedef struct {
+	zone_node_t *last;                   /*!< Last node of the normal tree. */
+	zone_node_t *last_nsec3;             /*!< Last node of the NSEC3 tree. */
+	uint8_t last_lf[KNOT_DNAME_MAXLEN];  /*!< Lookup format of 'last'. */
+	uint8_t last_nsec3_lf[KNOT_DNAME_MAXLEN];
+	bool unsorted;                       /*!< Normal tree input not sorted. */
+	bool unsorted_nsec3;                 /*!< NSEC3 tree input not sorted. */
+} zone_contents_build_t;
+
 /*!
  * \brief Signature of callback for zone contents apply functions.
  */
@@ -69,6 +98,21 @@ zone_contents_t *zone_contents_new(const knot_dname_t *apex_name);
  */
 int zone_contents_add_rr(zone_contents_t *z, const knot_rrset_t *rr, zone_node_t **n);
 
+/*!
+ * \brief Add an RR to contents being built from a stream of RRs.
+ *
+ * Same as zone_contents_add_rr(), but faster if the RRs come sorted.
+ *
+ * \param z      Contents to add to.
+ * \param build  Insertion state (zeroed before the first RR).
+ * \param rr     The RR to add.
+ * \param n      Node to which the RR has been added to.
+ *
+ * \return KNOT_E*
+ */
+int zone_contents_build_rr(zone_contents_t *z, zone_contents_build_t *build,
+                           const knot_rrset_t *rr, zone_node_t **n);
+
 /*!
  * \brief Remove an RR from contents.
  *
@@ -243,6 +287,44 @@ int zone_contents_nsec3_apply_inorder(zone_contents_t *zone,
  */
 int zone_contents_shallow_copy(const zone_contents_t *from, zone_contents_t **to);
 
+/*!
+ * \brief Create a deep copy of zone contents.
+ *
+ * The copy is built in the calling thread, so its memory is allocated on the
+ * node the thread runs on. Replicas of the original are not copied.
+ *
+ * The nodes of the copy and their data are allocated from an arena, which is
+ * freed at once with the copy. The copy must not be modified.
+ *
+ * \param from        Original zone contents.
+ * \param to          Copy of the zone contents.
+ * \param huge_pages  Back the arena with huge pages if possible.
+ *
+ * \retval KNOT_EOK
+ * \retval KNOT_EINVAL
+ * \retval KNOT_ENOMEM
+ */
+int zone_contents_deep_copy(const zone_contents_t *from, zone_contents_t **to,
+                            bool huge_pages);
+
+/*!
+ * \brief Get the zone contents for reading on the given memory node.
+ *
+ * \param contents  Zone contents.
+ * \param node      Memory node of the reader.
+ *
+ * \return Replica for the node if available, the contents otherwise.
+ */
+const zone_contents_t *zone_contents_local(const zone_contents_t *contents,
+                                           unsigned node);
+
+/*!
+ * \brief Deallocate the replicas of zone contents.
+ *
+ * \param contents  Zone contents.
+ */
+void zone_contents_free_replicas(zone_contents_t *contents);
+
 /*!
  * \brief Deallocate directly owned data of zone contents.
  *
@@ -14,6 +14,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <sys/types.h>
@@ -28,6 +29,8 @@
 #include "knot/dnssec/zone-nsec.h"
 #include "libknot/libknot.h"
 #include "contrib/base32hex.h"
+#include "contrib/hat-trie/hat-trie.h"
+#include "contrib/macros.h"
 #include "contrib/mempattern.h"
 #include "contrib/wire.h"
 #include "knot/dnssec/nsec-chain.h"
@@ -119,9 +122,21 @@ typedef struct semchecks_data {
 	err_handler_t *handler;
 	bool fatal_error;
 	const zone_node_t *next_nsec;
+	bool next_nsec_unknown;  /*!< Previous NSEC is in another partition. */
 	enum check_levels level;
 } semchecks_data_t;
 
+/*!
+ * \brief Pseudo error recorded for the first NSEC node of a partition.
+ *
+ * The link from the previous NSEC node is checked when the partitions
+ * are merged.
+ */
+#define ZC_NSEC_LINK 1
+
+/*! \brief Minimal number of nodes checked by one thread. */
+#define PARTITION_MIN_NODES 1024
+
 static int check_cname_multiple(const zone_node_t *node, semchecks_data_t *data);
 static int check_dname(const zone_node_t *node, semchecks_data_t *data);
 static int check_delegation(const zone_node_t *node, semchecks_data_t *data);
@@ -525,7 +540,14 @@ static int check_nsec(const zone_node_t *node, semchecks_data_t *data)
 		}
 	}
 
-	if (data->next_nsec != node) {
+	if (data->next_nsec_unknown) {
+		data->next_nsec_unknown = false;
+		ret = data->handler->cb(data->handler, data->zone, node,
+		                        ZC_NSEC_LINK, NULL);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	} else if (data->next_nsec != node) {
 		ret = data->handler->cb(data->handler, data->zone, node,
 		                        ZC_ERR_NSEC_RDATA_CHAIN,
 		                        NULL);
@@ -809,8 +831,195 @@ static int do_checks_in_tree(zone_node_t *node, void *data)
 	return ret;
 }
 
+/*! \brief Semantic error recorded by a partition. */
+typedef struct {
+	const zone_node_t *node;
+	int error;
+	char *data;
+} sem_error_t;
+
+/*! \brief Error handler recording the errors of one partition. */
+typedef struct {
+	err_handler_t _cb;
+	sem_error_t *errors;
+	size_t count;
+	size_t max;
+} err_handler_buffer_t;
+
+/*! \brief Contiguous part of the zone checked by one thread. */
+typedef struct {
+	semchecks_data_t data;
+	err_handler_buffer_t buffer;
+	zone_node_t **nodes;
+	size_t count;
+	int ret;
+	pthread_t thread;
+} sem_partition_t;
+
+static int err_handler_buffer(err_handler_t *handler, const zone_contents_t *zone,
+                              const zone_node_t *node, int error, const char *data)
+{
+	UNUSED(zone);
+	err_handler_buffer_t *h = (err_handler_buffer_t *)handler;
+
+	if (h->count == h->max) {
+		size_t max = (h->max > 0) ? 2 * h->max : 16;
+		sem_error_t *errors = realloc(h->errors, max * sizeof(*errors));
+		if (errors == NULL) {
+			return KNOT_ENOMEM;
+		}
+		h->errors = errors;
+		h->max = max;
+	}
+
+	sem_error_t *err = &h->errors[h->count];
+	err->node = node;
+	err->error = error;
+	err->data = NULL;
+	if (data != NULL) {
+		err->data = strdup(data);
+		if (err->data == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+	h->count += 1;
+
+	return KNOT_EOK;
+}
+
+static void err_handler_buffer_clear(err_handler_buffer_t *h)
+{
+	for (size_t i = 0; i < h->count; i++) {
+		free(h->errors[i].data);
+	}
+	free(h->errors);
+}
+
+static int collect_node(zone_node_t *node, void *data)
+{
+	zone_node_t ***pos = data;
+	*(*pos)++ = node;
+
+	return KNOT_EOK;
+}
+
+static void *check_partition(void *arg)
+{
+	sem_partition_t *part = arg;
+
+	part->ret = KNOT_EOK;
+	for (size_t i = 0; part->ret == KNOT_EOK && i < part->count; i++) {
+		part->ret = do_checks_in_tree(part->nodes[i], &part->data);
+	}
+
+	return NULL;
+}
+
+/*!
+ * \brief Pass the recorded errors to the handler in the zone order.
+ *
+ * The result is the same as if the zone was checked by one thread.
+ */
+static int merge_partitions(sem_partition_t *parts, unsigned count,
+                            semchecks_data_t *data)
+{
+	for (unsigned i = 0; i < count; i++) {
+		sem_partition_t *part = &parts[i];
+		for (size_t j = 0; j < part->buffer.count; j++) {
+			sem_error_t *err = &part->buffer.errors[j];
+			int ret = KNOT_EOK;
+			if (err->error != ZC_NSEC_LINK) {
+				ret = data->handler->cb(data->handler, data->zone,
+				                        err->node, err->error, err->data);
+			} else if (data->next_nsec != err->node) {
+				ret = data->handler->cb(data->handler, data->zone,
+				                        err->node, ZC_ERR_NSEC_RDATA_CHAIN,
+				                        NULL);
+			}
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+
+		if (part->ret != KNOT_EOK) {
+			return part->ret;
+		}
+		if (part->data.fatal_error) {
+			data->fatal_error = true;
+		}
+		if (!part->data.next_nsec_unknown) {
+			data->next_nsec = part->data.next_nsec;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static int check_parallel(semchecks_data_t *data, unsigned threads)
+{
+	zone_contents_t *zone = data->zone;
+	size_t node_count = zone_tree_weight(zone->nodes);
+
+	zone_node_t **nodes = malloc(node_count * sizeof(*nodes));
+	sem_partition_t *parts = calloc(threads, sizeof(*parts));
+	if (nodes == NULL || parts == NULL) {
+		free(nodes);
+		free(parts);
+		return KNOT_ENOMEM;
+	}
+
+	zone_node_t **pos = nodes;
+	int ret = zone_contents_tree_apply_inorder(zone, collect_node, &pos);
+	if (ret != KNOT_EOK) {
+		free(nodes);
+		free(parts);
+		return ret;
+	}
+	assert(pos == nodes + node_count);
+
+	// Lookup indices are built lazily, which must not happen in the threads.
+	hattrie_build_index(zone->nodes);
+	if (zone->nsec3_nodes != NULL) {
+		hattrie_build_index(zone->nsec3_nodes);
+	}
+
+	unsigned started = 0;
+	for (unsigned i = 0; i < threads; i++) {
+		sem_partition_t *part = &parts[i];
+		part->buffer._cb.cb = err_handler_buffer;
+		part->data = *data;
+		part->data.handler = &part->buffer._cb;
+		part->data.next_nsec_unknown = true;
+		part->nodes = nodes + node_count * i / threads;
+		part->count = node_count * (i + 1) / threads - node_count * i / threads;
+
+		if (pthread_create(&part->thread, NULL, check_partition, part) != 0) {
+			break;
+		}
+		started++;
+	}
+
+	// Check the rest in this thread if some thread couldn't be started.
+	for (unsigned i = started; i < threads; i++) {
+		check_partition(&parts[i]);
+	}
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(parts[i].thread, NULL);
+	}
+
+	ret = merge_partitions(parts, threads, data);
+
+	for (unsigned i = 0; i < threads; i++) {
+		err_handler_buffer_clear(&parts[i].buffer);
+	}
+	free(parts);
+	free(nodes);
+
+	return ret;
+}
+
 int zone_do_sem_checks(zone_contents_t *zone, bool optional,
-                       err_handler_t *handler)
+                       err_handler_t *handler, unsigned threads)
 {
 	if (!zone || !handler) {
 		return KNOT_EINVAL;
@@ -834,8 +1043,16 @@ int zone_do_sem_checks(zone_contents_t *zone, bool optional,
 		}
 	}
 
-	int ret = zone_contents_tree_apply_inorder(zone, do_checks_in_tree,
-	                                           &data);
+	size_t node_count = zone_tree_weight(zone->nodes);
+	threads = MIN(threads, node_count / PARTITION_MIN_NODES);
+
+	int ret = KNOT_EOK;
+	if (threads > 1) {
+		ret = check_parallel(&data, threads);
+	} else {
+		ret = zone_contents_tree_apply_inorder(zone, do_checks_in_tree,
+		                                       &data);
+	}
 
 	if (ret != KNOT_EOK) {
 		return ret;
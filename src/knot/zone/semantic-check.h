@@ -109,16 +109,19 @@ struct err_handler {
 /*!
  * \brief Check zone for semantic errors.
  *
- * Errors are logged in error handler.
+ * Errors are logged in error handler. If more threads are used, each of them
+ * checks a contiguous part of the zone and the errors are passed to the
+ * handler afterwards, in the same order as if only one thread was used.
  *
  * \param zone Zone to be searched / checked
  * \param optional To do also optional check
  * \param handler Semantic error handler.
+ * \param threads Maximal number of checking threads.
  * \retval KNOT_EOK no error found
  * \retval KNOT_ESEMCHECK found semantic error
  * \retval KNOT_EINVAL or other error
  */
 int zone_do_sem_checks(zone_contents_t *zone, bool optional,
-                       err_handler_t *handler);
+                       err_handler_t *handler, unsigned threads);
 
 /*! @} */
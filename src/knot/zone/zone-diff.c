@@ -15,17 +15,18 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
 
 #include "libknot/libknot.h"
+#include "contrib/macros.h"
 #include "knot/zone/zone-diff.h"
 #include "knot/zone/serial.h"
 
-struct zone_diff_param {
-	zone_tree_t *nodes;
-	changeset_t *changeset;
-};
+/*! \brief Minimal number of nodes (in both trees) per diffing thread. */
+#define PARTITION_MIN_NODES 8192
 
 static int load_soas(const zone_contents_t *zone1, const zone_contents_t *zone2,
                      changeset_t *changeset)
@@ -103,46 +104,82 @@ static int remove_node(const zone_node_t *node, changeset_t *changeset)
 	return KNOT_EOK;
 }
 
-static bool rr_exists(const knot_rrset_t *in, const knot_rrset_t *ref,
-                      size_t ref_pos)
+/*!
+ * \brief Check if the RR sets are equal including the TTLs.
+ *
+ * Both sets are canonically sorted, so the RRs are compared at the same
+ * positions, without any allocations.
+ */
+static bool rdataset_equal(const knot_rdataset_t *rrs1,
+                           const knot_rdataset_t *rrs2)
 {
-	knot_rdata_t *to_check = knot_rdataset_at(&ref->rrs, ref_pos);
-	const bool compare_ttls = true;
-	return knot_rdataset_member(&in->rrs, to_check, compare_ttls);
+	if (!knot_rdataset_eq(rrs1, rrs2)) {
+		return false;
+	}
+
+	for (uint16_t i = 0; i < rrs1->rr_count; i++) {
+		if (knot_rdata_ttl(knot_rdataset_at(rrs1, i)) !=
+		    knot_rdata_ttl(knot_rdataset_at(rrs2, i))) {
+			return false;
+		}
+	}
+
+	return true;
 }
 
+/*!
+ * \brief Get the RRs missing in the other set, RRs with a changed TTL are
+ *        in both results.
+ *
+ * Both sets are canonically sorted, so they are merged in one pass.
+ */
 static int rdata_return_changes(const knot_rrset_t *rrset1,
                                 const knot_rrset_t *rrset2,
-                                knot_rrset_t *changes)
+                                knot_rrset_t *to_remove,
+                                knot_rrset_t *to_add)
 {
-	if (rrset1 == NULL || rrset2 == NULL) {
-		return KNOT_EINVAL;
-	}
+	knot_rrset_init(to_remove, rrset1->owner, rrset1->type, rrset1->rclass);
+	knot_rrset_init(to_add, rrset2->owner, rrset2->type, rrset2->rclass);
+
+	const knot_rdataset_t *rrs1 = &rrset1->rrs;
+	const knot_rdataset_t *rrs2 = &rrset2->rrs;
+
+	uint16_t i = 0, j = 0;
+	while (i < rrs1->rr_count || j < rrs2->rr_count) {
+		knot_rdata_t *rr1 = (i < rrs1->rr_count) ? knot_rdataset_at(rrs1, i) : NULL;
+		knot_rdata_t *rr2 = (j < rrs2->rr_count) ? knot_rdataset_at(rrs2, j) : NULL;
+
+		int cmp = 0;
+		if (rr1 == NULL) {
+			cmp = 1;
+		} else if (rr2 == NULL) {
+			cmp = -1;
+		} else {
+			cmp = knot_rdata_cmp(rr1, rr2);
+		}
 
-	/*
-	* Take one rdata from first list and search through the second list
-	* looking for an exact match. If no match occurs, it means that this
-	* particular RR has changed.
-	* After the list has been traversed, we have a list of
-	* changed/removed rdatas. This has awful computation time.
-	*/
-
-	/* Create fake RRSet, it will be easier to handle. */
-	knot_rrset_init(changes, rrset1->owner, rrset1->type, rrset1->rclass);
-
-	uint16_t rr1_count = rrset1->rrs.rr_count;
-	for (uint16_t i = 0; i < rr1_count; ++i) {
-		if (!rr_exists(rrset2, rrset1, i)) {
-			/*
-			 * No such RR is present in 'rrset2'. We'll copy
-			 * index 'i' into 'changes' RRSet.
-			 */
-			knot_rdata_t *add_rr = knot_rdataset_at(&rrset1->rrs, i);
-			int ret = knot_rdataset_add(&changes->rrs, add_rr, NULL);
-			if (ret != KNOT_EOK) {
-				knot_rdataset_clear(&changes->rrs, NULL);
-				return ret;
+		int ret = KNOT_EOK;
+		if (cmp < 0) {
+			ret = knot_rdataset_add(&to_remove->rrs, rr1, NULL);
+			i++;
+		} else if (cmp > 0) {
+			ret = knot_rdataset_add(&to_add->rrs, rr2, NULL);
+			j++;
+		} else {
+			if (knot_rdata_ttl(rr1) != knot_rdata_ttl(rr2)) {
+				ret = knot_rdataset_add(&to_remove->rrs, rr1, NULL);
+				if (ret == KNOT_EOK) {
+					ret = knot_rdataset_add(&to_add->rrs, rr2, NULL);
+				}
 			}
+			i++;
+			j++;
+		}
+
+		if (ret != KNOT_EOK) {
+			knot_rdataset_clear(&to_remove->rrs, NULL);
+			knot_rdataset_clear(&to_add->rrs, NULL);
+			return ret;
 		}
 	}
 
@@ -152,9 +189,15 @@ static int rdata_return_changes(const knot_rrset_t *rrset1,
 static int diff_rrsets(const knot_rrset_t *rrset1, const knot_rrset_t *rrset2,
                        changeset_t *changeset)
 {
-	if (changeset == NULL || (rrset1 == NULL && rrset2 == NULL)) {
+	if (changeset == NULL || rrset1 == NULL || rrset2 == NULL) {
 		return KNOT_EINVAL;
 	}
+
+	/* Most of the RR sets don't change. */
+	if (rdataset_equal(&rrset1->rrs, &rrset2->rrs)) {
+		return KNOT_EOK;
+	}
+
 	/*
 	 * The easiest solution is to remove all the RRs that had no match and
 	 * to add all RRs that had no match, but those from second RRSet. */
@@ -162,20 +205,13 @@ static int diff_rrsets(const knot_rrset_t *rrset1, const knot_rrset_t *rrset2,
 	/* Get RRs to add to zone and to remove from zone. */
 	knot_rrset_t to_remove;
 	knot_rrset_t to_add;
-	if (rrset1 != NULL && rrset2 != NULL) {
-		int ret = rdata_return_changes(rrset1, rrset2, &to_remove);
-		if (ret != KNOT_EOK) {
-			return ret;
-		}
-
-		ret = rdata_return_changes(rrset2, rrset1, &to_add);
-		if (ret != KNOT_EOK) {
-			return ret;
-		}
+	int ret = rdata_return_changes(rrset1, rrset2, &to_remove, &to_add);
+	if (ret != KNOT_EOK) {
+		return ret;
 	}
 
 	if (!knot_rrset_empty(&to_remove)) {
-		int ret = changeset_add_removal(changeset, &to_remove, 0);
+		ret = changeset_add_removal(changeset, &to_remove, 0);
 		knot_rdataset_clear(&to_remove.rrs, NULL);
 		if (ret != KNOT_EOK) {
 			knot_rdataset_clear(&to_add.rrs, NULL);
@@ -184,7 +220,7 @@ static int diff_rrsets(const knot_rrset_t *rrset1, const knot_rrset_t *rrset2,
 	}
 
 	if (!knot_rrset_empty(&to_add)) {
-		int ret = changeset_add_addition(changeset, &to_add, 0);
+		ret = changeset_add_addition(changeset, &to_add, 0);
 		knot_rdataset_clear(&to_add.rrs, NULL);
 		return ret;
 	}
@@ -192,87 +228,54 @@ static int diff_rrsets(const knot_rrset_t *rrset1, const knot_rrset_t *rrset2,
 	return KNOT_EOK;
 }
 
-/*!< \todo this could be generic function for adding / removing. */
-static int knot_zone_diff_node(zone_node_t **node_ptr, void *data)
+/*! \brief Diff the nodes with the same owner from both trees. */
+static int diff_nodes(const zone_node_t *node1, const zone_node_t *node2,
+                      changeset_t *changeset)
 {
-	if (node_ptr == NULL || *node_ptr == NULL || data == NULL) {
-		return KNOT_EINVAL;
-	}
-
-	zone_node_t *node = *node_ptr;
-
-	struct zone_diff_param *param = (struct zone_diff_param *)data;
-	if (param->changeset == NULL) {
-		return KNOT_EINVAL;
-	}
-
-	/*
-	 * First, we have to search the second tree to see if there's according
-	 * node, if not, the whole node has been removed.
-	 */
-	zone_node_t *node_in_second_tree = NULL;
-	const knot_dname_t *node_owner = node->owner;
-	assert(node_owner);
-
-	zone_tree_get(param->nodes, node_owner, &node_in_second_tree);
-
-	if (node_in_second_tree == NULL) {
-		return remove_node(node, param->changeset);
-	}
-
-	assert(node_in_second_tree != node);
-
-	/* The nodes are in both trees, we have to diff each RRSet. */
-	if (node->rrset_count == 0) {
-		/*
-		 * If there are no RRs in the first tree, all of the RRs
-		 * in the second tree will have to be inserted to ADD section.
-		 */
-		return add_node(node_in_second_tree, param->changeset);
-	}
-
-	for (unsigned i = 0; i < node->rrset_count; i++) {
-		/* Search for the RRSet in the node from the second tree. */
-		knot_rrset_t rrset = node_rrset_at(node, i);
+	for (unsigned i = 0; i < node1->rrset_count; i++) {
+		knot_rrset_t rrset = node_rrset_at(node1, i);
 
 		/* SOAs are handled explicitly. */
 		if (rrset.type == KNOT_RRTYPE_SOA) {
 			continue;
 		}
 
-		knot_rrset_t rrset_from_second_node =
-			node_rrset(node_in_second_tree, rrset.type);
-		if (knot_rrset_empty(&rrset_from_second_node)) {
-			/* RRSet has been removed. Make a copy and remove. */
-			int ret = changeset_add_removal(
-				param->changeset, &rrset, 0);
-			if (ret != KNOT_EOK) {
-				return ret;
-			}
+		/* Search for the RRSet in the node from the second tree. */
+		knot_rrset_t rrset2 = node_rrset(node2, rrset.type);
+		int ret = KNOT_EOK;
+		if (knot_rrset_empty(&rrset2)) {
+			/* RRSet has been removed. */
+			ret = changeset_add_removal(changeset, &rrset, 0);
 		} else {
-			/* Diff RRSets. */
-			int ret = diff_rrsets(&rrset, &rrset_from_second_node,
-			                      param->changeset);
-			if (ret != KNOT_EOK) {
-				return ret;
-			}
+			ret = diff_rrsets(&rrset, &rrset2, changeset);
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
 		}
 	}
 
-	for (unsigned i = 0; i < node_in_second_tree->rrset_count; i++) {
-		/* Search for the RRSet in the node from the second tree. */
-		knot_rrset_t rrset = node_rrset_at(node_in_second_tree, i);
+	/* Same types in the same order, everything compared above. */
+	if (node1->rrset_count == node2->rrset_count) {
+		bool same_types = true;
+		for (unsigned i = 0; same_types && i < node1->rrset_count; i++) {
+			same_types = node1->rrs[i].type == node2->rrs[i].type;
+		}
+		if (same_types) {
+			return KNOT_EOK;
+		}
+	}
+
+	for (unsigned i = 0; i < node2->rrset_count; i++) {
+		knot_rrset_t rrset = node_rrset_at(node2, i);
 
 		/* SOAs are handled explicitly. */
 		if (rrset.type == KNOT_RRTYPE_SOA) {
 			continue;
 		}
 
-		knot_rrset_t rrset_from_first_node = node_rrset(node, rrset.type);
-		if (knot_rrset_empty(&rrset_from_first_node)) {
-			/* RRSet has been added. Make a copy and add. */
-			int ret = changeset_add_addition(
-				param->changeset, &rrset, 0);
+		if (!node_rrtype_exists(node1, rrset.type)) {
+			/* RRSet has been added. */
+			int ret = changeset_add_addition(changeset, &rrset, 0);
 			if (ret != KNOT_EOK) {
 				return ret;
 			}
@@ -282,71 +285,293 @@ static int knot_zone_diff_node(zone_node_t **node_ptr, void *data)
 	return KNOT_EOK;
 }
 
-/*!< \todo possibly not needed! */
-static int add_new_nodes(zone_node_t **node_ptr, void *data)
+/*! \brief Diff the node with its counterpart, one of them may be missing. */
+static int diff_node_pair(const zone_node_t *node1, const zone_node_t *node2,
+                          changeset_t *changeset)
 {
-	if (node_ptr == NULL || *node_ptr == NULL || data == NULL) {
-		return KNOT_EINVAL;
+	if (node2 == NULL) {
+		return remove_node(node1, changeset);
+	} else if (node1 == NULL) {
+		return add_node(node2, changeset);
+	} else {
+		return diff_nodes(node1, node2, changeset);
 	}
+}
 
-	zone_node_t *node = *node_ptr;
-
-	struct zone_diff_param *param = (struct zone_diff_param *)data;
-	if (param->changeset == NULL) {
-		return KNOT_EINVAL;
+/*! \brief Compare the tree keys, the same order as in the sorted iteration. */
+static int key_cmp(const char *key1, size_t len1, const char *key2, size_t len2)
+{
+	int ret = memcmp(key1, key2, MIN(len1, len2));
+	if (ret == 0 && len1 != len2) {
+		ret = (len1 < len2) ? -1 : 1;
 	}
 
-	/*
-	* If a node is not present in the second zone, it is a new node
-	* and has to be added to changeset. Differencies on the RRSet level are
-	* already handled.
-	*/
+	return ret;
+}
 
-	const knot_dname_t *node_owner = node->owner;
-	/*
-	 * Node should definitely have an owner, otherwise it would not be in
-	 * the tree.
-	 */
-	assert(node_owner);
+/*!
+ * \brief Walk both trees in the canonical order at once.
+ *
+ * Nodes with the same owner are met at the same time, so no lookups are
+ * needed, and the nodes missing in one of the trees are found on the way.
+ */
+static int load_trees(zone_tree_t *nodes1, zone_tree_t *nodes2,
+                      changeset_t *changeset)
+{
+	assert(changeset);
 
-	zone_node_t *new_node = NULL;
-	zone_tree_get(param->nodes, node_owner, &new_node);
+	hattrie_iter_t *it1 = zone_tree_is_empty(nodes1) ? NULL :
+	                      hattrie_iter_begin(nodes1, true);
+	hattrie_iter_t *it2 = zone_tree_is_empty(nodes2) ? NULL :
+	                      hattrie_iter_begin(nodes2, true);
 
 	int ret = KNOT_EOK;
+	while (ret == KNOT_EOK) {
+		bool end1 = (it1 == NULL || hattrie_iter_finished(it1));
+		bool end2 = (it2 == NULL || hattrie_iter_finished(it2));
+		if (end1 && end2) {
+			break;
+		}
+
+		int cmp = 0;
+		if (end1) {
+			cmp = 1;
+		} else if (end2) {
+			cmp = -1;
+		} else {
+			size_t len1 = 0, len2 = 0;
+			const char *key1 = hattrie_iter_key(it1, &len1);
+			const char *key2 = hattrie_iter_key(it2, &len2);
+			cmp = key_cmp(key1, len1, key2, len2);
+		}
 
-	if (!new_node) {
-		assert(node);
-		ret = add_node(node, param->changeset);
+		zone_node_t *node1 = (cmp <= 0) ? *hattrie_iter_val(it1) : NULL;
+		zone_node_t *node2 = (cmp >= 0) ? *hattrie_iter_val(it2) : NULL;
+		ret = diff_node_pair(node1, node2, changeset);
+
+		if (cmp <= 0) {
+			hattrie_iter_next(it1);
+		}
+		if (cmp >= 0) {
+			hattrie_iter_next(it2);
+		}
 	}
 
+	hattrie_iter_free(it1);
+	hattrie_iter_free(it2);
+
 	return ret;
 }
 
-static int load_trees(zone_tree_t *nodes1, zone_tree_t *nodes2,
-                      changeset_t *changeset)
+/*! \brief Contiguous part of the trees diffed by one thread. */
+typedef struct {
+	changeset_t changeset;
+	zone_node_t **nodes1;
+	zone_node_t **nodes2;
+	size_t count1;
+	size_t count2;
+	int ret;
+	pthread_t thread;
+} diff_partition_t;
+
+static int collect_node(zone_node_t **node, void *data)
 {
-	assert(changeset);
+	zone_node_t ***pos = data;
+	*(*pos)++ = *node;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Get the nodes of the tree in the canonical order. */
+static zone_node_t **collect_nodes(zone_tree_t *tree, size_t count)
+{
+	zone_node_t **nodes = malloc(MAX(count, 1) * sizeof(*nodes));
+	if (nodes == NULL) {
+		return NULL;
+	}
+
+	zone_node_t **pos = nodes;
+	if (zone_tree_apply_inorder(tree, collect_node, &pos) != KNOT_EOK) {
+		free(nodes);
+		return NULL;
+	}
+	assert(pos == nodes + count);
+
+	return nodes;
+}
+
+/*! \brief Find the first node not below the owner in the canonical order. */
+static size_t lower_bound(zone_node_t **nodes, size_t count,
+                          const knot_dname_t *owner)
+{
+	size_t lo = 0, hi = count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (knot_dname_cmp(nodes[mid]->owner, owner) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/*! \brief Walk the node arrays of the partition at once, like load_trees(). */
+static void *diff_partition(void *arg)
+{
+	diff_partition_t *part = arg;
+
+	size_t i = 0, j = 0;
+	part->ret = KNOT_EOK;
+	while (part->ret == KNOT_EOK && (i < part->count1 || j < part->count2)) {
+		int cmp = 0;
+		if (i == part->count1) {
+			cmp = 1;
+		} else if (j == part->count2) {
+			cmp = -1;
+		} else {
+			cmp = knot_dname_cmp(part->nodes1[i]->owner,
+			                     part->nodes2[j]->owner);
+		}
+
+		const zone_node_t *node1 = (cmp <= 0) ? part->nodes1[i++] : NULL;
+		const zone_node_t *node2 = (cmp >= 0) ? part->nodes2[j++] : NULL;
+		part->ret = diff_node_pair(node1, node2, &part->changeset);
+	}
+
+	return NULL;
+}
+
+/*! \brief Add the changes of the partition into the resulting changeset. */
+static int merge_partition(changeset_t *changeset, const changeset_t *part)
+{
+	changeset_iter_t itt;
+	int ret = changeset_iter_rem(&itt, part, false);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
 
-	struct zone_diff_param param = {
-		.changeset = changeset
-	};
+	knot_rrset_t rrset = changeset_iter_next(&itt);
+	while (ret == KNOT_EOK && !knot_rrset_empty(&rrset)) {
+		ret = changeset_add_removal(changeset, &rrset, 0);
+		rrset = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
 
-	// Traverse one tree, compare every node, each RRSet with its rdata.
-	param.nodes = nodes2;
-	int ret = zone_tree_apply(nodes1, knot_zone_diff_node, &param);
+	ret = changeset_iter_add(&itt, part, false);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
 
-	// Some nodes may have been added. Add missing nodes to changeset.
-	param.nodes = nodes1;
-	ret = zone_tree_apply(nodes2, add_new_nodes, &param);
+	rrset = changeset_iter_next(&itt);
+	while (ret == KNOT_EOK && !knot_rrset_empty(&rrset)) {
+		ret = changeset_add_addition(changeset, &rrset, 0);
+		rrset = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
 
 	return ret;
 }
 
+/*!
+ * \brief Diff the trees in parallel.
+ *
+ * The first tree is split into parts with the same number of nodes, the
+ * second one at the same owners. Each part is diffed into its own changeset
+ * by one thread, the changesets are merged afterwards.
+ */
+static int load_trees_parallel(zone_tree_t *nodes1, zone_tree_t *nodes2,
+                               changeset_t *changeset, unsigned threads)
+{
+	size_t count1 = zone_tree_weight(nodes1);
+	size_t count2 = zone_tree_weight(nodes2);
+
+	zone_node_t **array1 = collect_nodes(nodes1, count1);
+	zone_node_t **array2 = collect_nodes(nodes2, count2);
+	diff_partition_t *parts = calloc(threads, sizeof(*parts));
+	if (array1 == NULL || array2 == NULL || parts == NULL) {
+		free(array1);
+		free(array2);
+		free(parts);
+		return KNOT_ENOMEM;
+	}
+
+	const knot_dname_t *apex = changeset->add->apex->owner;
+
+	int ret = KNOT_EOK;
+	unsigned ready = 0;
+	size_t begin2 = 0;
+	for (; ready < threads; ready++) {
+		diff_partition_t *part = &parts[ready];
+		size_t begin1 = count1 * ready / threads;
+		size_t end1 = count1 * (ready + 1) / threads;
+		size_t end2 = (end1 < count1) ?
+		              lower_bound(array2, count2, array1[end1]->owner) : count2;
+
+		part->nodes1 = array1 + begin1;
+		part->count1 = end1 - begin1;
+		part->nodes2 = array2 + begin2;
+		part->count2 = end2 - begin2;
+		begin2 = end2;
+
+		ret = changeset_init(&part->changeset, apex);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+	}
+
+	unsigned started = 0;
+	for (; ret == KNOT_EOK && started < threads; started++) {
+		if (pthread_create(&parts[started].thread, NULL, diff_partition,
+		                   &parts[started]) != 0) {
+			break;
+		}
+	}
+
+	// Diff the rest in this thread if some thread couldn't be started.
+	for (unsigned i = started; ret == KNOT_EOK && i < threads; i++) {
+		diff_partition(&parts[i]);
+	}
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(parts[i].thread, NULL);
+	}
+
+	for (unsigned i = 0; ret == KNOT_EOK && i < threads; i++) {
+		ret = parts[i].ret;
+		if (ret == KNOT_EOK) {
+			ret = merge_partition(changeset, &parts[i].changeset);
+		}
+	}
+
+	for (unsigned i = 0; i < ready; i++) {
+		changeset_clear(&parts[i].changeset);
+	}
+	free(parts);
+	free(array1);
+	free(array2);
+
+	return ret;
+}
+
+static int diff_trees(zone_tree_t *nodes1, zone_tree_t *nodes2,
+                      changeset_t *changeset, unsigned threads)
+{
+	size_t count = zone_tree_weight(nodes1) + zone_tree_weight(nodes2);
+	threads = MIN(threads, count / PARTITION_MIN_NODES);
+
+	if (threads > 1) {
+		return load_trees_parallel(nodes1, nodes2, changeset, threads);
+	} else {
+		return load_trees(nodes1, nodes2, changeset);
+	}
+}
+
 int zone_contents_diff(const zone_contents_t *zone1, const zone_contents_t *zone2,
-                       changeset_t *changeset)
+                       changeset_t *changeset, unsigned threads)
 {
 	if (zone1 == NULL || zone2 == NULL || changeset == NULL) {
 		return KNOT_EINVAL;
@@ -357,12 +582,13 @@ int zone_contents_diff(const zone_contents_t *zone1, const zone_contents_t *zone
 		return ret;
 	}
 
-	ret = load_trees(zone1->nodes, zone2->nodes, changeset);
+	ret = diff_trees(zone1->nodes, zone2->nodes, changeset, threads);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
 
-	return load_trees(zone1->nsec3_nodes, zone2->nsec3_nodes, changeset);
+	return diff_trees(zone1->nsec3_nodes, zone2->nsec3_nodes, changeset,
+	                  threads);
 }
 
 int zone_tree_add_diff(zone_tree_t *t1, zone_tree_t *t2, changeset_t *changeset)
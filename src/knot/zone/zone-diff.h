@@ -21,9 +21,22 @@
 
 /*!
  * \brief Create diff between two zone trees.
- * */
+ *
+ * The trees are walked in the canonical order at once and the RR sets with
+ * the same owner and type are compared in place, so unchanged nodes cost no
+ * lookups nor allocations. Large trees may be split among several threads.
+ *
+ * \param zone1      Old zone contents.
+ * \param zone2      New zone contents.
+ * \param changeset  Changeset to store the differences into.
+ * \param threads    Maximal number of diffing threads.
+ *
+ * \retval KNOT_ENODIFF if the SOA serials are equal.
+ * \retval KNOT_ERANGE if the SOA serial decreased.
+ * \return KNOT_E*
+ */
 int zone_contents_diff(const zone_contents_t *zone1, const zone_contents_t *zone2,
-                       changeset_t *changeset);
+                       changeset_t *changeset, unsigned threads);
 
 /*!
  * \brief Add diff between two zone trees into the changeset.
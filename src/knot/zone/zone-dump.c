@@ -14,41 +14,195 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <assert.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <string.h>
 
 #include "knot/dnssec/zone-nsec.h"
 #include "knot/zone/zone-dump.h"
 #include "libknot/libknot.h"
+#include "contrib/macros.h"
 
-/*! \brief Size of auxiliary buffer. */
-#define DUMP_BUF_LEN (70 * 1024)
+/*! \brief Size of the output buffer, also the maximal text length of one RR. */
+#define DUMP_BUF_LEN (1024 * 1024)
+
+/*! \brief Maximal length of the RR header text (owner, TTL, class, type). */
+#define DUMP_HEADER_LEN (4 * KNOT_DNAME_MAXLEN + 64)
+
+/*! \brief Number of nodes formatted by a thread at once. */
+#define DUMP_CHUNK_NODES 1024
+
+/*! \brief Text output buffer. */
+typedef struct {
+	char   *data;
+	size_t len;
+	size_t size;
+	FILE   *file; /*!< Flushed into if full, the buffer grows if NULL. */
+} dump_buf_t;
+
+/*! \brief Part of the zone dump, all the passes are written in order. */
+typedef struct {
+	const char *comment;
+	bool       nsec3_tree;
+	bool       dump_rrsig;
+	bool       dump_nsec;
+} dump_pass_t;
 
 /*! \brief Dump parameters. */
 typedef struct {
-	FILE     *file;
-	char     *buf;
-	size_t   buflen;
-	uint64_t rr_count;
-	bool     dump_rrsig;
-	bool     dump_nsec;
+	dump_buf_t buf;
+	uint64_t   rr_count;
+	const dump_pass_t *pass;
 	const knot_dname_t *origin;
 	const knot_dump_style_t *style;
 } dump_params_t;
 
-static int apex_node_dump_text(zone_node_t *node, dump_params_t *params)
+/*! \brief Formatted chunk of nodes waiting to be written. */
+typedef struct {
+	dump_buf_t buf;
+	uint64_t   rr_count;
+	bool       done;
+	int        ret;
+} dump_slot_t;
+
+/*! \brief Shared state of the formatting threads. */
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;
+	zone_node_t     **nodes;
+	size_t          count;
+	size_t          chunks;
+	size_t          next;    /*!< Next chunk to be formatted. */
+	size_t          written; /*!< Number of chunks already written. */
+	dump_slot_t     *slots;  /*!< Chunk N is formatted into slot N % slot_count. */
+	size_t          slot_count;
+	int             ret;     /*!< First error, stops the threads. */
+	const dump_params_t *params;
+} dump_workers_t;
+
+static int buf_init(dump_buf_t *buf, FILE *file)
 {
-	knot_rrset_t soa = node_rrset(node, KNOT_RRTYPE_SOA);
-	knot_dump_style_t soa_style = *params->style;
+	buf->data = malloc(DUMP_BUF_LEN);
+	if (buf->data == NULL) {
+		return KNOT_ENOMEM;
+	}
+	buf->len = 0;
+	buf->size = DUMP_BUF_LEN;
+	buf->file = file;
 
-	// Dump SOA record as a first.
-	if (!params->dump_nsec) {
-		if (knot_rrset_txt_dump(&soa, params->buf, params->buflen,
-		                        &soa_style) < 0) {
-			return KNOT_ENOMEM;
+	return KNOT_EOK;
+}
+
+static int buf_flush(dump_buf_t *buf)
+{
+	if (buf->len > 0 && fwrite(buf->data, 1, buf->len, buf->file) != buf->len) {
+		return knot_map_errno();
+	}
+	buf->len = 0;
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Make room for a text which didn't fit into the free space.
+ *
+ * The buffer is flushed into the file if set, or enlarged otherwise.
+ */
+static int buf_make_room(dump_buf_t *buf)
+{
+	if (buf->size - buf->len >= DUMP_BUF_LEN) {
+		return KNOT_ESPACE;
+	}
+
+	if (buf->file != NULL) {
+		return buf_flush(buf);
+	}
+
+	char *data = realloc(buf->data, 2 * buf->size);
+	if (data == NULL) {
+		return KNOT_ENOMEM;
+	}
+	buf->data = data;
+	buf->size *= 2;
+
+	return KNOT_EOK;
+}
+
+static int dump_str(dump_buf_t *buf, const char *str)
+{
+	size_t len = strlen(str);
+	while (buf->size - buf->len < len) {
+		int ret = buf_make_room(buf);
+		if (ret != KNOT_EOK) {
+			return ret;
 		}
-		params->rr_count += soa.rrs.rr_count;
-		fprintf(params->file, "%s", params->buf);
-		params->buf[0] = '\0';
+	}
+
+	memcpy(buf->data + buf->len, str, len);
+	buf->len += len;
+
+	return KNOT_EOK;
+}
+
+static int dump_rrset(dump_params_t *params, const knot_rrset_t *rrset)
+{
+	dump_buf_t *buf = &params->buf;
+
+	char header[DUMP_HEADER_LEN];
+	int header_len = 0;
+	uint32_t header_ttl = 0;
+
+	for (uint16_t i = 0; i < rrset->rrs.rr_count; i++) {
+		// The header is formatted again only if the TTL differs.
+		uint32_t ttl = knot_rdata_ttl(knot_rdataset_at(&rrset->rrs, i));
+		if (i == 0 || ttl != header_ttl) {
+			header_len = knot_rrset_txt_dump_header(rrset, ttl, header,
+			                                        sizeof(header),
+			                                        params->style);
+			if (header_len < 0) {
+				return KNOT_ESPACE;
+			}
+			header_ttl = ttl;
+		}
+
+		// Dump the RR directly into the buffer, retry if it didn't fit.
+		while (true) {
+			char *dst = buf->data + buf->len;
+			size_t avail = buf->size - buf->len;
+			if (avail > (size_t)header_len) {
+				memcpy(dst, header, header_len);
+				int ret = knot_rrset_txt_dump_data(rrset, i,
+				                                   dst + header_len,
+				                                   avail - header_len,
+				                                   params->style);
+				// Keep room for the terminating zero as before.
+				if (ret >= 0 && (size_t)(header_len + ret + 1) < avail) {
+					dst[header_len + ret] = '\n';
+					buf->len += header_len + ret + 1;
+					break;
+				}
+			}
+
+			int ret = buf_make_room(buf);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+	}
+
+	params->rr_count += rrset->rrs.rr_count;
+
+	return KNOT_EOK;
+}
+
+static int apex_node_dump_text(zone_node_t *node, dump_params_t *params)
+{
+	// Dump SOA record as a first.
+	knot_rrset_t soa = node_rrset(node, KNOT_RRTYPE_SOA);
+	int ret = dump_rrset(params, &soa);
+	if (ret != KNOT_EOK) {
+		return ret;
 	}
 
 	// Dump other records.
@@ -65,13 +219,10 @@ static int apex_node_dump_text(zone_node_t *node, dump_params_t *params)
 			break;
 		}
 
-		if (knot_rrset_txt_dump(&rrset, params->buf, params->buflen,
-		                        params->style) < 0) {
-			return KNOT_ENOMEM;
+		ret = dump_rrset(params, &rrset);
+		if (ret != KNOT_EOK) {
+			return ret;
 		}
-		params->rr_count +=  rrset.rrs.rr_count;
-		fprintf(params->file, "%s", params->buf);
-		params->buf[0] = '\0';
 	}
 
 	return KNOT_EOK;
@@ -80,12 +231,12 @@ static int apex_node_dump_text(zone_node_t *node, dump_params_t *params)
 static int node_dump_text(zone_node_t *node, void *data)
 {
 	dump_params_t *params = (dump_params_t *)data;
+	const dump_pass_t *pass = params->pass;
 
 	// Zone apex rrsets.
-	if (node->owner == params->origin && !params->dump_rrsig &&
-	    !params->dump_nsec) {
-		apex_node_dump_text(node, params);
-		return KNOT_EOK;
+	if (node->owner == params->origin && !pass->dump_rrsig &&
+	    !pass->dump_nsec) {
+		return apex_node_dump_text(node, params);
 	}
 
 	// Dump non-apex rrsets.
@@ -93,134 +244,318 @@ static int node_dump_text(zone_node_t *node, void *data)
 		knot_rrset_t rrset = node_rrset_at(node, i);
 		switch (rrset.type) {
 		case KNOT_RRTYPE_RRSIG:
-			if (params->dump_rrsig) {
+			if (pass->dump_rrsig) {
 				break;
 			}
 			continue;
 		case KNOT_RRTYPE_NSEC:
-			if (params->dump_nsec) {
+			if (pass->dump_nsec) {
 				break;
 			}
 			continue;
 		case KNOT_RRTYPE_NSEC3:
-			if (params->dump_nsec) {
+			if (pass->dump_nsec) {
 				break;
 			}
 			continue;
 		default:
-			if (params->dump_nsec || params->dump_rrsig) {
+			if (pass->dump_nsec || pass->dump_rrsig) {
 				continue;
 			}
 			break;
 		}
 
-		if (knot_rrset_txt_dump(&rrset, params->buf, params->buflen,
-		                        params->style) < 0) {
-			return KNOT_ENOMEM;
+		int ret = dump_rrset(params, &rrset);
+		if (ret != KNOT_EOK) {
+			return ret;
 		}
-		params->rr_count += rrset.rrs.rr_count;
-		fprintf(params->file, "%s", params->buf);
-		params->buf[0] = '\0';
 	}
 
 	return KNOT_EOK;
 }
 
-int zone_dump_text(zone_contents_t *zone, FILE *file)
+static void *dump_worker(void *arg)
 {
-	if (zone == NULL || file == NULL) {
-		return KNOT_EINVAL;
+	dump_workers_t *w = arg;
+
+	pthread_mutex_lock(&w->lock);
+	while (true) {
+		// Don't get ahead of the writer by more than the number of slots.
+		while (w->ret == KNOT_EOK && w->next < w->chunks &&
+		       w->next >= w->written + w->slot_count) {
+			pthread_cond_wait(&w->cond, &w->lock);
+		}
+		if (w->ret != KNOT_EOK || w->next >= w->chunks) {
+			break;
+		}
+
+		size_t chunk = w->next++;
+		dump_slot_t *slot = &w->slots[chunk % w->slot_count];
+		pthread_mutex_unlock(&w->lock);
+
+		dump_params_t params = *w->params;
+		params.buf = slot->buf;
+		params.buf.len = 0;
+		params.rr_count = 0;
+
+		size_t end = MIN((chunk + 1) * DUMP_CHUNK_NODES, w->count);
+		int ret = KNOT_EOK;
+		for (size_t i = chunk * DUMP_CHUNK_NODES; ret == KNOT_EOK && i < end; i++) {
+			ret = node_dump_text(w->nodes[i], &params);
+		}
+
+		pthread_mutex_lock(&w->lock);
+		slot->buf = params.buf;
+		slot->rr_count = params.rr_count;
+		slot->ret = ret;
+		slot->done = true;
+		if (ret != KNOT_EOK && w->ret == KNOT_EOK) {
+			w->ret = ret;
+		}
+		pthread_cond_broadcast(&w->cond);
+	}
+	pthread_mutex_unlock(&w->lock);
+
+	return NULL;
+}
+
+/*! \brief Write the formatted chunks into the file in the zone order. */
+static int write_chunks(dump_workers_t *w, dump_params_t *params)
+{
+	int ret = buf_flush(&params->buf);
+
+	for (size_t chunk = 0; ret == KNOT_EOK && chunk < w->chunks; chunk++) {
+		dump_slot_t *slot = &w->slots[chunk % w->slot_count];
+
+		pthread_mutex_lock(&w->lock);
+		while (!slot->done && w->ret == KNOT_EOK) {
+			pthread_cond_wait(&w->cond, &w->lock);
+		}
+		ret = slot->done ? slot->ret : w->ret;
+		pthread_mutex_unlock(&w->lock);
+
+		if (ret != KNOT_EOK) {
+			break;
+		}
+		if (slot->buf.len > 0 &&
+		    fwrite(slot->buf.data, 1, slot->buf.len, params->buf.file) != slot->buf.len) {
+			ret = knot_map_errno();
+		}
+		params->rr_count += slot->rr_count;
+
+		pthread_mutex_lock(&w->lock);
+		slot->done = false;
+		w->written++;
+		pthread_cond_broadcast(&w->cond);
+		pthread_mutex_unlock(&w->lock);
 	}
 
-	// Allocate auxiliary buffer for dumping operations.
-	char *buf = malloc(DUMP_BUF_LEN);
-	if (buf == NULL) {
+	if (ret != KNOT_EOK) {
+		pthread_mutex_lock(&w->lock);
+		if (w->ret == KNOT_EOK) {
+			w->ret = ret;
+		}
+		pthread_cond_broadcast(&w->cond);
+		pthread_mutex_unlock(&w->lock);
+	}
+
+	return ret;
+}
+
+/*!
+ * \brief Format the nodes in parallel and write them in the zone order.
+ *
+ * The nodes are split into chunks, which are claimed by the threads. At most
+ * two chunks per thread are formatted ahead of the writer.
+ */
+static int dump_parallel(zone_node_t **nodes, size_t count, unsigned threads,
+                         dump_params_t *params)
+{
+	dump_workers_t w = {
+		.nodes = nodes,
+		.count = count,
+		.chunks = (count + DUMP_CHUNK_NODES - 1) / DUMP_CHUNK_NODES,
+		.slot_count = 2 * threads,
+		.params = params
+	};
+
+	w.slots = calloc(w.slot_count, sizeof(*w.slots));
+	pthread_t *workers = calloc(threads, sizeof(*workers));
+	if (w.slots == NULL || workers == NULL) {
+		free(w.slots);
+		free(workers);
 		return KNOT_ENOMEM;
 	}
 
-	fprintf(file, ";; Zone dump (Knot DNS %s)\n", PACKAGE_VERSION);
+	int ret = KNOT_EOK;
+	for (size_t i = 0; ret == KNOT_EOK && i < w.slot_count; i++) {
+		ret = buf_init(&w.slots[i].buf, NULL);
+	}
 
-	// Set structure with parameters.
-	zone_node_t *apex = zone->apex;
-	dump_params_t params;
-	params.file = file;
-	params.buf = buf;
-	params.buflen = DUMP_BUF_LEN;
-	params.rr_count = 0;
-	params.origin = apex->owner;
-	params.style = &KNOT_DUMP_STYLE_DEFAULT;
-
-	int ret;
-
-	// Dump standard zone records without rrsigs.
-	params.dump_rrsig = false;
-	params.dump_nsec = false;
-	ret = zone_contents_tree_apply_inorder(zone, node_dump_text, &params);
+	pthread_mutex_init(&w.lock, NULL);
+	pthread_cond_init(&w.cond, NULL);
+
+	unsigned started = 0;
+	for (unsigned i = 0; ret == KNOT_EOK && i < threads; i++) {
+		if (pthread_create(&workers[i], NULL, dump_worker, &w) != 0) {
+			break;
+		}
+		started++;
+	}
+
+	if (ret == KNOT_EOK && started == 0) {
+		ret = KNOT_ENOMEM;
+	}
+	if (ret == KNOT_EOK) {
+		ret = write_chunks(&w, params);
+	}
+
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(workers[i], NULL);
+	}
+
+	pthread_cond_destroy(&w.cond);
+	pthread_mutex_destroy(&w.lock);
+	for (size_t i = 0; i < w.slot_count; i++) {
+		free(w.slots[i].buf.data);
+	}
+	free(w.slots);
+	free(workers);
+
+	return ret;
+}
+
+static int collect_node(zone_node_t *node, void *data)
+{
+	zone_node_t ***pos = data;
+	*(*pos)++ = node;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Get the nodes of the tree in the zone order. */
+static zone_node_t **collect_nodes(zone_contents_t *zone, bool nsec3_tree,
+                                   size_t count)
+{
+	zone_node_t **nodes = malloc(count * sizeof(*nodes));
+	if (nodes == NULL) {
+		return NULL;
+	}
+
+	zone_node_t **pos = nodes;
+	int ret = nsec3_tree ?
+	          zone_contents_nsec3_apply_inorder(zone, collect_node, &pos) :
+	          zone_contents_tree_apply_inorder(zone, collect_node, &pos);
 	if (ret != KNOT_EOK) {
-		return ret;
+		free(nodes);
+		return NULL;
 	}
+	assert(pos == nodes + count);
 
-	// Dump DNSSEC signatures if secured.
-	if (zone_contents_is_signed(zone)) {
-		fprintf(file, ";; DNSSEC signatures\n");
+	return nodes;
+}
 
-		// Dump rrsig records.
-		params.dump_rrsig = true;
-		params.dump_nsec = false;
-		ret = zone_contents_tree_apply_inorder(zone, node_dump_text,
-		                                       &params);
+static int dump_pass(zone_contents_t *zone, dump_params_t *params,
+                     const dump_pass_t *pass, unsigned threads)
+{
+	params->pass = pass;
+
+	if (pass->comment != NULL) {
+		int ret = dump_str(&params->buf, pass->comment);
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
 	}
 
-	// Dump NSEC3 chain if available.
-	if (knot_is_nsec3_enabled(zone)) {
-		fprintf(file, ";; DNSSEC NSEC3 chain\n");
-
-		params.dump_rrsig = false;
-		params.dump_nsec = true;
-		ret = zone_contents_nsec3_apply_inorder(zone, node_dump_text,
-		                                        &params);
-		if (ret != KNOT_EOK) {
-			return ret;
+	zone_tree_t *tree = pass->nsec3_tree ? zone->nsec3_nodes : zone->nodes;
+	size_t weight = (tree != NULL) ? zone_tree_weight(tree) : 0;
+	threads = MIN(threads, weight / (2 * DUMP_CHUNK_NODES));
+
+	if (threads <= 1) {
+		if (pass->nsec3_tree) {
+			return zone_contents_nsec3_apply_inorder(zone, node_dump_text,
+			                                         params);
+		} else {
+			return zone_contents_tree_apply_inorder(zone, node_dump_text,
+			                                        params);
 		}
+	}
 
-		fprintf(file, ";; DNSSEC NSEC3 signatures\n");
+	zone_node_t **nodes = collect_nodes(zone, pass->nsec3_tree, weight);
+	if (nodes == NULL) {
+		return KNOT_ENOMEM;
+	}
 
-		params.dump_rrsig = true;
-		params.dump_nsec = false;
-		ret = zone_contents_nsec3_apply_inorder(zone, node_dump_text,
-		                                        &params);
-		if (ret != KNOT_EOK) {
-			return ret;
-		}
+	int ret = dump_parallel(nodes, weight, threads, params);
+	free(nodes);
+
+	return ret;
+}
+
+int zone_dump_text(zone_contents_t *zone, FILE *file, unsigned threads)
+{
+	if (zone == NULL || file == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	// Set structure with parameters.
+	dump_params_t params = {
+		.origin = zone->apex->owner,
+		.style = &KNOT_DUMP_STYLE_DEFAULT
+	};
+
+	// Allocate output buffer flushed into the file.
+	int ret = buf_init(&params.buf, file);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	char line[128];
+	snprintf(line, sizeof(line), ";; Zone dump (Knot DNS %s)\n", PACKAGE_VERSION);
+	ret = dump_str(&params.buf, line);
+
+	// Standard zone records without rrsigs, then DNSSEC records if secured.
+	const dump_pass_t records = { NULL };
+	const dump_pass_t rrsigs = { ";; DNSSEC signatures\n", false, true, false };
+	const dump_pass_t nsec = { ";; DNSSEC NSEC chain\n", false, false, true };
+	const dump_pass_t nsec3 = { ";; DNSSEC NSEC3 chain\n", true, false, true };
+	const dump_pass_t nsec3_rrsigs = { ";; DNSSEC NSEC3 signatures\n", true, true, false };
+
+	const dump_pass_t *passes[4] = { &records };
+	unsigned pass_count = 1;
+	if (zone_contents_is_signed(zone)) {
+		passes[pass_count++] = &rrsigs;
+	}
+	if (knot_is_nsec3_enabled(zone)) {
+		passes[pass_count++] = &nsec3;
+		passes[pass_count++] = &nsec3_rrsigs;
 	} else if (zone_contents_is_signed(zone)) {
-		fprintf(file, ";; DNSSEC NSEC chain\n");
+		passes[pass_count++] = &nsec;
+	}
 
-		// Dump nsec records.
-		params.dump_rrsig = false;
-		params.dump_nsec = true;
-		ret = zone_contents_tree_apply_inorder(zone, node_dump_text,
-		                                       &params);
-		if (ret != KNOT_EOK) {
-			return ret;
-		}
+	for (unsigned i = 0; ret == KNOT_EOK && i < pass_count; i++) {
+		ret = dump_pass(zone, &params, passes[i], threads);
 	}
 
-	// Create formated date-time string.
-	time_t now = time(NULL);
-	struct tm tm;
-	localtime_r(&now, &tm);
-	char date[64];
-	strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S %Z", &tm);
+	if (ret == KNOT_EOK) {
+		// Create formated date-time string.
+		time_t now = time(NULL);
+		struct tm tm;
+		localtime_r(&now, &tm);
+		char date[64];
+		strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S %Z", &tm);
+
+		// Dump trailing statistics.
+		snprintf(line, sizeof(line), ";; Written %"PRIu64" records\n"
+		                             ";; Time %s\n", params.rr_count, date);
+		ret = dump_str(&params.buf, line);
+	}
 
-	// Dump trailing statistics.
-	fprintf(file, ";; Written %"PRIu64" records\n"
-	              ";; Time %s\n",
-	        params.rr_count, date);
+	if (ret == KNOT_EOK) {
+		ret = buf_flush(&params.buf);
+	}
 
-	free(buf);
+	free(params.buf.data);
 
-	return KNOT_EOK;
+	return ret;
 }
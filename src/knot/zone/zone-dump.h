@@ -29,12 +29,17 @@
 /*!
  * \brief Dumps given zone to text file.
  *
- * \param zone Zone to be saved.
- * \param file File to write to.
+ * The records are formatted into a large buffer, which is written into
+ * the file when full. Large zones are formatted by the given number of threads
+ * with the output in the same order.
+ *
+ * \param zone     Zone to be saved.
+ * \param file     File to write to.
+ * \param threads  Number of formatting threads (0 or 1 formats in this thread).
  *
  * \retval KNOT_EOK on success.
  * \retval < 0 if error.
  */
-int zone_dump_text(zone_contents_t *zone, FILE *file);
+int zone_dump_text(zone_contents_t *zone, FILE *file, unsigned threads);
 
 /*! @} */
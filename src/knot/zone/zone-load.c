@@ -166,7 +166,8 @@ int zone_load_post(conf_t *conf, zone_t *zone, zone_contents_t *contents,
 	val = conf_zone_get(conf, C_IXFR_DIFF, zone->name);
 	bool build_diffs = conf_bool(&val);
 	if (dnssec_enable) {
-		ret = knot_dnssec_zone_sign(contents, &change, 0, dnssec_refresh);
+		ret = knot_dnssec_zone_sign(contents, &change, 0, dnssec_refresh,
+		                            zone->dnssec_cache);
 		if (ret != KNOT_EOK) {
 			changeset_clear(&change);
 			return ret;
@@ -198,7 +199,8 @@ int zone_load_post(conf_t *conf, zone_t *zone, zone_contents_t *contents,
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
-		ret = zone_contents_diff(zone->contents, contents, &change);
+		ret = zone_contents_diff(zone->contents, contents, &change,
+		                         conf_bg_threads(conf));
 		if (ret == KNOT_ENODIFF) {
 			log_zone_warning(zone->name, "failed to create journal "
 			                 "entry, zone file changed without "
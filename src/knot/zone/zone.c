@@ -20,8 +20,11 @@
 #include <urcu.h>
 
 #include "knot/common/log.h"
+#include "knot/dnssec/key-cache.h"
 #include "knot/nameserver/process_query.h"
 #include "knot/query/requestor.h"
+#include "knot/server/dthreads.h"
+#include "knot/server/numa.h"
 #include "knot/updates/zone-update.h"
 #include "knot/zone/contents.h"
 #include "knot/zone/serial.h"
@@ -75,6 +78,13 @@ zone_t* zone_new(const knot_dname_t *name)
 	// Initialize query modules list.
 	init_list(&zone->query_modules);
 
+	// DNSSEC signing cache
+	zone->dnssec_cache = kdnssec_cache_new();
+	if (zone->dnssec_cache == NULL) {
+		zone_free(&zone);
+		return NULL;
+	}
+
 	return zone;
 }
 
@@ -117,6 +127,8 @@ void zone_free(zone_t **zone_ptr)
 
 	conf_deactivate_modules(&zone->query_modules, &zone->query_plan);
 
+	kdnssec_cache_free(zone->dnssec_cache);
+
 	free(zone);
 	*zone_ptr = NULL;
 }
@@ -184,6 +196,11 @@ zone_contents_t *zone_switch_contents(zone_t *zone, zone_contents_t *new_content
 		return NULL;
 	}
 
+	static uint64_t generation = 0;
+	if (new_contents != NULL) {
+		new_contents->generation = __sync_add_and_fetch(&generation, 1);
+	}
+
 	zone_contents_t *old_contents;
 	zone_contents_t **current_contents = &zone->contents;
 	old_contents = rcu_xchg_pointer(current_contents, new_contents);
@@ -191,6 +208,81 @@ zone_contents_t *zone_switch_contents(zone_t *zone, zone_contents_t *new_content
 	return old_contents;
 }
 
+/*! \brief Per-node replicas being built. */
+typedef struct {
+	zone_contents_t *contents;
+	zone_contents_t **replicas;
+	bool huge_pages;
+} replicate_ctx_t;
+
+static int replicate_run(dthread_t *thread)
+{
+	replicate_ctx_t *ctx = thread->data;
+	unsigned node = dt_get_id(thread);
+
+	/* Build the copy on the node, the first touch places its memory there. */
+	const unsigned *cpus = NULL;
+	size_t cpu_count = numa_node_cpus(node, &cpus);
+	dt_setaffinity(thread, (unsigned *)cpus, cpu_count);
+
+	return zone_contents_deep_copy(ctx->contents, &ctx->replicas[node],
+	                               ctx->huge_pages);
+}
+
+void zone_replicate_contents(conf_t *conf, zone_t *zone, zone_contents_t *contents)
+{
+	if (conf == NULL || zone == NULL || contents == NULL) {
+		return;
+	}
+
+	unsigned nodes = numa_nodes();
+	conf_val_t val = conf_zone_get(conf, C_NUMA_REPLICATE, zone->name);
+	if (!conf_bool(&val) || nodes < 2 || zone_contents_is_empty(contents)) {
+		return;
+	}
+
+	/* Only the replicas are put in huge pages, not the loaded contents. */
+	val = conf_get(conf, C_SRV, C_HUGE_PAGES);
+	replicate_ctx_t ctx = {
+		.contents = contents,
+		.replicas = calloc(nodes, sizeof(zone_contents_t *)),
+		.huge_pages = conf_bool(&val)
+	};
+	dt_unit_t *unit = NULL;
+	if (ctx.replicas == NULL ||
+	    (unit = dt_create(nodes, replicate_run, NULL, &ctx)) == NULL) {
+		log_zone_error(zone->name, "failed to replicate zone contents (%s)",
+		               knot_strerror(KNOT_ENOMEM));
+		free(ctx.replicas);
+		return;
+	}
+
+	dt_start(unit);
+	dt_join(unit);
+	dt_delete(&unit);
+
+	unsigned count = 0;
+	size_t memory = 0;
+	for (unsigned i = 0; i < nodes; i++) {
+		if (ctx.replicas[i] != NULL) {
+			count += 1;
+			memory += mp_total_size(ctx.replicas[i]->mm->ctx);
+		}
+	}
+
+	contents->replicas = ctx.replicas;
+	contents->replica_count = nodes;
+
+	if (count < nodes) {
+		log_zone_warning(zone->name, "failed to replicate zone contents "
+		                 "on %u of %u memory nodes", nodes - count, nodes);
+	}
+	if (count > 0) {
+		log_zone_info(zone->name, "zone contents replicated on %u memory "
+		              "nodes, node data %zu KiB", count, memory / 1024);
+	}
+}
+
 bool zone_is_slave(conf_t *conf, const zone_t *zone)
 {
 	if (conf == NULL || zone == NULL) {
@@ -340,7 +432,7 @@ int zone_flush_journal(conf_t *conf, zone_t *zone)
 	char *zonefile = conf_zonefile(conf, zone->name);
 
 	/* Synchronize journal. */
-	int ret = zonefile_write(zonefile, contents);
+	int ret = zonefile_write(zonefile, contents, conf_bg_threads(conf));
 	if (ret != KNOT_EOK) {
 		log_zone_warning(zone->name, "failed to update zone file (%s)",
 		                 knot_strerror(ret));
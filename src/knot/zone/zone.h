@@ -87,6 +87,9 @@ typedef struct zone
 	/*! \brief Query modules. */
 	list_t query_modules;
 	struct query_plan *query_plan;
+
+	/*! \brief Cached DNSSEC signing context and keys. */
+	struct kdnssec_cache *dnssec_cache;
 } zone_t;
 
 /*!
@@ -126,6 +129,17 @@ int zone_change_store(conf_t *conf, zone_t *zone, changeset_t *change);
  */
 zone_contents_t *zone_switch_contents(zone_t *zone, zone_contents_t *new_contents);
 
+/*!
+ * \brief Replicate the contents on each memory node if configured.
+ *
+ * Must be called before the contents are switched in. The replicas are
+ * freed together with the contents.
+ *
+ * \note Each replica is a full deep copy, so every commit (including small
+ *       DDNS or IXFR updates) costs O(zone size) per memory node.
+ */
+void zone_replicate_contents(conf_t *conf, zone_t *zone, zone_contents_t *contents);
+
 /*! \brief Checks if the zone is slave. */
 bool zone_is_slave(conf_t *conf, const zone_t *zone);
 
@@ -109,7 +109,7 @@ int zcreator_step(zcreator_t *zc, const knot_rrset_t *rr)
 	}
 
 	zone_node_t *node = NULL;
-	int ret = zone_contents_add_rr(zc->z, rr, &node);
+	int ret = zone_contents_build_rr(zc->z, &zc->build, rr, &node);
 	if (ret != KNOT_EOK) {
 		if (!handle_err(zc, node, rr, ret, zc->master)) {
 			// Fatal error
@@ -265,7 +265,7 @@ zone_contents_t *zonefile_load(zloader_t *loader)
 	}
 
 	ret = zone_do_sem_checks(zc->z, loader->semantic_checks,
-	                         loader->err_handler);
+	                         loader->err_handler, loader->threads);
 	INFO(zname, "semantic check, completed");
 
 	if (ret != KNOT_EOK) {
@@ -366,7 +366,7 @@ static int make_path(const char *path, mode_t mode)
 	return KNOT_EOK;
 }
 
-int zonefile_write(const char *path, zone_contents_t *zone)
+int zonefile_write(const char *path, zone_contents_t *zone, unsigned threads)
 {
 	if (!zone || !path) {
 		return KNOT_EINVAL;
@@ -384,8 +384,10 @@ int zonefile_write(const char *path, zone_contents_t *zone)
 		return ret;
 	}
 
-	ret = zone_dump_text(zone, file);
-	fclose(file);
+	ret = zone_dump_text(zone, file, threads);
+	if (fclose(file) != 0 && ret == KNOT_EOK) {
+		ret = knot_map_errno();
+	}
 	if (ret != KNOT_EOK) {
 		unlink(tmp_name);
 		free(tmp_name);
@@ -32,9 +32,10 @@
  * \brief Zone creator structure.
  */
 typedef struct zcreator {
-	zone_contents_t *z;  /*!< Created zone. */
-	bool master;         /*!< True if server is a primary master for the zone. */
-	int ret;             /*!< Return value. */
+	zone_contents_t *z;            /*!< Created zone. */
+	bool master;                   /*!< True if server is a primary master for the zone. */
+	int ret;                       /*!< Return value. */
+	zone_contents_build_t build;   /*!< Insertion state (zeroed initially). */
 } zcreator_t;
 
 /*!
@@ -43,6 +44,7 @@ typedef struct zcreator {
 typedef struct zloader {
 	char *source;                /*!< Zone source file. */
 	bool semantic_checks;        /*!< Do semantic checks. */
+	unsigned threads;            /*!< Semantic checks threads (0 means 1). */
 	err_handler_t *err_handler;  /*!< Semantic checks error handler. */
 	zcreator_t *creator;         /*!< Loader context. */
 	zs_scanner_t scanner;        /*!< Zone scanner. */
@@ -93,8 +95,14 @@ int zonefile_exists(const char *path, time_t *mtime);
 
 /*!
  * \brief Write zone contents to zone file.
+ *
+ * \param path     Zonefile path.
+ * \param zone     Zone contents to be written.
+ * \param threads  Number of threads formatting the zone.
+ *
+ * \return KNOT_E*
  */
-int zonefile_write(const char *path, zone_contents_t *zone);
+int zonefile_write(const char *path, zone_contents_t *zone, unsigned threads);
 
 /*!
  * \brief Close zone file loader.
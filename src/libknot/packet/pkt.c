@@ -801,6 +801,20 @@ int knot_pkt_parse_section(knot_pkt_t *pkt, unsigned flags)
 	uint16_t rr_parsed = 0;
 	uint16_t rr_count = pkt_rr_wirecount(pkt, pkt->current);
 
+	/* Skip answer RRs, they are read with knot_rr_view_parse() later. */
+	if (pkt->current == KNOT_ANSWER && (flags & KNOT_PF_NOANSWER)) {
+		for (rr_parsed = 0; rr_parsed < rr_count; ++rr_parsed) {
+			knot_rr_view_t view;
+			ret = knot_rr_view_parse(pkt->wire, &pkt->parsed, pkt->size,
+			                         &view);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+
+		return KNOT_EOK;
+	}
+
 	/* Parse all RRs belonging to the section. */
 	for (rr_parsed = 0; rr_parsed < rr_count; ++rr_parsed) {
 		ret = knot_pkt_parse_rr(pkt, flags);
@@ -831,6 +845,10 @@ int knot_pkt_parse_payload(knot_pkt_t *pkt, unsigned flags)
 		return KNOT_EMALF;
 	}
 
+	if (flags & KNOT_PF_NOANSWER) {
+		rr_count -= knot_wire_get_ancount(pkt->wire);
+	}
+
 	int ret = pkt_rr_array_alloc(pkt, rr_count);
 	if (ret != KNOT_EOK) {
 		return ret;
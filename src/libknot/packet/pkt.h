@@ -72,6 +72,7 @@ enum {
 	KNOT_PF_CHECKDUP  = 1 << 3, /*!< Check for duplicates. */
 	KNOT_PF_KEEPWIRE  = 1 << 4, /*!< Keep wireformat untouched when parsing. */
 	KNOT_PF_NOCANON   = 1 << 5, /*!< Don't canonicalize rrsets during parsing. */
+	KNOT_PF_NOANSWER  = 1 << 6, /*!< Only check answer RRs, don't store them. */
 };
 
 /*!
@@ -269,9 +270,11 @@ uint16_t knot_pkt_rr_offset(const knot_pktsection_t *section, uint16_t i);
  * includes semantic checks over specific RRs (TSIG, OPT).
  *
  * \note For KNOT_PF_KEEPWIRE see note for \fn knot_pkt_parse_rr
+ * \note For KNOT_PF_NOANSWER see note for \fn knot_pkt_parse_section
  *
  * \param pkt Given packet.
- * \param flags Parsing flags (allowed KNOT_PF_KEEPWIRE)
+ * \param flags Parsing flags (allowed KNOT_PF_KEEPWIRE, KNOT_PF_NOCANON,
+ *              KNOT_PF_NOANSWER)
  * \return KNOT_EOK, KNOT_EMALF and other errors
  */
 int knot_pkt_parse(knot_pkt_t *pkt, unsigned flags);
@@ -297,6 +300,9 @@ int knot_pkt_parse_rr(knot_pkt_t *pkt, unsigned flags);
  * \brief Parse current packet section.
  *
  * \note For KNOT_PF_KEEPWIRE see note for \fn knot_pkt_parse_rr
+ * \note When KNOT_PF_NOANSWER is set, the answer section RRs are only checked
+ *       and skipped, the section is empty. The RRs can be read from the wire
+ *       (following the question) with knot_rr_view_parse().
  *
  * \param pkt
  * \param flags
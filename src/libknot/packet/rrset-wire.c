@@ -275,6 +275,79 @@ static int rdata_len(const uint8_t **src, size_t *src_avail,
 	return _len;
 }
 
+/*!
+ * \brief RDATA processing variant, derived from the RR type descriptor.
+ */
+typedef enum {
+	RDATA_GENERIC = 0, /*!< Descriptor traversal. */
+	RDATA_COPY,        /*!< No compressible names, binary copy of the RDATA. */
+	RDATA_NAME,        /*!< Fixed-size prefix and one compressible name. */
+} rdata_shape_t;
+
+/*!
+ * \brief RDATA processing plan, selected once per RR set.
+ */
+typedef struct {
+	rdata_shape_t write; /*!< RDATA to wire processing. */
+	bool parse_copy;     /*!< No names, RDATA from wire is a binary copy. */
+	bool remainder;      /*!< The last block consumes the remaining data. */
+	uint16_t fixed_size; /*!< Total size of the fixed-size blocks. */
+	int name_offset;     /*!< Offset of the first name if fixed, or -1. */
+	const knot_rdata_descriptor_t *desc; /*!< RDATA descriptor. */
+} rdata_plan_t;
+
+/*!
+ * \brief Select RDATA processing for the given descriptor.
+ */
+static void rdata_plan_init(rdata_plan_t *plan, const knot_rdata_descriptor_t *desc)
+{
+	memset(plan, 0, sizeof(*plan));
+	plan->name_offset = -1;
+	plan->desc = desc;
+
+	int names = 0, compressible = 0;
+	bool naptr = false, fixed_offset = true;
+	for (int i = 0; desc->block_types[i] != KNOT_RDATA_WF_END; i++) {
+		int type = desc->block_types[i];
+		switch (type) {
+		case KNOT_RDATA_WF_COMPRESSIBLE_DNAME:
+			compressible++;
+			// FALLTHROUGH
+		case KNOT_RDATA_WF_DECOMPRESSIBLE_DNAME:
+		case KNOT_RDATA_WF_FIXED_DNAME:
+			if (names++ == 0 && fixed_offset) {
+				plan->name_offset = plan->fixed_size;
+			}
+			fixed_offset = false;
+			break;
+		case KNOT_RDATA_WF_NAPTR_HEADER:
+			naptr = true;
+			fixed_offset = false;
+			break;
+		case KNOT_RDATA_WF_REMAINDER:
+			plan->remainder = true;
+			fixed_offset = false;
+			break;
+		default:
+			assert(type > 0);
+			plan->fixed_size += type;
+			break;
+		}
+	}
+
+	plan->parse_copy = (names == 0 && !naptr);
+
+	if (compressible == 0 && !naptr && (names == 0 || plan->name_offset >= 0)) {
+		plan->write = RDATA_COPY;
+	} else if (compressible == 1 && names == 1 && !naptr && !plan->remainder &&
+	           plan->name_offset == plan->fixed_size) {
+		/* The name is the last block (NS, CNAME, PTR, MX, ...). */
+		plan->write = RDATA_NAME;
+	} else {
+		plan->write = RDATA_GENERIC;
+	}
+}
+
 /*- RRSet to wire -----------------------------------------------------------*/
 
 /*!
@@ -412,11 +485,69 @@ static int compress_rdata_dname(const uint8_t **src, size_t *src_avail,
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Write RDATA without compressible names as a binary copy.
+ */
+static int write_rdata_copy(const uint8_t **src, size_t *src_avail,
+                            uint8_t **dst, size_t *dst_avail,
+                            const rdata_plan_t *plan, dname_config_t *dname_cfg)
+{
+	/* Check the sizes known from the descriptor. */
+	if (*src_avail < plan->fixed_size ||
+	    (plan->name_offset >= 0 && *src_avail <= (size_t)plan->name_offset) ||
+	    (plan->parse_copy && !plan->remainder && *src_avail != plan->fixed_size)) {
+		return KNOT_EMALF;
+	}
+
+	/* The names must be valid and consume the RDATA with the other blocks. */
+	if (plan->name_offset >= 0 && rdata_len(src, src_avail, NULL, plan->desc) < 0) {
+		return KNOT_EMALF;
+	}
+
+	uint8_t *rdata = *dst;
+	int ret = write_rdata_fixed(src, src_avail, dst, dst_avail, *src_avail);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	/* Update compression hints, the name itself is never compressed. */
+
+	if (plan->name_offset >= 0 &&
+	    compr_get_ptr(dname_cfg->compr, dname_cfg->hint) == 0) {
+		const uint8_t *name = rdata + plan->name_offset;
+		compr_set_ptr(dname_cfg->compr, dname_cfg->hint, name,
+		              knot_dname_size(name));
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Write RDATA consisting of a fixed-size prefix and a compressible name.
+ */
+static int write_rdata_name(const uint8_t **src, size_t *src_avail,
+                            uint8_t **dst, size_t *dst_avail,
+                            const rdata_plan_t *plan, dname_config_t *dname_cfg)
+{
+	int ret = write_rdata_fixed(src, src_avail, dst, dst_avail, plan->fixed_size);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (*src_avail == 0) {
+		return KNOT_EMALF;
+	}
+
+	return compress_rdata_dname(src, src_avail, dst, dst_avail,
+	                            KNOT_RDATA_WF_COMPRESSIBLE_DNAME, dname_cfg);
+}
+
 /*!
  * \brief Write RDLENGTH and RDATA fields of a RR in a wire.
  */
 static int write_rdata(const knot_rrset_t *rrset, uint16_t rrset_index,
-                       uint8_t **dst, size_t *dst_avail, knot_compr_t *compr)
+                       uint8_t **dst, size_t *dst_avail, knot_compr_t *compr,
+                       const rdata_plan_t *plan)
 {
 	assert(rrset);
 	assert(rrset_index < rrset->rrs.rr_count);
@@ -448,10 +579,22 @@ static int write_rdata(const knot_rrset_t *rrset, uint16_t rrset_index,
 	size_t src_avail = knot_rdata_rdlen(rdata);
 	if (src_avail > 0) {
 		/* Only write non-empty data. */
-		const knot_rdata_descriptor_t *desc =
-			knot_get_rdata_descriptor(rrset->type);
-		int ret = rdata_traverse(&src, &src_avail, dst, dst_avail,
-		                         desc, &dname_cfg);
+		int ret = KNOT_EOK;
+		switch (plan->write) {
+		case RDATA_COPY:
+			ret = write_rdata_copy(&src, &src_avail, dst, dst_avail,
+			                       plan, &dname_cfg);
+			break;
+		case RDATA_NAME:
+			ret = write_rdata_name(&src, &src_avail, dst, dst_avail,
+			                       plan, &dname_cfg);
+			break;
+		default:
+			ret = rdata_traverse(&src, &src_avail, dst, dst_avail,
+			                     knot_get_rdata_descriptor(rrset->type),
+			                     &dname_cfg);
+			break;
+		}
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
@@ -474,7 +617,8 @@ static int write_rdata(const knot_rrset_t *rrset, uint16_t rrset_index,
  * \brief Write one RR from a RR Set to wire.
  */
 static int write_rr(const knot_rrset_t *rrset, uint16_t rrset_index,
-                    uint8_t **dst, size_t *dst_avail, knot_compr_t *compr)
+                    uint8_t **dst, size_t *dst_avail, knot_compr_t *compr,
+                    const rdata_plan_t *plan)
 {
 	int ret;
 
@@ -488,7 +632,7 @@ static int write_rr(const knot_rrset_t *rrset, uint16_t rrset_index,
 		return ret;
 	}
 
-	return write_rdata(rrset, rrset_index, dst, dst_avail, compr);
+	return write_rdata(rrset, rrset_index, dst, dst_avail, compr, plan);
 }
 
 /*!
@@ -505,8 +649,11 @@ int knot_rrset_to_wire(const knot_rrset_t *rrset, uint8_t *wire, uint16_t max_si
 	uint8_t *write = wire;
 	size_t capacity = max_size;
 
+	rdata_plan_t plan;
+	rdata_plan_init(&plan, knot_get_rdata_descriptor(rrset->type));
+
 	for (uint16_t i = 0; i < rrset->rrs.rr_count; i++) {
-		int ret = write_rr(rrset, i, &write, &capacity, compr);
+		int ret = write_rr(rrset, i, &write, &capacity, compr, &plan);
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
@@ -609,6 +756,68 @@ static bool allow_zero_rdata(const knot_rrset_t *rr,
 	       desc->type_name == NULL;        // Unknown RR type
 }
 
+static const knot_rdata_descriptor_t *parse_descriptor(uint16_t type)
+{
+	const knot_rdata_descriptor_t *desc = knot_get_rdata_descriptor(type);
+	if (desc->type_name == NULL) {
+		desc = knot_get_obsolete_rdata_descriptor(type);
+	}
+
+	return desc;
+}
+
+/*!
+ * \brief Compute size of the decompressed non-empty RDATA.
+ */
+static int rdata_unpacked_size(const uint8_t *pkt_wire, const uint8_t *src,
+                               uint16_t rdlength,
+                               const knot_rdata_descriptor_t *desc,
+                               const rdata_plan_t *plan)
+{
+	int size = rdlength;
+	if (plan->parse_copy) {
+		/* No names, the size is known from the descriptor. */
+		if (rdlength < plan->fixed_size ||
+		    (!plan->remainder && rdlength != plan->fixed_size)) {
+			return KNOT_EMALF;
+		}
+	} else {
+		size_t src_avail = rdlength;
+		size = rdata_len(&src, &src_avail, pkt_wire, desc);
+		if (size < 0) {
+			return size;
+		}
+	}
+
+	if (size > MAX_RDLENGTH) {
+		/* DNAME compression caused RDATA overflow. */
+		return KNOT_EMALF;
+	}
+
+	return size;
+}
+
+/*!
+ * \brief Decompress non-empty RDATA of the size from rdata_unpacked_size().
+ */
+static int rdata_unpack(const uint8_t *pkt_wire, const uint8_t *src,
+                        uint16_t rdlength, const knot_rdata_descriptor_t *desc,
+                        const rdata_plan_t *plan, uint8_t *dst, size_t dst_avail)
+{
+	size_t src_avail = rdlength;
+
+	if (plan->parse_copy) {
+		return write_rdata_fixed(&src, &src_avail, &dst, &dst_avail, rdlength);
+	}
+
+	dname_config_t dname_cfg = {
+		.write_cb = decompress_rdata_dname,
+		.pkt_wire = pkt_wire
+	};
+
+	return rdata_traverse(&src, &src_avail, &dst, &dst_avail, desc, &dname_cfg);
+}
+
 /*!
  * \brief Parse RDATA part of one RR from packet wireformat.
  */
@@ -624,10 +833,7 @@ static int parse_rdata(const uint8_t *pkt_wire, size_t *pos, size_t pkt_size,
 		return KNOT_EMALF;
 	}
 
-	const knot_rdata_descriptor_t *desc = knot_get_rdata_descriptor(rrset->type);
-	if (desc->type_name == NULL) {
-		desc = knot_get_obsolete_rdata_descriptor(rrset->type);
-	}
+	const knot_rdata_descriptor_t *desc = parse_descriptor(rrset->type);
 
 	if (rdlength == 0) {
 		if (allow_zero_rdata(rrset, desc)) {
@@ -640,18 +846,15 @@ static int parse_rdata(const uint8_t *pkt_wire, size_t *pos, size_t pkt_size,
 	/* Source and destination buffer */
 
 	const uint8_t *src = pkt_wire + *pos;
-	size_t src_avail = rdlength;
 
-	int buffer_size = rdata_len(&src, &src_avail, pkt_wire, desc);
+	rdata_plan_t plan;
+	rdata_plan_init(&plan, desc);
+
+	int buffer_size = rdata_unpacked_size(pkt_wire, src, rdlength, desc, &plan);
 	if (buffer_size < 0) {
 		return buffer_size;
 	}
 
-	if (buffer_size > MAX_RDLENGTH) {
-		/* DNAME compression caused RDATA overflow. */
-		return KNOT_EMALF;
-	}
-
 	knot_rdataset_t *rrs = &rrset->rrs;
 	int ret = knot_rdataset_reserve(rrs, buffer_size, mm);
 	if (ret != KNOT_EOK) {
@@ -661,17 +864,11 @@ static int parse_rdata(const uint8_t *pkt_wire, size_t *pos, size_t pkt_size,
 	knot_rdata_t *rr = knot_rdataset_at(rrs, rrs->rr_count - 1);
 	assert(rr);
 	knot_rdata_set_ttl(rr, ttl);
-	uint8_t *dst = knot_rdata_data(rr);
-	size_t dst_avail = buffer_size;
 
 	/* Parse RDATA */
 
-	dname_config_t dname_cfg = {
-		.write_cb = decompress_rdata_dname,
-		.pkt_wire = pkt_wire
-	};
-
-	ret = rdata_traverse(&src, &src_avail, &dst, &dst_avail, desc, &dname_cfg);
+	ret = rdata_unpack(pkt_wire, src, rdlength, desc, &plan,
+	                   knot_rdata_data(rr), buffer_size);
 	if (ret != KNOT_EOK) {
 		knot_rdataset_unreserve(rrs, mm);
 		return ret;
@@ -720,3 +917,92 @@ int knot_rrset_rr_from_wire(const uint8_t *pkt_wire, size_t *pos, size_t pkt_siz
 
 	return KNOT_EOK;
 }
+
+/*- RR view -----------------------------------------------------------------*/
+
+_public_
+int knot_rr_view_parse(const uint8_t *pkt_wire, size_t *pos, size_t pkt_size,
+                       knot_rr_view_t *view)
+{
+	if (!pkt_wire || !pos || !view || *pos > pkt_size) {
+		return KNOT_EINVAL;
+	}
+
+	wire_ctx_t wire = wire_ctx_init_const(pkt_wire, pkt_size);
+	wire_ctx_set_offset(&wire, *pos);
+
+	int owner_size = knot_dname_wire_check(wire.position,
+	                                       pkt_wire + pkt_size, pkt_wire);
+	if (owner_size <= 0) {
+		return KNOT_EMALF;
+	}
+
+	view->pkt_wire = pkt_wire;
+	view->owner = wire.position;
+	wire_ctx_skip(&wire, owner_size);
+
+	view->type = wire_ctx_read_u16(&wire);
+	view->rclass = wire_ctx_read_u16(&wire);
+	view->ttl = wire_ctx_read_u32(&wire);
+	view->rdlength = wire_ctx_read_u16(&wire);
+	view->rdata = wire.position;
+
+	if (wire.error != KNOT_EOK ||
+	    wire_ctx_available(&wire) < view->rdlength) {
+		return KNOT_EMALF;
+	}
+
+	*pos = wire_ctx_offset(&wire) + view->rdlength;
+
+	return KNOT_EOK;
+}
+
+_public_
+int knot_rr_view_expand(const knot_rr_view_t *view, knot_rrset_t *rrset,
+                        knot_dname_t *owner, knot_rdata_t *rdata, bool canonical)
+{
+	if (!view || !rrset || !owner || !rdata) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = knot_dname_unpack(owner, view->owner, KNOT_DNAME_MAXLEN,
+	                            view->pkt_wire);
+	if (ret <= 0) {
+		return KNOT_EMALF;
+	}
+
+	knot_rrset_init(rrset, owner, view->type, view->rclass);
+
+	const knot_rdata_descriptor_t *desc = parse_descriptor(view->type);
+
+	int size = 0;
+	if (view->rdlength > 0) {
+		rdata_plan_t plan;
+		rdata_plan_init(&plan, desc);
+
+		size = rdata_unpacked_size(view->pkt_wire, view->rdata,
+		                           view->rdlength, desc, &plan);
+		if (size < 0) {
+			return size;
+		}
+
+		ret = rdata_unpack(view->pkt_wire, view->rdata, view->rdlength,
+		                   desc, &plan, knot_rdata_data(rdata), size);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	} else if (!allow_zero_rdata(rrset, desc)) {
+		return KNOT_EMALF;
+	}
+
+	knot_rdata_set_ttl(rdata, view->ttl);
+	knot_rdata_set_rdlen(rdata, size);
+	rrset->rrs.rr_count = 1;
+	rrset->rrs.data = rdata;
+
+	if (canonical) {
+		return knot_rrset_rr_to_canonical(rrset);
+	}
+
+	return KNOT_EOK;
+}
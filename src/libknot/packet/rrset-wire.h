@@ -27,6 +27,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "libknot/consts.h"
 #include "libknot/dname.h"
 #include "libknot/rrset.h"
 #include "libknot/mm_ctx.h"
@@ -61,4 +62,57 @@ int knot_rrset_to_wire(const knot_rrset_t *rrset, uint8_t *wire, uint16_t max_si
 int knot_rrset_rr_from_wire(const uint8_t *pkt_wire, size_t *pos, size_t pkt_size,
                             knot_mm_t *mm, knot_rrset_t *rrset, bool canonical);
 
+/*!
+ * \brief View of one RR in a packet wire.
+ *
+ * The owner and RDATA are not copied and may contain compression pointers,
+ * they are decompressed only by knot_rr_view_expand().
+ */
+typedef struct {
+	const uint8_t *pkt_wire; /*!< Packet wire (compression pointer target). */
+	const uint8_t *owner;    /*!< Owner in the packet wire. */
+	const uint8_t *rdata;    /*!< RDATA in the packet wire. */
+	uint16_t rdlength;
+	uint16_t type;
+	uint16_t rclass;
+	uint32_t ttl;
+} knot_rr_view_t;
+
+/*!
+ * \brief Size of the RDATA buffer for knot_rr_view_expand().
+ */
+#define KNOT_RR_VIEW_RDATA_SIZE (MAX_RDLENGTH + 8)
+
+/*!
+ * \brief Parses one RR header from wire and skips the RDATA.
+ *
+ * Only the owner and the RR bounds are checked, no memory is allocated.
+ *
+ * \param pkt_wire  Source wire (the whole packet).
+ * \param pos       Position in \a wire where to start parsing.
+ * \param pkt_size  Total size of data in \a wire (size of the packet).
+ * \param view      Output RR view.
+ *
+ * \return KNOT_E*
+ */
+int knot_rr_view_parse(const uint8_t *pkt_wire, size_t *pos, size_t pkt_size,
+                       knot_rr_view_t *view);
+
+/*!
+ * \brief Decompresses the viewed RR into a single-RR RR set.
+ *
+ * The RR set is backed by the given buffers, it must not be freed and is
+ * valid until the buffers are reused.
+ *
+ * \param view       RR view.
+ * \param rrset      Output RR set.
+ * \param owner      Owner buffer of KNOT_DNAME_MAXLEN bytes.
+ * \param rdata      RDATA buffer of KNOT_RR_VIEW_RDATA_SIZE bytes.
+ * \param canonical  Convert the RR to canonical format.
+ *
+ * \return KNOT_E*
+ */
+int knot_rr_view_expand(const knot_rr_view_t *view, knot_rrset_t *rrset,
+                        knot_dname_t *owner, knot_rdata_t *rdata, bool canonical);
+
 /*! @} */
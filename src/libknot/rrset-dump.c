@@ -88,6 +88,38 @@ static void dump_string(rrset_dump_params_t *p, const char *str)
 	p->ret = 0;
 }
 
+/*! \brief Write a number in decimal, same as snprintf "%u" but faster. */
+static int uint_to_str(char *dst, size_t maxlen, uint32_t value)
+{
+	char   buf[10];
+	size_t len = 0;
+
+	do {
+		buf[len++] = '0' + value % 10;
+		value /= 10;
+	} while (value != 0);
+
+	if (len >= maxlen) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		dst[i] = buf[len - 1 - i];
+	}
+	dst[len] = '\0';
+
+	return len;
+}
+
+/*! \brief Write a number in decimal with the given number of digits. */
+static void uint_to_digits(char *dst, unsigned value, size_t digits)
+{
+	while (digits-- > 0) {
+		dst[digits] = '0' + value % 10;
+		value /= 10;
+	}
+}
+
 static void wire_num8_to_str(rrset_dump_params_t *p)
 {
 	uint8_t data = *(p->in);
@@ -100,7 +132,7 @@ static void wire_num8_to_str(rrset_dump_params_t *p)
 	}
 
 	// Write number.
-	int ret = snprintf(p->out, p->out_max, "%u", data);
+	int ret = uint_to_str(p->out, p->out_max, data);
 	if (ret <= 0 || (size_t)ret >= p->out_max) {
 		return;
 	}
@@ -130,7 +162,7 @@ static void wire_num16_to_str(rrset_dump_params_t *p)
 	data = wire_read_u16(p->in);
 
 	// Write number.
-	int ret = snprintf(p->out, p->out_max, "%u", data);
+	int ret = uint_to_str(p->out, p->out_max, data);
 	if (ret <= 0 || (size_t)ret >= p->out_max) {
 		return;
 	}
@@ -160,7 +192,7 @@ static void wire_num32_to_str(rrset_dump_params_t *p)
 	data = wire_read_u32(p->in);
 
 	// Write number.
-	int ret = snprintf(p->out, p->out_max, "%u", data);
+	int ret = uint_to_str(p->out, p->out_max, data);
 	if (ret <= 0 || (size_t)ret >= p->out_max) {
 		return;
 	}
@@ -664,16 +696,22 @@ static void wire_timestamp_to_str(rrset_dump_params_t *p)
 	time_t timestamp = ntohl(data);
 
 	if (p->style->human_tmstamp) {
-		struct tm result;
-		// Write timestamp in YYYYMMDDhhmmss format.
-		ret = strftime(p->out, p->out_max, "%Y%m%d%H%M%S",
-		               gmtime_r(&timestamp, &result));
-		if (ret == 0) {
+		struct tm tm;
+		// Write timestamp in YYYYMMDDhhmmss format (the year fits 4 digits).
+		ret = 14;
+		if (gmtime_r(&timestamp, &tm) == NULL || (size_t)ret >= p->out_max) {
 			return;
 		}
+		uint_to_digits(p->out,      tm.tm_year + 1900, 4);
+		uint_to_digits(p->out + 4,  tm.tm_mon + 1, 2);
+		uint_to_digits(p->out + 6,  tm.tm_mday, 2);
+		uint_to_digits(p->out + 8,  tm.tm_hour, 2);
+		uint_to_digits(p->out + 10, tm.tm_min, 2);
+		uint_to_digits(p->out + 12, tm.tm_sec, 2);
+		p->out[ret] = '\0';
 	} else {
 		// Write timestamp only.
-		ret = snprintf(p->out, p->out_max, "%u", ntohl(data));
+		ret = uint_to_str(p->out, p->out_max, ntohl(data));
 		if (ret <= 0 || (size_t)ret >= p->out_max) {
 			return;
 		}
@@ -1930,14 +1968,25 @@ int knot_rrset_txt_dump_header(const knot_rrset_t      *rrset,
 	char   buf[32];
 	int    ret;
 
-	// Dump rrset owner.
-	char *name = knot_dname_to_str_alloc(rrset->owner);
+	// Dump rrset owner, allocate the name only if converted to IDN.
+	char name_buf[4 * KNOT_DNAME_MAXLEN + 1];
+	char *name = NULL;
 	if (style->ascii_to_idn != NULL) {
-		style->ascii_to_idn(&name);
+		name = knot_dname_to_str_alloc(rrset->owner);
+		if (name != NULL) {
+			style->ascii_to_idn(&name);
+		}
+	} else {
+		name = knot_dname_to_str(name_buf, rrset->owner, sizeof(name_buf));
+	}
+	if (name == NULL) {
+		return KNOT_EINVAL;
 	}
 	char sep = strlen(name) < 4 * TAB_WIDTH ? '\t' : ' ';
 	ret = snprintf(dst + len, maxlen - len, "%-20s%c", name, sep);
-	free(name);
+	if (name != name_buf) {
+		free(name);
+	}
 	SNPRINTF_CHECK(ret, maxlen - len);
 	len += ret;
 
@@ -2004,15 +2053,32 @@ int knot_rrset_txt_dump(const knot_rrset_t      *rrset,
 	size_t len = 0;
 	int    ret;
 
+	// Previous header, copied if the TTL is the same.
+	size_t   header_pos = 0;
+	size_t   header_len = 0;
+	uint32_t header_ttl = 0;
+
 	// Loop over rdata in rrset.
 	uint16_t rr_count = rrset->rrs.rr_count;
 	for (uint16_t i = 0; i < rr_count; i++) {
 		// Dump rdata owner, class, ttl and type.
 		const knot_rdata_t *rr_data = knot_rdataset_at(&rrset->rrs, i);
-		ret = knot_rrset_txt_dump_header(rrset, knot_rdata_ttl(rr_data),
-		                                 dst + len, maxlen - len, style);
-		if (ret < 0) {
-			return KNOT_ESPACE;
+		uint32_t ttl = knot_rdata_ttl(rr_data);
+		if (i > 0 && ttl == header_ttl) {
+			if (header_len >= maxlen - len) {
+				return KNOT_ESPACE;
+			}
+			memcpy(dst + len, dst + header_pos, header_len);
+			ret = header_len;
+		} else {
+			ret = knot_rrset_txt_dump_header(rrset, ttl, dst + len,
+			                                 maxlen - len, style);
+			if (ret < 0) {
+				return KNOT_ESPACE;
+			}
+			header_pos = len;
+			header_len = ret;
+			header_ttl = ttl;
 		}
 		len += ret;
 
@@ -16,8 +16,11 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
 #include <time.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include "dnssec/error.h"
 #include "dnssec/tsig.h"
@@ -85,32 +88,10 @@ static int check_key(const knot_rrset_t *tsig_rr,
 	return KNOT_EOK;
 }
 
-static int compute_digest(const uint8_t *wire, size_t wire_len,
-                          uint8_t *digest, size_t *digest_len,
-                          const knot_tsig_key_t *key)
+static void digest_add(dnssec_tsig_ctx_t *hmac, const uint8_t *data, size_t size)
 {
-	if (!wire || !digest || !digest_len || !key) {
-		return KNOT_EINVAL;
-	}
-
-	if (!key->name) {
-		return KNOT_EMALF;
-	}
-
-	dnssec_tsig_ctx_t *ctx = NULL;
-	int result = dnssec_tsig_new(&ctx, key->algorithm, &key->secret);
-	if (result != DNSSEC_EOK) {
-		return KNOT_TSIG_EBADSIG;
-	}
-
-	dnssec_binary_t cover = { .data = (uint8_t *)wire, .size = wire_len };
-	dnssec_tsig_add(ctx, &cover);
-
-	*digest_len = dnssec_tsig_size(ctx);
-	dnssec_tsig_write(ctx, digest);
-	dnssec_tsig_free(ctx);
-
-	return KNOT_EOK;
+	dnssec_binary_t cover = { .data = (uint8_t *)data, .size = size };
+	dnssec_tsig_add(hmac, &cover);
 }
 
 static int check_time_signed(const knot_rrset_t *tsig_rr,
@@ -149,21 +130,26 @@ static int check_time_signed(const knot_rrset_t *tsig_rr,
 	return KNOT_EOK;
 }
 
-static int write_tsig_variables(uint8_t *wire, const knot_rrset_t *tsig_rr)
+static int digest_add_variables(dnssec_tsig_ctx_t *hmac,
+                                const knot_rrset_t *tsig_rr)
 {
-	if (wire == NULL || tsig_rr == NULL) {
+	if (hmac == NULL || tsig_rr == NULL) {
 		return KNOT_EINVAL;
 	}
 
+	/* Everything up to the other data, which is added separately. */
+	uint8_t wire[2 * KNOT_DNAME_MAXLEN + KNOT_TSIG_VARIABLES_LENGTH];
+
 	/* Copy TSIG variables - starting with key name. */
 	const knot_dname_t *tsig_owner = tsig_rr->owner;
 	if (!tsig_owner) {
 		return KNOT_EINVAL;
 	}
 
-	int offset = 0;
-
-	offset += knot_dname_to_wire(wire + offset, tsig_owner, KNOT_DNAME_MAXLEN);
+	int offset = knot_dname_to_wire(wire, tsig_owner, KNOT_DNAME_MAXLEN);
+	if (offset < 0) {
+		return offset;
+	}
 
 	/*!< \todo which order? */
 
@@ -183,10 +169,11 @@ static int write_tsig_variables(uint8_t *wire, const knot_rrset_t *tsig_rr)
 
 	/* Te algorithm name must be in canonical form, i.e. in lowercase. */
 	uint8_t *alg_name_wire = wire + offset;
-	offset += knot_dname_to_wire(alg_name_wire, alg_name, KNOT_DNAME_MAXLEN);
-	if (knot_dname_to_lower(alg_name_wire) != KNOT_EOK) {
+	int alg_name_len = knot_dname_to_wire(alg_name_wire, alg_name, KNOT_DNAME_MAXLEN);
+	if (alg_name_len < 0 || knot_dname_to_lower(alg_name_wire) != KNOT_EOK) {
 		return KNOT_EINVAL;
 	}
+	offset += alg_name_len;
 
 	/* Following data are written in network order. */
 	/* Time signed. */
@@ -213,137 +200,175 @@ static int write_tsig_variables(uint8_t *wire, const knot_rrset_t *tsig_rr)
 	wire_write_u16(wire + offset, other_data_length);
 	offset += sizeof(uint16_t);
 
+	digest_add(hmac, wire, offset);
+
 	/* Skip the length. */
-	memcpy(wire + offset, other_data, other_data_length);
+	digest_add(hmac, other_data, other_data_length);
 
 	return KNOT_EOK;
 }
 
-static int wire_write_timers(uint8_t *wire, const knot_rrset_t *tsig_rr)
+static int digest_add_timers(dnssec_tsig_ctx_t *hmac, const knot_rrset_t *tsig_rr)
 {
-	if (wire == NULL || tsig_rr == NULL) {
+	if (hmac == NULL || tsig_rr == NULL) {
 		return KNOT_EINVAL;
 	}
 
+	uint8_t wire[KNOT_TSIG_TIMERS_LENGTH];
+
 	//write time signed
 	wire_write_u48(wire, knot_tsig_rdata_time_signed(tsig_rr));
 	//write fudge
 	wire_write_u16(wire + 6, knot_tsig_rdata_fudge(tsig_rr));
 
+	digest_add(hmac, wire, sizeof(wire));
+
 	return KNOT_EOK;
 }
 
-static int create_sign_wire(const uint8_t *msg, size_t msg_len,
-                            const uint8_t *request_mac, size_t request_mac_len,
-                            uint8_t *digest, size_t *digest_len,
-                            const knot_rrset_t *tmp_tsig,
-                            const knot_tsig_key_t *key)
+struct knot_tsig_stream {
+	dnssec_tsig_ctx_t *hmac; /*!< HMAC context (NULL until first used). */
+	unsigned pending;        /*!< Unsigned messages since the last MAC. */
+};
+
+/*! \brief Drop the context, partially hashed data can't be removed from it. */
+static void stream_fail(knot_tsig_stream_t *stream)
 {
-	if (!msg || !key || digest_len == NULL) {
-		return KNOT_EINVAL;
+	dnssec_tsig_free(stream->hmac);
+	stream->hmac = NULL;
+	stream->pending = 0;
+}
+
+/*!
+ * \brief Start the digest of a run of messages with the previous MAC.
+ *
+ * The request MAC of the first message in a session is prefixed with its
+ * length only if present, the previous MAC of the next messages always.
+ */
+static int stream_begin(knot_tsig_stream_t *stream, const knot_tsig_key_t *key,
+                        const uint8_t *prev_mac, size_t prev_mac_len, bool next)
+{
+	if (stream->pending > 0) {
+		return KNOT_EOK;
 	}
 
-	/* Create tmp TSIG. */
-	int ret = KNOT_EOK;
+	if (stream->hmac == NULL) {
+		if (!key->name) {
+			return KNOT_EMALF;
+		}
 
-	/*
-	 * Create tmp wire, it should contain message
-	 * plus request mac plus tsig varibles.
-	 */
-	size_t wire_len = sizeof(uint8_t) *
-			(msg_len + request_mac_len + ((request_mac_len > 0)
-			 ? 2 : 0) +
-			knot_tsig_rdata_tsig_variables_length(tmp_tsig));
-	uint8_t *wire = malloc(wire_len);
-	if (!wire) {
-		return KNOT_ENOMEM;
+		int ret = dnssec_tsig_new(&stream->hmac, key->algorithm, &key->secret);
+		if (ret != DNSSEC_EOK) {
+			stream->hmac = NULL;
+			return KNOT_TSIG_EBADSIG;
+		}
 	}
 
-	memset(wire, 0, wire_len);
+	if (next || prev_mac_len > 0) {
+		uint8_t len[sizeof(uint16_t)];
+		wire_write_u16(len, prev_mac_len);
+		digest_add(stream->hmac, len, sizeof(len));
+		digest_add(stream->hmac, prev_mac, prev_mac_len);
+	}
 
-	uint8_t *pos = wire;
+	return KNOT_EOK;
+}
 
-	/* Copy the request MAC - should work even if NULL. */
-	if (request_mac_len > 0) {
-		wire_write_u16(pos, request_mac_len);
-		pos += 2;
-		memcpy(pos, request_mac, sizeof(uint8_t) * request_mac_len);
+/*!
+ * \brief Compute the digest of a message (prepended with the previous MAC
+ *        and the unsigned messages in the stream) and its TSIG variables.
+ */
+static int stream_digest(knot_tsig_stream_t *stream,
+                         const uint8_t *msg, size_t msg_len,
+                         const uint8_t *prev_mac, size_t prev_mac_len,
+                         uint8_t *digest, size_t *digest_len,
+                         const knot_rrset_t *tmp_tsig,
+                         const knot_tsig_key_t *key, bool next)
+{
+	if (!msg || !key || digest_len == NULL) {
+		return KNOT_EINVAL;
 	}
-	pos += request_mac_len;
-	/* Copy the original message. */
-	memcpy(pos, msg, msg_len);
-	pos += msg_len;
-	/* Copy TSIG variables. */
-	ret = write_tsig_variables(pos, tmp_tsig);
+
+	int ret = stream_begin(stream, key, prev_mac, prev_mac_len, next);
 	if (ret != KNOT_EOK) {
-		free(wire);
+		*digest_len = 0;
 		return ret;
 	}
 
-	/* Compute digest. */
-	ret = compute_digest(wire, wire_len, digest, digest_len, key);
+	digest_add(stream->hmac, msg, msg_len);
+
+	if (next) {
+		ret = digest_add_timers(stream->hmac, tmp_tsig);
+	} else {
+		ret = digest_add_variables(stream->hmac, tmp_tsig);
+	}
 	if (ret != KNOT_EOK) {
+		stream_fail(stream);
 		*digest_len = 0;
-		free(wire);
 		return ret;
 	}
 
-	free(wire);
+	/* Writing the digest also resets the context for the next run. */
+	*digest_len = dnssec_tsig_size(stream->hmac);
+	dnssec_tsig_write(stream->hmac, digest);
+	stream->pending = 0;
 
 	return KNOT_EOK;
 }
 
-static int create_sign_wire_next(const uint8_t *msg, size_t msg_len,
-                                 const uint8_t *prev_mac, size_t prev_mac_len,
-                                 uint8_t *digest, size_t *digest_len,
-                                 const knot_rrset_t *tmp_tsig,
-                                 const knot_tsig_key_t *key)
+_public_
+knot_tsig_stream_t *knot_tsig_stream_new(void)
 {
-	if (!msg || !key || digest_len == NULL) {
-		return KNOT_EINVAL;
+	return calloc(1, sizeof(knot_tsig_stream_t));
+}
+
+_public_
+void knot_tsig_stream_free(knot_tsig_stream_t *stream)
+{
+	if (stream == NULL) {
+		return;
 	}
 
-	/* Create tmp TSIG. */
-	int ret = KNOT_EOK;
+	stream_fail(stream);
+	free(stream);
+}
 
-	/*
-	 * Create tmp wire, it should contain message
-	 * plus request mac plus tsig varibles.
-	 */
-	size_t wire_len = sizeof(uint8_t) *
-	                (msg_len + prev_mac_len +
-			knot_tsig_rdata_tsig_timers_length() + 2);
-	uint8_t *wire = malloc(wire_len);
-	if (!wire) {
-		return KNOT_ENOMEM;
+_public_
+void knot_tsig_stream_clear(knot_tsig_stream_t *stream)
+{
+	if (stream == NULL) {
+		return;
 	}
 
-	memset(wire, 0, wire_len);
+	stream_fail(stream);
+}
+
+_public_
+unsigned knot_tsig_stream_pending(const knot_tsig_stream_t *stream)
+{
+	if (stream == NULL) {
+		return 0;
+	}
 
-	/* Copy the request MAC - should work even if NULL. */
-	wire_write_u16(wire, prev_mac_len);
-	memcpy(wire + 2, prev_mac, sizeof(uint8_t) * prev_mac_len);
-	/* Copy the original message. */
-	memcpy(wire + prev_mac_len + 2, msg, msg_len);
-	/* Copy TSIG variables. */
+	return stream->pending;
+}
 
-	ret = wire_write_timers(wire + prev_mac_len + msg_len + 2,
-	                                  tmp_tsig);
-	if (ret != KNOT_EOK) {
-		free(wire);
-		return ret;
+_public_
+int knot_tsig_stream_add(knot_tsig_stream_t *stream, const knot_tsig_key_t *key,
+                         const uint8_t *prev_digest, size_t prev_digest_len,
+                         const uint8_t *msg, size_t msg_len)
+{
+	if (!stream || !key || !msg) {
+		return KNOT_EINVAL;
 	}
 
-	/* Compute digest. */
-	ret = compute_digest(wire, wire_len,
-	                               digest, digest_len, key);
+	int ret = stream_begin(stream, key, prev_digest, prev_digest_len, true);
 	if (ret != KNOT_EOK) {
-		*digest_len = 0;
-		free(wire);
 		return ret;
 	}
 
-	free(wire);
+	digest_add(stream->hmac, msg, msg_len);
+	stream->pending += 1;
 
 	return KNOT_EOK;
 }
@@ -403,11 +428,10 @@ int knot_tsig_sign(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
 	uint8_t digest_tmp[KNOT_TSIG_MAX_DIGEST_SIZE];
 	size_t digest_tmp_len = 0;
 
-	int ret = KNOT_ERROR;
-	ret = create_sign_wire(msg, *msg_len, /*msg_max_len,*/
-	                                     request_mac, request_mac_len,
-	                                     digest_tmp, &digest_tmp_len,
-					     tmp_tsig, key);
+	knot_tsig_stream_t stream = { 0 };
+	int ret = stream_digest(&stream, msg, *msg_len, request_mac, request_mac_len,
+	                        digest_tmp, &digest_tmp_len, tmp_tsig, key, false);
+	knot_tsig_stream_clear(&stream);
 	if (ret != KNOT_EOK) {
 		knot_rrset_free(&tmp_tsig, NULL);
 		return ret;
@@ -442,12 +466,12 @@ int knot_tsig_sign(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
 	return KNOT_EOK;
 }
 
-_public_
-int knot_tsig_sign_next(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
-                        const uint8_t *prev_digest, size_t prev_digest_len,
-                        uint8_t *digest, size_t *digest_len,
-                        const knot_tsig_key_t *key, uint8_t *to_sign,
-                        size_t to_sign_len)
+static int sign_next(knot_tsig_stream_t *stream,
+                     uint8_t *msg, size_t *msg_len, size_t msg_max_len,
+                     const uint8_t *prev_digest, size_t prev_digest_len,
+                     uint8_t *digest, size_t *digest_len,
+                     const knot_tsig_key_t *key, const uint8_t *to_sign,
+                     size_t to_sign_len)
 {
 	if (!msg || !msg_len || !key || !digest || !digest_len) {
 		return KNOT_EINVAL;
@@ -468,32 +492,9 @@ int knot_tsig_sign_next(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
 	knot_tsig_rdata_set_time_signed(tmp_tsig, time(NULL));
 	knot_tsig_rdata_set_fudge(tmp_tsig, KNOT_TSIG_FUDGE_DEFAULT);
 
-	/* Create wire to be signed. */
-	size_t wire_len = prev_digest_len + to_sign_len
-	                  + KNOT_TSIG_TIMERS_LENGTH + 2;
-	uint8_t *wire = malloc(wire_len);
-	if (!wire) {
-		knot_rrset_free(&tmp_tsig, NULL);
-		return KNOT_ENOMEM;
-	}
-	memset(wire, 0, wire_len);
-
-	/* Write previous digest length. */
-	wire_write_u16(wire, prev_digest_len);
-	/* Write previous digest. */
-	memcpy(wire + 2, prev_digest, sizeof(uint8_t) * prev_digest_len);
-	/* Write original message. */
-	memcpy(wire + prev_digest_len + 2, to_sign, to_sign_len);
-	/* Write timers. */
-	wire_write_timers(wire + prev_digest_len + to_sign_len + 2,
-	                            tmp_tsig);
-
-	int ret = KNOT_ERROR;
-	ret = compute_digest(wire, wire_len,
-	                               digest_tmp, &digest_tmp_len, key);
-
-	/* No matter how the function did, this data is no longer needed. */
-	free(wire);
+	int ret = stream_digest(stream, to_sign, to_sign_len,
+	                        prev_digest, prev_digest_len,
+	                        digest_tmp, &digest_tmp_len, tmp_tsig, key, true);
 	if (ret != KNOT_EOK) {
 		knot_rrset_free(&tmp_tsig, NULL);
 		*digest_len = 0;
@@ -537,7 +538,40 @@ int knot_tsig_sign_next(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
 	return KNOT_EOK;
 }
 
-static int check_digest(const knot_rrset_t *tsig_rr,
+_public_
+int knot_tsig_sign_next(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
+                        const uint8_t *prev_digest, size_t prev_digest_len,
+                        uint8_t *digest, size_t *digest_len,
+                        const knot_tsig_key_t *key, uint8_t *to_sign,
+                        size_t to_sign_len)
+{
+	knot_tsig_stream_t stream = { 0 };
+	int ret = sign_next(&stream, msg, msg_len, msg_max_len,
+	                    prev_digest, prev_digest_len, digest, digest_len,
+	                    key, to_sign, to_sign_len);
+	knot_tsig_stream_clear(&stream);
+
+	return ret;
+}
+
+_public_
+int knot_tsig_sign_next_stream(knot_tsig_stream_t *stream,
+                               uint8_t *msg, size_t *msg_len, size_t msg_max_len,
+                               const uint8_t *prev_digest, size_t prev_digest_len,
+                               uint8_t *digest, size_t *digest_len,
+                               const knot_tsig_key_t *key)
+{
+	if (!stream || !msg_len) {
+		return KNOT_EINVAL;
+	}
+
+	return sign_next(stream, msg, msg_len, msg_max_len,
+	                 prev_digest, prev_digest_len, digest, digest_len,
+	                 key, msg, *msg_len);
+}
+
+static int check_digest(knot_tsig_stream_t *stream,
+                        const knot_rrset_t *tsig_rr,
                         const uint8_t *wire, size_t size,
                         const uint8_t *request_mac, size_t request_mac_len,
                         const knot_tsig_key_t *tsig_key,
@@ -570,34 +604,14 @@ static int check_digest(const knot_rrset_t *tsig_rr,
 		return ret;
 	}
 
-	uint8_t *wire_to_sign = malloc(sizeof(uint8_t) * size);
-	if (!wire_to_sign) {
-		return KNOT_ENOMEM;
-	}
-
-	memset(wire_to_sign, 0, sizeof(uint8_t) * size);
-	memcpy(wire_to_sign, wire, size);
-
 	uint8_t digest_tmp[KNOT_TSIG_MAX_DIGEST_SIZE];
 	size_t digest_tmp_len = 0;
 	assert(tsig_rr->rrs.rr_count > 0);
 
-	if (use_times) {
-		/* Wire is not a single packet, TSIG RRs must be stripped already. */
-		ret = create_sign_wire_next(wire_to_sign, size,
-		                                 request_mac, request_mac_len,
-		                                 digest_tmp, &digest_tmp_len,
-		                                 tsig_rr, tsig_key);
-	} else {
-		ret = create_sign_wire(wire_to_sign, size,
-		                            request_mac, request_mac_len,
-		                            digest_tmp, &digest_tmp_len,
-		                            tsig_rr, tsig_key);
-	}
-
-	assert(tsig_rr->rrs.rr_count > 0);
-	free(wire_to_sign);
-
+	/* Wire is a single packet, TSIG RR must be stripped already. */
+	ret = stream_digest(stream, wire, size, request_mac, request_mac_len,
+	                    digest_tmp, &digest_tmp_len, tsig_rr, tsig_key,
+	                    use_times);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -623,13 +637,50 @@ static int check_digest(const knot_rrset_t *tsig_rr,
 	return KNOT_EOK;
 }
 
+/*! \brief Check the digest with a temporary stream. */
+static int check_digest_once(const knot_rrset_t *tsig_rr,
+                             const uint8_t *wire, size_t size,
+                             const uint8_t *request_mac, size_t request_mac_len,
+                             const knot_tsig_key_t *tsig_key,
+                             uint64_t prev_time_signed, int use_times)
+{
+	knot_tsig_stream_t stream = { 0 };
+	int ret = check_digest(&stream, tsig_rr, wire, size, request_mac,
+	                       request_mac_len, tsig_key, prev_time_signed,
+	                       use_times);
+	knot_tsig_stream_clear(&stream);
+
+	return ret;
+}
+
+/*! \brief Check the digest with a session stream, drop it if failed. */
+static int check_digest_stream(knot_tsig_stream_t *stream,
+                               const knot_rrset_t *tsig_rr,
+                               const uint8_t *wire, size_t size,
+                               const uint8_t *request_mac, size_t request_mac_len,
+                               const knot_tsig_key_t *tsig_key,
+                               uint64_t prev_time_signed, int use_times)
+{
+	if (stream == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = check_digest(stream, tsig_rr, wire, size, request_mac,
+	                       request_mac_len, tsig_key, prev_time_signed,
+	                       use_times);
+	if (ret != KNOT_EOK) {
+		stream_fail(stream);
+	}
+
+	return ret;
+}
+
 _public_
 int knot_tsig_server_check(const knot_rrset_t *tsig_rr,
                            const uint8_t *wire, size_t size,
                            const knot_tsig_key_t *tsig_key)
 {
-	return check_digest(tsig_rr, wire, size, NULL, 0, tsig_key,
-	                              0, 0);
+	return check_digest_once(tsig_rr, wire, size, NULL, 0, tsig_key, 0, 0);
 }
 
 _public_
@@ -639,9 +690,8 @@ int knot_tsig_client_check(const knot_rrset_t *tsig_rr,
                            const knot_tsig_key_t *tsig_key,
                            uint64_t prev_time_signed)
 {
-	return check_digest(tsig_rr, wire, size, request_mac,
-	                              request_mac_len, tsig_key,
-	                              prev_time_signed, 0);
+	return check_digest_once(tsig_rr, wire, size, request_mac,
+	                         request_mac_len, tsig_key, prev_time_signed, 0);
 }
 
 _public_
@@ -652,9 +702,34 @@ int knot_tsig_client_check_next(const knot_rrset_t *tsig_rr,
                                 const knot_tsig_key_t *tsig_key,
                                 uint64_t prev_time_signed)
 {
-	return check_digest(tsig_rr, wire, size, prev_digest,
-	                              prev_digest_len, tsig_key,
-	                              prev_time_signed, 1);
+	return check_digest_once(tsig_rr, wire, size, prev_digest,
+	                         prev_digest_len, tsig_key, prev_time_signed, 1);
+}
+
+_public_
+int knot_tsig_client_check_stream(knot_tsig_stream_t *stream,
+                                  const knot_rrset_t *tsig_rr,
+                                  const uint8_t *wire, size_t size,
+                                  const uint8_t *request_mac,
+                                  size_t request_mac_len,
+                                  const knot_tsig_key_t *tsig_key,
+                                  uint64_t prev_time_signed)
+{
+	return check_digest_stream(stream, tsig_rr, wire, size, request_mac,
+	                           request_mac_len, tsig_key, prev_time_signed, 0);
+}
+
+_public_
+int knot_tsig_client_check_next_stream(knot_tsig_stream_t *stream,
+                                       const knot_rrset_t *tsig_rr,
+                                       const uint8_t *wire, size_t size,
+                                       const uint8_t *prev_digest,
+                                       size_t prev_digest_len,
+                                       const knot_tsig_key_t *tsig_key,
+                                       uint64_t prev_time_signed)
+{
+	return check_digest_stream(stream, tsig_rr, wire, size, prev_digest,
+	                           prev_digest_len, tsig_key, prev_time_signed, 1);
 }
 
 _public_
@@ -27,8 +27,30 @@
 #include <stdint.h>
 
 #include "libknot/rrtype/tsig.h"
+#include "libknot/tsig.h"
 #include "libknot/rrset.h"
 
+/*!
+ * \brief Running TSIG digest of a multi-message session.
+ *
+ * The HMAC context is created for the session key once and reused for all
+ * the messages. Messages left unsigned (RFC 2845, section 4.4) are added to
+ * the digest as they come, the next signed message covers them.
+ */
+typedef struct knot_tsig_stream knot_tsig_stream_t;
+
+/*!
+ * \brief Create a running digest for a session.
+ *
+ * \return New running digest or NULL if out of memory.
+ */
+knot_tsig_stream_t *knot_tsig_stream_new(void);
+
+/*!
+ * \brief Free the running digest.
+ */
+void knot_tsig_stream_free(knot_tsig_stream_t *stream);
+
 /*!
  * \brief Generate TSIG signature of a message.
  *
@@ -97,6 +119,62 @@ int knot_tsig_sign_next(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
                         const knot_tsig_key_t *key, uint8_t *to_sign,
                         size_t to_sign_len);
 
+/*!
+ * \brief Generate TSIG signature of a 2nd or later message in a TCP session
+ *        using a running digest.
+ *
+ * Same as knot_tsig_sign_next(), except that the HMAC context of the stream
+ * is reused and the digest also covers the unsigned messages added to the
+ * stream since the previous signed message.
+ *
+ * \param stream Running digest of the session.
+ * \param msg Message to be signed.
+ * \param msg_len Size of the message in bytes.
+ * \param msg_max_len Maximum size of the message in bytes.
+ * \param prev_digest Previous digest sent by the server in the session.
+ * \param prev_digest_len Size of the previous digest in bytes.
+ * \param digest Buffer to save the digest in.
+ * \param digest_len In: size of the buffer. Out: real size of the digest saved.
+ * \param key Key of the session.
+ *
+ * \retval KNOT_EOK if successful.
+ */
+int knot_tsig_sign_next_stream(knot_tsig_stream_t *stream,
+                               uint8_t *msg, size_t *msg_len, size_t msg_max_len,
+                               const uint8_t *prev_digest, size_t prev_digest_len,
+                               uint8_t *digest, size_t *digest_len,
+                               const knot_tsig_key_t *key);
+
+/*!
+ * \brief Add a message, which is not signed, to the running digest.
+ *
+ * RFC 2845 (section 4.4) allows the intermediate messages in a TCP session
+ * to be unsigned, the next signed message covers them. The message is hashed
+ * right away, so it doesn't have to be kept.
+ *
+ * \param stream Running digest of the session.
+ * \param key Key of the session.
+ * \param prev_digest Digest of the last signed message in the session.
+ * \param prev_digest_len Size of the previous digest in bytes.
+ * \param msg Message wire (without TSIG RR).
+ * \param msg_len Size of the message in bytes.
+ *
+ * \retval KNOT_EOK if successful.
+ */
+int knot_tsig_stream_add(knot_tsig_stream_t *stream, const knot_tsig_key_t *key,
+                         const uint8_t *prev_digest, size_t prev_digest_len,
+                         const uint8_t *msg, size_t msg_len);
+
+/*!
+ * \brief Free the HMAC context of the running digest and reset it.
+ */
+void knot_tsig_stream_clear(knot_tsig_stream_t *stream);
+
+/*!
+ * \brief Get the number of unsigned messages added since the last MAC.
+ */
+unsigned knot_tsig_stream_pending(const knot_tsig_stream_t *stream);
+
 /*!
  * \brief Checks incoming request.
  *
@@ -157,6 +235,39 @@ int knot_tsig_client_check_next(const knot_rrset_t *tsig_rr,
                                 const knot_tsig_key_t *key,
                                 uint64_t prev_time_signed);
 
+/*!
+ * \brief Checks incoming response using a running digest.
+ *
+ * Same as knot_tsig_client_check(), but the digest also covers the unsigned
+ * messages added to the stream before.
+ *
+ * \note The stream is reset if the check fails.
+ */
+int knot_tsig_client_check_stream(knot_tsig_stream_t *stream,
+                                  const knot_rrset_t *tsig_rr,
+                                  const uint8_t *wire, size_t size,
+                                  const uint8_t *request_mac,
+                                  size_t request_mac_len,
+                                  const knot_tsig_key_t *key,
+                                  uint64_t prev_time_signed);
+
+/*!
+ * \brief Checks signature of 2nd or next packet in a TCP session using
+ *        a running digest.
+ *
+ * Same as knot_tsig_client_check_next(), but the digest also covers the
+ * unsigned messages added to the stream since the previous signed one.
+ *
+ * \note The stream is reset if the check fails.
+ */
+int knot_tsig_client_check_next_stream(knot_tsig_stream_t *stream,
+                                       const knot_rrset_t *tsig_rr,
+                                       const uint8_t *wire, size_t size,
+                                       const uint8_t *prev_digest,
+                                       size_t prev_digest_len,
+                                       const knot_tsig_key_t *key,
+                                       uint64_t prev_time_signed);
+
 /*!
  * \todo Documentation!
  */
@@ -20,6 +20,7 @@
 #include <poll.h>
 #include <stdlib.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 
 #ifdef HAVE_SYS_UIO_H
@@ -251,6 +252,19 @@ int net_connect(net_t *net)
 		int       cs, err = 0;
 		socklen_t err_len = sizeof(err);
 
+		// Defer the connection request to the first write.
+		if (net->fastopen) {
+#ifdef TCP_FASTOPEN_CONNECT
+			const int on = 1;
+			if (setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT,
+			               &on, sizeof(on)) == -1) {
+				WARN("can't use TCP Fast Open for %s\n", net->remote_str);
+			}
+#else
+			WARN("TCP Fast Open is not supported\n");
+#endif
+		}
+
 		// Connect using socket.
 		if (connect(sockfd, net->srv->ai_addr, net->srv->ai_addrlen)
 		    == -1 && errno != EINPROGRESS) {
@@ -361,7 +375,21 @@ int net_send(const net_t *net, const uint8_t *buf, const size_t buf_len)
 		ssize_t total = iov[0].iov_len + iov[1].iov_len;
 
 		// Send data.
-		if (writev(net->sockfd, iov, 2) != total) {
+		ssize_t ret = writev(net->sockfd, iov, 2);
+
+		// Wait for the connection if the Fast Open cookie isn't known.
+		if (ret == -1 && errno == EINPROGRESS) {
+			struct pollfd pfd = {
+				.fd = net->sockfd,
+				.events = POLLOUT,
+				.revents = 0,
+			};
+			if (poll(&pfd, 1, 1000 * net->wait) == 1) {
+				ret = writev(net->sockfd, iov, 2);
+			}
+		}
+
+		if (ret != total) {
 			WARN("can't send query to %s\n", net->remote_str);
 			return KNOT_NET_ESEND;
 		}
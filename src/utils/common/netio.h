@@ -51,6 +51,8 @@ typedef struct {
 	int	socktype;
 	/*! Timeout for all network operations. */
 	int	wait;
+	/*! Use TCP Fast Open. */
+	bool	fastopen;
 
 	/*! Local interface parameters. */
 	const srv_info_t *local;
@@ -20,6 +20,7 @@
 #include <sys/time.h>
 
 #include "utils/kdig/kdig_exec.h"
+#include "utils/kdig/kdig_load.h"
 #include "utils/common/exec.h"
 #include "utils/common/msg.h"
 #include "utils/common/netio.h"
@@ -301,7 +302,7 @@ static bool use_edns(const query_t *query)
 	       query->padding > -1 || query->alignment > 0;
 }
 
-static knot_pkt_t *create_query_packet(const query_t *query)
+knot_pkt_t *create_query_packet(const query_t *query)
 {
 	// Set packet buffer size.
 	uint16_t max_size;
@@ -705,6 +706,7 @@ static void process_query(const query_t *query)
 			if (ret != KNOT_EOK) {
 				continue;
 			}
+			net.fastopen = query->fastopen;
 
 			// Loop over all resolved addresses for remote.
 			while (net.srv != NULL) {
@@ -990,6 +992,7 @@ static void process_xfr(const query_t *query)
 		knot_pkt_free(&out_packet);
 		return;
 	}
+	net.fastopen = query->fastopen;
 
 	// Loop over all resolved addresses for remote.
 	while (net.srv != NULL) {
@@ -1043,6 +1046,9 @@ int kdig_exec(const kdig_params_t *params)
 #endif // USE_DNSTAP
 		case OPERATION_LIST_SOA:
 			break;
+		case OPERATION_LOAD:
+			process_load(query);
+			break;
 		default:
 			ERR("unsupported operation\n");
 			break;
@@ -29,6 +29,15 @@
 #include "utils/common/params.h"
 #include "utils/kdig/kdig_params.h"
 
+/*!
+ * \brief Creates a query packet according to the query parameters.
+ *
+ * \param query  Query parameters.
+ *
+ * \return New packet or NULL on error.
+ */
+knot_pkt_t *create_query_packet(const query_t *query);
+
 int kdig_exec(const kdig_params_t *params);
 
 /*! @} */
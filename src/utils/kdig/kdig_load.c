@@ -0,0 +1,965 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "utils/kdig/kdig_load.h"
+#include "utils/kdig/kdig_exec.h"
+#include "utils/common/msg.h"
+#include "utils/common/netio.h"
+#include "utils/common/sign.h"
+#include "libknot/libknot.h"
+#include "contrib/getline.h"
+#include "contrib/hist.h"
+#include "contrib/macros.h"
+#include "contrib/time.h"
+#include "contrib/wire.h"
+
+#define LOAD_BATCH	64			/*!< Messages per syscall. */
+#define LOAD_IDS	(UINT16_MAX + 1)	/*!< Query IDs per thread. */
+#define LOAD_RCODES	16			/*!< Header RCODE values. */
+#define LOAD_SWEEP	(100 * 1000000ULL)	/*!< Timeout check period (ns). */
+#define LOAD_SOCKBUF	(4 * 1024 * 1024)	/*!< UDP socket buffer size. */
+
+/*! \brief Pre-built query messages. */
+typedef struct {
+	uint8_t *wire;		/*!< Concatenated messages. */
+	size_t wire_len;
+	size_t wire_max;
+	size_t *offset;		/*!< Message offsets in the wire. */
+	uint16_t *size;		/*!< Message sizes. */
+	size_t count;
+	size_t max;
+	uint16_t max_size;	/*!< Largest message size. */
+} load_pool_t;
+
+/*! \brief Shared load context. */
+typedef struct {
+	const query_t *query;
+	load_pool_t pool;
+	const struct addrinfo *remote;
+	const struct addrinfo *local;
+	int socktype;
+	uint64_t start;		/*!< Start of the sending phase (ns). */
+	uint64_t duration;	/*!< Length of the sending phase (ns). */
+	uint64_t timeout;	/*!< Reply timeout (ns). */
+} load_ctx_t;
+
+/*! \brief Load statistics. */
+typedef struct {
+	uint64_t sent;
+	uint64_t received;
+	uint64_t lost;
+	uint64_t truncated;
+	uint64_t unexpected;	/*!< Late, duplicate or malformed replies. */
+	uint64_t errors;	/*!< Socket errors and reconnections. */
+	uint64_t connections;	/*!< Established TCP connections. */
+	uint64_t rcode[LOAD_RCODES];
+	hist_t latency;		/*!< Reply latency (ns). */
+	hist_t setup;		/*!< TCP connection setup time (ns). */
+} load_stats_t;
+
+/*! \brief Load thread state. */
+typedef struct {
+	pthread_t thread;
+	const load_ctx_t *ctx;
+	unsigned index;
+	uint64_t rate;		/*!< Thread share of the rate (0 ~ unlimited). */
+	int fd;
+	uint64_t rnd;		/*!< Random prefix selection state. */
+	size_t next;		/*!< Next replayed query. */
+	uint16_t id;		/*!< Next query ID candidate. */
+	uint64_t *sent_at;	/*!< Send time by query ID (0 ~ not outstanding). */
+	size_t outstanding;
+	sign_context_t sign;
+	uint8_t *tx;		/*!< Output buffer. */
+	size_t tx_slot;		/*!< Output buffer size per message. */
+	size_t tx_len;		/*!< TCP output length. */
+	size_t tx_off;		/*!< TCP output already sent. */
+	size_t conn_sent;	/*!< Queries sent over the TCP connection. */
+	uint8_t *rx;		/*!< Input buffer. */
+	size_t rx_slot;		/*!< Input buffer size per message. */
+	size_t rx_len;		/*!< TCP input length. */
+	load_stats_t stats;
+} load_thread_t;
+
+static uint64_t now_ns(void)
+{
+	timev_t now;
+	time_now(&now);
+#ifdef HAVE_CLOCK_GETTIME
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#else
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_usec * 1000;
+#endif
+}
+
+static uint64_t rnd_next(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 2685821657736338717ULL;
+}
+
+static int pool_add(load_pool_t *pool, const query_t *query,
+                    const char *owner, uint16_t type)
+{
+	// Reuse all the query settings except for the question.
+	query_t tmp = *query;
+	tmp.owner = (char *)owner;
+	if (tmp.type_num != type) {
+		tmp.type_num = type;
+		tmp.serial = -1;
+	}
+
+	knot_pkt_t *pkt = create_query_packet(&tmp);
+	if (pkt == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (pool->count == pool->max) {
+		size_t max = MAX(pool->max * 2, 64);
+		size_t *offset = realloc(pool->offset, max * sizeof(*offset));
+		if (offset == NULL) {
+			knot_pkt_free(&pkt);
+			return KNOT_ENOMEM;
+		}
+		pool->offset = offset;
+		uint16_t *size = realloc(pool->size, max * sizeof(*size));
+		if (size == NULL) {
+			knot_pkt_free(&pkt);
+			return KNOT_ENOMEM;
+		}
+		pool->size = size;
+		pool->max = max;
+	}
+
+	if (pool->wire_len + pkt->size > pool->wire_max) {
+		size_t max = MAX(pool->wire_max * 2, pool->wire_len + pkt->size);
+		uint8_t *wire = realloc(pool->wire, max);
+		if (wire == NULL) {
+			knot_pkt_free(&pkt);
+			return KNOT_ENOMEM;
+		}
+		pool->wire = wire;
+		pool->wire_max = max;
+	}
+
+	memcpy(pool->wire + pool->wire_len, pkt->wire, pkt->size);
+	pool->offset[pool->count] = pool->wire_len;
+	pool->size[pool->count] = pkt->size;
+	pool->max_size = MAX(pool->max_size, pkt->size);
+	pool->wire_len += pkt->size;
+	pool->count++;
+
+	knot_pkt_free(&pkt);
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Loads queries from a file.
+ *
+ * Each line contains a query name optionally followed by a type.
+ * Empty lines and lines starting with '#' are skipped.
+ */
+static int pool_load_file(load_pool_t *pool, const query_t *query)
+{
+	FILE *file = fopen(query->load.file, "r");
+	if (file == NULL) {
+		ERR("can't open query file %s\n", query->load.file);
+		return KNOT_EACCES;
+	}
+
+	int ret = KNOT_EOK;
+	char *line = NULL;
+	size_t line_size = 0;
+	size_t line_num = 0;
+	while (knot_getline(&line, &line_size, file) != -1) {
+		line_num++;
+
+		char *save = NULL;
+		char *name = strtok_r(line, " \t\r\n", &save);
+		if (name == NULL || name[0] == '#') {
+			continue;
+		}
+
+		uint16_t type = query->type_num;
+		char *type_str = strtok_r(NULL, " \t\r\n", &save);
+		if (type_str != NULL &&
+		    knot_rrtype_from_string(type_str, &type) != 0) {
+			ERR("invalid type on line %zu of %s\n", line_num,
+			    query->load.file);
+			ret = KNOT_EINVAL;
+			break;
+		}
+
+		ret = pool_add(pool, query, name, type);
+		if (ret != KNOT_EOK) {
+			ERR("invalid query on line %zu of %s\n", line_num,
+			    query->load.file);
+			break;
+		}
+	}
+
+	free(line);
+	fclose(file);
+
+	if (ret == KNOT_EOK && pool->count == 0) {
+		ERR("no queries in %s\n", query->load.file);
+		return KNOT_ENOENT;
+	}
+
+	return ret;
+}
+
+static int pool_init(load_pool_t *pool, const query_t *query)
+{
+	memset(pool, 0, sizeof(*pool));
+
+	if (query->load.file != NULL) {
+		return pool_load_file(pool, query);
+	}
+
+	if (query->load.names == 0) {
+		return pool_add(pool, query, query->owner, query->type_num);
+	}
+
+	// Synthetic names <prefix>.<owner> with a uniform distribution.
+	bool root = (strcmp(query->owner, ".") == 0);
+	for (uint32_t i = 0; i < query->load.names; i++) {
+		char name[KNOT_DNAME_TXT_MAXLEN + 1];
+		int ret = snprintf(name, sizeof(name), "l%"PRIu32".%s", i,
+		                   root ? "" : query->owner);
+		if (ret < 0 || ret >= sizeof(name)) {
+			return KNOT_ESPACE;
+		}
+
+		ret = pool_add(pool, query, name, query->type_num);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static void pool_deinit(load_pool_t *pool)
+{
+	free(pool->wire);
+	free(pool->offset);
+	free(pool->size);
+	memset(pool, 0, sizeof(*pool));
+}
+
+/*! \brief Returns the number of queries to be sent now. */
+static size_t send_count(const load_thread_t *t, uint64_t now)
+{
+	const load_ctx_t *ctx = t->ctx;
+
+	if (now >= ctx->start + ctx->duration) {
+		return 0;
+	}
+
+	size_t count = MIN(LOAD_BATCH, ctx->query->load.window - t->outstanding);
+	if (t->rate > 0) {
+		uint64_t due = (now - ctx->start) / 1000 * t->rate / 1000000 + 1;
+		count = (due > t->stats.sent) ? MIN(count, due - t->stats.sent) : 0;
+	}
+
+	return count;
+}
+
+/*! \brief Copies the next query into the buffer, assigns an ID and signs it. */
+static int prepare_query(load_thread_t *t, uint8_t *buf, size_t max_len,
+                         size_t *len, uint16_t *id)
+{
+	const load_ctx_t *ctx = t->ctx;
+	const load_pool_t *pool = &ctx->pool;
+
+	size_t idx;
+	if (ctx->query->load.names > 0) {
+		idx = rnd_next(&t->rnd) % pool->count;
+	} else {
+		idx = t->next++ % pool->count;
+	}
+
+	*len = pool->size[idx];
+	memcpy(buf, pool->wire + pool->offset[idx], *len);
+
+	// The window is smaller than the ID space, so there is a free one.
+	while (t->sent_at[t->id] != 0) {
+		t->id++;
+	}
+	*id = t->id++;
+	knot_wire_set_id(buf, *id);
+
+	if (t->sign.digest != NULL) {
+		size_t digest_size = t->sign.digest_size;
+		return knot_tsig_sign(buf, len, max_len, NULL, 0, t->sign.digest,
+		                      &digest_size, t->sign.tsig_key, 0, 0);
+	}
+
+	return KNOT_EOK;
+}
+
+static void mark_sent(load_thread_t *t, uint16_t id, uint64_t now)
+{
+	t->sent_at[id] = now;
+	t->outstanding++;
+	t->stats.sent++;
+}
+
+static void process_reply(load_thread_t *t, const uint8_t *wire, size_t len,
+                          uint64_t now)
+{
+	if (len < KNOT_WIRE_HEADER_SIZE || !knot_wire_get_qr(wire)) {
+		t->stats.unexpected++;
+		return;
+	}
+
+	uint16_t id = knot_wire_get_id(wire);
+	uint64_t sent = t->sent_at[id];
+	if (sent == 0) {
+		t->stats.unexpected++;
+		return;
+	}
+	t->sent_at[id] = 0;
+	t->outstanding--;
+
+	t->stats.received++;
+	if (knot_wire_get_tc(wire)) {
+		t->stats.truncated++;
+	}
+	t->stats.rcode[knot_wire_get_rcode(wire)]++;
+	hist_record(&t->stats.latency, now - sent);
+}
+
+/*! \brief Drops the outstanding queries older than the limit. */
+static void expire(load_thread_t *t, uint64_t limit, bool all)
+{
+	if (t->outstanding == 0) {
+		return;
+	}
+
+	for (size_t id = 0; id < LOAD_IDS; id++) {
+		uint64_t sent = t->sent_at[id];
+		if (sent != 0 && (all || sent < limit)) {
+			t->sent_at[id] = 0;
+			t->outstanding--;
+			t->stats.lost++;
+		}
+	}
+}
+
+static int load_socket(const load_ctx_t *ctx)
+{
+	int fd = socket(ctx->remote->ai_family, ctx->socktype, 0);
+	if (fd < 0) {
+		return -1;
+	}
+
+	// Send the first queries with the connection request.
+	if (ctx->socktype == SOCK_STREAM && ctx->query->fastopen) {
+#ifdef TCP_FASTOPEN_CONNECT
+		const int on = 1;
+		(void)setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof(on));
+#endif
+	}
+
+	if (ctx->local != NULL &&
+	    bind(fd, ctx->local->ai_addr, ctx->local->ai_addrlen) != 0) {
+		close(fd);
+		return -1;
+	}
+
+	if (ctx->socktype == SOCK_DGRAM) {
+		int size = LOAD_SOCKBUF;
+		(void)setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+		(void)setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	}
+
+	if (fcntl(fd, F_SETFL, O_NONBLOCK) == -1) {
+		close(fd);
+		return -1;
+	}
+
+	if (connect(fd, ctx->remote->ai_addr, ctx->remote->ai_addrlen) != 0) {
+		if (errno != EINPROGRESS) {
+			close(fd);
+			return -1;
+		}
+
+		// Wait for the TCP connection.
+		struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+		int err = 0;
+		socklen_t err_len = sizeof(err);
+		if (poll(&pfd, 1, ctx->timeout / 1000000) != 1 ||
+		    getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) != 0 ||
+		    err != 0) {
+			close(fd);
+			return -1;
+		}
+	}
+
+	return fd;
+}
+
+static void udp_send(load_thread_t *t, size_t count)
+{
+	struct iovec iov[LOAD_BATCH];
+	uint16_t ids[LOAD_BATCH];
+	size_t prepared = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		uint8_t *buf = t->tx + prepared * t->tx_slot;
+		size_t len;
+		if (prepare_query(t, buf, t->tx_slot, &len, &ids[prepared]) != KNOT_EOK) {
+			t->stats.errors++;
+			continue;
+		}
+		iov[prepared].iov_base = buf;
+		iov[prepared].iov_len = len;
+		prepared++;
+	}
+
+	uint64_t now = now_ns();
+	size_t sent = 0;
+	int ret = 0;
+#ifdef HAVE_SENDMMSG
+	struct mmsghdr msgs[LOAD_BATCH];
+	memset(msgs, 0, prepared * sizeof(*msgs));
+	for (size_t i = 0; i < prepared; i++) {
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	ret = sendmmsg(t->fd, msgs, prepared, 0);
+	if (ret > 0) {
+		sent = ret;
+	}
+#else
+	while (sent < prepared &&
+	       (ret = send(t->fd, iov[sent].iov_base, iov[sent].iov_len, 0)) > 0) {
+		sent++;
+	}
+#endif
+	if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+		t->stats.errors++;
+	}
+
+	for (size_t i = 0; i < sent; i++) {
+		mark_sent(t, ids[i], now);
+	}
+}
+
+static void udp_recv(load_thread_t *t)
+{
+	while (true) {
+		size_t received = 0;
+		size_t lens[LOAD_BATCH];
+#ifdef HAVE_RECVMMSG
+		struct iovec iov[LOAD_BATCH];
+		struct mmsghdr msgs[LOAD_BATCH];
+		memset(msgs, 0, sizeof(msgs));
+		for (size_t i = 0; i < LOAD_BATCH; i++) {
+			iov[i].iov_base = t->rx + i * t->rx_slot;
+			iov[i].iov_len = t->rx_slot;
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		int ret = recvmmsg(t->fd, msgs, LOAD_BATCH, MSG_DONTWAIT, NULL);
+		for (int i = 0; i < ret; i++) {
+			lens[received++] = msgs[i].msg_len;
+		}
+#else
+		while (received < LOAD_BATCH) {
+			ssize_t ret = recv(t->fd, t->rx + received * t->rx_slot,
+			                   t->rx_slot, MSG_DONTWAIT);
+			if (ret < 0) {
+				break;
+			}
+			lens[received++] = ret;
+		}
+#endif
+		if (received == 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				t->stats.errors++;
+			}
+			return;
+		}
+
+		uint64_t now = now_ns();
+		for (size_t i = 0; i < received; i++) {
+			process_reply(t, t->rx + i * t->rx_slot, lens[i], now);
+		}
+
+		if (received < LOAD_BATCH) {
+			return;
+		}
+	}
+}
+
+static int udp_run(load_thread_t *t)
+{
+	const load_ctx_t *ctx = t->ctx;
+	uint64_t end = ctx->start + ctx->duration;
+	uint64_t next_sweep = 0;
+
+	t->fd = load_socket(ctx);
+	if (t->fd < 0) {
+		return KNOT_NET_ECONNECT;
+	}
+
+	struct pollfd pfd = { .fd = t->fd, .events = POLLIN };
+
+	uint64_t now = now_ns();
+	while (now < end || (t->outstanding > 0 && now < end + ctx->timeout)) {
+		size_t count = send_count(t, now);
+		if (count > 0) {
+			udp_send(t, count);
+		}
+
+		if (poll(&pfd, 1, (count > 0) ? 0 : 1) > 0) {
+			udp_recv(t);
+		}
+
+		now = now_ns();
+		if (now >= next_sweep) {
+			expire(t, now - ctx->timeout, false);
+			next_sweep = now + LOAD_SWEEP;
+		}
+	}
+
+	expire(t, 0, true);
+	close(t->fd);
+
+	return KNOT_EOK;
+}
+
+static void tcp_reset(load_thread_t *t)
+{
+	if (t->fd >= 0) {
+		close(t->fd);
+		t->fd = -1;
+	}
+	t->tx_len = 0;
+	t->tx_off = 0;
+	t->rx_len = 0;
+
+	// Replies to the queries on the closed connection won't come.
+	expire(t, 0, true);
+}
+
+static void tcp_enqueue(load_thread_t *t, size_t count)
+{
+	uint64_t now = now_ns();
+	for (size_t i = 0; i < count; i++) {
+		uint8_t *buf = t->tx + t->tx_len;
+		size_t len;
+		uint16_t id;
+		if (prepare_query(t, buf + sizeof(uint16_t), t->tx_slot - sizeof(uint16_t),
+		                  &len, &id) != KNOT_EOK) {
+			t->stats.errors++;
+			continue;
+		}
+		wire_write_u16(buf, len);
+		t->tx_len += sizeof(uint16_t) + len;
+		mark_sent(t, id, now);
+	}
+}
+
+static bool tcp_send(load_thread_t *t)
+{
+	ssize_t ret = send(t->fd, t->tx + t->tx_off, t->tx_len - t->tx_off,
+	                   MSG_NOSIGNAL);
+	if (ret < 0) {
+		// In progress if the Fast Open cookie isn't known yet.
+		return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS);
+	}
+
+	t->tx_off += ret;
+	if (t->tx_off == t->tx_len) {
+		t->tx_off = 0;
+		t->tx_len = 0;
+	}
+
+	return true;
+}
+
+static bool tcp_recv(load_thread_t *t)
+{
+	ssize_t ret = recv(t->fd, t->rx + t->rx_len, t->rx_slot - t->rx_len,
+	                   MSG_DONTWAIT);
+	if (ret == 0) {
+		return false;
+	} else if (ret < 0) {
+		return (errno == EAGAIN || errno == EWOULDBLOCK);
+	}
+	t->rx_len += ret;
+
+	uint64_t now = now_ns();
+	size_t pos = 0;
+	while (t->rx_len - pos >= sizeof(uint16_t)) {
+		size_t len = wire_read_u16(t->rx + pos);
+		if (t->rx_len - pos < sizeof(uint16_t) + len) {
+			break;
+		}
+		process_reply(t, t->rx + pos + sizeof(uint16_t), len, now);
+		pos += sizeof(uint16_t) + len;
+	}
+
+	t->rx_len -= pos;
+	memmove(t->rx, t->rx + pos, t->rx_len);
+
+	return true;
+}
+
+static int tcp_run(load_thread_t *t)
+{
+	const load_ctx_t *ctx = t->ctx;
+	uint64_t end = ctx->start + ctx->duration;
+	uint64_t next_sweep = 0;
+
+	t->fd = -1;
+
+	uint32_t conn_queries = ctx->query->load.conn_queries;
+
+	uint64_t now = now_ns();
+	while (now < end || (t->outstanding > 0 && now < end + ctx->timeout)) {
+		if (t->fd < 0) {
+			t->fd = load_socket(ctx);
+			if (t->fd < 0) {
+				if (t->stats.sent == 0) {
+					return KNOT_NET_ECONNECT;
+				}
+				t->stats.errors++;
+				break;
+			}
+			t->conn_sent = 0;
+			t->stats.connections++;
+			uint64_t connected = now_ns();
+			hist_record(&t->stats.setup, connected - now);
+			now = connected;
+		}
+
+		// Enqueue the next batch when the previous one is written.
+		size_t count = 0;
+		if (t->tx_len == 0) {
+			count = send_count(t, now);
+			if (conn_queries > 0) {
+				count = MIN(count, conn_queries - t->conn_sent);
+			}
+			tcp_enqueue(t, count);
+			t->conn_sent += count;
+		}
+
+		struct pollfd pfd = {
+			.fd = t->fd,
+			.events = POLLIN | (t->tx_len > 0 ? POLLOUT : 0)
+		};
+		if (poll(&pfd, 1, (count > 0) ? 0 : 1) > 0) {
+			bool ok = true;
+			if (pfd.revents & POLLOUT) {
+				ok = tcp_send(t);
+			}
+			if (ok && (pfd.revents & (POLLIN | POLLHUP | POLLERR))) {
+				ok = tcp_recv(t);
+			}
+			if (!ok) {
+				t->stats.errors++;
+				tcp_reset(t);
+			}
+		}
+
+		// Reconnect when all the replies on the connection are received.
+		if (conn_queries > 0 && t->fd >= 0 && t->conn_sent >= conn_queries &&
+		    t->tx_len == 0 && t->outstanding == 0) {
+			tcp_reset(t);
+		}
+
+		now = now_ns();
+		if (now >= next_sweep) {
+			expire(t, now - ctx->timeout, false);
+			next_sweep = now + LOAD_SWEEP;
+		}
+	}
+
+	tcp_reset(t);
+
+	return KNOT_EOK;
+}
+
+static void *load_thread(void *arg)
+{
+	load_thread_t *t = arg;
+
+	int ret = (t->ctx->socktype == SOCK_STREAM) ? tcp_run(t) : udp_run(t);
+	if (ret != KNOT_EOK) {
+		ERR("load thread %u failed (%s)\n", t->index, knot_strerror(ret));
+	}
+
+	return NULL;
+}
+
+static int thread_init(load_thread_t *t, const load_ctx_t *ctx, unsigned index)
+{
+	const query_t *query = ctx->query;
+
+	memset(t, 0, sizeof(*t));
+	t->ctx = ctx;
+	t->index = index;
+	t->fd = -1;
+	t->rnd = index + 1;
+	t->next = index * ctx->pool.count / query->load.threads;
+	t->id = index * LOAD_IDS / query->load.threads;
+
+	// Spread the rate over the threads.
+	t->rate = query->load.rate / query->load.threads;
+	if (index < query->load.rate % query->load.threads) {
+		t->rate++;
+	}
+	if (query->load.rate > 0 && t->rate == 0) {
+		return KNOT_EINVAL;
+	}
+
+	size_t tsig_size = 0;
+	if (query->tsig_key.name != NULL) {
+		int ret = sign_context_init_tsig(&t->sign, &query->tsig_key);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		tsig_size = knot_tsig_wire_maxsize(&query->tsig_key);
+	}
+
+	t->tx_slot = sizeof(uint16_t) + ctx->pool.max_size + tsig_size;
+	if (ctx->socktype == SOCK_STREAM) {
+		t->rx_slot = 2 * (sizeof(uint16_t) + MAX_PACKET_SIZE);
+		t->rx = malloc(t->rx_slot);
+	} else {
+		t->rx_slot = MAX_PACKET_SIZE;
+		t->rx = malloc(LOAD_BATCH * t->rx_slot);
+	}
+	t->tx = malloc(LOAD_BATCH * t->tx_slot);
+	t->sent_at = calloc(LOAD_IDS, sizeof(*t->sent_at));
+	if (t->rx == NULL || t->tx == NULL || t->sent_at == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	return KNOT_EOK;
+}
+
+static void thread_deinit(load_thread_t *t)
+{
+	sign_context_deinit(&t->sign);
+	free(t->rx);
+	free(t->tx);
+	free(t->sent_at);
+}
+
+static void stats_merge(load_stats_t *dst, const load_stats_t *src)
+{
+	dst->sent += src->sent;
+	dst->received += src->received;
+	dst->lost += src->lost;
+	dst->truncated += src->truncated;
+	dst->unexpected += src->unexpected;
+	dst->errors += src->errors;
+	for (size_t i = 0; i < LOAD_RCODES; i++) {
+		dst->rcode[i] += src->rcode[i];
+	}
+	hist_merge(&dst->latency, &src->latency);
+	dst->connections += src->connections;
+	hist_merge(&dst->setup, &src->setup);
+}
+
+static void print_stats(const load_ctx_t *ctx, const load_stats_t *stats,
+                        const char *remote)
+{
+	const load_t *load = &ctx->query->load;
+	double seconds = ctx->duration / 1e9;
+
+	printf(";; Load to %s, %"PRIu32" thread(s), %"PRIu32" s, ",
+	       remote, load->threads, load->duration);
+	if (load->rate > 0) {
+		printf("rate %"PRIu32" qps, ", load->rate);
+	} else {
+		printf("unlimited rate, ");
+	}
+	printf("window %"PRIu32", ", load->window);
+	if (ctx->socktype == SOCK_STREAM && load->conn_queries > 0) {
+		printf("%"PRIu32" queries per connection, ", load->conn_queries);
+	}
+	printf("%zu distinct queries\n", ctx->pool.count);
+
+	printf(";; Sent:       %"PRIu64" (%.0f qps)\n", stats->sent,
+	       stats->sent / seconds);
+	printf(";; Received:   %"PRIu64" (%.0f qps)\n", stats->received,
+	       stats->received / seconds);
+	printf(";; Lost:       %"PRIu64" (%.2f %%)\n", stats->lost,
+	       stats->sent > 0 ? 100.0 * stats->lost / stats->sent : 0.0);
+	printf(";; Truncated:  %"PRIu64"\n", stats->truncated);
+	printf(";; Unexpected: %"PRIu64"\n", stats->unexpected);
+	printf(";; Errors:     %"PRIu64"\n", stats->errors);
+
+	printf(";; RCODEs:    ");
+	if (stats->received == 0) {
+		printf(" -");
+	}
+	for (size_t i = 0; i < LOAD_RCODES; i++) {
+		if (stats->rcode[i] == 0) {
+			continue;
+		}
+		const knot_lookup_t *rcode = knot_lookup_by_id(knot_rcode_names, i);
+		if (rcode != NULL) {
+			printf(" %s %"PRIu64, rcode->name, stats->rcode[i]);
+		} else {
+			printf(" RCODE%zu %"PRIu64, i, stats->rcode[i]);
+		}
+	}
+	printf("\n");
+
+	const hist_t *lat = &stats->latency;
+	printf(";; Latency ms: avg %.3f, p50 %.3f, p90 %.3f, p99 %.3f, "
+	       "p99.9 %.3f, max %.3f\n",
+	       lat->count > 0 ? lat->sum / 1e6 / lat->count : 0.0,
+	       hist_percentile(lat, 500) / 1e6, hist_percentile(lat, 900) / 1e6,
+	       hist_percentile(lat, 990) / 1e6, hist_percentile(lat, 999) / 1e6,
+	       lat->max / 1e6);
+
+	if (ctx->socktype != SOCK_STREAM) {
+		return;
+	}
+
+	const hist_t *setup = &stats->setup;
+	printf(";; Connections: %"PRIu64" (%.0f per second)\n",
+	       stats->connections, stats->connections / seconds);
+	printf(";; Setup ms:   avg %.3f, p50 %.3f, p90 %.3f, p99 %.3f, max %.3f\n",
+	       setup->count > 0 ? setup->sum / 1e6 / setup->count : 0.0,
+	       hist_percentile(setup, 500) / 1e6, hist_percentile(setup, 900) / 1e6,
+	       hist_percentile(setup, 990) / 1e6, setup->max / 1e6);
+}
+
+void process_load(const query_t *query)
+{
+	if (query == NULL) {
+		DBG_NULL;
+		return;
+	}
+
+	if (query->tls.enable) {
+		ERR("load generation over TLS is not supported\n");
+		return;
+	}
+
+	if (EMPTY_LIST(query->servers)) {
+		ERR("no server to load\n");
+		return;
+	}
+	srv_info_t *remote = HEAD(query->servers);
+
+	int iptype = get_iptype(query->ip);
+	int socktype = (query->protocol == PROTO_TCP) ? SOCK_STREAM : SOCK_DGRAM;
+
+	net_t net;
+	int ret = net_init(query->local, remote, iptype, socktype, query->wait,
+	                   NULL, &net);
+	if (ret != KNOT_EOK) {
+		ERR("can't resolve server %s@%s\n", remote->name, remote->service);
+		net_clean(&net);
+		return;
+	}
+
+	load_ctx_t ctx = {
+		.query = query,
+		.remote = net.srv,
+		.local = net.local_info,
+		.socktype = socktype,
+		.duration = query->load.duration * 1000000000ULL,
+		// Wait forever is limited to the load duration.
+		.timeout = (query->wait > 0 ? query->wait : query->load.duration) *
+		           1000000000ULL,
+	};
+
+	ret = pool_init(&ctx.pool, query);
+	if (ret != KNOT_EOK) {
+		ERR("can't prepare queries (%s)\n", knot_strerror(ret));
+		pool_deinit(&ctx.pool);
+		net_clean(&net);
+		return;
+	}
+
+	load_thread_t *threads = calloc(query->load.threads, sizeof(*threads));
+	if (threads == NULL) {
+		pool_deinit(&ctx.pool);
+		net_clean(&net);
+		return;
+	}
+
+	for (unsigned i = 0; i < query->load.threads; i++) {
+		ret = thread_init(&threads[i], &ctx, i);
+		if (ret != KNOT_EOK) {
+			ERR("can't initialize load thread (%s)\n", knot_strerror(ret));
+			goto cleanup;
+		}
+	}
+
+	ctx.start = now_ns();
+	unsigned started = 0;
+	for (; started < query->load.threads; started++) {
+		if (pthread_create(&threads[started].thread, NULL, load_thread,
+		                   &threads[started]) != 0) {
+			ERR("can't start load thread\n");
+			break;
+		}
+	}
+
+	load_stats_t *stats = calloc(1, sizeof(*stats));
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(threads[i].thread, NULL);
+		if (stats != NULL) {
+			stats_merge(stats, &threads[i].stats);
+		}
+	}
+
+	if (stats != NULL && started == query->load.threads) {
+		char *remote_str = NULL;
+		get_addr_str((struct sockaddr_storage *)net.srv->ai_addr,
+		             socktype, &remote_str);
+		print_stats(&ctx, stats, remote_str != NULL ? remote_str : remote->name);
+		free(remote_str);
+	}
+	free(stats);
+
+cleanup:
+	for (unsigned i = 0; i < query->load.threads; i++) {
+		thread_deinit(&threads[i]);
+	}
+	free(threads);
+	pool_deinit(&ctx.pool);
+	net_clean(&net);
+}
@@ -0,0 +1,40 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!
+ * \file
+ *
+ * \brief kdig load generator.
+ *
+ * The queries are pre-built from the query parameters (flags, EDNS, ...)
+ * and sent by several threads, each with its own socket, at a target rate.
+ * UDP uses batched send/receive, TCP uses one pipelined connection per thread.
+ *
+ * \addtogroup knot_utils
+ * @{
+ */
+
+#pragma once
+
+#include "utils/kdig/kdig_params.h"
+
+/*!
+ * \brief Generates load against the first server and prints the statistics.
+ *
+ * \param query  Query parameters including the load parameters.
+ */
+void process_load(const query_t *query);
+
+/*! @} */
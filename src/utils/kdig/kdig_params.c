@@ -38,6 +38,9 @@
 #define DEFAULT_RETRIES_DIG	2
 #define DEFAULT_TIMEOUT_DIG	5
 #define DEFAULT_ALIGNMENT_SIZE	128
+#define DEFAULT_LOAD_DURATION	10
+#define DEFAULT_LOAD_THREADS	1
+#define DEFAULT_LOAD_WINDOW	100
 
 static const flags_t DEFAULT_FLAGS_DIG = {
 	.aa_flag = false,
@@ -531,6 +534,24 @@ static int opt_noignore(const char *arg, void *query)
 	return KNOT_EOK;
 }
 
+static int opt_fastopen(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	q->fastopen = true;
+
+	return KNOT_EOK;
+}
+
+static int opt_nofastopen(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	q->fastopen = false;
+
+	return KNOT_EOK;
+}
+
 static int opt_tcp(const char *arg, void *query)
 {
 	query_t *q = query;
@@ -919,6 +940,168 @@ static int opt_noidn(const char *arg, void *query)
 	return KNOT_EOK;
 }
 
+static int opt_load(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	if (arg != NULL) {
+		if (str_to_u32(arg, &q->load.duration) != KNOT_EOK ||
+		    q->load.duration == 0) {
+			ERR("invalid +load=%s\n", arg);
+			return KNOT_EINVAL;
+		}
+	} else {
+		q->load.duration = DEFAULT_LOAD_DURATION;
+	}
+
+	q->operation = OPERATION_LOAD;
+
+	return KNOT_EOK;
+}
+
+static int opt_noload(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	q->load.duration = DEFAULT_LOAD_DURATION;
+	if (q->operation == OPERATION_LOAD) {
+		q->operation = OPERATION_QUERY;
+	}
+
+	return KNOT_EOK;
+}
+
+static int opt_qps(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	if (str_to_u32(arg, &q->load.rate) != KNOT_EOK) {
+		ERR("invalid +qps=%s\n", arg);
+		return KNOT_EINVAL;
+	}
+
+	return KNOT_EOK;
+}
+
+static int opt_noqps(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	q->load.rate = 0;
+
+	return KNOT_EOK;
+}
+
+static int opt_threads(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	if (str_to_u32(arg, &q->load.threads) != KNOT_EOK ||
+	    q->load.threads == 0) {
+		ERR("invalid +threads=%s\n", arg);
+		return KNOT_EINVAL;
+	}
+
+	return KNOT_EOK;
+}
+
+static int opt_nothreads(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	q->load.threads = DEFAULT_LOAD_THREADS;
+
+	return KNOT_EOK;
+}
+
+static int opt_window(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	// Query IDs must be unique within a thread.
+	if (str_to_u32(arg, &q->load.window) != KNOT_EOK ||
+	    q->load.window == 0 || q->load.window > UINT16_MAX) {
+		ERR("invalid +window=%s\n", arg);
+		return KNOT_EINVAL;
+	}
+
+	return KNOT_EOK;
+}
+
+static int opt_nowindow(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	q->load.window = DEFAULT_LOAD_WINDOW;
+
+	return KNOT_EOK;
+}
+
+static int opt_names(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	if (str_to_u32(arg, &q->load.names) != KNOT_EOK) {
+		ERR("invalid +names=%s\n", arg);
+		return KNOT_EINVAL;
+	}
+
+	return KNOT_EOK;
+}
+
+static int opt_nonames(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	q->load.names = 0;
+
+	return KNOT_EOK;
+}
+
+static int opt_conn(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	if (str_to_u32(arg, &q->load.conn_queries) != KNOT_EOK) {
+		ERR("invalid +conn=%s\n", arg);
+		return KNOT_EINVAL;
+	}
+
+	return KNOT_EOK;
+}
+
+static int opt_noconn(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	q->load.conn_queries = 0;
+
+	return KNOT_EOK;
+}
+
+static int opt_qfile(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	free(q->load.file);
+	q->load.file = strdup(arg);
+	if (q->load.file == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	return KNOT_EOK;
+}
+
+static int opt_noqfile(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	free(q->load.file);
+	q->load.file = NULL;
+
+	return KNOT_EOK;
+}
+
 static const param_t kdig_opts2[] = {
 	{ "multiline",      ARG_NONE,     opt_multiline },
 	{ "nomultiline",    ARG_NONE,     opt_nomultiline },
@@ -998,6 +1181,9 @@ static const param_t kdig_opts2[] = {
 	{ "ignore",         ARG_NONE,     opt_ignore },
 	{ "noignore",       ARG_NONE,     opt_noignore },
 
+	{ "fastopen",       ARG_NONE,     opt_fastopen },
+	{ "nofastopen",     ARG_NONE,     opt_nofastopen },
+
 	{ "tls",            ARG_NONE,     opt_tls },
 	{ "notls",          ARG_NONE,     opt_notls },
 
@@ -1034,6 +1220,27 @@ static const param_t kdig_opts2[] = {
 	{ "retry",          ARG_REQUIRED, opt_retry },
 	{ "noretry",        ARG_NONE,     opt_noretry },
 
+	{ "load",           ARG_OPTIONAL, opt_load },
+	{ "noload",         ARG_NONE,     opt_noload },
+
+	{ "qps",            ARG_REQUIRED, opt_qps },
+	{ "noqps",          ARG_NONE,     opt_noqps },
+
+	{ "threads",        ARG_REQUIRED, opt_threads },
+	{ "nothreads",      ARG_NONE,     opt_nothreads },
+
+	{ "window",         ARG_REQUIRED, opt_window },
+	{ "nowindow",       ARG_NONE,     opt_nowindow },
+
+	{ "names",          ARG_REQUIRED, opt_names },
+	{ "nonames",        ARG_NONE,     opt_nonames },
+
+	{ "conn",           ARG_REQUIRED, opt_conn },
+	{ "noconn",         ARG_NONE,     opt_noconn },
+
+	{ "qfile",          ARG_REQUIRED, opt_qfile },
+	{ "noqfile",        ARG_NONE,     opt_noqfile },
+
 	/* "idn" doesn't work since it must be called before query creation. */
 	{ "noidn",          ARG_NONE,     opt_noidn },
 
@@ -1073,6 +1280,7 @@ query_t *query_create(const char *owner, const query_t *conf)
 		query->retries = DEFAULT_RETRIES_DIG;
 		query->wait = DEFAULT_TIMEOUT_DIG;
 		query->ignore_tc = false;
+		query->fastopen = false;
 		query->class_num = -1;
 		query->type_num = -1;
 		query->serial = -1;
@@ -1085,6 +1293,13 @@ query_t *query_create(const char *owner, const query_t *conf)
 		query->padding = -1;
 		query->alignment = 0;
 		tls_params_init(&query->tls);
+		query->load.duration = DEFAULT_LOAD_DURATION;
+		query->load.rate = 0;
+		query->load.threads = DEFAULT_LOAD_THREADS;
+		query->load.window = DEFAULT_LOAD_WINDOW;
+		query->load.names = 0;
+		query->load.conn_queries = 0;
+		query->load.file = NULL;
 		//query->tsig_key
 		query->subnet = NULL;
 #if USE_DNSTAP
@@ -1111,6 +1326,7 @@ query_t *query_create(const char *owner, const query_t *conf)
 		query->retries = conf->retries;
 		query->wait = conf->wait;
 		query->ignore_tc = conf->ignore_tc;
+		query->fastopen = conf->fastopen;
 		query->class_num = conf->class_num;
 		query->type_num = conf->type_num;
 		query->serial = conf->serial;
@@ -1123,6 +1339,14 @@ query_t *query_create(const char *owner, const query_t *conf)
 		query->padding = conf->padding;
 		query->alignment = conf->alignment;
 		tls_params_copy(&query->tls, &conf->tls);
+		query->load = conf->load;
+		if (conf->load.file != NULL) {
+			query->load.file = strdup(conf->load.file);
+			if (query->load.file == NULL) {
+				query_free(query);
+				return NULL;
+			}
+		}
 		if (conf->tsig_key.name != NULL) {
 			int ret = knot_tsig_key_copy(&query->tsig_key,
 			                             &conf->tsig_key);
@@ -1196,6 +1420,7 @@ void query_free(query_t *query)
 	free(query->owner);
 	free(query->port);
 	free(query->subnet);
+	free(query->load.file);
 	free(query);
 }
 
@@ -1557,8 +1782,9 @@ void complete_queries(list_t *queries, const query_t *conf)
 		}
 
 		// Set zone transfer if any.
-		if (q->type_num == KNOT_RRTYPE_AXFR ||
-		    q->type_num == KNOT_RRTYPE_IXFR) {
+		if ((q->type_num == KNOT_RRTYPE_AXFR ||
+		     q->type_num == KNOT_RRTYPE_IXFR) &&
+		    q->operation != OPERATION_LOAD) {
 			q->operation = OPERATION_XFR;
 		}
 
@@ -1605,6 +1831,7 @@ static void print_help(void)
 	       "       +[no]ttl              Show TTL value.\n"
 	       "       +[no]tcp              Use TCP protocol.\n"
 	       "       +[no]ignore           Don't use TCP automatically if truncated.\n"
+	       "       +[no]fastopen         Use TCP Fast Open.\n"
 	       "       +[no]tls              Use TLS with Opportunistic privacy profile.\n"
 	       "       +[no]tls-ca[=FILE]    Use TLS with Out-Of-Band privacy profile.\n"
 	       "       +[no]tls-pin=BASE64   Use TLS with pinned certificate.\n"
@@ -1617,6 +1844,13 @@ static void print_help(void)
 	       "       +[no]edns[=N]         Use EDNS (=version).\n"
 	       "       +[no]time=T           Set wait for reply interval in seconds.\n"
 	       "       +[no]retry=N          Set number of retries.\n"
+	       "       +[no]load[=S]         Generate load for S seconds instead of a query.\n"
+	       "       +[no]qps=N            Set load target rate (queries per second).\n"
+	       "       +[no]threads=N        Set number of load threads.\n"
+	       "       +[no]window=N         Set maximal outstanding queries per load thread.\n"
+	       "       +[no]names=N          Use N distinct prefixes of load query name.\n"
+	       "       +[no]conn=N           Reconnect after N load queries over TCP.\n"
+	       "       +[no]qfile=FILE       Replay load queries from a file.\n"
 	       "       +noidn                Disable IDN transformation.\n"
 	       "\n"
 	       "       -h, --help            Print the program help.\n"
@@ -46,7 +46,9 @@ typedef enum {
 	/*!< Dump dnstap file. */
 	OPERATION_LIST_DNSTAP,
 	/*!< Query for NS and all authoritative SOA records. */
-	OPERATION_LIST_SOA
+	OPERATION_LIST_SOA,
+	/*!< Load generation (server benchmarking). */
+	OPERATION_LOAD
 } operation_t;
 
 /*! \brief DNS header and EDNS flags. */
@@ -69,6 +71,24 @@ typedef struct {
 	bool	do_flag;
 } flags_t;
 
+/*! \brief Load generation parameters. */
+typedef struct {
+	/*!< Duration of the sending phase in seconds. */
+	uint32_t	duration;
+	/*!< Target rate in queries per second (0 means unlimited). */
+	uint32_t	rate;
+	/*!< Number of sending threads (each with its own socket). */
+	uint32_t	threads;
+	/*!< Maximal number of outstanding queries per thread. */
+	uint32_t	window;
+	/*!< Number of distinct random name prefixes (0 means exact name). */
+	uint32_t	names;
+	/*!< Number of queries per TCP connection (0 means unlimited). */
+	uint32_t	conn_queries;
+	/*!< Query file to replay (optional). */
+	char		*file;
+} load_t;
+
 /*! \brief Basic parameters for DNS query. */
 typedef struct query query_t; // Forward declaration due to configuration.
 struct query {
@@ -98,6 +118,8 @@ struct query {
 	int32_t		wait;
 	/*!< Ignore truncated response. */
 	bool		ignore_tc;
+	/*!< Use TCP Fast Open. */
+	bool		fastopen;
 	/*!< Class number (16unsigned + -1 uninitialized). */
 	int32_t		class_num;
 	/*!< Type number (16unsigned + -1 uninitialized). */
@@ -126,6 +148,8 @@ struct query {
 	uint16_t	alignment;
 	/*!< TLS parameters. */
 	tls_params_t	tls;
+	/*!< Load generation parameters. */
+	load_t		load;
 #if USE_DNSTAP
 	/*!< Context for dnstap reader input. */
 	dt_reader_t	*dt_reader;
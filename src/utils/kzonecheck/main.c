@@ -34,6 +34,8 @@ static void print_help(void)
 	       " -o, --origin <zone_origin>           Zone name\n"
 	       "                                      (default filename or\n"
 	       "                                      filename without trailing .zone)\n"
+	       " -j, --jobs <num>                     Number of semantic checks threads\n"
+	       "                                      (default number of CPUs)\n"
 	       " -v, --verbose                        Enable debug output.\n"
 	       " -h, --help                           Print the program help.\n"
 	       " -V, --version                        Print the program version.\n"
@@ -47,10 +49,12 @@ int main(int argc, char *argv[])
 	char *zonename = NULL;
 	bool verbose = false;
 	FILE *outfile = stdout;
+	long jobs = sysconf(_SC_NPROCESSORS_ONLN);
 
 	/* Long options. */
 	struct option opts[] = {
 		{ "origin",  required_argument, NULL, 'o' },
+		{ "jobs",    required_argument, NULL, 'j' },
 		{ "verbose", no_argument,       NULL, 'v' },
 		{ "help",    no_argument,       NULL, 'h' },
 		{ "version", no_argument,       NULL, 'V' },
@@ -59,11 +63,19 @@ int main(int argc, char *argv[])
 
 	/* Parse command line arguments */
 	int opt = 0, li = 0;
-	while ((opt = getopt_long(argc, argv, "o:vVh", opts, &li)) != -1) {
+	while ((opt = getopt_long(argc, argv, "o:j:vVh", opts, &li)) != -1) {
 		switch (opt) {
 		case 'o':
 			zonename = strdup(optarg);
 			break;
+		case 'j':
+			jobs = strtol(optarg, NULL, 10);
+			if (jobs < 1) {
+				fprintf(stderr, "Invalid number of jobs '%s'.\n", optarg);
+				print_help();
+				return EXIT_FAILURE;
+			}
+			break;
 		case 'v':
 			verbose = true;
 			break;
@@ -109,7 +121,7 @@ int main(int argc, char *argv[])
 
 	knot_dname_t *dname = knot_dname_from_str_alloc(zonename);
 	free(zonename);
-	int ret = zone_check(filename, dname, outfile);
+	int ret = zone_check(filename, dname, outfile, (jobs > 0) ? jobs : 1);
 	knot_dname_free(&dname, NULL);
 
 	log_close();
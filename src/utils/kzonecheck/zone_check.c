@@ -78,7 +78,7 @@ static void print_statistics(err_handler_stats_t *handler)
 }
 
 int zone_check(const char *zone_file, const knot_dname_t *zone_name,
-               FILE *outfile)
+               FILE *outfile, unsigned threads)
 {
 	zloader_t zl;
 	int ret = zonefile_open(&zl, zone_file, zone_name, true);
@@ -93,6 +93,7 @@ int zone_check(const char *zone_file, const knot_dname_t *zone_name,
 
 	zl.err_handler = (err_handler_t *)&handler;
 	zl.creator->master = true;
+	zl.threads = threads;
 
 	zone_contents_t *contents;
 	contents = zonefile_load(&zl);
@@ -0,0 +1,508 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * NSEC/NSEC3 chain maintenance benchmark for dynamic updates.
+ *
+ * A synthetic zone with a complete chain is generated in memory. Each
+ * single-record update is applied to a fresh copy of the zone exactly as
+ * the DDNS processing does it, and the chain is then both repaired
+ * incrementally and recreated from scratch. The latencies of both are
+ * reported and the resulting chain changes are compared.
+ */
+
+#include <assert.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libknot/libknot.h"
+#include "knot/dnssec/nsec-chain.h"
+#include "knot/dnssec/nsec3-chain.h"
+#include "knot/nameserver/query_timing.h"
+#include "knot/updates/apply.h"
+#include "knot/updates/changesets.h"
+#include "knot/zone/contents.h"
+#include "contrib/hist.h"
+#include "contrib/wire_ctx.h"
+
+#define PROGRAM_NAME "bench-ddns"
+
+#define BENCH_ORIGIN   "example."
+#define BENCH_TTL      3600
+#define BENCH_GROUP    100   /*!< Hosts per empty non-terminal group. */
+
+#define DEFAULT_HOSTS      100000
+#define DEFAULT_UPDATES    100
+#define DEFAULT_ITERATIONS 10
+#define DEFAULT_SEED       1
+
+/*! \brief Update kinds, used in turns. */
+enum update_kind {
+	U_ADD = 0,   /*!< New host in an existing group. */
+	U_ADD_ENT,   /*!< New host in a new group (new empty non-terminal). */
+	U_REMOVE,    /*!< Removal of an existing host. */
+	U_KINDS
+};
+
+static const char *kind_names[U_KINDS] = {
+	[U_ADD]     = "add",
+	[U_ADD_ENT] = "add-ent",
+	[U_REMOVE]  = "remove",
+};
+
+typedef struct {
+	bool nsec3;
+	dnssec_nsec3_params_t params;
+	uint32_t ttl;
+} bench_chain_t;
+
+/*! \brief Simple reproducible PRNG (xorshift64*). */
+static uint64_t rnd_next(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 2685821657736338717ULL;
+}
+
+static knot_rrset_t *make_rr(const char *owner, uint16_t type,
+                             const uint8_t *rdata, uint16_t rdata_len)
+{
+	knot_dname_t *name = knot_dname_from_str_alloc(owner);
+	if (name == NULL) {
+		return NULL;
+	}
+
+	knot_rrset_t *rr = knot_rrset_new(name, type, KNOT_CLASS_IN, NULL);
+	knot_dname_free(&name, NULL);
+	if (rr == NULL) {
+		return NULL;
+	}
+
+	if (knot_rrset_add_rdata(rr, rdata, rdata_len, BENCH_TTL, NULL) != KNOT_EOK) {
+		knot_rrset_free(&rr, NULL);
+		return NULL;
+	}
+
+	return rr;
+}
+
+static knot_rrset_t *make_host(const char *owner, unsigned id)
+{
+	uint8_t addr[4] = { 10, id >> 16, id >> 8, id };
+	return make_rr(owner, KNOT_RRTYPE_A, addr, sizeof(addr));
+}
+
+static int add_rr(zone_contents_t *zone, knot_rrset_t *rr)
+{
+	if (rr == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	zone_node_t *node = NULL;
+	int ret = zone_contents_add_rr(zone, rr, &node);
+	knot_rrset_free(&rr, NULL);
+
+	return ret;
+}
+
+/*! \brief Apply a changeset to the zone the same way an update is applied. */
+static int apply_chain(apply_ctx_t *ctx, const changeset_t *ch)
+{
+	changeset_iter_t itt;
+	int ret = changeset_iter_rem(&itt, ch, false);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	knot_rrset_t rr = changeset_iter_next(&itt);
+	while (ret == KNOT_EOK && !knot_rrset_empty(&rr)) {
+		ret = apply_remove_rr(ctx, &rr);
+		rr = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = changeset_iter_add(&itt, ch, false);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	rr = changeset_iter_next(&itt);
+	while (ret == KNOT_EOK && !knot_rrset_empty(&rr)) {
+		ret = apply_add_rr(ctx, &rr);
+		rr = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+
+	return ret;
+}
+
+static int create_chain(const zone_contents_t *zone, const bench_chain_t *chain,
+                        changeset_t *ch)
+{
+	if (chain->nsec3) {
+		return knot_nsec3_create_chain(zone, &chain->params, chain->ttl, ch);
+	} else {
+		return knot_nsec_create_chain(zone, chain->ttl, ch);
+	}
+}
+
+static int fix_chain(const zone_contents_t *zone, const bench_chain_t *chain,
+                     const changeset_t *update, changeset_t *ch)
+{
+	if (chain->nsec3) {
+		return knot_nsec3_fix_chain(zone, update, &chain->params, chain->ttl, ch);
+	} else {
+		return knot_nsec_fix_chain(zone, update, chain->ttl, ch);
+	}
+}
+
+/*! \brief Generate the zone with hosts in groups and its chain. */
+static zone_contents_t *make_zone(unsigned hosts, const bench_chain_t *chain)
+{
+	knot_dname_t *origin = knot_dname_from_str_alloc(BENCH_ORIGIN);
+	zone_contents_t *zone = zone_contents_new(origin);
+	knot_dname_free(&origin, NULL);
+	if (zone == NULL) {
+		return NULL;
+	}
+
+	uint8_t rdata[256];
+	wire_ctx_t wire = wire_ctx_init(rdata, sizeof(rdata));
+	wire_ctx_write(&wire, (uint8_t *)"\x02""ns""\x07""example", 12);
+	wire_ctx_write(&wire, (uint8_t *)"\x0a""hostmaster""\x07""example", 20);
+	wire_ctx_write_u32(&wire, 1);
+	wire_ctx_write_u32(&wire, 3600);
+	wire_ctx_write_u32(&wire, 900);
+	wire_ctx_write_u32(&wire, 604800);
+	wire_ctx_write_u32(&wire, chain->ttl);
+	int ret = add_rr(zone, make_rr(BENCH_ORIGIN, KNOT_RRTYPE_SOA, rdata,
+	                               wire_ctx_offset(&wire)));
+	if (ret == KNOT_EOK) {
+		ret = add_rr(zone, make_rr(BENCH_ORIGIN, KNOT_RRTYPE_NS, rdata, 12));
+	}
+	if (ret == KNOT_EOK && chain->nsec3) {
+		wire = wire_ctx_init(rdata, sizeof(rdata));
+		wire_ctx_write_u8(&wire, chain->params.algorithm);
+		wire_ctx_write_u8(&wire, 0);
+		wire_ctx_write_u16(&wire, chain->params.iterations);
+		wire_ctx_write_u8(&wire, chain->params.salt.size);
+		wire_ctx_write(&wire, chain->params.salt.data, chain->params.salt.size);
+		ret = add_rr(zone, make_rr(BENCH_ORIGIN, KNOT_RRTYPE_NSEC3PARAM,
+		                           rdata, wire_ctx_offset(&wire)));
+	}
+	if (ret == KNOT_EOK) {
+		ret = add_rr(zone, make_host("ns." BENCH_ORIGIN, 0));
+	}
+
+	for (unsigned i = 0; i < hosts && ret == KNOT_EOK; i++) {
+		char owner[64];
+		snprintf(owner, sizeof(owner), "h%u.g%u." BENCH_ORIGIN,
+		         i, i / BENCH_GROUP);
+		ret = add_rr(zone, make_host(owner, i));
+	}
+
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_adjust_full(zone);
+	}
+
+	changeset_t ch;
+	if (ret == KNOT_EOK) {
+		ret = changeset_init(&ch, zone->apex->owner);
+	}
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(&zone);
+		return NULL;
+	}
+
+	apply_ctx_t ctx;
+	apply_init_ctx(&ctx, zone, 0);
+	ret = create_chain(zone, chain, &ch);
+	if (ret == KNOT_EOK) {
+		ret = apply_chain(&ctx, &ch);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_adjust_full(zone);
+	}
+	update_cleanup(&ctx);
+	changeset_clear(&ch);
+
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(&zone);
+		return NULL;
+	}
+
+	return zone;
+}
+
+static knot_rrset_t *make_update(enum update_kind kind, unsigned n,
+                                 unsigned hosts, uint64_t *rnd)
+{
+	char owner[64];
+	unsigned host = rnd_next(rnd) % hosts;
+
+	switch (kind) {
+	case U_ADD:
+		snprintf(owner, sizeof(owner), "new%u.g%u." BENCH_ORIGIN,
+		         n, host / BENCH_GROUP);
+		return make_host(owner, n);
+	case U_ADD_ENT:
+		snprintf(owner, sizeof(owner), "new%u.x%u." BENCH_ORIGIN, n, n);
+		return make_host(owner, n);
+	case U_REMOVE:
+		snprintf(owner, sizeof(owner), "h%u.g%u." BENCH_ORIGIN,
+		         host, host / BENCH_GROUP);
+		return make_host(owner, host);
+	default:
+		assert(0);
+		return NULL;
+	}
+}
+
+/*! \brief Check that all chain records from one changeset are in the other. */
+static bool chain_included(const changeset_t *a, const changeset_t *b,
+                           bool additions)
+{
+	changeset_iter_t itt;
+	if (additions) {
+		changeset_iter_add(&itt, a, false);
+	} else {
+		changeset_iter_rem(&itt, a, false);
+	}
+
+	const zone_contents_t *other = additions ? b->add : b->remove;
+
+	bool included = true;
+	knot_rrset_t rr = changeset_iter_next(&itt);
+	while (included && !knot_rrset_empty(&rr)) {
+		const zone_node_t *node = NULL;
+		if (rr.type == KNOT_RRTYPE_NSEC) {
+			node = zone_contents_find_node(other, rr.owner);
+		} else if (rr.type == KNOT_RRTYPE_NSEC3) {
+			node = zone_contents_find_nsec3_node(other, rr.owner);
+		} else {
+			rr = changeset_iter_next(&itt);
+			continue;
+		}
+		knot_rrset_t other_rr = node_rrset(node, rr.type);
+		included = knot_rrset_equal(&rr, &other_rr, KNOT_RRSET_COMPARE_WHOLE);
+		rr = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+
+	return included;
+}
+
+static bool chain_equal(const changeset_t *a, const changeset_t *b)
+{
+	return chain_included(a, b, true) && chain_included(b, a, true) &&
+	       chain_included(a, b, false) && chain_included(b, a, false);
+}
+
+/*! \brief Apply one update to a copy of the zone and maintain the chain. */
+static int run_update(zone_contents_t *zone, const bench_chain_t *chain,
+                      enum update_kind kind, knot_rrset_t *rr,
+                      hist_t *fix_hist, hist_t *full_hist, bool *equal)
+{
+	changeset_t update, fixed, full;
+	changeset_init(&update, zone->apex->owner);
+	changeset_init(&fixed, zone->apex->owner);
+	changeset_init(&full, zone->apex->owner);
+
+	int ret = (kind == U_REMOVE) ? changeset_add_removal(&update, rr, 0) :
+	                               changeset_add_addition(&update, rr, 0);
+
+	zone_contents_t *copy = NULL;
+	if (ret == KNOT_EOK) {
+		ret = apply_prepare_zone_copy(zone, &copy);
+	}
+
+	apply_ctx_t ctx;
+	apply_init_ctx(&ctx, copy, 0);
+	if (ret == KNOT_EOK) {
+		ret = (kind == U_REMOVE) ? apply_remove_rr(&ctx, rr) :
+		                           apply_add_rr(&ctx, rr);
+	}
+	if (ret == KNOT_EOK) {
+		ret = apply_prepare_to_sign(&ctx);
+	}
+
+	if (ret == KNOT_EOK) {
+		uint64_t start = qtime_now();
+		ret = fix_chain(copy, chain, &update, &fixed);
+		hist_record(fix_hist, qtime_now() - start);
+	}
+	if (ret == KNOT_EOK && full_hist != NULL) {
+		uint64_t start = qtime_now();
+		ret = create_chain(copy, chain, &full);
+		hist_record(full_hist, qtime_now() - start);
+		*equal = chain_equal(&fixed, &full);
+	}
+
+	update_rollback(&ctx);
+	update_free_zone(&copy);
+	changeset_clear(&update);
+	changeset_clear(&fixed);
+	changeset_clear(&full);
+
+	return ret;
+}
+
+static void print_row(const char *name, const hist_t *hist)
+{
+	printf("%-10s %10"PRIu64" %10"PRIu64" %10"PRIu64" %10"PRIu64"\n",
+	       name, hist->count ? hist->sum / hist->count / 1000 : 0,
+	       hist_percentile(hist, 500) / 1000,
+	       hist_percentile(hist, 990) / 1000, hist->max / 1000);
+}
+
+static void print_help(void)
+{
+	printf("Usage: %s [parameters]\n"
+	       "\n"
+	       "Parameters:\n"
+	       " -r, --hosts <num>       Number of host names in the zone (default %u).\n"
+	       " -u, --updates <num>     Number of updates (default %u).\n"
+	       " -i, --iterations <num>  NSEC3 iterations (default %u).\n"
+	       " -e, --nsec              Use NSEC instead of NSEC3.\n"
+	       " -x, --no-full           Don't compare with the full chain recreation.\n"
+	       " -s, --seed <num>        Update generator seed (default %u).\n"
+	       " -h, --help              Print the program help.\n",
+	       PROGRAM_NAME, DEFAULT_HOSTS, DEFAULT_UPDATES, DEFAULT_ITERATIONS,
+	       DEFAULT_SEED);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned hosts = DEFAULT_HOSTS;
+	unsigned updates = DEFAULT_UPDATES;
+	uint64_t seed = DEFAULT_SEED;
+	bool full = true;
+	bench_chain_t chain = {
+		.nsec3 = true,
+		.params = {
+			.algorithm = DNSSEC_NSEC3_ALGORITHM_SHA1,
+			.iterations = DEFAULT_ITERATIONS,
+			.salt = { .data = (uint8_t *)"\xca\xfe\xba\xbe", .size = 4 }
+		},
+		.ttl = 300
+	};
+
+	struct option opts[] = {
+		{ "hosts",      required_argument, NULL, 'r' },
+		{ "updates",    required_argument, NULL, 'u' },
+		{ "iterations", required_argument, NULL, 'i' },
+		{ "nsec",       no_argument,       NULL, 'e' },
+		{ "no-full",    no_argument,       NULL, 'x' },
+		{ "seed",       required_argument, NULL, 's' },
+		{ "help",       no_argument,       NULL, 'h' },
+		{ NULL }
+	};
+
+	int opt = 0;
+	while ((opt = getopt_long(argc, argv, "r:u:i:exs:h", opts, NULL)) != -1) {
+		switch (opt) {
+		case 'r':
+			hosts = strtoul(optarg, NULL, 10);
+			break;
+		case 'u':
+			updates = strtoul(optarg, NULL, 10);
+			break;
+		case 'i':
+			chain.params.iterations = strtoul(optarg, NULL, 10);
+			break;
+		case 'e':
+			chain.nsec3 = false;
+			break;
+		case 'x':
+			full = false;
+			break;
+		case 's':
+			seed = strtoull(optarg, NULL, 10);
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (hosts == 0) {
+		print_help();
+		return EXIT_FAILURE;
+	}
+
+	uint64_t build_start = qtime_now();
+	zone_contents_t *zone = make_zone(hosts, &chain);
+	if (zone == NULL) {
+		fprintf(stderr, "failed to create zone\n");
+		return EXIT_FAILURE;
+	}
+	double build_time = (qtime_now() - build_start) / 1e9;
+
+	printf("zone:    %s %u hosts, %s (built in %.2f s)\n"
+	       "updates: %u, seed: %"PRIu64"\n\n",
+	       BENCH_ORIGIN, hosts, chain.nsec3 ? "NSEC3" : "NSEC", build_time,
+	       updates, seed);
+
+	hist_t *fix_hist = calloc(U_KINDS, sizeof(hist_t));
+	hist_t *full_hist = calloc(U_KINDS, sizeof(hist_t));
+	assert(fix_hist && full_hist);
+
+	int ret = KNOT_EOK;
+	unsigned mismatches = 0;
+	uint64_t rnd = seed ? seed : DEFAULT_SEED;
+	for (unsigned i = 0; i < updates && ret == KNOT_EOK; i++) {
+		enum update_kind kind = i % U_KINDS;
+		knot_rrset_t *rr = make_update(kind, i, hosts, &rnd);
+		bool equal = true;
+		ret = (rr != NULL) ? run_update(zone, &chain, kind, rr, &fix_hist[kind],
+		                                full ? &full_hist[kind] : NULL, &equal) :
+		                     KNOT_ENOMEM;
+		knot_rrset_free(&rr, NULL);
+		if (!equal) {
+			mismatches++;
+		}
+	}
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to process update (%s)\n", knot_strerror(ret));
+	}
+
+	printf("%-10s %10s %10s %10s %10s  (microseconds)\n",
+	       "repair", "avg", "p50", "p99", "max");
+	for (unsigned k = 0; k < U_KINDS; k++) {
+		print_row(kind_names[k], &fix_hist[k]);
+	}
+	if (full) {
+		printf("\n%-10s %10s %10s %10s %10s  (microseconds)\n",
+		       "recreate", "avg", "p50", "p99", "max");
+		for (unsigned k = 0; k < U_KINDS; k++) {
+			print_row(kind_names[k], &full_hist[k]);
+		}
+		printf("\nmismatches: %u\n", mismatches);
+	}
+
+	free(fix_hist);
+	free(full_hist);
+	zone_contents_deep_free(&zone);
+
+	return (ret == KNOT_EOK && mismatches == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,624 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * In-process query answering benchmark.
+ *
+ * A synthetic signed zone is generated and loaded through the regular zone
+ * loading path. A reproducible query mix is then driven through the query
+ * processing layer in the same way as the UDP handler does it, without any
+ * sockets involved.
+ */
+
+#include <assert.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <urcu.h>
+
+#include "libknot/libknot.h"
+#include "knot/conf/conf.h"
+#include "knot/nameserver/process_query.h"
+#include "knot/nameserver/query_timing.h"
+#include "knot/query/layer.h"
+#include "knot/zone/zone-load.h"
+#include "contrib/macros.h"
+#include "contrib/mempattern.h"
+#include "contrib/sockaddr.h"
+#include "contrib/ucw/mempool.h"
+
+#define PROGRAM_NAME "bench-query"
+
+#define BENCH_ORIGIN    "example."
+#define BENCH_POOL      65536 /*!< Number of distinct pre-generated queries. */
+#define BENCH_SIG_LEN   344   /*!< Base64 length of a 256B dummy signature. */
+#define BENCH_TXT_COUNT 8     /*!< Number of strings in the large TXT. */
+
+#define DEFAULT_THREADS 1
+#define DEFAULT_QUERIES 1000000
+#define DEFAULT_HOSTS   100000
+#define DEFAULT_SEED    1
+
+/*! \brief Query mix classes. */
+enum query_kind {
+	Q_HIT = 0,
+	Q_DNSSEC,
+	Q_NXDOMAIN,
+	Q_WILDCARD,
+	Q_REFERRAL,
+	Q_ANY,
+	Q_TXT,
+	Q_KINDS
+};
+
+static const struct {
+	const char *name;
+	unsigned weight; /*!< Share of the mix in percents. */
+} kinds[Q_KINDS] = {
+	[Q_HIT]      = { "hit",      50 },
+	[Q_DNSSEC]   = { "dnssec",   20 },
+	[Q_NXDOMAIN] = { "nxdomain", 10 },
+	[Q_WILDCARD] = { "wildcard",  8 },
+	[Q_REFERRAL] = { "referral",  6 },
+	[Q_ANY]      = { "any",       3 },
+	[Q_TXT]      = { "txt",       3 },
+};
+
+typedef struct {
+	uint8_t wire[KNOT_WIRE_MIN_PKTSIZE];
+	size_t size;
+	enum query_kind kind;
+} bench_query_t;
+
+typedef struct {
+	struct mempool *pool;
+	uint64_t allocs;
+} count_mm_t;
+
+typedef struct {
+	pthread_t thread;
+	server_t *server;
+	const bench_query_t *queries;
+	size_t count;
+	unsigned id;
+	uint64_t elapsed;
+	uint64_t answered;
+	uint64_t queries_kind[Q_KINDS];
+	uint64_t allocs_kind[Q_KINDS];
+	hist_t hist[Q_KINDS];
+} bench_worker_t;
+
+/*! \brief Simple reproducible PRNG (xorshift64*). */
+static uint64_t rnd_next(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 2685821657736338717ULL;
+}
+
+static void *count_alloc(void *ctx, size_t size)
+{
+	count_mm_t *mm = ctx;
+	mm->allocs++;
+	return mp_alloc(mm->pool, size);
+}
+
+typedef struct {
+	knot_dname_t *name;
+	const char *types;
+} nsec_owner_t;
+
+static int owner_cmp(const void *a, const void *b)
+{
+	const nsec_owner_t *o1 = a, *o2 = b;
+	return knot_dname_cmp(o1->name, o2->name);
+}
+
+static void put_rrsig(FILE *f, const char *owner, const char *type,
+                      unsigned labels, const char *sig)
+{
+	fprintf(f, "%s 3600 RRSIG %s 8 %u 3600 20300101000000 20160101000000 "
+	        "12345 " BENCH_ORIGIN " %s\n", owner, type, labels, sig);
+}
+
+/*! \brief Write the synthetic zone with dummy signatures and an NSEC chain. */
+static int write_zone(FILE *f, unsigned hosts)
+{
+	char sig[BENCH_SIG_LEN + 1];
+	memset(sig, 'A', BENCH_SIG_LEN - 2);
+	memcpy(sig + BENCH_SIG_LEN - 2, "==", 3);
+
+	nsec_owner_t *owners = calloc(hosts + 5, sizeof(*owners));
+	if (owners == NULL) {
+		return KNOT_ENOMEM;
+	}
+	size_t count = 0;
+
+	fprintf(f, "$ORIGIN " BENCH_ORIGIN "\n$TTL 3600\n");
+
+	/* Apex. */
+	fprintf(f, "@ SOA ns hostmaster 1 3600 900 604800 300\n"
+	           "@ NS ns\n"
+	           "@ DNSKEY 257 3 8 %s\n", sig);
+	put_rrsig(f, "@", "SOA", 1, sig);
+	put_rrsig(f, "@", "NS", 1, sig);
+	put_rrsig(f, "@", "DNSKEY", 1, sig);
+	owners[count++] = (nsec_owner_t){ knot_dname_from_str_alloc(BENCH_ORIGIN),
+	                                  "SOA NS DNSKEY RRSIG NSEC" };
+
+	fprintf(f, "ns A 192.0.2.1\n");
+	put_rrsig(f, "ns", "A", 2, sig);
+	owners[count++] = (nsec_owner_t){ knot_dname_from_str_alloc("ns." BENCH_ORIGIN),
+	                                  "A RRSIG NSEC" };
+
+	/* Hosts. */
+	for (unsigned i = 0; i < hosts; i++) {
+		char owner[32];
+		snprintf(owner, sizeof(owner), "host%u", i);
+		fprintf(f, "%s A 10.%u.%u.%u\n%s AAAA 2001:db8::%x:%x\n",
+		        owner, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff,
+		        owner, i >> 16, i & 0xffff);
+		put_rrsig(f, owner, "A", 2, sig);
+		put_rrsig(f, owner, "AAAA", 2, sig);
+
+		char fqdn[64];
+		snprintf(fqdn, sizeof(fqdn), "%s." BENCH_ORIGIN, owner);
+		owners[count++] = (nsec_owner_t){ knot_dname_from_str_alloc(fqdn),
+		                                  "A AAAA RRSIG NSEC" };
+	}
+
+	/* Wildcard. */
+	fprintf(f, "*.wild A 192.0.2.2\n");
+	put_rrsig(f, "*.wild", "A", 2, sig);
+	owners[count++] = (nsec_owner_t){ knot_dname_from_str_alloc("*.wild." BENCH_ORIGIN),
+	                                  "A RRSIG NSEC" };
+
+	/* Delegation with glue. */
+	fprintf(f, "sub NS ns.sub\nns.sub A 192.0.2.3\n");
+	owners[count++] = (nsec_owner_t){ knot_dname_from_str_alloc("sub." BENCH_ORIGIN),
+	                                  "NS RRSIG NSEC" };
+
+	/* Large TXT. */
+	fprintf(f, "txt TXT");
+	for (unsigned i = 0; i < BENCH_TXT_COUNT; i++) {
+		char chunk[251];
+		memset(chunk, 'a' + i, sizeof(chunk) - 1);
+		chunk[sizeof(chunk) - 1] = '\0';
+		fprintf(f, " \"%s\"", chunk);
+	}
+	fprintf(f, "\n");
+	put_rrsig(f, "txt", "TXT", 2, sig);
+	owners[count++] = (nsec_owner_t){ knot_dname_from_str_alloc("txt." BENCH_ORIGIN),
+	                                  "TXT RRSIG NSEC" };
+
+	/* NSEC chain in canonical order. */
+	qsort(owners, count, sizeof(*owners), owner_cmp);
+	for (size_t i = 0; i < count; i++) {
+		char owner[KNOT_DNAME_TXT_MAXLEN + 1], next[KNOT_DNAME_TXT_MAXLEN + 1];
+		knot_dname_to_str(owner, owners[i].name, sizeof(owner));
+		knot_dname_to_str(next, owners[(i + 1) % count].name, sizeof(next));
+		fprintf(f, "%s NSEC %s %s\n", owner, next, owners[i].types);
+
+		unsigned labels = knot_dname_labels(owners[i].name, NULL);
+		if (knot_dname_is_wildcard(owners[i].name)) {
+			labels--;
+		}
+		put_rrsig(f, owner, "NSEC", labels, sig);
+		knot_dname_free(&owners[i].name, NULL);
+	}
+	free(owners);
+
+	return ferror(f) ? KNOT_ERROR : KNOT_EOK;
+}
+
+static int load_zone(server_t *server, unsigned hosts)
+{
+	char path[] = "/tmp/knot-bench-zone.XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		return knot_map_errno();
+	}
+	FILE *f = fdopen(fd, "w");
+	if (f == NULL) {
+		close(fd);
+		unlink(path);
+		return knot_map_errno();
+	}
+	int ret = write_zone(f, hosts);
+	fclose(f);
+	if (ret != KNOT_EOK) {
+		unlink(path);
+		return ret;
+	}
+
+	char conf_str[512];
+	snprintf(conf_str, sizeof(conf_str),
+	         "server:\n identity: bench\n"
+	         "zone:\n - domain: " BENCH_ORIGIN "\n"
+	         "   file: %s\n   semantic-checks: off\n", path);
+
+	conf_t *new_conf = NULL;
+	ret = conf_new(&new_conf, conf_scheme, NULL, CONF_FNONE);
+	if (ret == KNOT_EOK) {
+		ret = conf_import(new_conf, conf_str, false);
+	}
+	if (ret != KNOT_EOK) {
+		conf_free(new_conf);
+		unlink(path);
+		return ret;
+	}
+	conf_update(new_conf);
+
+	knot_dname_t *origin = knot_dname_from_str_alloc(BENCH_ORIGIN);
+	zone_t *zone = zone_new(origin);
+	knot_dname_free(&origin, NULL);
+	if (zone == NULL) {
+		unlink(path);
+		return KNOT_ENOMEM;
+	}
+
+	ret = zone_load_contents(conf(), zone->name, &zone->contents);
+	unlink(path);
+	if (ret != KNOT_EOK) {
+		zone_free(&zone);
+		return ret;
+	}
+
+	server->zone_db = knot_zonedb_new(1);
+	if (server->zone_db == NULL) {
+		zone_free(&zone);
+		return KNOT_ENOMEM;
+	}
+	knot_zonedb_insert(server->zone_db, zone);
+
+	return knot_zonedb_build_index(server->zone_db);
+}
+
+static int make_query(bench_query_t *query, enum query_kind kind,
+                      unsigned hosts, uint64_t *rnd)
+{
+	char name[KNOT_DNAME_TXT_MAXLEN + 1];
+	uint16_t qtype = KNOT_RRTYPE_A;
+	uint16_t payload = 0;
+	bool dnssec = false;
+	unsigned n = rnd_next(rnd) % hosts;
+
+	switch (kind) {
+	case Q_HIT:
+		snprintf(name, sizeof(name), "host%u." BENCH_ORIGIN, n);
+		qtype = (n & 1) ? KNOT_RRTYPE_AAAA : KNOT_RRTYPE_A;
+		break;
+	case Q_DNSSEC:
+		snprintf(name, sizeof(name), "host%u." BENCH_ORIGIN, n);
+		payload = 4096;
+		dnssec = true;
+		break;
+	case Q_NXDOMAIN:
+		snprintf(name, sizeof(name), "nx%u." BENCH_ORIGIN, n);
+		payload = 4096;
+		dnssec = (n & 1);
+		break;
+	case Q_WILDCARD:
+		snprintf(name, sizeof(name), "w%u.wild." BENCH_ORIGIN, n);
+		break;
+	case Q_REFERRAL:
+		snprintf(name, sizeof(name), "www%u.sub." BENCH_ORIGIN, n);
+		break;
+	case Q_ANY:
+		snprintf(name, sizeof(name), "host%u." BENCH_ORIGIN, n);
+		qtype = KNOT_RRTYPE_ANY;
+		break;
+	case Q_TXT:
+		snprintf(name, sizeof(name), "txt." BENCH_ORIGIN);
+		qtype = KNOT_RRTYPE_TXT;
+		payload = 4096;
+		break;
+	default:
+		assert(0);
+		return KNOT_EINVAL;
+	}
+
+	knot_pkt_t *pkt = knot_pkt_new(query->wire, sizeof(query->wire), NULL);
+	if (pkt == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_wire_set_id(pkt->wire, rnd_next(rnd));
+	knot_dname_t *qname = knot_dname_from_str_alloc(name);
+	int ret = knot_pkt_put_question(pkt, qname, KNOT_CLASS_IN, qtype);
+	knot_dname_free(&qname, NULL);
+
+	if (ret == KNOT_EOK && payload > 0) {
+		knot_rrset_t opt_rr;
+		ret = knot_edns_init(&opt_rr, payload, 0, 0, &pkt->mm);
+		if (ret == KNOT_EOK) {
+			if (dnssec) {
+				knot_edns_set_do(&opt_rr);
+			}
+			knot_pkt_begin(pkt, KNOT_ADDITIONAL);
+			ret = knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, &opt_rr,
+			                   KNOT_PF_FREE);
+			if (ret != KNOT_EOK) {
+				knot_rrset_clear(&opt_rr, &pkt->mm);
+			}
+		}
+	}
+
+	query->size = pkt->size;
+	query->kind = kind;
+	knot_pkt_free(&pkt);
+
+	return ret;
+}
+
+static bench_query_t *make_queries(unsigned hosts, uint64_t seed)
+{
+	bench_query_t *queries = calloc(BENCH_POOL, sizeof(*queries));
+	if (queries == NULL) {
+		return NULL;
+	}
+
+	uint64_t rnd = seed ? seed : DEFAULT_SEED;
+	for (unsigned i = 0; i < BENCH_POOL; i++) {
+		unsigned roll = rnd_next(&rnd) % 100;
+		enum query_kind kind = 0;
+		while (roll >= kinds[kind].weight) {
+			roll -= kinds[kind].weight;
+			kind++;
+		}
+		if (make_query(&queries[i], kind, hosts, &rnd) != KNOT_EOK) {
+			free(queries);
+			return NULL;
+		}
+	}
+
+	return queries;
+}
+
+static void *worker_run(void *arg)
+{
+	bench_worker_t *w = arg;
+
+	rcu_register_thread();
+
+	count_mm_t cmm = { .pool = mp_new(16 * MM_DEFAULT_BLKSIZE) };
+	knot_mm_t mm = { .ctx = &cmm, .alloc = count_alloc, .free = NULL };
+
+	knot_layer_t layer;
+	memset(&layer, 0, sizeof(layer));
+	knot_layer_init(&layer, &mm, process_query_layer());
+
+	struct sockaddr_storage ss;
+	sockaddr_set(&ss, AF_INET, "127.0.0.1", 53);
+
+	/* Same parameters as the UDP handler. */
+	struct process_query_param param = { 0 };
+	param.remote = &ss;
+	param.proc_flags = NS_QUERY_NO_AXFR | NS_QUERY_NO_IXFR |
+	                   NS_QUERY_LIMIT_SIZE | NS_QUERY_LIMIT_ANY;
+	param.server = w->server;
+	param.thread_id = w->id;
+	if (w->server->rrl != NULL && w->server->rrl->rate > 0) {
+		param.proc_flags |= NS_QUERY_LIMIT_RATE;
+	}
+
+	uint8_t *rx_buf = malloc(KNOT_WIRE_MAX_PKTSIZE);
+	uint8_t *tx_buf = malloc(KNOT_WIRE_MAX_PKTSIZE);
+	assert(rx_buf && tx_buf);
+
+	/* Each worker starts at a different place of the query pool. */
+	size_t offset = (w->id * 7919) % BENCH_POOL;
+
+	uint64_t begin = qtime_now();
+	for (size_t i = 0; i < w->count; i++) {
+		const bench_query_t *q = &w->queries[(offset + i) % BENCH_POOL];
+		memcpy(rx_buf, q->wire, q->size);
+		uint64_t allocs = cmm.allocs;
+		uint64_t start = qtime_now();
+
+		layer.state = knot_layer_begin(&layer, &param);
+
+		knot_pkt_t *query = knot_pkt_new(rx_buf, q->size, layer.mm);
+		knot_pkt_t *ans = knot_pkt_new(tx_buf, KNOT_WIRE_MAX_PKTSIZE, layer.mm);
+
+		(void) knot_pkt_parse(query, 0);
+		int state = knot_layer_consume(&layer, query);
+		while (state & (KNOT_STATE_PRODUCE | KNOT_STATE_FAIL)) {
+			state = knot_layer_produce(&layer, ans);
+		}
+		if (state == KNOT_STATE_DONE && ans->size > 0) {
+			w->answered++;
+		}
+
+		knot_layer_finish(&layer);
+		knot_pkt_free(&query);
+		knot_pkt_free(&ans);
+		mp_flush(cmm.pool);
+
+		hist_record(&w->hist[q->kind], qtime_now() - start);
+		w->queries_kind[q->kind]++;
+		w->allocs_kind[q->kind] += cmm.allocs - allocs;
+	}
+	w->elapsed = qtime_now() - begin;
+
+	free(rx_buf);
+	free(tx_buf);
+	mp_delete(cmm.pool);
+
+	rcu_unregister_thread();
+
+	return NULL;
+}
+
+static void print_row(const char *name, uint64_t queries, uint64_t total,
+                      uint64_t allocs, const hist_t *hist)
+{
+	printf("%-10s %6.1f%% %10.2f %10"PRIu64" %10"PRIu64" %10"PRIu64"\n",
+	       name, total ? 100.0 * queries / total : 0.0,
+	       queries ? (double)allocs / queries : 0.0,
+	       hist_percentile(hist, 500), hist_percentile(hist, 990),
+	       hist->max);
+}
+
+static void print_help(void)
+{
+	printf("Usage: %s [parameters]\n"
+	       "\n"
+	       "Parameters:\n"
+	       " -t, --threads <num>   Number of processing threads (default %u).\n"
+	       " -n, --queries <num>   Number of queries per thread (default %u).\n"
+	       " -r, --hosts <num>     Number of host names in the zone (default %u).\n"
+	       " -s, --seed <num>      Query mix generator seed (default %u).\n"
+	       " -h, --help            Print the program help.\n",
+	       PROGRAM_NAME, DEFAULT_THREADS, DEFAULT_QUERIES, DEFAULT_HOSTS,
+	       DEFAULT_SEED);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned threads = DEFAULT_THREADS;
+	unsigned long queries = DEFAULT_QUERIES;
+	unsigned hosts = DEFAULT_HOSTS;
+	uint64_t seed = DEFAULT_SEED;
+
+	struct option opts[] = {
+		{ "threads", required_argument, NULL, 't' },
+		{ "queries", required_argument, NULL, 'n' },
+		{ "hosts",   required_argument, NULL, 'r' },
+		{ "seed",    required_argument, NULL, 's' },
+		{ "help",    no_argument,       NULL, 'h' },
+		{ NULL }
+	};
+
+	int opt = 0;
+	while ((opt = getopt_long(argc, argv, "t:n:r:s:h", opts, NULL)) != -1) {
+		switch (opt) {
+		case 't':
+			threads = strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			queries = strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			hosts = strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			seed = strtoull(optarg, NULL, 10);
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (threads == 0 || hosts == 0) {
+		print_help();
+		return EXIT_FAILURE;
+	}
+
+	rcu_register_thread();
+
+	server_t server;
+	int ret = server_init(&server, 1);
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to initialize server (%s)\n", knot_strerror(ret));
+		rcu_unregister_thread();
+		return EXIT_FAILURE;
+	}
+
+	uint64_t load_start = qtime_now();
+	ret = load_zone(&server, hosts);
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to load zone (%s)\n", knot_strerror(ret));
+		server_deinit(&server);
+		rcu_unregister_thread();
+		return EXIT_FAILURE;
+	}
+	double load_time = (qtime_now() - load_start) / 1e9;
+
+	bench_query_t *pool = make_queries(hosts, seed);
+	bench_worker_t *workers = calloc(threads, sizeof(*workers));
+	if (pool == NULL || workers == NULL) {
+		fprintf(stderr, "failed to prepare queries\n");
+		ret = KNOT_ENOMEM;
+		goto finish;
+	}
+
+	printf("zone:    %s %u hosts (loaded in %.2f s)\n"
+	       "threads: %u, queries per thread: %lu, seed: %"PRIu64"\n\n",
+	       BENCH_ORIGIN, hosts, load_time, threads, queries, seed);
+
+	for (unsigned i = 0; i < threads; i++) {
+		workers[i].server = &server;
+		workers[i].queries = pool;
+		workers[i].count = queries;
+		workers[i].id = i;
+		pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]);
+	}
+
+	hist_t *total = calloc(Q_KINDS + 1, sizeof(hist_t));
+	uint64_t total_queries = 0, total_allocs = 0, answered = 0;
+	uint64_t elapsed = 0, elapsed_max = 0;
+	uint64_t kind_queries[Q_KINDS] = { 0 }, kind_allocs[Q_KINDS] = { 0 };
+	assert(total);
+
+	for (unsigned i = 0; i < threads; i++) {
+		bench_worker_t *w = &workers[i];
+		pthread_join(w->thread, NULL);
+		for (unsigned k = 0; k < Q_KINDS; k++) {
+			hist_merge(&total[k], &w->hist[k]);
+			hist_merge(&total[Q_KINDS], &w->hist[k]);
+			kind_queries[k] += w->queries_kind[k];
+			kind_allocs[k] += w->allocs_kind[k];
+			total_allocs += w->allocs_kind[k];
+		}
+		total_queries += w->count;
+		answered += w->answered;
+		elapsed += w->elapsed;
+		elapsed_max = MAX(elapsed_max, w->elapsed);
+	}
+
+	printf("%-10s %7s %10s %10s %10s %10s\n",
+	       "kind", "share", "allocs/q", "p50 ns", "p99 ns", "max ns");
+	for (unsigned k = 0; k < Q_KINDS; k++) {
+		print_row(kinds[k].name, kind_queries[k], total_queries,
+		          kind_allocs[k], &total[k]);
+	}
+	print_row("all", total_queries, total_queries, total_allocs, &total[Q_KINDS]);
+
+	printf("\nanswered: %"PRIu64"/%"PRIu64"\n"
+	       "qps:      %.0f total, %.0f per core\n",
+	       answered, total_queries,
+	       elapsed_max ? total_queries * 1e9 / elapsed_max : 0.0,
+	       elapsed ? total_queries * 1e9 / elapsed : 0.0);
+
+	free(total);
+finish:
+	free(workers);
+	free(pool);
+	server_deinit(&server);
+	conf_free(conf());
+	rcu_unregister_thread();
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
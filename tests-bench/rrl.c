@@ -0,0 +1,254 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * Response rate limiting contention benchmark.
+ *
+ * A number of threads query the rate limiting table the same way as the UDP
+ * workers do for each answer, with an increasing number of threads. Either
+ * each query comes from a random address of a large pool (a spoofed flood)
+ * or all the queries come from a single address (a single attacked bucket).
+ * The throughput of the table is reported together with the share of the
+ * limited answers.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libknot/libknot.h"
+#include "knot/nameserver/query_timing.h"
+#include "knot/server/rrl.h"
+#include "contrib/sockaddr.h"
+
+#define PROGRAM_NAME "bench-rrl"
+
+#define BENCH_QNAME    "host.example."
+#define BENCH_RATE     200
+
+#define DEFAULT_QUERIES 1000000
+#define DEFAULT_BLOCKS  100000
+#define DEFAULT_SIZE    393241
+#define DEFAULT_THREADS 8
+
+typedef struct {
+	pthread_t thread;
+	rrl_table_t *rrl;
+	rrl_req_t *req;
+	unsigned queries;
+	unsigned blocks;
+	uint64_t seed;
+	unsigned limited;
+} worker_t;
+
+/*! \brief Simple reproducible PRNG (xorshift64*). */
+static uint64_t rnd_next(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 2685821657736338717ULL;
+}
+
+static void *worker_run(void *arg)
+{
+	worker_t *w = arg;
+
+	struct sockaddr_storage addr;
+	sockaddr_set(&addr, AF_INET, "192.0.2.1", 53);
+	struct sockaddr_in *ipv4 = (struct sockaddr_in *)&addr;
+
+	uint64_t state = w->seed;
+	for (unsigned i = 0; i < w->queries; i++) {
+		if (w->blocks > 0) {
+			uint32_t block = rnd_next(&state) % w->blocks;
+			ipv4->sin_addr.s_addr = htonl(0x0a000000 | block << 8 | (i & 0xff));
+		}
+		if (rrl_query(w->rrl, &addr, w->req, NULL) == KNOT_ELIMIT) {
+			w->limited++;
+		}
+	}
+
+	return NULL;
+}
+
+static int run(rrl_table_t *rrl, rrl_req_t *req, unsigned threads,
+               unsigned queries, unsigned blocks, uint64_t *time,
+               unsigned *limited)
+{
+	worker_t *workers = calloc(threads, sizeof(worker_t));
+	if (workers == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	rrl_reseed(rrl);
+
+	int ret = KNOT_EOK;
+	unsigned started = 0;
+	uint64_t start = qtime_now();
+	for (; started < threads; started++) {
+		worker_t *w = &workers[started];
+		w->rrl = rrl;
+		w->req = req;
+		w->queries = queries / threads;
+		w->blocks = blocks;
+		w->seed = started + 1;
+		if (pthread_create(&w->thread, NULL, worker_run, w) != 0) {
+			ret = KNOT_ERROR;
+			break;
+		}
+	}
+
+	*limited = 0;
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(workers[i].thread, NULL);
+		*limited += workers[i].limited;
+	}
+	*time = qtime_now() - start;
+
+	free(workers);
+
+	return ret;
+}
+
+static void print_help(void)
+{
+	printf("Usage: %s [parameters]\n"
+	       "\n"
+	       "Parameters:\n"
+	       " -n, --queries <num>  Number of queries per run (default %u).\n"
+	       " -b, --blocks <num>   Number of source /24 blocks (default %u).\n"
+	       " -s, --size <num>     Table size (default %u).\n"
+	       " -t, --threads <num>  Maximal number of threads (default %u).\n"
+	       " -h, --help           Print the program help.\n",
+	       PROGRAM_NAME, DEFAULT_QUERIES, DEFAULT_BLOCKS, DEFAULT_SIZE,
+	       DEFAULT_THREADS);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned queries = DEFAULT_QUERIES;
+	unsigned blocks = DEFAULT_BLOCKS;
+	unsigned size = DEFAULT_SIZE;
+	unsigned max_threads = DEFAULT_THREADS;
+
+	struct option opts[] = {
+		{ "queries", required_argument, NULL, 'n' },
+		{ "blocks",  required_argument, NULL, 'b' },
+		{ "size",    required_argument, NULL, 's' },
+		{ "threads", required_argument, NULL, 't' },
+		{ "help",    no_argument,       NULL, 'h' },
+		{ NULL }
+	};
+
+	int opt = 0;
+	while ((opt = getopt_long(argc, argv, "n:b:s:t:h", opts, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			queries = strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			blocks = strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			size = strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			max_threads = strtoul(optarg, NULL, 10);
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (queries == 0 || blocks == 0 || size < 10 * RRL_LOCK_GRANULARITY ||
+	    max_threads == 0) {
+		print_help();
+		return EXIT_FAILURE;
+	}
+
+	/* Positive answer to an A query, as the UDP workers pass it. */
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MIN_PKTSIZE, NULL);
+	knot_dname_t *qname = knot_dname_from_str_alloc(BENCH_QNAME);
+	if (query == NULL || qname == NULL ||
+	    knot_pkt_put_question(query, qname, KNOT_CLASS_IN, KNOT_RRTYPE_A) != KNOT_EOK) {
+		fprintf(stderr, "failed to create query\n");
+		knot_dname_free(&qname, NULL);
+		knot_pkt_free(&query);
+		return EXIT_FAILURE;
+	}
+	knot_dname_free(&qname, NULL);
+
+	uint8_t resp[KNOT_WIRE_MIN_PKTSIZE];
+	memcpy(resp, query->wire, query->size);
+	knot_wire_set_qr(resp);
+	knot_wire_set_ancount(resp, 1);
+	rrl_req_t req = {
+		.w = resp,
+		.len = query->size + 16,
+		.query = query
+	};
+
+	rrl_table_t *rrl = rrl_create(size);
+	if (rrl == NULL || rrl_setlocks(rrl, RRL_LOCK_GRANULARITY) != KNOT_EOK) {
+		fprintf(stderr, "failed to create table\n");
+		rrl_destroy(rrl);
+		knot_pkt_free(&query);
+		return EXIT_FAILURE;
+	}
+	rrl_setrate(rrl, BENCH_RATE);
+
+	printf("table: %u buckets, %u locks, rate %u\n\n", size,
+	       RRL_LOCK_GRANULARITY, BENCH_RATE);
+	printf("%-8s %-8s %10s %10s %12s %8s %8s\n", "sources", "threads",
+	       "time ms", "ns/query", "queries/s", "speedup", "limited");
+
+	int ret = KNOT_EOK;
+	for (int single = 0; single <= 1 && ret == KNOT_EOK; single++) {
+		uint64_t serial_time = 0;
+		for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+			uint64_t time = 0;
+			unsigned limited = 0;
+			ret = run(rrl, &req, threads, queries, single ? 0 : blocks,
+			          &time, &limited);
+			if (ret != KNOT_EOK) {
+				fprintf(stderr, "failed to run threads\n");
+				break;
+			}
+
+			if (threads == 1) {
+				serial_time = time;
+			}
+
+			unsigned total = queries / threads * threads;
+			printf("%-8s %-8u %10.1f %10.1f %12.0f %8.2f %7.1f%%\n",
+			       single ? "single" : "random", threads, time / 1e6,
+			       (double)time / total, total / (time / 1e9),
+			       (double)serial_time / time, 100.0 * limited / total);
+		}
+	}
+
+	rrl_destroy(rrl);
+	knot_pkt_free(&query);
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,339 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * RR set wire format conversion benchmark.
+ *
+ * For each of the common RR types, a synthetic RR set is written into
+ * a response with the QNAME in the question section, so that the names are
+ * compressed the same way as in the answers. The written RRs are then parsed
+ * back. The average time of both conversions per RR set and per RR is
+ * reported.
+ */
+
+#include <assert.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libknot/libknot.h"
+#include "contrib/wire.h"
+#include "contrib/wire_ctx.h"
+
+#define PROGRAM_NAME "bench-rrset-wire"
+
+#define BENCH_OWNER  "www.example.com."
+#define BENCH_TTL    3600
+
+#define DEFAULT_RRS        4
+#define DEFAULT_ITERATIONS 1000000
+
+/*! \brief Generates RDATA of the n-th RR of the given type. */
+typedef void (*rdata_gen_t)(wire_ctx_t *rdata, unsigned n);
+
+static void put_name(wire_ctx_t *rdata, const char *fmt, unsigned n)
+{
+	char str[KNOT_DNAME_TXT_MAXLEN];
+	snprintf(str, sizeof(str), fmt, n);
+
+	uint8_t name[KNOT_DNAME_MAXLEN];
+	knot_dname_t *dname = knot_dname_from_str(name, str, sizeof(name));
+	assert(dname);
+	wire_ctx_write(rdata, name, knot_dname_size(name));
+}
+
+static void put_bytes(wire_ctx_t *rdata, unsigned n, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		wire_ctx_write_u8(rdata, (uint8_t)(n * 31 + i * 7));
+	}
+}
+
+static void gen_a(wire_ctx_t *rdata, unsigned n)
+{
+	put_bytes(rdata, n, 4);
+}
+
+static void gen_aaaa(wire_ctx_t *rdata, unsigned n)
+{
+	put_bytes(rdata, n, 16);
+}
+
+static void gen_ns(wire_ctx_t *rdata, unsigned n)
+{
+	put_name(rdata, "ns%u.example.com.", n);
+}
+
+static void gen_mx(wire_ctx_t *rdata, unsigned n)
+{
+	wire_ctx_write_u16(rdata, 10 * (n + 1));
+	put_name(rdata, "mail%u.example.com.", n);
+}
+
+static void gen_soa(wire_ctx_t *rdata, unsigned n)
+{
+	put_name(rdata, "ns%u.example.com.", n);
+	put_name(rdata, "hostmaster%u.example.com.", n);
+	put_bytes(rdata, n, 20);
+}
+
+static void gen_srv(wire_ctx_t *rdata, unsigned n)
+{
+	put_bytes(rdata, n, 6);
+	put_name(rdata, "srv%u.example.com.", n);
+}
+
+static void gen_txt(wire_ctx_t *rdata, unsigned n)
+{
+	for (unsigned i = 0; i < 3; i++) {
+		wire_ctx_write_u8(rdata, 40);
+		put_bytes(rdata, n + i, 40);
+	}
+}
+
+static void gen_ds(wire_ctx_t *rdata, unsigned n)
+{
+	put_bytes(rdata, n, 4 + 32);
+}
+
+static void gen_rrsig(wire_ctx_t *rdata, unsigned n)
+{
+	put_bytes(rdata, n, 18);
+	put_name(rdata, "example.com.", n);
+	put_bytes(rdata, n, 256);
+}
+
+static void gen_nsec3(wire_ctx_t *rdata, unsigned n)
+{
+	wire_ctx_write_u8(rdata, 1);
+	wire_ctx_write_u8(rdata, 0);
+	wire_ctx_write_u16(rdata, 10);
+	wire_ctx_write_u8(rdata, 4);
+	put_bytes(rdata, n, 4);
+	wire_ctx_write_u8(rdata, 20);
+	put_bytes(rdata, n, 20);
+	wire_ctx_write(rdata, (const uint8_t *)"\x00\x06\x40\x00\x00\x00\x00\x03", 8);
+}
+
+static const struct {
+	uint16_t type;
+	rdata_gen_t gen;
+} types[] = {
+	{ KNOT_RRTYPE_A,     gen_a },
+	{ KNOT_RRTYPE_AAAA,  gen_aaaa },
+	{ KNOT_RRTYPE_NS,    gen_ns },
+	{ KNOT_RRTYPE_CNAME, gen_ns },
+	{ KNOT_RRTYPE_MX,    gen_mx },
+	{ KNOT_RRTYPE_SOA,   gen_soa },
+	{ KNOT_RRTYPE_SRV,   gen_srv },
+	{ KNOT_RRTYPE_TXT,   gen_txt },
+	{ KNOT_RRTYPE_DS,    gen_ds },
+	{ KNOT_RRTYPE_RRSIG, gen_rrsig },
+	{ KNOT_RRTYPE_NSEC3, gen_nsec3 },
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static knot_rrset_t *make_rrset(const knot_dname_t *owner, uint16_t type,
+                                rdata_gen_t gen, unsigned count)
+{
+	knot_rrset_t *rrset = knot_rrset_new(owner, type, KNOT_CLASS_IN, NULL);
+	if (rrset == NULL) {
+		return NULL;
+	}
+
+	for (unsigned n = 0; n < count; n++) {
+		uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+		wire_ctx_t rdata = wire_ctx_init(buf, sizeof(buf));
+		gen(&rdata, n);
+		assert(rdata.error == KNOT_EOK);
+		if (knot_rrset_add_rdata(rrset, buf, wire_ctx_offset(&rdata),
+		                         BENCH_TTL, NULL) != KNOT_EOK) {
+			knot_rrset_free(&rrset, NULL);
+			return NULL;
+		}
+	}
+
+	return rrset;
+}
+
+/*! \brief Prepare a response header and question, return the question end. */
+static size_t make_question(uint8_t *wire, const knot_dname_t *qname)
+{
+	memset(wire, 0, KNOT_WIRE_HEADER_SIZE);
+	knot_wire_set_qr(wire);
+	knot_wire_set_qdcount(wire, 1);
+
+	size_t pos = KNOT_WIRE_HEADER_SIZE;
+	pos += knot_dname_to_wire(wire + pos, qname, KNOT_DNAME_MAXLEN);
+	wire_write_u16(wire + pos, KNOT_RRTYPE_ANY);
+	wire_write_u16(wire + pos + 2, KNOT_CLASS_IN);
+
+	return pos + 4;
+}
+
+static int write_rrset(const knot_rrset_t *rrset, uint8_t *wire, size_t qend,
+                       knot_rrinfo_t *info)
+{
+	memset(info, 0, sizeof(*info));
+	info->compress_ptr[KNOT_COMPR_HINT_OWNER] = KNOT_COMPR_HINT_QNAME;
+
+	knot_compr_t compr = {
+		.wire = wire,
+		.rrinfo = info,
+		.suffix = {
+			.pos = KNOT_WIRE_HEADER_SIZE,
+			.labels = knot_dname_labels(wire + KNOT_WIRE_HEADER_SIZE, wire)
+		}
+	};
+
+	return knot_rrset_to_wire(rrset, wire + qend, KNOT_WIRE_MAX_PKTSIZE - qend,
+	                          &compr);
+}
+
+static int parse_rrs(const uint8_t *wire, size_t size, size_t qend, unsigned count)
+{
+	size_t pos = qend;
+	for (unsigned i = 0; i < count; i++) {
+		knot_rrset_t rr;
+		int ret = knot_rrset_rr_from_wire(wire, &pos, size, NULL, &rr, false);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		knot_rrset_clear(&rr, NULL);
+	}
+
+	return (pos == size) ? KNOT_EOK : KNOT_EMALF;
+}
+
+static int run_type(uint16_t type, rdata_gen_t gen, unsigned count,
+                    unsigned iterations)
+{
+	uint8_t owner[KNOT_DNAME_MAXLEN];
+	knot_dname_from_str(owner, BENCH_OWNER, sizeof(owner));
+
+	knot_rrset_t *rrset = make_rrset(owner, type, gen, count);
+	if (rrset == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	uint8_t wire[KNOT_WIRE_MAX_PKTSIZE];
+	size_t qend = make_question(wire, owner);
+	knot_rrinfo_t info;
+
+	int ret = KNOT_EOK;
+	int size = 0;
+	uint64_t start = now_ns();
+	for (unsigned i = 0; i < iterations; i++) {
+		size = write_rrset(rrset, wire, qend, &info);
+		if (size < 0) {
+			ret = size;
+			break;
+		}
+	}
+	uint64_t write_time = now_ns() - start;
+
+	start = now_ns();
+	for (unsigned i = 0; i < iterations && ret == KNOT_EOK; i++) {
+		ret = parse_rrs(wire, qend + size, qend, count);
+	}
+	uint64_t parse_time = now_ns() - start;
+
+	if (ret == KNOT_EOK) {
+		char type_str[16];
+		knot_rrtype_to_string(type, type_str, sizeof(type_str));
+		printf("%-8s %8d %10.1f %10.1f %10.1f %10.1f\n", type_str, size,
+		       (double)write_time / iterations,
+		       (double)write_time / iterations / count,
+		       (double)parse_time / iterations,
+		       (double)parse_time / iterations / count);
+	}
+
+	knot_rrset_free(&rrset, NULL);
+
+	return ret;
+}
+
+static void print_help(void)
+{
+	printf("Usage: %s [parameters]\n"
+	       "\n"
+	       "Parameters:\n"
+	       " -r, --rrs <num>         Number of RRs in each RR set (default %u).\n"
+	       " -n, --iterations <num>  Number of conversions per type (default %u).\n"
+	       " -h, --help              Print the program help.\n",
+	       PROGRAM_NAME, DEFAULT_RRS, DEFAULT_ITERATIONS);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned count = DEFAULT_RRS;
+	unsigned iterations = DEFAULT_ITERATIONS;
+
+	struct option opts[] = {
+		{ "rrs",        required_argument, NULL, 'r' },
+		{ "iterations", required_argument, NULL, 'n' },
+		{ "help",       no_argument,       NULL, 'h' },
+		{ NULL }
+	};
+
+	int opt = 0;
+	while ((opt = getopt_long(argc, argv, "r:n:h", opts, NULL)) != -1) {
+		switch (opt) {
+		case 'r':
+			count = strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			iterations = strtoul(optarg, NULL, 10);
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (count == 0 || iterations == 0) {
+		print_help();
+		return EXIT_FAILURE;
+	}
+
+	printf("owner: %s, RRs per set: %u, iterations: %u\n\n",
+	       BENCH_OWNER, count, iterations);
+	printf("%-8s %8s %10s %10s %10s %10s  (nanoseconds)\n",
+	       "type", "size", "write", "write/RR", "parse", "parse/RR");
+
+	int ret = KNOT_EOK;
+	for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+		ret = run_type(types[i].type, types[i].gen, count, iterations);
+		if (ret != KNOT_EOK) {
+			fprintf(stderr, "failed to convert RR set (%s)\n",
+			        knot_strerror(ret));
+			break;
+		}
+	}
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,317 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * Semantic checks throughput benchmark.
+ *
+ * A synthetic NSEC signed zone with dummy signatures is written into
+ * a temporary file and loaded through the zone loader. Some of the hosts
+ * miss a signature, so that there are errors to report. All the semantic
+ * checks are then run with an increasing number of threads and the check
+ * throughput is reported together with a digest of the reported errors,
+ * which must not depend on the number of threads.
+ */
+
+#include <assert.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libknot/libknot.h"
+#include "knot/nameserver/query_timing.h"
+#include "knot/zone/contents.h"
+#include "knot/zone/semantic-check.h"
+#include "knot/zone/zonefile.h"
+
+#define PROGRAM_NAME "bench-semcheck"
+
+#define BENCH_ORIGIN   "example."
+#define BENCH_SIG_LEN  344   /*!< Base64 length of a 2048-bit signature. */
+#define BENCH_DELEG    100   /*!< Hosts per delegation. */
+#define BENCH_UNSIGNED 1000  /*!< Hosts per host missing a signature. */
+
+#define DEFAULT_HOSTS   1000000
+#define DEFAULT_THREADS 8
+
+typedef struct {
+	knot_dname_t *name;
+	const char *types;
+} nsec_owner_t;
+
+/*! \brief Error handler counting the errors and hashing their order. */
+typedef struct {
+	err_handler_t _cb;
+	unsigned count;
+	uint64_t digest;
+} err_handler_digest_t;
+
+static int err_handler_digest(err_handler_t *handler, const zone_contents_t *zone,
+                              const zone_node_t *node, int error, const char *data)
+{
+	err_handler_digest_t *h = (err_handler_digest_t *)handler;
+
+	/* FNV-1a over the node pointers and the error codes. */
+	uint64_t items[2] = { (uintptr_t)node, (uint64_t)error };
+	const uint8_t *bytes = (const uint8_t *)items;
+	for (size_t i = 0; i < sizeof(items); i++) {
+		h->digest ^= bytes[i];
+		h->digest *= 1099511628211ULL;
+	}
+	h->count++;
+
+	return KNOT_EOK;
+}
+
+static int owner_cmp(const void *a, const void *b)
+{
+	const nsec_owner_t *o1 = a, *o2 = b;
+	return knot_dname_cmp(o1->name, o2->name);
+}
+
+static void put_rrsig(FILE *f, const char *owner, const char *type,
+                      unsigned labels, const char *sig)
+{
+	fprintf(f, "%s 3600 RRSIG %s 8 %u 3600 20300101000000 20160101000000 "
+	        "12345 " BENCH_ORIGIN " %s\n", owner, type, labels, sig);
+}
+
+static int add_owner(nsec_owner_t *owners, size_t *count, const char *owner,
+                     const char *types)
+{
+	owners[*count].name = knot_dname_from_str_alloc(owner);
+	owners[*count].types = types;
+	if (owners[*count].name == NULL) {
+		return KNOT_ENOMEM;
+	}
+	*count += 1;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Write the zone with dummy signatures and an NSEC chain. */
+static int write_zone(FILE *f, unsigned hosts)
+{
+	char sig[BENCH_SIG_LEN + 1];
+	memset(sig, 'A', BENCH_SIG_LEN - 2);
+	memcpy(sig + BENCH_SIG_LEN - 2, "==", 3);
+
+	size_t max = 2 + (size_t)hosts + hosts / BENCH_DELEG;
+	nsec_owner_t *owners = calloc(max, sizeof(*owners));
+	if (owners == NULL) {
+		return KNOT_ENOMEM;
+	}
+	size_t count = 0;
+
+	fprintf(f, "$ORIGIN " BENCH_ORIGIN "\n$TTL 3600\n");
+
+	/* Apex. */
+	fprintf(f, "@ SOA ns hostmaster 1 3600 900 604800 300\n"
+	           "@ NS ns\n"
+	           "@ DNSKEY 257 3 8 %s\n", sig);
+	put_rrsig(f, "@", "SOA", 1, sig);
+	put_rrsig(f, "@", "NS", 1, sig);
+	put_rrsig(f, "@", "DNSKEY", 1, sig);
+	int ret = add_owner(owners, &count, BENCH_ORIGIN, "SOA NS DNSKEY RRSIG NSEC");
+
+	fprintf(f, "ns A 192.0.2.1\n");
+	put_rrsig(f, "ns", "A", 2, sig);
+	if (ret == KNOT_EOK) {
+		ret = add_owner(owners, &count, "ns." BENCH_ORIGIN, "A RRSIG NSEC");
+	}
+
+	/* Hosts and delegations with glue. */
+	for (unsigned i = 0; i < hosts && ret == KNOT_EOK; i++) {
+		char owner[64];
+		snprintf(owner, sizeof(owner), "host%u." BENCH_ORIGIN, i);
+		fprintf(f, "%s A 10.%u.%u.%u\n%s AAAA 2001:db8::%x:%x\n",
+		        owner, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff,
+		        owner, i >> 16, i & 0xffff);
+		put_rrsig(f, owner, "A", 2, sig);
+		if (i % BENCH_UNSIGNED != 0) {
+			put_rrsig(f, owner, "AAAA", 2, sig);
+		}
+		ret = add_owner(owners, &count, owner, "A AAAA RRSIG NSEC");
+
+		if (i % BENCH_DELEG == 0 && ret == KNOT_EOK) {
+			snprintf(owner, sizeof(owner), "sub%u." BENCH_ORIGIN, i);
+			fprintf(f, "%s NS ns.%s\nns.%s A 192.0.2.3\n", owner, owner, owner);
+			ret = add_owner(owners, &count, owner, "NS RRSIG NSEC");
+		}
+	}
+
+	/* NSEC chain in canonical order. */
+	if (ret == KNOT_EOK) {
+		qsort(owners, count, sizeof(*owners), owner_cmp);
+	}
+	for (size_t i = 0; i < count && ret == KNOT_EOK; i++) {
+		char owner[KNOT_DNAME_TXT_MAXLEN + 1], next[KNOT_DNAME_TXT_MAXLEN + 1];
+		knot_dname_to_str(owner, owners[i].name, sizeof(owner));
+		knot_dname_to_str(next, owners[(i + 1) % count].name, sizeof(next));
+		fprintf(f, "%s NSEC %s %s\n", owner, next, owners[i].types);
+		put_rrsig(f, owner, "NSEC", knot_dname_labels(owners[i].name, NULL), sig);
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		knot_dname_free(&owners[i].name, NULL);
+	}
+	free(owners);
+
+	if (ret == KNOT_EOK && ferror(f)) {
+		ret = KNOT_ERROR;
+	}
+
+	return ret;
+}
+
+static zone_contents_t *load_zone(unsigned hosts)
+{
+	char path[] = "/tmp/knot-bench-zone.XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		return NULL;
+	}
+	FILE *f = fdopen(fd, "w");
+	if (f == NULL) {
+		close(fd);
+		unlink(path);
+		return NULL;
+	}
+	int ret = write_zone(f, hosts);
+	fclose(f);
+	if (ret != KNOT_EOK) {
+		unlink(path);
+		return NULL;
+	}
+
+	knot_dname_t *origin = knot_dname_from_str_alloc(BENCH_ORIGIN);
+	if (origin == NULL) {
+		unlink(path);
+		return NULL;
+	}
+
+	err_handler_digest_t handler = { { err_handler_digest } };
+
+	zloader_t zl;
+	zone_contents_t *contents = NULL;
+	ret = zonefile_open(&zl, path, origin, false);
+	if (ret == KNOT_EOK) {
+		zl.err_handler = &handler._cb;
+		contents = zonefile_load(&zl);
+		zonefile_close(&zl);
+	}
+
+	knot_dname_free(&origin, NULL);
+	unlink(path);
+
+	return contents;
+}
+
+static void print_help(void)
+{
+	printf("Usage: %s [parameters]\n"
+	       "\n"
+	       "Parameters:\n"
+	       " -r, --hosts <num>    Number of host names in the zone (default %u).\n"
+	       " -t, --threads <num>  Maximal number of threads (default %u).\n"
+	       " -h, --help           Print the program help.\n",
+	       PROGRAM_NAME, DEFAULT_HOSTS, DEFAULT_THREADS);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned hosts = DEFAULT_HOSTS;
+	unsigned max_threads = DEFAULT_THREADS;
+
+	struct option opts[] = {
+		{ "hosts",   required_argument, NULL, 'r' },
+		{ "threads", required_argument, NULL, 't' },
+		{ "help",    no_argument,       NULL, 'h' },
+		{ NULL }
+	};
+
+	int opt = 0;
+	while ((opt = getopt_long(argc, argv, "r:t:h", opts, NULL)) != -1) {
+		switch (opt) {
+		case 'r':
+			hosts = strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			max_threads = strtoul(optarg, NULL, 10);
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (hosts == 0 || max_threads == 0) {
+		print_help();
+		return EXIT_FAILURE;
+	}
+
+	uint64_t load_start = qtime_now();
+	zone_contents_t *zone = load_zone(hosts);
+	if (zone == NULL) {
+		fprintf(stderr, "failed to load zone\n");
+		return EXIT_FAILURE;
+	}
+	double load_time = (qtime_now() - load_start) / 1e9;
+	size_t nodes = zone_tree_weight(zone->nodes);
+
+	printf("zone: %s %u hosts, %zu nodes (loaded in %.2f s)\n\n",
+	       BENCH_ORIGIN, hosts, nodes, load_time);
+	printf("%-8s %10s %14s %8s %8s %18s\n", "threads", "time ms",
+	       "nodes/s", "speedup", "errors", "error digest");
+
+	int ret = KNOT_EOK;
+	uint64_t serial_time = 0;
+	uint64_t serial_digest = 0;
+	for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+		err_handler_digest_t handler = {
+			._cb = { err_handler_digest },
+			.digest = 14695981039346656037ULL
+		};
+
+		uint64_t start = qtime_now();
+		ret = zone_do_sem_checks(zone, true, &handler._cb, threads);
+		uint64_t time = qtime_now() - start;
+		if (ret != KNOT_EOK && ret != KNOT_ESEMCHECK) {
+			fprintf(stderr, "failed to run semantic checks (%s)\n",
+			        knot_strerror(ret));
+			break;
+		}
+		ret = KNOT_EOK;
+
+		if (threads == 1) {
+			serial_time = time;
+			serial_digest = handler.digest;
+		}
+
+		printf("%-8u %10.1f %14.0f %8.2f %8u %016"PRIx64"%s\n", threads,
+		       time / 1e6, nodes / (time / 1e9), (double)serial_time / time,
+		       handler.count, handler.digest,
+		       (handler.digest != serial_digest) ? " (differs)" : "");
+	}
+
+	zone_contents_deep_free(&zone);
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
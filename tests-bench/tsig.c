@@ -0,0 +1,326 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * Signed zone transfer benchmark.
+ *
+ * A session of full-sized AXFR messages is signed with TSIG the same way as
+ * the server does for an outgoing transfer and each message is verified the
+ * same way as the receiving side does it. The messages are signed either
+ * with a new HMAC context for each message, or with a running digest, which
+ * also allows to sign only every N-th message. The signing and verification
+ * throughput is reported.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libknot/libknot.h"
+#include "knot/nameserver/query_timing.h"
+
+#define PROGRAM_NAME "bench-tsig"
+
+#define BENCH_ORIGIN   "example."
+#define BENCH_KEY      "key.example."
+#define BENCH_SECRET   "Zm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFy"
+
+#define MAC_MAX_SIZE   64
+
+#define DEFAULT_MESSAGES 10000
+#define DEFAULT_SIZE     KNOT_WIRE_MAX_PKTSIZE
+#define DEFAULT_INTERVAL 10
+#define DEFAULT_ALG      "hmac-sha256"
+
+typedef struct {
+	const knot_tsig_key_t *key;
+	uint8_t *wire;
+	size_t size;
+	size_t max_size;
+} bench_msg_t;
+
+/*! \brief Build an AXFR message full of A records, leaving space for TSIG. */
+static int make_msg(bench_msg_t *msg, const knot_tsig_key_t *key, size_t max_size)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, max_size, NULL);
+	knot_dname_t *origin = knot_dname_from_str_alloc(BENCH_ORIGIN);
+	if (pkt == NULL || origin == NULL) {
+		knot_dname_free(&origin, NULL);
+		knot_pkt_free(&pkt);
+		return KNOT_ENOMEM;
+	}
+
+	knot_wire_set_qr(pkt->wire);
+	int ret = knot_pkt_put_question(pkt, origin, KNOT_CLASS_IN, KNOT_RRTYPE_AXFR);
+	if (ret == KNOT_EOK) {
+		ret = knot_pkt_begin(pkt, KNOT_ANSWER);
+	}
+	knot_pkt_reserve(pkt, knot_tsig_wire_maxsize(key));
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, origin, KNOT_RRTYPE_A, KNOT_CLASS_IN);
+	for (uint32_t i = 0; ret == KNOT_EOK; i++) {
+		uint8_t addr[4] = { 10, i >> 16, i >> 8, i };
+		ret = knot_rrset_add_rdata(&rr, addr, sizeof(addr), 3600, NULL);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+		ret = knot_pkt_put(pkt, 0, &rr, KNOT_PF_NOTRUNC);
+		knot_rdataset_clear(&rr.rrs, NULL);
+	}
+	if (ret == KNOT_ESPACE && knot_wire_get_ancount(pkt->wire) > 0) {
+		ret = KNOT_EOK;
+	}
+
+	if (ret == KNOT_EOK) {
+		msg->key = key;
+		msg->size = pkt->size;
+		msg->max_size = max_size;
+		msg->wire = malloc(max_size);
+		if (msg->wire == NULL) {
+			ret = KNOT_ENOMEM;
+		} else {
+			memcpy(msg->wire, pkt->wire, pkt->size);
+		}
+	}
+
+	knot_dname_free(&origin, NULL);
+	knot_pkt_free(&pkt);
+
+	return ret;
+}
+
+/*!
+ * \brief Sign and verify a session of messages.
+ *
+ * \param running   Use the running digest, otherwise the per-message API.
+ * \param interval  Sign only every N-th message (running digest only).
+ */
+static int run(bench_msg_t *msg, unsigned messages, bool running,
+               unsigned interval, uint64_t *sign_time, uint64_t *verify_time)
+{
+	const knot_tsig_key_t *key = msg->key;
+	uint8_t query_mac[MAC_MAX_SIZE];
+	memset(query_mac, 0xab, sizeof(query_mac));
+	size_t query_mac_len = dnssec_tsig_algorithm_size(key->algorithm);
+
+	uint8_t sign_mac[MAC_MAX_SIZE];
+	size_t sign_mac_len = query_mac_len;
+	memcpy(sign_mac, query_mac, query_mac_len);
+	knot_tsig_stream_t *sign_stream = knot_tsig_stream_new();
+
+	uint8_t verify_mac[MAC_MAX_SIZE];
+	size_t verify_mac_len = query_mac_len;
+	memcpy(verify_mac, query_mac, query_mac_len);
+	knot_tsig_stream_t *verify_stream = knot_tsig_stream_new();
+
+	*sign_time = 0;
+	*verify_time = 0;
+
+	size_t msg_size = msg->size;
+	int ret = KNOT_EOK;
+	for (unsigned i = 0; i < messages && ret == KNOT_EOK; i++) {
+		msg->size = msg_size;
+		knot_wire_set_arcount(msg->wire, 0);
+		size_t mac_len = sizeof(sign_mac);
+
+		uint64_t start = qtime_now();
+		if (i == 0) {
+			ret = knot_tsig_sign(msg->wire, &msg->size, msg->max_size,
+			                     sign_mac, sign_mac_len, sign_mac, &mac_len,
+			                     key, 0, 0);
+		} else if (!running) {
+			ret = knot_tsig_sign_next(msg->wire, &msg->size, msg->max_size,
+			                          sign_mac, sign_mac_len, sign_mac,
+			                          &mac_len, key, msg->wire, msg->size);
+		} else if (i < messages - 1 && knot_tsig_stream_pending(sign_stream) + 1 < interval) {
+			ret = knot_tsig_stream_add(sign_stream, key, sign_mac,
+			                           sign_mac_len, msg->wire, msg->size);
+			mac_len = sign_mac_len;
+		} else {
+			ret = knot_tsig_sign_next_stream(sign_stream, msg->wire,
+			                                 &msg->size, msg->max_size,
+			                                 sign_mac, sign_mac_len,
+			                                 sign_mac, &mac_len, key);
+		}
+		sign_mac_len = mac_len;
+		*sign_time += qtime_now() - start;
+
+		if (ret != KNOT_EOK) {
+			break;
+		}
+
+		/* The receiving side parses the message (which strips TSIG). */
+		start = qtime_now();
+		knot_pkt_t *pkt = knot_pkt_new(msg->wire, msg->size, NULL);
+		if (pkt == NULL) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+		ret = knot_pkt_parse(pkt, KNOT_PF_NOANSWER);
+		if (ret == KNOT_EOK && pkt->tsig_rr == NULL) {
+			ret = knot_tsig_stream_add(verify_stream, key, verify_mac,
+			                           verify_mac_len, pkt->wire, pkt->size);
+		} else if (ret == KNOT_EOK && !running && i == 0) {
+			ret = knot_tsig_client_check(pkt->tsig_rr, pkt->wire, pkt->size,
+			                             verify_mac, verify_mac_len, key, 0);
+		} else if (ret == KNOT_EOK && !running) {
+			ret = knot_tsig_client_check_next(pkt->tsig_rr, pkt->wire,
+			                                  pkt->size, verify_mac,
+			                                  verify_mac_len, key, 0);
+		} else if (ret == KNOT_EOK && i == 0) {
+			ret = knot_tsig_client_check_stream(verify_stream, pkt->tsig_rr,
+			                                    pkt->wire, pkt->size,
+			                                    verify_mac, verify_mac_len,
+			                                    key, 0);
+		} else if (ret == KNOT_EOK) {
+			ret = knot_tsig_client_check_next_stream(verify_stream,
+			                                         pkt->tsig_rr,
+			                                         pkt->wire, pkt->size,
+			                                         verify_mac, verify_mac_len,
+			                                         key, 0);
+		}
+		if (ret == KNOT_EOK && pkt->tsig_rr != NULL) {
+			verify_mac_len = knot_tsig_rdata_mac_length(pkt->tsig_rr);
+			memcpy(verify_mac, knot_tsig_rdata_mac(pkt->tsig_rr),
+			       verify_mac_len);
+		}
+		knot_pkt_free(&pkt);
+		*verify_time += qtime_now() - start;
+	}
+
+	msg->size = msg_size;
+	knot_tsig_stream_free(sign_stream);
+	knot_tsig_stream_free(verify_stream);
+
+	return ret;
+}
+
+static void print_help(void)
+{
+	printf("Usage: %s [parameters]\n"
+	       "\n"
+	       "Parameters:\n"
+	       " -n, --messages <num>  Number of messages in the session (default %u).\n"
+	       " -s, --size <num>      Maximal message size (default %u).\n"
+	       " -i, --interval <num>  Sign every N-th message (default %u).\n"
+	       " -a, --algorithm <str> TSIG algorithm (default %s).\n"
+	       " -h, --help            Print the program help.\n",
+	       PROGRAM_NAME, DEFAULT_MESSAGES, DEFAULT_SIZE, DEFAULT_INTERVAL,
+	       DEFAULT_ALG);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned messages = DEFAULT_MESSAGES;
+	unsigned size = DEFAULT_SIZE;
+	unsigned interval = DEFAULT_INTERVAL;
+	const char *alg = DEFAULT_ALG;
+
+	struct option opts[] = {
+		{ "messages",  required_argument, NULL, 'n' },
+		{ "size",      required_argument, NULL, 's' },
+		{ "interval",  required_argument, NULL, 'i' },
+		{ "algorithm", required_argument, NULL, 'a' },
+		{ "help",      no_argument,       NULL, 'h' },
+		{ NULL }
+	};
+
+	int opt = 0;
+	while ((opt = getopt_long(argc, argv, "n:s:i:a:h", opts, NULL)) != -1) {
+		switch (opt) {
+		case 'n':
+			messages = strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			size = strtoul(optarg, NULL, 10);
+			break;
+		case 'i':
+			interval = strtoul(optarg, NULL, 10);
+			break;
+		case 'a':
+			alg = optarg;
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (messages == 0 || size < KNOT_WIRE_MIN_PKTSIZE ||
+	    size > KNOT_WIRE_MAX_PKTSIZE || interval == 0 || interval > 100) {
+		print_help();
+		return EXIT_FAILURE;
+	}
+
+	knot_tsig_key_t key;
+	if (knot_tsig_key_init(&key, alg, BENCH_KEY, BENCH_SECRET) != KNOT_EOK) {
+		fprintf(stderr, "invalid algorithm '%s'\n", alg);
+		return EXIT_FAILURE;
+	}
+
+	bench_msg_t msg = { 0 };
+	if (make_msg(&msg, &key, size) != KNOT_EOK) {
+		fprintf(stderr, "failed to create message\n");
+		knot_tsig_key_deinit(&key);
+		return EXIT_FAILURE;
+	}
+
+	printf("session: %u messages of %zu bytes, %s\n\n", messages, msg.size, alg);
+	printf("%-16s %-9s %10s %10s %10s %10s %10s\n", "mode", "interval",
+	       "sign ms", "us/msg", "MB/s", "verify ms", "MB/s");
+
+	static const struct {
+		const char *name;
+		bool running;
+		bool custom;
+	} modes[] = {
+		{ "per-message", false, false },
+		{ "running digest", true, false },
+		{ "running digest", true, true },
+	};
+
+	int ret = KNOT_EOK;
+	for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+		unsigned every = modes[i].custom ? interval : 1;
+		if (modes[i].custom && interval == 1) {
+			continue;
+		}
+
+		uint64_t sign_time = 0, verify_time = 0;
+		ret = run(&msg, messages, modes[i].running, every, &sign_time,
+		          &verify_time);
+		if (ret != KNOT_EOK) {
+			fprintf(stderr, "failed to sign or verify (%s)\n",
+			        knot_strerror(ret));
+			break;
+		}
+
+		double total = (double)messages * msg.size;
+		printf("%-16s %-9u %10.1f %10.2f %10.1f %10.1f %10.1f\n",
+		       modes[i].name, every, sign_time / 1e6,
+		       sign_time / 1e3 / messages, total / (sign_time / 1e3),
+		       verify_time / 1e6, total / (verify_time / 1e3));
+	}
+
+	free(msg.wire);
+	knot_tsig_key_deinit(&key);
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
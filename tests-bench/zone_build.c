@@ -0,0 +1,322 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * Zone contents construction benchmark.
+ *
+ * A synthetic zone is generated in memory as a list of single RRs, either in
+ * the canonical order (as in zone files and zone transfers) or shuffled.
+ * The contents are built from it through the zone creator, which is used by
+ * both the zone loader and AXFR-in, and through the plain per-RR insertion.
+ * Each build runs in a separate process so that its peak memory can be
+ * measured.
+ */
+
+#include <assert.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "libknot/libknot.h"
+#include "knot/nameserver/query_timing.h"
+#include "knot/zone/contents.h"
+#include "knot/zone/zonefile.h"
+
+#define PROGRAM_NAME "bench-zone-build"
+
+#define BENCH_ORIGIN   "example."
+#define BENCH_TTL      3600
+#define BENCH_GROUP    100   /*!< Hosts per empty non-terminal group. */
+
+#define DEFAULT_HOSTS  1000000
+#define DEFAULT_SEED   1
+
+typedef struct {
+	knot_rrset_t *rrs;
+	size_t count;
+	size_t max;
+} rr_list_t;
+
+/*! \brief Simple reproducible PRNG (xorshift64*). */
+static uint64_t rnd_next(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 2685821657736338717ULL;
+}
+
+static int add_rr(rr_list_t *list, const char *owner, uint16_t type,
+                  const uint8_t *rdata, uint16_t rdata_len)
+{
+	assert(list->count < list->max);
+
+	knot_dname_t *name = knot_dname_from_str_alloc(owner);
+	if (name == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_rrset_t *rr = &list->rrs[list->count];
+	knot_rrset_init(rr, name, type, KNOT_CLASS_IN);
+	int ret = knot_rrset_add_rdata(rr, rdata, rdata_len, BENCH_TTL, NULL);
+	if (ret != KNOT_EOK) {
+		knot_dname_free(&name, NULL);
+		return ret;
+	}
+
+	list->count += 1;
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Generate the zone RRs.
+ *
+ * The apex has SOA and NS, each host has A and AAAA below an empty
+ * non-terminal group and every tenth host has a TXT too.
+ */
+static int make_rrs(rr_list_t *list, unsigned hosts)
+{
+	list->max = 2 + 3 * (size_t)hosts;
+	list->rrs = calloc(list->max, sizeof(knot_rrset_t));
+	if (list->rrs == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	static const uint8_t soa[] =
+		"\x02ns\x07""example\x00\x0a""hostmaster\x07""example\x00"
+		"\x00\x00\x00\x01\x00\x00\x0e\x10\x00\x00\x03\x84"
+		"\x00\x09\x3a\x80\x00\x00\x0e\x10";
+	static const uint8_t ns[] = "\x02ns\x07""example\x00";
+	static const uint8_t txt[] = "\x1b""v=spf1 ip4:192.0.2.0/24 -all";
+
+	int ret = add_rr(list, BENCH_ORIGIN, KNOT_RRTYPE_SOA, soa, sizeof(soa) - 1);
+	if (ret == KNOT_EOK) {
+		ret = add_rr(list, BENCH_ORIGIN, KNOT_RRTYPE_NS, ns, sizeof(ns) - 1);
+	}
+
+	for (unsigned i = 0; i < hosts && ret == KNOT_EOK; i++) {
+		char owner[KNOT_DNAME_TXT_MAXLEN];
+		snprintf(owner, sizeof(owner), "host%u.g%u.%s", i, i / BENCH_GROUP,
+		         BENCH_ORIGIN);
+
+		uint8_t a[4] = { 10, i >> 16, i >> 8, i };
+		uint8_t aaaa[16] = { 0x20, 0x01, 0x0d, 0xb8, [12] = i >> 24,
+		                     i >> 16, i >> 8, i };
+		ret = add_rr(list, owner, KNOT_RRTYPE_A, a, sizeof(a));
+		if (ret == KNOT_EOK) {
+			ret = add_rr(list, owner, KNOT_RRTYPE_AAAA, aaaa, sizeof(aaaa));
+		}
+		if (ret == KNOT_EOK && i % 10 == 0) {
+			ret = add_rr(list, owner, KNOT_RRTYPE_TXT, txt, sizeof(txt) - 1);
+		}
+	}
+
+	return ret;
+}
+
+static int rr_cmp(const void *a, const void *b)
+{
+	const knot_rrset_t *rr1 = a, *rr2 = b;
+	int ret = knot_dname_cmp(rr1->owner, rr2->owner);
+	if (ret == 0) {
+		ret = (int)rr1->type - (int)rr2->type;
+	}
+	return ret;
+}
+
+static void shuffle_rrs(rr_list_t *list, uint64_t seed)
+{
+	uint64_t state = seed;
+	for (size_t i = list->count - 1; i > 0; i--) {
+		size_t j = rnd_next(&state) % (i + 1);
+		knot_rrset_t tmp = list->rrs[i];
+		list->rrs[i] = list->rrs[j];
+		list->rrs[j] = tmp;
+	}
+}
+
+static void free_rrs(rr_list_t *list)
+{
+	for (size_t i = 0; i < list->count; i++) {
+		knot_rrset_clear(&list->rrs[i], NULL);
+	}
+	free(list->rrs);
+}
+
+static long maxrss_kb(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+/*! \brief Build the contents and print the results, runs in a child process. */
+static int run_build(const rr_list_t *list, const char *order, bool creator)
+{
+	knot_dname_t *origin = knot_dname_from_str_alloc(BENCH_ORIGIN);
+	if (origin == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	long rss_start = maxrss_kb();
+	uint64_t start = qtime_now();
+
+	zone_contents_t *zone = zone_contents_new(origin);
+	knot_dname_free(&origin, NULL);
+	if (zone == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	zcreator_t zc = { .z = zone, .master = true };
+
+	int ret = KNOT_EOK;
+	for (size_t i = 0; i < list->count && ret == KNOT_EOK; i++) {
+		if (creator) {
+			ret = zcreator_step(&zc, &list->rrs[i]);
+		} else {
+			zone_node_t *node = NULL;
+			ret = zone_contents_add_rr(zone, &list->rrs[i], &node);
+		}
+	}
+	uint64_t build_time = qtime_now() - start;
+
+	start = qtime_now();
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_adjust_full(zone);
+	}
+	uint64_t adjust_time = qtime_now() - start;
+
+	if (ret == KNOT_EOK) {
+		printf("%-10s %-8s %10.1f %10.1f %10.1f %10ld\n",
+		       order, creator ? "creator" : "insert",
+		       build_time / 1e6, adjust_time / 1e6,
+		       (double)build_time / list->count,
+		       maxrss_kb() - rss_start);
+	}
+
+	zone_contents_deep_free(&zone);
+
+	return ret;
+}
+
+static int run_child(const rr_list_t *list, const char *order, bool creator)
+{
+	fflush(stdout);
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		return KNOT_ERROR;
+	} else if (pid == 0) {
+		int ret = run_build(list, order, creator);
+		fflush(stdout);
+		_exit(ret == KNOT_EOK ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	int status = 0;
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+	    WEXITSTATUS(status) != EXIT_SUCCESS) {
+		return KNOT_ERROR;
+	}
+
+	return KNOT_EOK;
+}
+
+static void print_help(void)
+{
+	printf("Usage: %s [parameters]\n"
+	       "\n"
+	       "Parameters:\n"
+	       " -r, --hosts <num>  Number of host names in the zone (default %u).\n"
+	       " -s, --seed <num>   Shuffling seed (default %u).\n"
+	       " -h, --help         Print the program help.\n",
+	       PROGRAM_NAME, DEFAULT_HOSTS, DEFAULT_SEED);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned hosts = DEFAULT_HOSTS;
+	uint64_t seed = DEFAULT_SEED;
+
+	struct option opts[] = {
+		{ "hosts", required_argument, NULL, 'r' },
+		{ "seed",  required_argument, NULL, 's' },
+		{ "help",  no_argument,       NULL, 'h' },
+		{ NULL }
+	};
+
+	int opt = 0;
+	while ((opt = getopt_long(argc, argv, "r:s:h", opts, NULL)) != -1) {
+		switch (opt) {
+		case 'r':
+			hosts = strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			seed = strtoull(optarg, NULL, 10);
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (hosts == 0) {
+		print_help();
+		return EXIT_FAILURE;
+	}
+
+	rr_list_t list = { NULL };
+	if (make_rrs(&list, hosts) != KNOT_EOK) {
+		fprintf(stderr, "failed to generate zone\n");
+		free_rrs(&list);
+		return EXIT_FAILURE;
+	}
+
+	printf("zone: %s %u hosts, %zu RRs, seed: %"PRIu64"\n\n",
+	       BENCH_ORIGIN, hosts, list.count, seed);
+	printf("%-10s %-8s %10s %10s %10s %10s\n", "order", "path",
+	       "build ms", "adjust ms", "ns/RR", "peak kB");
+
+	int ret = KNOT_EOK;
+	for (int shuffled = 0; shuffled <= 1 && ret == KNOT_EOK; shuffled++) {
+		const char *order = "sorted";
+		if (shuffled) {
+			shuffle_rrs(&list, seed);
+			order = "shuffled";
+		} else {
+			qsort(list.rrs, list.count, sizeof(knot_rrset_t), rr_cmp);
+		}
+
+		ret = run_child(&list, order, false);
+		if (ret == KNOT_EOK) {
+			ret = run_child(&list, order, true);
+		}
+	}
+
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to build zone\n");
+	}
+
+	free_rrs(&list);
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,274 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * Zone difference benchmark.
+ *
+ * Two versions of a synthetic zone are built in memory, the second one with
+ * an increased SOA serial and a configurable fraction of the hosts changed:
+ * an address changed, a record removed, a TTL changed or a host added. The
+ * difference is then computed, as for ixfr-from-differences, with an
+ * increasing number of threads. The time and the number of changes are
+ * reported together with a digest of the changes, which must not depend on
+ * the number of threads.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libknot/libknot.h"
+#include "knot/nameserver/query_timing.h"
+#include "knot/updates/changesets.h"
+#include "knot/zone/contents.h"
+#include "knot/zone/zone-diff.h"
+
+#define PROGRAM_NAME "bench-zone-diff"
+
+#define BENCH_ORIGIN   "example."
+#define BENCH_TTL      3600
+
+#define DEFAULT_HOSTS   1000000
+#define DEFAULT_CHANGED 10000
+#define DEFAULT_THREADS 8
+
+static int add_rr(zone_contents_t *zone, const char *owner, uint16_t type,
+                  const uint8_t *rdata, uint16_t rdata_len, uint32_t ttl)
+{
+	knot_dname_t *name = knot_dname_from_str_alloc(owner);
+	if (name == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, name, type, KNOT_CLASS_IN);
+	int ret = knot_rrset_add_rdata(&rr, rdata, rdata_len, ttl, NULL);
+	if (ret == KNOT_EOK) {
+		zone_node_t *node = NULL;
+		ret = zone_contents_add_rr(zone, &rr, &node);
+	}
+	knot_rrset_clear(&rr, NULL);
+
+	return ret;
+}
+
+/*!
+ * \brief Build the zone.
+ *
+ * Each host has A and AAAA records. In the second version, every n-th host is
+ * changed in one of four ways.
+ */
+static zone_contents_t *make_zone(unsigned hosts, unsigned every, bool changed)
+{
+	knot_dname_t *origin = knot_dname_from_str_alloc(BENCH_ORIGIN);
+	if (origin == NULL) {
+		return NULL;
+	}
+	zone_contents_t *zone = zone_contents_new(origin);
+	knot_dname_free(&origin, NULL);
+	if (zone == NULL) {
+		return NULL;
+	}
+
+	uint8_t soa[] =
+		"\x02ns\x07""example\x00\x0a""hostmaster\x07""example\x00"
+		"\x00\x00\x00\x01\x00\x00\x0e\x10\x00\x00\x03\x84"
+		"\x00\x09\x3a\x80\x00\x00\x0e\x10";
+	static const uint8_t ns[] = "\x02ns\x07""example\x00";
+	if (changed) {
+		soa[sizeof(soa) - 1 - 20 + 3] = 2; // Serial.
+	}
+
+	int ret = add_rr(zone, BENCH_ORIGIN, KNOT_RRTYPE_SOA, soa, sizeof(soa) - 1,
+	                 BENCH_TTL);
+	if (ret == KNOT_EOK) {
+		ret = add_rr(zone, BENCH_ORIGIN, KNOT_RRTYPE_NS, ns, sizeof(ns) - 1,
+		             BENCH_TTL);
+	}
+
+	for (unsigned i = 0; i < hosts && ret == KNOT_EOK; i++) {
+		unsigned change = (changed && i % every == 0) ? (i / every) % 4 + 1 : 0;
+
+		char owner[KNOT_DNAME_TXT_MAXLEN];
+		snprintf(owner, sizeof(owner), "host%u.%s", i, BENCH_ORIGIN);
+
+		uint8_t a[4] = { 10, i >> 16, i >> 8, i };
+		uint8_t aaaa[16] = { 0x20, 0x01, 0x0d, 0xb8, [12] = i >> 24,
+		                     i >> 16, i >> 8, i };
+		uint32_t ttl = BENCH_TTL;
+		switch (change) {
+		case 1: a[0] = 172; break;           // Address changed.
+		case 2: aaaa[0] = 0; break;          // AAAA removed.
+		case 3: ttl = 2 * BENCH_TTL; break;  // TTL changed.
+		case 4:                              // Host added.
+			snprintf(owner, sizeof(owner), "new%u.%s", i, BENCH_ORIGIN);
+			break;
+		}
+
+		ret = add_rr(zone, owner, KNOT_RRTYPE_A, a, sizeof(a), ttl);
+		if (ret == KNOT_EOK && aaaa[0] != 0) {
+			ret = add_rr(zone, owner, KNOT_RRTYPE_AAAA, aaaa, sizeof(aaaa), ttl);
+		}
+		if (ret == KNOT_EOK && change == 4) {
+			snprintf(owner, sizeof(owner), "host%u.%s", i, BENCH_ORIGIN);
+			ret = add_rr(zone, owner, KNOT_RRTYPE_A, a, sizeof(a), ttl);
+		}
+	}
+
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(&zone);
+	}
+
+	return zone;
+}
+
+/*! \brief FNV-1a digest of the changes in the text form. */
+static int changes_digest(const changeset_t *ch, uint64_t *digest)
+{
+	changeset_iter_t itt;
+	int ret = changeset_iter_all(&itt, ch, true);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	*digest = 14695981039346656037ULL;
+
+	char buf[4096];
+	knot_rrset_t rrset = changeset_iter_next(&itt);
+	while (!knot_rrset_empty(&rrset)) {
+		int len = knot_rrset_txt_dump(&rrset, buf, sizeof(buf),
+		                              &KNOT_DUMP_STYLE_DEFAULT);
+		for (int i = 0; i < len; i++) {
+			*digest ^= (uint8_t)buf[i];
+			*digest *= 1099511628211ULL;
+		}
+		rrset = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+
+	return KNOT_EOK;
+}
+
+static void print_help(void)
+{
+	printf("Usage: %s [parameters]\n"
+	       "\n"
+	       "Parameters:\n"
+	       " -r, --hosts <num>    Number of host names in the zone (default %u).\n"
+	       " -c, --changed <num>  Number of changed hosts (default %u).\n"
+	       " -t, --threads <num>  Maximal number of threads (default %u).\n"
+	       " -h, --help           Print the program help.\n",
+	       PROGRAM_NAME, DEFAULT_HOSTS, DEFAULT_CHANGED, DEFAULT_THREADS);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned hosts = DEFAULT_HOSTS;
+	unsigned changed = DEFAULT_CHANGED;
+	unsigned max_threads = DEFAULT_THREADS;
+
+	struct option opts[] = {
+		{ "hosts",   required_argument, NULL, 'r' },
+		{ "changed", required_argument, NULL, 'c' },
+		{ "threads", required_argument, NULL, 't' },
+		{ "help",    no_argument,       NULL, 'h' },
+		{ NULL }
+	};
+
+	int opt = 0;
+	while ((opt = getopt_long(argc, argv, "r:c:t:h", opts, NULL)) != -1) {
+		switch (opt) {
+		case 'r':
+			hosts = strtoul(optarg, NULL, 10);
+			break;
+		case 'c':
+			changed = strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			max_threads = strtoul(optarg, NULL, 10);
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (hosts == 0 || changed == 0 || changed > hosts || max_threads == 0) {
+		print_help();
+		return EXIT_FAILURE;
+	}
+
+	unsigned every = hosts / changed;
+	zone_contents_t *zone1 = make_zone(hosts, every, false);
+	zone_contents_t *zone2 = make_zone(hosts, every, true);
+	if (zone1 == NULL || zone2 == NULL) {
+		fprintf(stderr, "failed to build zone\n");
+		zone_contents_deep_free(&zone1);
+		zone_contents_deep_free(&zone2);
+		return EXIT_FAILURE;
+	}
+
+	printf("zone: %s %u hosts, every %u. changed\n\n", BENCH_ORIGIN, hosts, every);
+	printf("%-8s %10s %10s %8s %10s %18s\n", "threads", "time ms",
+	       "ns/node", "speedup", "changes", "changes digest");
+
+	int ret = KNOT_EOK;
+	uint64_t serial_time = 0;
+	uint64_t serial_digest = 0;
+	size_t nodes = zone_tree_weight(zone1->nodes) + zone_tree_weight(zone2->nodes);
+	for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+		changeset_t ch;
+		ret = changeset_init(&ch, zone1->apex->owner);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+
+		uint64_t start = qtime_now();
+		ret = zone_contents_diff(zone1, zone2, &ch, threads);
+		uint64_t time = qtime_now() - start;
+
+		uint64_t digest = 0;
+		if (ret == KNOT_EOK) {
+			ret = changes_digest(&ch, &digest);
+		}
+		if (ret != KNOT_EOK) {
+			fprintf(stderr, "failed to diff zone (%s)\n", knot_strerror(ret));
+			changeset_clear(&ch);
+			break;
+		}
+
+		if (threads == 1) {
+			serial_time = time;
+			serial_digest = digest;
+		}
+
+		printf("%-8u %10.1f %10.1f %8.2f %10zu %016"PRIx64"%s\n", threads,
+		       time / 1e6, (double)time / nodes, (double)serial_time / time,
+		       changeset_size(&ch), digest,
+		       (digest != serial_digest) ? " (differs)" : "");
+
+		changeset_clear(&ch);
+	}
+
+	zone_contents_deep_free(&zone1);
+	zone_contents_deep_free(&zone2);
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
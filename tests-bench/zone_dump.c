@@ -0,0 +1,265 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * Zone file writing benchmark.
+ *
+ * A synthetic signed zone with dummy signatures is written into a temporary
+ * file and loaded through the zone loader. The zone is then written back into
+ * a zone file the same way as when the server flushes a zone, with
+ * an increasing number of formatting threads. The write throughput is reported
+ * together with a digest of the written file, which must not depend on the
+ * number of threads.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libknot/libknot.h"
+#include "knot/nameserver/query_timing.h"
+#include "knot/zone/contents.h"
+#include "knot/zone/zonefile.h"
+
+#define PROGRAM_NAME "bench-zone-dump"
+
+#define BENCH_ORIGIN   "example."
+#define BENCH_SIG_LEN  344   /*!< Base64 length of a 2048-bit signature. */
+
+#define DEFAULT_HOSTS   1000000
+#define DEFAULT_THREADS 8
+
+static void put_rrsig(FILE *f, const char *owner, const char *type,
+                      unsigned labels, const char *sig)
+{
+	fprintf(f, "%s 3600 RRSIG %s 8 %u 3600 20300101000000 20160101000000 "
+	        "12345 " BENCH_ORIGIN " %s\n", owner, type, labels, sig);
+}
+
+/*! \brief Write the zone with dummy signatures (NSEC chain is not needed). */
+static int write_zone(FILE *f, unsigned hosts)
+{
+	char sig[BENCH_SIG_LEN + 1];
+	for (size_t i = 0; i < BENCH_SIG_LEN - 2; i++) {
+		sig[i] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"[i % 52];
+	}
+	memcpy(sig + BENCH_SIG_LEN - 2, "==", 3);
+
+	fprintf(f, "$ORIGIN " BENCH_ORIGIN "\n$TTL 3600\n");
+
+	fprintf(f, "@ SOA ns hostmaster 1 3600 900 604800 300\n"
+	           "@ NS ns\n"
+	           "@ DNSKEY 257 3 8 %s\n", sig);
+	put_rrsig(f, "@", "SOA", 1, sig);
+	put_rrsig(f, "@", "NS", 1, sig);
+	put_rrsig(f, "@", "DNSKEY", 1, sig);
+
+	fprintf(f, "ns A 192.0.2.1\n");
+	put_rrsig(f, "ns", "A", 2, sig);
+
+	for (unsigned i = 0; i < hosts; i++) {
+		char owner[64];
+		snprintf(owner, sizeof(owner), "host%u." BENCH_ORIGIN, i);
+		fprintf(f, "%s A 10.%u.%u.%u\n%s AAAA 2001:db8::%x:%x\n",
+		        owner, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff,
+		        owner, i >> 16, i & 0xffff);
+		if (i % 10 == 0) {
+			fprintf(f, "%s TXT \"v=spf1 ip4:192.0.2.0/24 -all\"\n", owner);
+		}
+		put_rrsig(f, owner, "A", 2, sig);
+		put_rrsig(f, owner, "AAAA", 2, sig);
+	}
+
+	return ferror(f) ? KNOT_ERROR : KNOT_EOK;
+}
+
+static zone_contents_t *load_zone(unsigned hosts)
+{
+	char path[] = "/tmp/knot-bench-zone.XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		return NULL;
+	}
+	FILE *f = fdopen(fd, "w");
+	if (f == NULL) {
+		close(fd);
+		unlink(path);
+		return NULL;
+	}
+	int ret = write_zone(f, hosts);
+	fclose(f);
+	if (ret != KNOT_EOK) {
+		unlink(path);
+		return NULL;
+	}
+
+	knot_dname_t *origin = knot_dname_from_str_alloc(BENCH_ORIGIN);
+	if (origin == NULL) {
+		unlink(path);
+		return NULL;
+	}
+
+	err_handler_logger_t handler = { { err_handler_logger } };
+
+	zloader_t zl;
+	zone_contents_t *contents = NULL;
+	ret = zonefile_open(&zl, path, origin, false);
+	if (ret == KNOT_EOK) {
+		zl.err_handler = &handler._cb;
+		contents = zonefile_load(&zl);
+		zonefile_close(&zl);
+	}
+
+	knot_dname_free(&origin, NULL);
+	unlink(path);
+
+	return contents;
+}
+
+/*! \brief FNV-1a digest of the file without the trailing time comment. */
+static int file_digest(const char *path, uint64_t *digest, size_t *size)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL) {
+		return KNOT_EFILE;
+	}
+
+	*digest = 14695981039346656037ULL;
+	*size = 0;
+
+	char line[4096];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		size_t len = strlen(line);
+		*size += len;
+		if (strncmp(line, ";; Time ", 8) == 0) {
+			continue;
+		}
+		for (size_t i = 0; i < len; i++) {
+			*digest ^= (uint8_t)line[i];
+			*digest *= 1099511628211ULL;
+		}
+	}
+	fclose(f);
+
+	return KNOT_EOK;
+}
+
+static void print_help(void)
+{
+	printf("Usage: %s [parameters]\n"
+	       "\n"
+	       "Parameters:\n"
+	       " -r, --hosts <num>    Number of host names in the zone (default %u).\n"
+	       " -t, --threads <num>  Maximal number of threads (default %u).\n"
+	       " -h, --help           Print the program help.\n",
+	       PROGRAM_NAME, DEFAULT_HOSTS, DEFAULT_THREADS);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned hosts = DEFAULT_HOSTS;
+	unsigned max_threads = DEFAULT_THREADS;
+
+	struct option opts[] = {
+		{ "hosts",   required_argument, NULL, 'r' },
+		{ "threads", required_argument, NULL, 't' },
+		{ "help",    no_argument,       NULL, 'h' },
+		{ NULL }
+	};
+
+	int opt = 0;
+	while ((opt = getopt_long(argc, argv, "r:t:h", opts, NULL)) != -1) {
+		switch (opt) {
+		case 'r':
+			hosts = strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			max_threads = strtoul(optarg, NULL, 10);
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (hosts == 0 || max_threads == 0) {
+		print_help();
+		return EXIT_FAILURE;
+	}
+
+	uint64_t load_start = qtime_now();
+	zone_contents_t *zone = load_zone(hosts);
+	if (zone == NULL) {
+		fprintf(stderr, "failed to load zone\n");
+		return EXIT_FAILURE;
+	}
+	double load_time = (qtime_now() - load_start) / 1e9;
+
+	char dir[] = "/tmp/knot-bench-dump.XXXXXX";
+	if (mkdtemp(dir) == NULL) {
+		fprintf(stderr, "failed to create directory\n");
+		zone_contents_deep_free(&zone);
+		return EXIT_FAILURE;
+	}
+	char path[sizeof(dir) + 16];
+	snprintf(path, sizeof(path), "%s/zone", dir);
+
+	printf("zone: %s %u hosts, %zu nodes (loaded in %.2f s)\n\n",
+	       BENCH_ORIGIN, hosts, zone_tree_weight(zone->nodes), load_time);
+	printf("%-8s %10s %10s %8s %10s %18s\n", "threads", "time ms",
+	       "MB/s", "speedup", "size MB", "file digest");
+
+	int ret = KNOT_EOK;
+	uint64_t serial_time = 0;
+	uint64_t serial_digest = 0;
+	for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+		uint64_t start = qtime_now();
+		ret = zonefile_write(path, zone, threads);
+		uint64_t time = qtime_now() - start;
+
+		uint64_t digest = 0;
+		size_t size = 0;
+		if (ret == KNOT_EOK) {
+			ret = file_digest(path, &digest, &size);
+		}
+		if (ret != KNOT_EOK) {
+			fprintf(stderr, "failed to write zone file (%s)\n",
+			        knot_strerror(ret));
+			break;
+		}
+
+		if (threads == 1) {
+			serial_time = time;
+			serial_digest = digest;
+		}
+
+		printf("%-8u %10.1f %10.1f %8.2f %10.1f %016"PRIx64"%s\n", threads,
+		       time / 1e6, size / (time / 1e3), (double)serial_time / time,
+		       size / 1e6, digest,
+		       (digest != serial_digest) ? " (differs)" : "");
+	}
+
+	unlink(path);
+	rmdir(dir);
+	zone_contents_deep_free(&zone);
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
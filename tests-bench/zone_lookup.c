@@ -0,0 +1,397 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * Zone lookup benchmark.
+ *
+ * A synthetic zone is built by inserting the hosts in a random order, so its
+ * nodes are spread over the heap as after a long run of updates. Random names
+ * are then looked up in the zone itself and in its read-only copies allocated
+ * in an arena of regular pages and in an arena of huge pages. The data TLB
+ * misses are counted with the Linux performance counters if available.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+
+#include "libknot/libknot.h"
+#include "knot/nameserver/query_timing.h"
+#include "knot/zone/contents.h"
+#include "contrib/ucw/mempool.h"
+
+#define PROGRAM_NAME "bench-zone-lookup"
+
+#define BENCH_ORIGIN   "example."
+#define BENCH_TTL      3600
+#define BENCH_GROUP    100      /*!< Hosts per empty non-terminal group. */
+#define BENCH_POOL     1048576  /*!< Number of distinct pre-generated names. */
+
+#define DEFAULT_HOSTS   1000000
+#define DEFAULT_LOOKUPS 10000000
+#define DEFAULT_SEED    1
+
+typedef struct {
+	uint8_t *wire;     /*!< Names in wire format, one after another. */
+	size_t *offset;    /*!< Offsets of the names. */
+	size_t count;
+} name_pool_t;
+
+/*! \brief Simple reproducible PRNG (xorshift64*). */
+static uint64_t rnd_next(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * 2685821657736338717ULL;
+}
+
+static void host_name(char *buf, size_t size, unsigned i)
+{
+	snprintf(buf, size, "host%u.g%u.%s", i, i / BENCH_GROUP, BENCH_ORIGIN);
+}
+
+static int add_rr(zone_contents_t *zone, const char *owner, uint16_t type,
+                  const uint8_t *rdata, uint16_t rdata_len)
+{
+	knot_dname_t name[KNOT_DNAME_MAXLEN];
+	if (knot_dname_from_str(name, owner, sizeof(name)) == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, name, type, KNOT_CLASS_IN);
+	int ret = knot_rrset_add_rdata(&rr, rdata, rdata_len, BENCH_TTL, NULL);
+	if (ret == KNOT_EOK) {
+		zone_node_t *node = NULL;
+		ret = zone_contents_add_rr(zone, &rr, &node);
+	}
+	knot_rdataset_clear(&rr.rrs, NULL);
+
+	return ret;
+}
+
+/*!
+ * \brief Build the zone, hosts with A and AAAA are inserted in a random order.
+ */
+static int make_zone(unsigned hosts, uint64_t seed, zone_contents_t **out)
+{
+	knot_dname_t *origin = knot_dname_from_str_alloc(BENCH_ORIGIN);
+	zone_contents_t *zone = zone_contents_new(origin);
+	knot_dname_free(&origin, NULL);
+	unsigned *order = malloc(hosts * sizeof(unsigned));
+	if (zone == NULL || order == NULL) {
+		zone_contents_deep_free(&zone);
+		free(order);
+		return KNOT_ENOMEM;
+	}
+
+	static const uint8_t soa[] =
+		"\x02ns\x07""example\x00\x0a""hostmaster\x07""example\x00"
+		"\x00\x00\x00\x01\x00\x00\x0e\x10\x00\x00\x03\x84"
+		"\x00\x09\x3a\x80\x00\x00\x0e\x10";
+	static const uint8_t ns[] = "\x02ns\x07""example\x00";
+
+	int ret = add_rr(zone, BENCH_ORIGIN, KNOT_RRTYPE_SOA, soa, sizeof(soa) - 1);
+	if (ret == KNOT_EOK) {
+		ret = add_rr(zone, BENCH_ORIGIN, KNOT_RRTYPE_NS, ns, sizeof(ns) - 1);
+	}
+
+	uint64_t state = seed;
+	for (unsigned i = 0; i < hosts; i++) {
+		order[i] = i;
+	}
+	for (unsigned i = hosts - 1; i > 0; i--) {
+		unsigned j = rnd_next(&state) % (i + 1);
+		unsigned tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+
+	for (unsigned k = 0; k < hosts && ret == KNOT_EOK; k++) {
+		unsigned i = order[k];
+		char owner[KNOT_DNAME_TXT_MAXLEN];
+		host_name(owner, sizeof(owner), i);
+
+		uint8_t a[4] = { 10, i >> 16, i >> 8, i };
+		uint8_t aaaa[16] = { 0x20, 0x01, 0x0d, 0xb8, [12] = i >> 24,
+		                     i >> 16, i >> 8, i };
+		ret = add_rr(zone, owner, KNOT_RRTYPE_A, a, sizeof(a));
+		if (ret == KNOT_EOK) {
+			ret = add_rr(zone, owner, KNOT_RRTYPE_AAAA, aaaa, sizeof(aaaa));
+		}
+	}
+	free(order);
+
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_adjust_full(zone);
+	}
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(&zone);
+		return ret;
+	}
+
+	*out = zone;
+	return KNOT_EOK;
+}
+
+/*! \brief Generate random names, every tenth one doesn't exist. */
+static int make_names(name_pool_t *pool, unsigned hosts, uint64_t seed)
+{
+	pool->count = BENCH_POOL;
+	pool->wire = malloc(pool->count * KNOT_DNAME_MAXLEN);
+	pool->offset = malloc(pool->count * sizeof(size_t));
+	if (pool->wire == NULL || pool->offset == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	uint64_t state = seed + 1;
+	size_t pos = 0;
+	for (size_t i = 0; i < pool->count; i++) {
+		unsigned host = rnd_next(&state) % hosts;
+		char name[KNOT_DNAME_TXT_MAXLEN];
+		if (i % 10 == 9) {
+			snprintf(name, sizeof(name), "none%u.g%u.%s", host,
+			         host / BENCH_GROUP, BENCH_ORIGIN);
+		} else {
+			host_name(name, sizeof(name), host);
+		}
+		if (knot_dname_from_str(pool->wire + pos, name, KNOT_DNAME_MAXLEN) == NULL) {
+			return KNOT_EINVAL;
+		}
+		pool->offset[i] = pos;
+		pos += knot_dname_size(pool->wire + pos);
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Open a counter of data TLB read misses, -1 if not available. */
+static int dtlb_open(void)
+{
+#if defined(__linux__) && defined(__NR_perf_event_open)
+	struct perf_event_attr attr = {
+		.type = PERF_TYPE_HW_CACHE,
+		.size = sizeof(attr),
+		.config = PERF_COUNT_HW_CACHE_DTLB |
+		          (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		.disabled = 1,
+		.exclude_kernel = 1,
+		.exclude_hv = 1
+	};
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+	return -1;
+#endif
+}
+
+static void dtlb_start(int fd)
+{
+#ifdef __linux__
+	if (fd >= 0) {
+		ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+		ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+static int64_t dtlb_stop(int fd)
+{
+	uint64_t count = 0;
+#ifdef __linux__
+	if (fd >= 0) {
+		ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(fd, &count, sizeof(count)) == sizeof(count)) {
+			return count;
+		}
+	}
+#endif
+	return -1;
+}
+
+/*! \brief Anonymous memory in transparent huge pages (kB), -1 if unknown. */
+static long anon_huge_kb(void)
+{
+	FILE *file = fopen("/proc/self/smaps_rollup", "r");
+	if (file == NULL) {
+		return -1;
+	}
+
+	long kb = -1;
+	char line[128];
+	while (fgets(line, sizeof(line), file) != NULL) {
+		if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) {
+			break;
+		}
+	}
+	fclose(file);
+
+	return kb;
+}
+
+/*! \brief Keeps the touched answer data alive. */
+static volatile uint8_t sink;
+
+static const char *fmt_num(char *buf, size_t size, double value, const char *fmt)
+{
+	if (value < 0) {
+		return "-";
+	}
+	snprintf(buf, size, fmt, value);
+	return buf;
+}
+
+static void run_lookups(const char *variant, const zone_contents_t *zone,
+                        const name_pool_t *pool, unsigned lookups, long huge_kb)
+{
+	int dtlb = dtlb_open();
+
+	size_t found = 0;
+	dtlb_start(dtlb);
+	uint64_t start = qtime_now();
+	for (unsigned i = 0; i < lookups; i++) {
+		const knot_dname_t *name = pool->wire + pool->offset[i % pool->count];
+		const zone_node_t *node = NULL, *encloser = NULL, *prev = NULL;
+		int ret = zone_contents_find_dname(zone, name, &node, &encloser, &prev);
+		if (ret == ZONE_NAME_FOUND) {
+			/* Touch the answer data as the query processing does. */
+			const knot_rdataset_t *rrs = node_rdataset(node, KNOT_RRTYPE_A);
+			sink += knot_rdata_data(knot_rdataset_at(rrs, 0))[3];
+			found += 1;
+		}
+	}
+	uint64_t time = qtime_now() - start;
+	int64_t misses = dtlb_stop(dtlb);
+	if (dtlb >= 0) {
+		close(dtlb);
+	}
+
+	double memory = (zone->mm != NULL) ? (double)mp_total_size(zone->mm->ctx) / 1024 : -1;
+
+	char mem_buf[32], huge_buf[32], dtlb_buf[32];
+	printf("%-8s %10s %10s %10.1f %12s %10zu\n", variant,
+	       fmt_num(mem_buf, sizeof(mem_buf), memory, "%.0f"),
+	       fmt_num(huge_buf, sizeof(huge_buf), huge_kb, "%.0f"),
+	       (double)time / lookups,
+	       fmt_num(dtlb_buf, sizeof(dtlb_buf),
+	               (misses >= 0) ? (double)misses / lookups : -1, "%.3f"),
+	       found);
+}
+
+static void print_help(void)
+{
+	printf("Usage: %s [parameters]\n"
+	       "\n"
+	       "Parameters:\n"
+	       " -r, --hosts <num>    Number of host names in the zone (default %u).\n"
+	       " -n, --lookups <num>  Number of lookups (default %u).\n"
+	       " -s, --seed <num>     Random seed (default %u).\n"
+	       " -h, --help           Print the program help.\n",
+	       PROGRAM_NAME, DEFAULT_HOSTS, DEFAULT_LOOKUPS, DEFAULT_SEED);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned hosts = DEFAULT_HOSTS;
+	unsigned lookups = DEFAULT_LOOKUPS;
+	uint64_t seed = DEFAULT_SEED;
+
+	struct option opts[] = {
+		{ "hosts",   required_argument, NULL, 'r' },
+		{ "lookups", required_argument, NULL, 'n' },
+		{ "seed",    required_argument, NULL, 's' },
+		{ "help",    no_argument,       NULL, 'h' },
+		{ NULL }
+	};
+
+	int opt = 0;
+	while ((opt = getopt_long(argc, argv, "r:n:s:h", opts, NULL)) != -1) {
+		switch (opt) {
+		case 'r':
+			hosts = strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			lookups = strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			seed = strtoull(optarg, NULL, 10);
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (hosts == 0 || lookups == 0) {
+		print_help();
+		return EXIT_FAILURE;
+	}
+
+	zone_contents_t *zone = NULL;
+	name_pool_t pool = { NULL };
+	int ret = make_zone(hosts, seed, &zone);
+	if (ret == KNOT_EOK) {
+		ret = make_names(&pool, hosts, seed);
+	}
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to generate zone (%s)\n", knot_strerror(ret));
+		zone_contents_deep_free(&zone);
+		free(pool.wire);
+		free(pool.offset);
+		return EXIT_FAILURE;
+	}
+
+	printf("zone: %s %u hosts, lookups: %u, seed: %"PRIu64"\n\n",
+	       BENCH_ORIGIN, hosts, lookups, seed);
+	printf("%-8s %10s %10s %10s %12s %10s\n", "variant", "arena kB",
+	       "THP kB", "ns/lookup", "dTLB/lookup", "found");
+
+	run_lookups("malloc", zone, &pool, lookups, -1);
+
+	for (int huge = 0; huge <= 1 && ret == KNOT_EOK; huge++) {
+		long huge_kb = anon_huge_kb();
+		zone_contents_t *copy = NULL;
+		ret = zone_contents_deep_copy(zone, &copy, huge);
+		if (ret == KNOT_EOK) {
+			if (huge_kb >= 0) {
+				huge_kb = anon_huge_kb() - huge_kb;
+			}
+			run_lookups(huge ? "huge" : "arena", copy, &pool, lookups, huge_kb);
+			zone_contents_deep_free(&copy);
+		}
+	}
+
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to copy zone (%s)\n", knot_strerror(ret));
+	}
+
+	zone_contents_deep_free(&zone);
+	free(pool.wire);
+	free(pool.offset);
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -86,7 +86,7 @@ static void test_acl_allowed(void)
 		"    key: [ key2_md5, key3_sha256 ]\n"
 		"    action: [ notify, update ]\n"
 		"  - id: acl_range_addr\n"
-		"    address: [ 100.0.0.0-100.0.0.5, ::0-::5 ]\n"
+		"    address: [ 100.0.0.0-100.0.0.5, 100.0.0.250-100.0.1.5, ::0-::5 ]\n"
 		"    action: [ transfer ]\n"
 		"\n"
 		"zone:\n"
@@ -176,6 +176,18 @@ static void test_acl_allowed(void)
 	ret = acl_allowed(conf(), &acl, ACL_ACTION_TRANSFER, &addr, &key0);
 	ok(ret == true, "IPv4 address from range, no key, action match");
 
+	acl = conf_zone_get(conf(), C_ACL, zone_name);
+	ok(acl.code == KNOT_EOK, "Get zone ACL");
+	check_sockaddr_set(&addr, AF_INET, "100.0.1.1", 0);
+	ret = acl_allowed(conf(), &acl, ACL_ACTION_TRANSFER, &addr, &key0);
+	ok(ret == true, "IPv4 address from multi-byte range, no key, action match");
+
+	acl = conf_zone_get(conf(), C_ACL, zone_name);
+	ok(acl.code == KNOT_EOK, "Get zone ACL");
+	check_sockaddr_set(&addr, AF_INET, "100.0.1.6", 0);
+	ret = acl_allowed(conf(), &acl, ACL_ACTION_TRANSFER, &addr, &key0);
+	ok(ret == false, "IPv4 address out of range, no key, action match");
+
 	acl = conf_zone_get(conf(), C_ACL, zone_name);
 	ok(acl.code == KNOT_EOK, "Get zone ACL");
 	check_sockaddr_set(&addr, AF_INET6, "::1", 0);
@@ -898,10 +898,12 @@ static void test_conf_io_list(void)
 	      "server.tcp-idle-timeout\n"
 	      "server.tcp-reply-timeout\n"
 	      "server.max-tcp-clients\n"
+	      "server.tsig-sign-interval\n"
 	      "server.max-udp-payload\n"
 	      "server.max-ipv4-udp-payload\n"
 	      "server.max-ipv6-udp-payload\n"
-	      "server.rate-limit-slip";
+	      "server.rate-limit-slip\n"
+	      "server.cookies";
 	ok(strcmp(ref, out) == 0, "compare result");
 }
 
@@ -914,10 +916,12 @@ static const yp_item_t desc_server[] = {
 	{ C_TCP_IDLE_TIMEOUT,	  YP_TINT,  YP_VNONE },
 	{ C_TCP_REPLY_TIMEOUT,	  YP_TINT,  YP_VNONE },
 	{ C_MAX_TCP_CLIENTS,	  YP_TINT,  YP_VNONE },
+	{ C_TSIG_SIGN_INTERVAL,   YP_TINT,  YP_VNONE },
 	{ C_MAX_UDP_PAYLOAD,      YP_TINT,  YP_VNONE },
 	{ C_MAX_IPV4_UDP_PAYLOAD, YP_TINT,  YP_VNONE },
 	{ C_MAX_IPV6_UDP_PAYLOAD, YP_TINT,  YP_VNONE },
 	{ C_RATE_LIMIT_SLIP,	  YP_TINT,  YP_VNONE },
+	{ C_COOKIES,              YP_TBOOL, YP_VNONE },
 	{ NULL }
 };
 
@@ -0,0 +1,159 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include "contrib/addr_ranges.h"
+#include "contrib/sockaddr.h"
+#include "libknot/errcode.h"
+
+static struct sockaddr *addr(int family, const char *str)
+{
+	static struct sockaddr_storage ss[2];
+	static int last = 0;
+
+	last = (last + 1) % 2;
+	sockaddr_set(&ss[last], family, str, 0);
+	return (struct sockaddr *)&ss[last];
+}
+
+static void check_match(const addr_ranges_t *ranges, int family,
+                        const char *str, bool expected)
+{
+	bool match = addr_ranges_match(ranges, addr(family, str));
+	ok(match == expected, "addr_ranges_match: %s %s", str,
+	   expected ? "matches" : "doesn't match");
+}
+
+static void test_empty(void)
+{
+	ok(!addr_ranges_match(NULL, addr(AF_INET, "1.2.3.4")),
+	   "addr_ranges_match: NULL set");
+
+	addr_ranges_t *ranges = addr_ranges_new();
+	ok(ranges != NULL, "addr_ranges_new");
+	addr_ranges_build(ranges);
+	check_match(ranges, AF_INET, "1.2.3.4", false);
+	check_match(ranges, AF_INET6, "::1", false);
+	addr_ranges_free(ranges);
+}
+
+static void test_ranges(void)
+{
+	addr_ranges_t *ranges = addr_ranges_new();
+
+	int ret = addr_ranges_add_net(ranges, addr(AF_INET, "10.1.2.3"), 16);
+	ok(ret == KNOT_EOK, "addr_ranges_add_net: IPv4 /16");
+	ret = addr_ranges_add_net(ranges, addr(AF_INET, "192.0.2.1"), 32);
+	ok(ret == KNOT_EOK, "addr_ranges_add_net: IPv4 /32");
+	ret = addr_ranges_add_net(ranges, addr(AF_INET6, "2001:db8::"), 33);
+	ok(ret == KNOT_EOK, "addr_ranges_add_net: IPv6 /33");
+	ret = addr_ranges_add_range(ranges, addr(AF_INET, "100.0.0.250"),
+	                            addr(AF_INET, "100.0.1.5"));
+	ok(ret == KNOT_EOK, "addr_ranges_add_range: IPv4");
+	ret = addr_ranges_add_range(ranges, addr(AF_INET, "100.0.1.0"),
+	                            addr(AF_INET, "100.0.1.10"));
+	ok(ret == KNOT_EOK, "addr_ranges_add_range: IPv4 overlapping");
+	ret = addr_ranges_add_range(ranges, addr(AF_INET6, "::5"),
+	                            addr(AF_INET6, "::1"));
+	ok(ret == KNOT_EOK, "addr_ranges_add_range: IPv6 empty");
+	ret = addr_ranges_add_range(ranges, addr(AF_INET, "1.1.1.1"),
+	                            addr(AF_INET6, "::1"));
+	ok(ret == KNOT_EINVAL, "addr_ranges_add_range: mixed families");
+
+	addr_ranges_build(ranges);
+
+	check_match(ranges, AF_INET, "10.1.0.0", true);
+	check_match(ranges, AF_INET, "10.1.255.255", true);
+	check_match(ranges, AF_INET, "10.2.0.0", false);
+	check_match(ranges, AF_INET, "10.0.255.255", false);
+	check_match(ranges, AF_INET, "192.0.2.1", true);
+	check_match(ranges, AF_INET, "192.0.2.2", false);
+	check_match(ranges, AF_INET, "100.0.0.249", false);
+	check_match(ranges, AF_INET, "100.0.0.250", true);
+	check_match(ranges, AF_INET, "100.0.1.7", true);
+	check_match(ranges, AF_INET, "100.0.1.10", true);
+	check_match(ranges, AF_INET, "100.0.1.11", false);
+	check_match(ranges, AF_INET6, "2001:db8:7fff:ffff::1", true);
+	check_match(ranges, AF_INET6, "2001:db8:8000::", false);
+	check_match(ranges, AF_INET6, "::1", false);
+	check_match(ranges, AF_INET6, "::ffff:10.1.0.1", false);
+
+	addr_ranges_free(ranges);
+}
+
+static void test_nested(void)
+{
+	addr_ranges_t *ranges = addr_ranges_new();
+	addr_ranges_add_net(ranges, addr(AF_INET6, "2001:db8:1fff::1"), 35);
+	addr_ranges_add_net(ranges, addr(AF_INET6, "2001:db8:1::"), 48);
+	addr_ranges_build(ranges);
+
+	ok(ranges->ipv6.count == 1, "addr_ranges_build: nested network merged");
+	check_match(ranges, AF_INET6, "2001:db8::", true);
+	check_match(ranges, AF_INET6, "2001:db8:1fff:ffff:ffff:ffff:ffff:ffff", true);
+	check_match(ranges, AF_INET6, "2001:db8:2000::", false);
+	addr_ranges_free(ranges);
+
+	/* Prefix 0 covers the whole address family. */
+	ranges = addr_ranges_new();
+	addr_ranges_add_net(ranges, addr(AF_INET6, "2001:db8::"), 0);
+	addr_ranges_build(ranges);
+
+	check_match(ranges, AF_INET6, "::", true);
+	check_match(ranges, AF_INET6, "ffff::", true);
+	check_match(ranges, AF_INET, "192.0.2.1", false);
+	addr_ranges_free(ranges);
+}
+
+static void test_raw(void)
+{
+	addr_ranges_t *ranges = addr_ranges_new();
+	addr_ranges_add_net(ranges, addr(AF_INET, "192.0.2.0"), 24);
+	addr_ranges_build(ranges);
+
+	const uint8_t inside[] = { 192, 0, 2, 77 };
+	const uint8_t outside[] = { 192, 0, 3, 0 };
+	ok(addr_ranges_match_raw(ranges, AF_INET, inside),
+	   "addr_ranges_match_raw: matches");
+	ok(!addr_ranges_match_raw(ranges, AF_INET, outside),
+	   "addr_ranges_match_raw: doesn't match");
+	ok(!addr_ranges_match_raw(ranges, AF_UNSPEC, inside),
+	   "addr_ranges_match_raw: unknown family");
+	ok(!addr_ranges_match_raw(NULL, AF_INET, inside),
+	   "addr_ranges_match_raw: NULL set");
+
+	addr_ranges_free(ranges);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	diag("empty set");
+	test_empty();
+
+	diag("ranges");
+	test_ranges();
+
+	diag("nested networks");
+	test_nested();
+
+	diag("raw addresses");
+	test_raw();
+
+	return 0;
+}
@@ -0,0 +1,78 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <tap/basic.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "contrib/hist.h"
+
+/*! \brief Check that the estimate is within the histogram precision. */
+static bool near(uint64_t estimate, uint64_t exact)
+{
+	return estimate >= exact &&
+	       estimate <= exact + (exact >> HIST_SUB_BITS) + 1;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	hist_t *a = calloc(1, sizeof(*a));
+	hist_t *b = calloc(1, sizeof(*b));
+	hist_t *c = calloc(1, sizeof(*c));
+	assert(a && b && c);
+
+	/* Empty histogram. */
+	ok(hist_percentile(a, 500) == 0, "empty histogram percentile");
+
+	/* Small exact values. */
+	for (uint64_t i = 1; i <= 10; i++) {
+		hist_record(a, i);
+	}
+	ok(a->count == 10 && a->sum == 55 && a->max == 10,
+	   "record count, sum and max");
+	ok(hist_percentile(a, 500) == 5, "exact p50 of small values");
+	ok(hist_percentile(a, 1000) == 10, "exact p100 of small values");
+
+	/* Uniform large values. */
+	for (uint64_t i = 1; i <= 100000; i++) {
+		hist_record(b, i * 10);
+	}
+	ok(near(hist_percentile(b, 500), 500000), "p50 of uniform values");
+	ok(near(hist_percentile(b, 990), 990000), "p99 of uniform values");
+	ok(hist_percentile(b, 1000) == 1000000, "p100 is the maximum");
+
+	/* Extreme value. */
+	hist_record(c, UINT64_MAX);
+	ok(hist_percentile(c, 500) == UINT64_MAX, "maximal value");
+
+	/* Merge. */
+	hist_t *m = calloc(1, sizeof(*m));
+	assert(m);
+	hist_merge(m, b);
+	hist_merge(m, b);
+	ok(m->count == 200000 && m->max == 1000000, "merge count and max");
+	ok(hist_percentile(m, 500) == hist_percentile(b, 500), "merge percentile");
+
+	free(a);
+	free(b);
+	free(c);
+	free(m);
+
+	return 0;
+}
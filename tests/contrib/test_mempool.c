@@ -0,0 +1,92 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <tap/basic.h>
+
+#include "contrib/mempattern.h"
+#include "contrib/ucw/mempool.h"
+
+#define HUGE_PAGE_SIZE	(2 * 1024 * 1024)
+#define BLOCK_SIZE	100
+#define BLOCK_COUNT	(3 * HUGE_PAGE_SIZE / BLOCK_SIZE)
+
+/*! \brief Fill the pool over several chunks and check the data survived. */
+static bool fill_pool(knot_mm_t *mm)
+{
+	static uint8_t *blocks[BLOCK_COUNT];
+
+	for (int i = 0; i < BLOCK_COUNT; i++) {
+		blocks[i] = mm_alloc(mm, BLOCK_SIZE);
+		if (blocks[i] == NULL) {
+			return false;
+		}
+		memset(blocks[i], i & 0xff, BLOCK_SIZE);
+	}
+
+	for (int i = 0; i < BLOCK_COUNT; i++) {
+		if (blocks[i][0] != (i & 0xff) || blocks[i][BLOCK_SIZE - 1] != (i & 0xff)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void test_pool(bool huge)
+{
+	const char *name = huge ? "huge" : "regular";
+
+	knot_mm_t mm;
+	if (huge) {
+		mm_ctx_mempool_huge(&mm, MM_DEFAULT_BLKSIZE);
+	} else {
+		mm_ctx_mempool(&mm, MM_DEFAULT_BLKSIZE);
+	}
+	ok(mm.ctx != NULL, "%s: create pool", name);
+
+	ok(fill_pool(&mm), "%s: allocate over several chunks", name);
+
+	uint64_t total = mp_total_size(mm.ctx);
+	ok(total >= (uint64_t)BLOCK_COUNT * BLOCK_SIZE, "%s: total size", name);
+	if (huge) {
+		struct mempool *pool = mm.ctx;
+		ok(pool->chunk_size > HUGE_PAGE_SIZE / 2 &&
+		   pool->chunk_size < HUGE_PAGE_SIZE, "%s: chunk size rounded up", name);
+	}
+
+	/* Blocks bigger than a half of the chunk don't use the chunks. */
+	void *big = mm_alloc(&mm, HUGE_PAGE_SIZE);
+	ok(big != NULL, "%s: allocate big block", name);
+	memset(big, 0, HUGE_PAGE_SIZE);
+
+	mp_flush(mm.ctx);
+	ok(fill_pool(&mm), "%s: allocate after flush", name);
+
+	mp_delete(mm.ctx);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	test_pool(false);
+	test_pool(true);
+
+	return 0;
+}
@@ -721,6 +721,58 @@ static void test_bind_multiple(void)
 	close(sock_two);
 }
 
+static void test_send_nowait(void)
+{
+	struct sockaddr_storage addr = addr_local();
+	int server = net_bound_socket(SOCK_STREAM, (struct sockaddr *)&addr, 0);
+	ok(server >= 0, "server, create socket");
+
+	int r = listen(server, LISTEN_BACKLOG);
+	ok(r == 0, "server, start listening");
+
+	addr = addr_from_socket(server);
+	int client = net_connected_socket(SOCK_STREAM, (struct sockaddr *)&addr, NULL);
+	ok(client >= 0, "client, create connected socket");
+
+	r = poll_read(server);
+	int accepted = net_accept(server, NULL);
+	ok(r == 1 && accepted >= 0, "server, accept connection");
+
+	// fill the buffers, the peer doesn't read
+
+	uint8_t buffer[4096] = { 0 };
+	size_t total = 0;
+	ssize_t sent = 0;
+	for (int i = 0; i < 100000; i++) {
+		sent = net_stream_send_nowait(client, buffer, sizeof(buffer));
+		if (sent <= 0) {
+			break;
+		}
+		total += sent;
+	}
+	ok(sent == 0 && total > 0, "client, send until the socket isn't writable");
+
+	// drain the data, the socket becomes writable
+
+	for (size_t received = 0; received < total; ) {
+		r = net_stream_recv(accepted, buffer, sizeof(buffer), TIMEOUT);
+		if (r <= 0) {
+			break;
+		}
+		received += r;
+	}
+	struct pollfd pfd = { .fd = client, .events = POLLOUT };
+	r = poll(&pfd, 1, TIMEOUT);
+	sent = net_stream_send_nowait(client, buffer, 1);
+	ok(r == 1 && sent == 1, "client, send after the peer read data");
+
+	ok(net_stream_send_nowait(-1, buffer, 1) == KNOT_EINVAL, "invalid socket");
+
+	close(accepted);
+	close(client);
+	close(server);
+}
+
 static void signal_noop(int sig)
 {
 }
@@ -752,6 +804,9 @@ int main(int argc, char *argv[])
 	diag("DNS messages over TCP");
 	test_dns_tcp();
 
+	diag("sending without blocking");
+	test_send_nowait();
+
 	diag("flag NET_BIND_MULTIPLE");
 	test_bind_multiple();
 
@@ -0,0 +1,94 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <tap/basic.h>
+
+#include "dnssec/crypto.h"
+#include "knot/server/cookies.h"
+#include "libknot/errcode.h"
+#include "libknot/rrtype/opt-cookie.h"
+#include "contrib/sockaddr.h"
+
+static bool check(const cookie_secrets_t *secrets, const struct sockaddr_storage *addr,
+                  const uint8_t *cc, const uint8_t *sc, uint16_t sc_len)
+{
+	struct knot_dns_cookies cookies = {
+		.cc = cc,
+		.cc_len = KNOT_OPT_COOKIE_CLNT,
+		.sc = sc,
+		.sc_len = sc_len
+	};
+
+	return cookie_check(secrets, (struct sockaddr *)addr, &cookies);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	dnssec_crypto_init();
+
+	struct sockaddr_storage addr, addr2;
+	sockaddr_set(&addr, AF_INET6, "2001:db8::1", 0);
+	sockaddr_set(&addr2, AF_INET, "192.0.2.1", 0);
+	const uint8_t cc[KNOT_OPT_COOKIE_CLNT] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	uint8_t cc2[KNOT_OPT_COOKIE_CLNT] = { 1, 2, 3, 4, 5, 6, 7, 9 };
+
+	cookie_secrets_t secrets;
+	int ret = cookie_secrets_init(&secrets);
+	ok(ret == KNOT_EOK, "cookies: init secrets");
+
+	uint8_t sc[KNOT_OPT_COOKIE_SRVR_MAX];
+	uint16_t sc_len = cookie_server_write(&secrets, (struct sockaddr *)&addr,
+	                                      cc, sizeof(cc), sc);
+	ok(sc_len >= KNOT_OPT_COOKIE_SRVR_MIN && sc_len <= KNOT_OPT_COOKIE_SRVR_MAX,
+	   "cookies: write server cookie");
+
+	ok(check(&secrets, &addr, cc, sc, sc_len), "cookies: valid cookie");
+	ok(!check(&secrets, &addr2, cc, sc, sc_len), "cookies: other client address");
+	ok(!check(&secrets, &addr, cc2, sc, sc_len), "cookies: other client cookie");
+	ok(!check(&secrets, &addr, cc, sc, sc_len - 1), "cookies: truncated cookie");
+	sc[0] ^= 0xff;
+	ok(!check(&secrets, &addr, cc, sc, sc_len), "cookies: modified cookie");
+	sc[0] ^= 0xff;
+
+	/* Cookies from the previous secret are accepted. */
+	ret = cookie_secrets_rotate(&secrets);
+	ok(ret == KNOT_EOK, "cookies: rotate secret");
+	ok(check(&secrets, &addr, cc, sc, sc_len), "cookies: previous secret");
+
+	uint8_t sc2[KNOT_OPT_COOKIE_SRVR_MAX];
+	uint16_t sc2_len = cookie_server_write(&secrets, (struct sockaddr *)&addr,
+	                                       cc, sizeof(cc), sc2);
+	ok(sc2_len == sc_len && memcmp(sc, sc2, sc_len) != 0,
+	   "cookies: new cookie with current secret");
+
+	/* Older secrets are forgotten. */
+	ret = cookie_secrets_rotate(&secrets);
+	ok(ret == KNOT_EOK, "cookies: rotate secret again");
+	ok(!check(&secrets, &addr, cc, sc, sc_len), "cookies: expired secret");
+	ok(check(&secrets, &addr, cc, sc2, sc2_len), "cookies: previous secret again");
+
+	for (int i = 0; i < 2 * COOKIE_SECRET_SLOTS; i++) {
+		cookie_secrets_rotate(&secrets);
+	}
+	ok(secrets.current < COOKIE_SECRET_SLOTS, "cookies: slots wrap around");
+
+	dnssec_crypto_cleanup();
+
+	return 0;
+}
@@ -0,0 +1,303 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <tap/basic.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "libknot/descriptor.h"
+#include "libknot/errcode.h"
+#include "knot/query/forward.h"
+#include "contrib/mempattern.h"
+#include "contrib/net.h"
+#include "contrib/sockaddr.h"
+#include "contrib/ucw/mempool.h"
+
+static const int TIMEOUT = 2000;
+
+static int accepted = 0;
+
+static void set_blocking_mode(int sock)
+{
+	int flags = fcntl(sock, F_GETFL);
+	flags &= ~O_NONBLOCK;
+	fcntl(sock, F_SETFL, flags);
+}
+
+/*! \brief Mirror UDP queries as responses until an empty message. */
+static void *udp_responder_thread(void *arg)
+{
+	int fd = *(int *)arg;
+
+	set_blocking_mode(fd);
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+	while (true) {
+		struct sockaddr_storage ss;
+		socklen_t ss_len = sizeof(ss);
+		ssize_t len = recvfrom(fd, buf, sizeof(buf), 0,
+		                       (struct sockaddr *)&ss, &ss_len);
+		if (len < KNOT_WIRE_HEADER_SIZE) {
+			break;
+		}
+		knot_wire_set_qr(buf);
+		sendto(fd, buf, len, 0, (struct sockaddr *)&ss, ss_len);
+	}
+
+	return NULL;
+}
+
+/*! \brief Mirror TCP queries on each connection until an empty message. */
+static void *tcp_responder_thread(void *arg)
+{
+	int fd = *(int *)arg;
+
+	set_blocking_mode(fd);
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+	while (true) {
+		int client = accept(fd, NULL, NULL);
+		if (client < 0) {
+			break;
+		}
+		accepted += 1;
+		int len;
+		while ((len = net_dns_tcp_recv(client, buf, sizeof(buf), -1)) >=
+		       KNOT_WIRE_HEADER_SIZE) {
+			knot_wire_set_qr(buf);
+			net_dns_tcp_send(client, buf, len, -1);
+		}
+		close(client);
+		if (len > 0) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static knot_pkt_t *make_query(knot_mm_t *mm, uint16_t id)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	assert(pkt);
+	knot_wire_set_id(pkt->wire, id);
+	static const knot_dname_t *name = (uint8_t *)"\x04""test";
+	knot_pkt_put_question(pkt, name, KNOT_CLASS_IN, KNOT_RRTYPE_SOA);
+
+	return pkt;
+}
+
+static int bound_socket(int type, struct sockaddr_storage *addr)
+{
+	sockaddr_set(addr, AF_INET, "127.0.0.1", 0);
+	int fd = net_bound_socket(type, (struct sockaddr *)addr, 0);
+	assert(fd >= 0);
+	socklen_t addr_len = sockaddr_len((struct sockaddr *)addr);
+	getsockname(fd, (struct sockaddr *)addr, &addr_len);
+
+	return fd;
+}
+
+/*! \brief Wait for a deferred answer finished for the queue. */
+static query_defer_t *wait_deferred(query_defer_queue_t *queue)
+{
+	struct pollfd pfd = { .fd = queue->pipe[0], .events = POLLIN };
+	if (poll(&pfd, 1, TIMEOUT) <= 0) {
+		return NULL;
+	}
+
+	return query_defer_queue_pop(queue);
+}
+
+static void test_udp(knot_mm_t *mm, knot_forwarder_t *fwd, const char *msg,
+                     bool answered)
+{
+	query_defer_queue_t *queue = query_defer_queue_new();
+	struct sockaddr_storage client;
+	sockaddr_set(&client, AF_INET, "127.0.0.1", 53);
+
+	knot_pkt_t *query = make_query(mm, 0x1234);
+	query_defer_t *defer = query_defer_new(queue, fwd, query, -1, &client);
+	int ret = knot_forwarder_udp(fwd, query, defer, 100);
+	is_int(KNOT_EOK, ret, "forward: %s/submit", msg);
+
+	/* The answer is passed back to the queue. */
+	query_defer_t *done = wait_deferred(queue);
+	ok(done == defer && done->owner == fwd &&
+	   done->query_len == query->size, "forward: %s/deferred", msg);
+	if (done != NULL && answered) {
+		ok(done->data_len == query->size &&
+		   knot_wire_get_id(done->data) == 0x1234 &&
+		   knot_wire_get_qr(done->data), "forward: %s/response", msg);
+	} else if (done != NULL) {
+		ok(done->data == NULL, "forward: %s/no response", msg);
+	}
+	query_defer_free(done);
+
+	knot_pkt_free(&query);
+	query_defer_queue_free(queue);
+}
+
+/*! \brief Pending answers are dropped with the forwarder. */
+static void test_udp_pending(knot_mm_t *mm, const struct sockaddr_storage *silent)
+{
+	knot_forwarder_t *fwd = knot_forwarder_new((struct sockaddr *)silent, NULL);
+	query_defer_queue_t *queue = query_defer_queue_new();
+	struct sockaddr_storage client;
+	sockaddr_set(&client, AF_INET, "127.0.0.1", 53);
+
+	knot_pkt_t *query = make_query(mm, 0x5678);
+	query_defer_t *defer = query_defer_new(queue, fwd, query, -1, &client);
+	int ret = knot_forwarder_udp(fwd, query, defer, TIMEOUT);
+	is_int(KNOT_EOK, ret, "forward: UDP pending/submit");
+
+	knot_forwarder_free(fwd);
+	ok(query_defer_queue_pop(queue) == NULL, "forward: UDP pending/dropped");
+
+	knot_pkt_free(&query);
+	query_defer_queue_free(queue);
+}
+
+static bool queue_woken(query_defer_queue_t *queue)
+{
+	struct pollfd pfd = { .fd = queue->pipe[0], .events = POLLIN };
+	return poll(&pfd, 1, 0) == 1;
+}
+
+/*! \brief Each answer finished after the queue is emptied wakes the worker. */
+static void test_queue_wakeup(knot_mm_t *mm)
+{
+	query_defer_queue_t *queue = query_defer_queue_new();
+	struct sockaddr_storage client;
+	sockaddr_set(&client, AF_INET, "127.0.0.1", 53);
+	knot_pkt_t *query = make_query(mm, 0x9abc);
+
+	query_defer_t *defer[3];
+	for (int i = 0; i < 3; i++) {
+		defer[i] = query_defer_new(queue, NULL, query, -1, &client);
+	}
+
+	ok(!queue_woken(queue) && query_defer_queue_pop(queue) == NULL,
+	   "defer: empty queue");
+
+	/* Two answers, one wake-up. */
+	query_defer_finish(defer[0], NULL, 0);
+	query_defer_finish(defer[1], NULL, 0);
+	ok(queue_woken(queue), "defer: woken by the first answer");
+	ok(query_defer_queue_pop(queue) == defer[0] &&
+	   query_defer_queue_pop(queue) == defer[1] &&
+	   query_defer_queue_pop(queue) == NULL && !queue_woken(queue),
+	   "defer: answers taken, wake-up consumed");
+
+	/* Answer finished after the queue was emptied. */
+	query_defer_finish(defer[2], NULL, 0);
+	ok(queue_woken(queue) && query_defer_queue_pop(queue) == defer[2],
+	   "defer: woken by the next answer");
+
+	for (int i = 0; i < 3; i++) {
+		query_defer_free(defer[i]);
+	}
+	knot_pkt_free(&query);
+	query_defer_queue_free(queue);
+}
+
+static void test_tcp(knot_mm_t *mm, knot_forwarder_t *fwd)
+{
+	for (int i = 0; i < 3; i++) {
+		knot_pkt_t *query = make_query(mm, 0x4321 + i);
+		knot_pkt_t *answer = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+		int ret = knot_forwarder_tcp(fwd, query, answer, TIMEOUT);
+		is_int(KNOT_EOK, ret, "forward: TCP/exec %i", i);
+		ok(answer->size == query->size &&
+		   knot_wire_get_id(answer->wire) == 0x4321 + i &&
+		   knot_wire_get_qr(answer->wire), "forward: TCP/response %i", i);
+		knot_pkt_free(&query);
+		knot_pkt_free(&answer);
+	}
+
+	is_int(1, accepted, "forward: TCP/connection reused");
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	knot_mm_t mm;
+	mm_ctx_mempool(&mm, MM_DEFAULT_BLKSIZE);
+
+	/* Start UDP responder. */
+	struct sockaddr_storage udp_upstream;
+	int udp_fd = bound_socket(SOCK_DGRAM, &udp_upstream);
+	pthread_t udp_thread;
+	pthread_create(&udp_thread, 0, udp_responder_thread, &udp_fd);
+
+	/* Start TCP responder. */
+	struct sockaddr_storage tcp_upstream;
+	int tcp_fd = bound_socket(SOCK_STREAM, &tcp_upstream);
+	int ret = listen(tcp_fd, 10);
+	(void)ret;
+	assert(ret == 0);
+	pthread_t tcp_thread;
+	pthread_create(&tcp_thread, 0, tcp_responder_thread, &tcp_fd);
+
+	/* Upstream that never answers. */
+	struct sockaddr_storage silent;
+	int silent_fd = bound_socket(SOCK_DGRAM, &silent);
+
+	test_queue_wakeup(&mm);
+
+	/* Forward to a live upstream. */
+	knot_forwarder_t *fwd = knot_forwarder_new((struct sockaddr *)&udp_upstream, NULL);
+	ok(fwd != NULL, "forward: create");
+	test_udp(&mm, fwd, "UDP", true);
+	knot_forwarder_free(fwd);
+
+	/* Forward to an unresponsive upstream. */
+	fwd = knot_forwarder_new((struct sockaddr *)&silent, NULL);
+	test_udp(&mm, fwd, "UDP timeout", false);
+	knot_forwarder_free(fwd);
+	test_udp_pending(&mm, &silent);
+
+	/* Forward over a pooled TCP connection. */
+	fwd = knot_forwarder_new((struct sockaddr *)&tcp_upstream, NULL);
+	test_tcp(&mm, fwd);
+	knot_forwarder_free(fwd);
+
+	/* Terminate responders. */
+	int conn = net_connected_socket(SOCK_DGRAM, (struct sockaddr *)&udp_upstream, NULL);
+	assert(conn > 0);
+	net_dgram_send(conn, (uint8_t *)"", 1, NULL);
+	close(conn);
+	pthread_join(udp_thread, NULL);
+
+	conn = net_connected_socket(SOCK_STREAM, (struct sockaddr *)&tcp_upstream, NULL);
+	assert(conn > 0);
+	net_dns_tcp_send(conn, (uint8_t *)"", 1, TIMEOUT);
+	pthread_join(tcp_thread, NULL);
+	close(conn);
+
+	close(udp_fd);
+	close(tcp_fd);
+	close(silent_fd);
+
+	/* Cleanup. */
+	mp_delete((struct mempool *)mm.ctx);
+
+	return 0;
+}
@@ -187,6 +187,25 @@ int main(int argc, char *argv[])
 	/* Compare copied packet to original. */
 	packet_match(in, copy);
 
+	/*
+	 * Parsing without the answer section.
+	 */
+	knot_pkt_t *noanswer = knot_pkt_new(in->wire, in->size, &in->mm);
+	ret = knot_pkt_parse(noanswer, KNOT_PF_NOANSWER);
+	ok(ret == KNOT_EOK && noanswer->parsed == noanswer->size,
+	   "pkt: parse without answer");
+	ok(knot_pkt_section(noanswer, KNOT_ANSWER)->count == 0 &&
+	   knot_pkt_section(noanswer, KNOT_AUTHORITY)->count == NAMECOUNT - 1 &&
+	   noanswer->opt_rr != NULL, "pkt: skipped answer section");
+
+	size_t pos = KNOT_WIRE_HEADER_SIZE + knot_pkt_question_size(noanswer);
+	knot_rr_view_t view;
+	ret = knot_rr_view_parse(noanswer->wire, &pos, noanswer->size, &view);
+	ok(ret == KNOT_EOK && view.type == KNOT_RRTYPE_A &&
+	   view.rdlength == RDLEN(0) && memcmp(view.rdata, RDVAL(0), RDLEN(0)) == 0,
+	   "pkt: answer RR view");
+	knot_pkt_free(&noanswer);
+
 	/* Free packets. */
 	knot_pkt_free(&copy);
 	knot_pkt_free(&out);
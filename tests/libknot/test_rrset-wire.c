@@ -73,7 +73,7 @@ struct wire_data {
 	const char *msg;
 };
 
-#define FROM_CASE_COUNT 17
+#define FROM_CASE_COUNT 18
 
 static const struct wire_data FROM_CASES[FROM_CASE_COUNT] = {
 { .wire = { MESSAGE_HEADER(1, 0, 0), QUERY(QNAME, KNOT_RRTYPE_A)},
@@ -188,6 +188,13 @@ static const struct wire_data FROM_CASES[FROM_CASE_COUNT] = {
   .pos = QUERY_SIZE + QNAME_SIZE,
   .code = KNOT_EOK,
   .msg = "Obsolete RR type"},
+{ .wire = { MESSAGE_HEADER(1, 0, 0), QUERY(QNAME, KNOT_RRTYPE_SRV),
+            RR_HEADER(QNAME_POINTER, KNOT_RRTYPE_SRV, 0x00, 0x0a),
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x35, QNAME_POINTER, 0xde, 0xad },
+  .size = QUERY_SIZE + QNAME_SIZE + RR_HEADER_SIZE + 2 + 10,
+  .pos = QUERY_SIZE + QNAME_SIZE,
+  .code = KNOT_EMALF,
+  .msg = "SRV trailing data"},
 };
 
 #define TEST_CASE_FROM(rrset, i) size_t _pos##i = FROM_CASES[i].pos; \
@@ -246,6 +253,85 @@ static void test_canonization(void)
 	check_canon(wire, size, pos, true, low_qname, low_dname);
 }
 
+static void check_to_wire(uint16_t type, const uint8_t *rdata, uint16_t rdlen,
+                          int code, const char *msg)
+{
+	knot_dname_t owner[] = { QNAME };
+	knot_rrset_t *rrset = knot_rrset_new(owner, type, KNOT_CLASS_IN, NULL);
+	assert(rrset);
+	int ret = knot_rrset_add_rdata(rrset, rdata, rdlen, 3600, NULL);
+	assert(ret == KNOT_EOK);
+
+	uint8_t wire[512];
+	ret = knot_rrset_to_wire(rrset, wire, sizeof(wire), NULL);
+	ok(code == KNOT_EOK ? ret > 0 : ret == code, "rrset to wire: %s", msg);
+
+	knot_rrset_free(&rrset, NULL);
+}
+
+static void test_to_wire(void)
+{
+	/* Name at a fixed offset, followed by nothing. */
+	const uint8_t srv[] = { 0x00, 0x0a, 0x00, 0x05, 0x00, 0x35, QNAME };
+	check_to_wire(KNOT_RRTYPE_SRV, srv, sizeof(srv), KNOT_EOK, "SRV valid");
+
+	const uint8_t srv_trailing[] = { 0x00, 0x0a, 0x00, 0x05, 0x00, 0x35, QNAME,
+	                                 0xde, 0xad };
+	check_to_wire(KNOT_RRTYPE_SRV, srv_trailing, sizeof(srv_trailing),
+	              KNOT_EMALF, "SRV trailing data");
+
+	const uint8_t srv_partial[] = { 0x00, 0x0a, 0x00, 0x05, 0x00, 0x35, 0x03,
+	                                'n', 'i', 'c' };
+	check_to_wire(KNOT_RRTYPE_SRV, srv_partial, sizeof(srv_partial),
+	              KNOT_EMALF, "SRV partial name");
+
+	/* Two names at a fixed offset. */
+	const uint8_t rp_trailing[] = { QNAME, QNAME, 0x00 };
+	check_to_wire(KNOT_RRTYPE_RP, rp_trailing, sizeof(rp_trailing),
+	              KNOT_EMALF, "RP trailing data");
+
+	/* Compressible name after a fixed-size prefix. */
+	const uint8_t mx_trailing[] = { 0x00, 0x0a, QNAME, 0x00 };
+	check_to_wire(KNOT_RRTYPE_MX, mx_trailing, sizeof(mx_trailing),
+	              KNOT_EMALF, "MX trailing data");
+}
+
+static void test_views(void)
+{
+	static uint8_t rdata_buf[KNOT_RR_VIEW_RDATA_SIZE];
+	uint8_t owner_buf[KNOT_DNAME_MAXLEN];
+
+	for (int i = 0; i < FROM_CASE_COUNT; ++i) {
+		const struct wire_data *data = &FROM_CASES[i];
+
+		knot_rrset_t rrset;
+		knot_rrset_init_empty(&rrset);
+		size_t pos = data->pos;
+		int ret = knot_rrset_rr_from_wire(data->wire, &pos, data->size,
+		                                  NULL, &rrset, true);
+
+		knot_rr_view_t view;
+		knot_rrset_t expanded;
+		size_t view_pos = data->pos;
+		int view_ret = knot_rr_view_parse(data->wire, &view_pos,
+		                                  data->size, &view);
+		if (view_ret == KNOT_EOK) {
+			view_ret = knot_rr_view_expand(&view, &expanded, owner_buf,
+			                               rdata_buf, true);
+		}
+
+		ok(view_ret == ret, "rr view: %s", data->msg);
+		if (ret == KNOT_EOK && view_ret == KNOT_EOK) {
+			ok(view_pos == pos &&
+			   knot_rrset_equal(&rrset, &expanded, KNOT_RRSET_COMPARE_WHOLE) &&
+			   knot_rdata_ttl(rrset.rrs.data) == knot_rdata_ttl(expanded.rrs.data),
+			   "rr view: %s, compare with parsed RR", data->msg);
+		}
+
+		knot_rrset_clear(&rrset, NULL);
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -257,8 +343,14 @@ int main(int argc, char *argv[])
 	diag("Test various inputs");
 	test_inputs();
 
+	diag("Test RDATA to wire");
+	test_to_wire();
+
 	diag("Test canonization");
 	test_canonization();
 
+	diag("Test RR views");
+	test_views();
+
 	return EXIT_SUCCESS;
 }
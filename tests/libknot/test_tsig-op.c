@@ -0,0 +1,278 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+#include <string.h>
+
+#include "libknot/libknot.h"
+
+#define MSG_COUNT	7
+#define MSG_MAX_SIZE	512
+#define MAC_MAX_SIZE	64
+
+typedef struct {
+	uint8_t wire[MSG_MAX_SIZE];
+	size_t size;
+	bool is_signed;
+} msg_t;
+
+static size_t make_msg(uint8_t *wire, uint16_t id, bool response)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, MSG_MAX_SIZE, NULL);
+	knot_dname_t *qname = knot_dname_from_str_alloc("example.com.");
+	if (pkt == NULL || qname == NULL ||
+	    knot_pkt_put_question(pkt, qname, KNOT_CLASS_IN, KNOT_RRTYPE_AXFR) != KNOT_EOK) {
+		bail("failed to create message");
+	}
+	knot_wire_set_id(pkt->wire, id);
+	if (response) {
+		knot_wire_set_qr(pkt->wire);
+	}
+
+	size_t size = pkt->size;
+	memcpy(wire, pkt->wire, size);
+	knot_dname_free(&qname, NULL);
+	knot_pkt_free(&pkt);
+
+	return size;
+}
+
+/*! \brief Parse the message, which strips the TSIG RR. */
+static knot_pkt_t *parse_msg(uint8_t *wire, size_t size)
+{
+	knot_pkt_t *pkt = knot_pkt_new(wire, size, NULL);
+	if (pkt == NULL || knot_pkt_parse(pkt, 0) != KNOT_EOK) {
+		bail("failed to parse message");
+	}
+
+	return pkt;
+}
+
+static void test_single(const knot_tsig_key_t *key, uint8_t *mac, size_t *mac_len)
+{
+	uint8_t wire[MSG_MAX_SIZE];
+	size_t size = make_msg(wire, 1, false);
+
+	int ret = knot_tsig_sign(wire, &size, sizeof(wire), NULL, 0, mac, mac_len,
+	                         key, 0, 0);
+	ok(ret == KNOT_EOK, "sign query");
+
+	knot_pkt_t *pkt = parse_msg(wire, size);
+	ret = knot_tsig_server_check(pkt->tsig_rr, pkt->wire, pkt->size, key);
+	ok(ret == KNOT_EOK, "check query");
+
+	/* Tamper with the message. */
+	pkt->wire[pkt->size - 1] ^= 0xff;
+	ret = knot_tsig_server_check(pkt->tsig_rr, pkt->wire, pkt->size, key);
+	ok(ret == KNOT_TSIG_EBADSIG, "check modified query");
+
+	knot_pkt_free(&pkt);
+}
+
+static void sign_session(const knot_tsig_key_t *key, msg_t *msgs,
+                         const uint8_t *request_mac, size_t request_mac_len,
+                         unsigned interval)
+{
+	uint8_t mac[MAC_MAX_SIZE];
+	size_t mac_len = sizeof(mac);
+	knot_tsig_stream_t *stream = knot_tsig_stream_new();
+
+	int ret = KNOT_EOK;
+	for (int i = 0; i < MSG_COUNT && ret == KNOT_EOK; i++) {
+		msg_t *msg = &msgs[i];
+		msg->size = make_msg(msg->wire, 2, true);
+		msg->is_signed = (i == 0 || i == MSG_COUNT - 1 ||
+		                  knot_tsig_stream_pending(stream) + 1 >= interval);
+		size_t prev_len = mac_len;
+		mac_len = sizeof(mac);
+		if (i == 0) {
+			ret = knot_tsig_sign(msg->wire, &msg->size, sizeof(msg->wire),
+			                     request_mac, request_mac_len,
+			                     mac, &mac_len, key, 0, 0);
+		} else if (!msg->is_signed) {
+			ret = knot_tsig_stream_add(stream, key, mac, prev_len,
+			                           msg->wire, msg->size);
+			mac_len = prev_len;
+		} else {
+			ret = knot_tsig_sign_next_stream(stream, msg->wire, &msg->size,
+			                                 sizeof(msg->wire), mac, prev_len,
+			                                 mac, &mac_len, key);
+		}
+	}
+	ok(ret == KNOT_EOK, "sign session, every %u. message", interval);
+
+	knot_tsig_stream_free(stream);
+}
+
+static void test_session(const knot_tsig_key_t *key,
+                         const uint8_t *request_mac, size_t request_mac_len,
+                         unsigned interval)
+{
+	msg_t msgs[MSG_COUNT];
+	sign_session(key, msgs, request_mac, request_mac_len, interval);
+
+	/* Check with a running digest. */
+	uint8_t mac[MAC_MAX_SIZE];
+	size_t mac_len = request_mac_len;
+	memcpy(mac, request_mac, request_mac_len);
+	knot_tsig_stream_t *stream = knot_tsig_stream_new();
+
+	int ret = KNOT_EOK;
+	unsigned signed_count = 0;
+	for (int i = 0; i < MSG_COUNT && ret == KNOT_EOK; i++) {
+		uint8_t wire[MSG_MAX_SIZE];
+		memcpy(wire, msgs[i].wire, msgs[i].size);
+		knot_pkt_t *pkt = parse_msg(wire, msgs[i].size);
+		if (pkt->tsig_rr == NULL) {
+			ret = knot_tsig_stream_add(stream, key, mac, mac_len,
+			                           pkt->wire, pkt->size);
+		} else if (i == 0) {
+			ret = knot_tsig_client_check_stream(stream, pkt->tsig_rr,
+			                                    pkt->wire, pkt->size,
+			                                    mac, mac_len, key, 0);
+		} else {
+			ret = knot_tsig_client_check_next_stream(stream, pkt->tsig_rr,
+			                                         pkt->wire, pkt->size,
+			                                         mac, mac_len, key, 0);
+		}
+		if (pkt->tsig_rr != NULL) {
+			mac_len = knot_tsig_rdata_mac_length(pkt->tsig_rr);
+			memcpy(mac, knot_tsig_rdata_mac(pkt->tsig_rr), mac_len);
+			signed_count += 1;
+		}
+		knot_pkt_free(&pkt);
+	}
+	ok(ret == KNOT_EOK && knot_tsig_stream_pending(stream) == 0,
+	   "check session, every %u. message, signed %u", interval, signed_count);
+
+	knot_tsig_stream_free(stream);
+
+	/* Check the last run of messages in one buffer without the stream. */
+	uint8_t buffer[MSG_COUNT * MSG_MAX_SIZE];
+	size_t buffer_size = 0;
+	const knot_rrset_t *last_tsig = NULL;
+	knot_pkt_t *pkts[MSG_COUNT] = { NULL };
+	for (int i = 0; i < MSG_COUNT; i++) {
+		pkts[i] = parse_msg(msgs[i].wire, msgs[i].size);
+		if (i < MSG_COUNT - 1 && pkts[i]->tsig_rr != NULL) {
+			mac_len = knot_tsig_rdata_mac_length(pkts[i]->tsig_rr);
+			memcpy(mac, knot_tsig_rdata_mac(pkts[i]->tsig_rr), mac_len);
+			buffer_size = 0;
+			continue;
+		}
+		memcpy(buffer + buffer_size, pkts[i]->wire, pkts[i]->size);
+		buffer_size += pkts[i]->size;
+		last_tsig = pkts[i]->tsig_rr;
+	}
+	ret = knot_tsig_client_check_next(last_tsig, buffer, buffer_size,
+	                                  mac, mac_len, key, 0);
+	ok(ret == KNOT_EOK, "check buffered run, every %u. message", interval);
+
+	/* Modified unsigned message is detected by the next signed one. */
+	if (interval > 1) {
+		buffer[KNOT_WIRE_HEADER_SIZE] ^= 0xff;
+		ret = knot_tsig_client_check_next(last_tsig, buffer, buffer_size,
+		                                  mac, mac_len, key, 0);
+		ok(ret == KNOT_TSIG_EBADSIG, "check modified run, every %u. message",
+		   interval);
+	}
+
+	for (int i = 0; i < MSG_COUNT; i++) {
+		knot_pkt_free(&pkts[i]);
+	}
+}
+
+static void test_stream_reset(const knot_tsig_key_t *key,
+                              const uint8_t *request_mac, size_t request_mac_len)
+{
+	msg_t msgs[MSG_COUNT];
+	sign_session(key, msgs, request_mac, request_mac_len, MSG_COUNT);
+
+	knot_tsig_stream_t *stream = knot_tsig_stream_new();
+	knot_pkt_t *pkt = parse_msg(msgs[0].wire, msgs[0].size);
+	uint8_t mac[MAC_MAX_SIZE];
+	size_t mac_len = knot_tsig_rdata_mac_length(pkt->tsig_rr);
+	memcpy(mac, knot_tsig_rdata_mac(pkt->tsig_rr), mac_len);
+	knot_pkt_free(&pkt);
+
+	pkt = parse_msg(msgs[1].wire, msgs[1].size);
+	pkt->wire[KNOT_WIRE_HEADER_SIZE] ^= 0xff;
+	int ret = knot_tsig_stream_add(stream, key, mac, mac_len, pkt->wire, pkt->size);
+	ok(ret == KNOT_EOK && knot_tsig_stream_pending(stream) == 1,
+	   "add modified message");
+	knot_pkt_free(&pkt);
+
+	for (int i = 2; i < MSG_COUNT - 1; i++) {
+		pkt = parse_msg(msgs[i].wire, msgs[i].size);
+		knot_tsig_stream_add(stream, key, mac, mac_len, pkt->wire, pkt->size);
+		knot_pkt_free(&pkt);
+	}
+
+	pkt = parse_msg(msgs[MSG_COUNT - 1].wire, msgs[MSG_COUNT - 1].size);
+	ret = knot_tsig_client_check_next_stream(stream, pkt->tsig_rr, pkt->wire,
+	                                         pkt->size, mac, mac_len, key, 0);
+	ok(ret == KNOT_TSIG_EBADSIG && knot_tsig_stream_pending(stream) == 0,
+	   "check after modified message, stream reset");
+	knot_pkt_free(&pkt);
+
+	/* The reset stream is usable for a new session. */
+	sign_session(key, msgs, request_mac, request_mac_len, MSG_COUNT);
+	pkt = parse_msg(msgs[0].wire, msgs[0].size);
+	mac_len = knot_tsig_rdata_mac_length(pkt->tsig_rr);
+	memcpy(mac, knot_tsig_rdata_mac(pkt->tsig_rr), mac_len);
+	knot_pkt_free(&pkt);
+
+	for (int i = 1; i < MSG_COUNT - 1; i++) {
+		pkt = parse_msg(msgs[i].wire, msgs[i].size);
+		knot_tsig_stream_add(stream, key, mac, mac_len, pkt->wire, pkt->size);
+		knot_pkt_free(&pkt);
+	}
+
+	pkt = parse_msg(msgs[MSG_COUNT - 1].wire, msgs[MSG_COUNT - 1].size);
+	ret = knot_tsig_client_check_next_stream(stream, pkt->tsig_rr, pkt->wire,
+	                                         pkt->size, mac, mac_len, key, 0);
+	ok(ret == KNOT_EOK, "check new session after reset");
+	knot_pkt_free(&pkt);
+
+	knot_tsig_stream_free(stream);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	knot_tsig_key_t key = { 0 };
+	int ret = knot_tsig_key_init(&key, "hmac-sha256", "key.name", "c2VjcmV0");
+	ok(ret == KNOT_EOK, "key init");
+
+	uint8_t query_mac[MAC_MAX_SIZE];
+	size_t query_mac_len = sizeof(query_mac);
+
+	diag("single message");
+	test_single(&key, query_mac, &query_mac_len);
+
+	diag("multiple messages");
+	test_session(&key, query_mac, query_mac_len, 1);
+	test_session(&key, query_mac, query_mac_len, 2);
+	test_session(&key, query_mac, query_mac_len, MSG_COUNT);
+
+	diag("stream reset");
+	test_stream_reset(&key, query_mac, query_mac_len);
+
+	knot_tsig_key_deinit(&key);
+
+	return 0;
+}
@@ -0,0 +1,156 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <tap/basic.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "knot/modules/synth_record/addr.h"
+#include "libknot/consts.h"
+#include "libknot/dname.h"
+#include "libknot/errcode.h"
+
+#define PREFIX "dynamic-"
+
+/*! \brief Parse forward label and compare with the expected address. */
+static void test_forward(const char *text, bool ipv4, bool ipv6, const char *expected)
+{
+	uint8_t label[1 + KNOT_DNAME_MAXLABELLEN];
+	label[0] = strlen(text);
+	memcpy(label + 1, text, label[0]);
+
+	synth_addr_t addr;
+	int ret = synth_addr_forward(label, PREFIX, strlen(PREFIX), ipv4, ipv6, &addr);
+	if (expected == NULL) {
+		ok(ret == KNOT_EINVAL, "forward: reject '%s'", text);
+		return;
+	}
+
+	uint8_t exp_addr[SYNTH_ADDR_MAXLEN];
+	int family = strchr(expected, ':') != NULL ? AF_INET6 : AF_INET;
+	inet_pton(family, expected, exp_addr);
+	size_t len = (family == AF_INET) ? 4 : 16;
+	ok(ret == KNOT_EOK && addr.family == family &&
+	   memcmp(addr.addr, exp_addr, len) == 0, "forward: parse '%s'", text);
+}
+
+/*! \brief Parse reverse name and compare with the expected address. */
+static void test_reverse(const char *name_str, const char *expected)
+{
+	knot_dname_t *name = knot_dname_from_str_alloc(name_str);
+
+	synth_addr_t addr;
+	int ret = synth_addr_reverse(name, NULL, &addr);
+	if (expected == NULL) {
+		ok(ret == KNOT_EINVAL, "reverse: reject '%s'", name_str);
+	} else {
+		uint8_t exp_addr[SYNTH_ADDR_MAXLEN];
+		int family = strchr(expected, ':') != NULL ? AF_INET6 : AF_INET;
+		inet_pton(family, expected, exp_addr);
+		size_t len = (family == AF_INET) ? 4 : 16;
+		ok(ret == KNOT_EOK && addr.family == family &&
+		   memcmp(addr.addr, exp_addr, len) == 0, "reverse: parse '%s'", name_str);
+	}
+
+	knot_dname_free(&name, NULL);
+}
+
+/*! \brief Write forward label for the address and compare with the expected one. */
+static void test_label(const char *addr_str, const char *prefix, const char *expected)
+{
+	synth_addr_t addr = { 0 };
+	addr.family = strchr(addr_str, ':') != NULL ? AF_INET6 : AF_INET;
+	inet_pton(addr.family, addr_str, addr.addr);
+
+	uint8_t label[1 + KNOT_DNAME_MAXLABELLEN];
+	int ret = synth_addr_label(&addr, prefix, strlen(prefix), label);
+	if (expected == NULL) {
+		ok(ret == KNOT_ESPACE, "label: too long for '%s'", addr_str);
+		return;
+	}
+
+	ok(ret == KNOT_EOK && label[0] == strlen(expected) &&
+	   memcmp(label + 1, expected, label[0]) == 0, "label: write '%s'", addr_str);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	/* Forward names, label prefix. */
+	test_forward("dynamic-192-0-2-1", true, true, "192.0.2.1");
+	test_forward("DYNAMIC-0-0-0-0", true, true, "0.0.0.0");
+	test_forward("dynamic-255-255-255-255", true, true, "255.255.255.255");
+	test_forward("static-192-0-2-1", true, true, NULL);
+	test_forward("dynamic-", true, true, NULL);
+	test_forward("dynamic", true, true, NULL);
+	test_forward("dynamic-192-0-2-1", false, true, NULL);
+
+	/* Forward names, IPv6. */
+	test_forward("dynamic-2001-db8--1", true, true, "2001:db8::1");
+	test_forward("dynamic-2001-0DB8-0-0-0-0-0-1", true, true, "2001:db8::1");
+	test_forward("dynamic---1", true, true, "::1");
+	test_forward("dynamic-2001--", true, true, "2001::");
+	test_forward("dynamic-1-2-3-4-5-6-7-8", true, true, "1:2:3:4:5:6:7:8");
+	test_forward("dynamic-2001-db8--1", true, false, NULL);
+
+	/* Forward names, malformed addresses. */
+	test_forward("dynamic-192-0-02-1", true, true, NULL);
+	test_forward("dynamic-256-0-2-1", true, true, NULL);
+	test_forward("dynamic-1000-0-2-1", true, true, NULL);
+	test_forward("dynamic-192-0-2", true, true, NULL);
+	test_forward("dynamic-192-0-2-1-", true, true, NULL);
+	test_forward("dynamic-192-0--2-1", true, false, NULL);
+	test_forward("dynamic-192-0--2-1", true, true, "192:0::2:1");
+	test_forward("dynamic-192.0.2.1", true, true, NULL);
+	test_forward("dynamic-2001-db8---1", true, true, NULL);
+	test_forward("dynamic-1--2--3", true, true, NULL);
+	test_forward("dynamic--1", true, true, NULL);
+	test_forward("dynamic-1-", true, true, NULL);
+	test_forward("dynamic-12345--1", true, true, NULL);
+	test_forward("dynamic-g--1", true, true, NULL);
+	test_forward("dynamic-1-2-3-4-5-6-7", true, true, NULL);
+	test_forward("dynamic-1-2-3-4-5-6-7-8-9", true, true, NULL);
+	test_forward("dynamic-1-2-3-4--5-6-7-8", true, true, NULL);
+
+	/* Reverse names. */
+	test_reverse("1.2.0.192.in-addr.arpa.", "192.0.2.1");
+	test_reverse("255.255.255.255.in-addr.arpa.", "255.255.255.255");
+	test_reverse("1.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.8.B.D.0.1.0.0.2.ip6.arpa.",
+	             "2001:db8::1");
+	test_reverse("2.0.192.in-addr.arpa.", NULL);
+	test_reverse("0.1.2.0.192.in-addr.arpa.", NULL);
+	test_reverse("01.2.0.192.in-addr.arpa.", NULL);
+	test_reverse("256.2.0.192.in-addr.arpa.", NULL);
+	test_reverse("a.2.0.192.in-addr.arpa.", NULL);
+	test_reverse("g.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.8.b.d.0.1.0.0.2.ip6.arpa.",
+	             NULL);
+	test_reverse("10.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.8.b.d.0.1.0.0.2.ip6.arpa.",
+	             NULL);
+	test_reverse("0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.8.b.d.0.1.0.0.2.ip6.arpa.",
+	             NULL);
+
+	/* Forward labels. */
+	test_label("192.0.2.1", PREFIX, "dynamic-192-0-2-1");
+	test_label("0.0.0.0", "", "0-0-0-0");
+	test_label("2001:db8::1", PREFIX, "dynamic-2001-0db8-0000-0000-0000-0000-0000-0001");
+	test_label("2001:db8::1", "longest-possible-prefix-",
+	           "longest-possible-prefix-2001-0db8-0000-0000-0000-0000-0000-0001");
+	test_label("2001:db8::1", "longest-possible-prefix-x", NULL);
+
+	return 0;
+}
@@ -0,0 +1,314 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <tap/basic.h>
+
+#include "libknot/libknot.h"
+#include "knot/dnssec/nsec-chain.h"
+#include "knot/dnssec/nsec3-chain.h"
+#include "knot/updates/apply.h"
+#include "knot/updates/changesets.h"
+#include "knot/zone/contents.h"
+#include "zscanner/scanner.h"
+
+#define ORIGIN "example."
+#define TTL 300
+
+static const char *zone_str =
+	"@        SOA ns hostmaster 1 3600 900 604800 300\n"
+	"@        NS ns\n"
+	"ns       A 192.0.2.1\n"
+	"h1.g1    A 192.0.2.11\n"
+	"h2.g1    A 192.0.2.12\n"
+	"h3.g1    A 192.0.2.13\n"
+	"h1.g2    A 192.0.2.21\n"
+	"h2.g2    TXT \"text\"\n"
+	"only.one A 192.0.2.31\n"
+	"x.a.b.c  A 192.0.2.41\n"
+	"y.a.b.c  A 192.0.2.42\n";
+
+/*! \brief Update test case, records to be removed and added. */
+typedef struct {
+	const char *name;
+	const char *rem;
+	const char *add;
+} update_case_t;
+
+static const update_case_t updates[] = {
+	{ "add to existing node", NULL,
+	  "h1.g1 TXT \"new\"\n" },
+	{ "add under existing parent", NULL,
+	  "h4.g1 A 192.0.2.14\n" },
+	{ "add with new non-terminal", NULL,
+	  "h1.g3 A 192.0.2.51\n" },
+	{ "add with new non-terminals", NULL,
+	  "z.d.e.f A 192.0.2.52\n" },
+	{ "add under leaf", NULL,
+	  "sub.h2.g2 A 192.0.2.53\n" },
+	{ "remove from node", "h2.g2 TXT \"text\"\n",
+	  NULL },
+	{ "remove node", "h2.g1 A 192.0.2.12\n",
+	  NULL },
+	{ "remove last child", "only.one A 192.0.2.31\n",
+	  NULL },
+	{ "remove deep non-terminals", "x.a.b.c A 192.0.2.41\n"
+	                               "y.a.b.c A 192.0.2.42\n",
+	  NULL },
+	{ "replace node", "h1.g2 A 192.0.2.21\n",
+	  "h1.g4 A 192.0.2.21\n" },
+	{ "remove and add in the chain gap", "h3.g1 A 192.0.2.13\n",
+	  "h31.g1 A 192.0.2.13\n"
+	  "h0.g1 A 192.0.2.10\n" },
+	{ NULL }
+};
+
+typedef struct {
+	bool nsec3;
+	dnssec_nsec3_params_t params;
+} chain_t;
+
+typedef struct {
+	zone_contents_t *zone;
+	changeset_t *ch;
+	bool add;
+	int ret;
+} parse_ctx_t;
+
+static void parse_rr(zs_scanner_t *sc)
+{
+	parse_ctx_t *ctx = sc->process.data;
+	if (ctx->ret != KNOT_EOK) {
+		return;
+	}
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, sc->r_owner, sc->r_type, sc->r_class);
+	ctx->ret = knot_rrset_add_rdata(&rr, sc->r_data, sc->r_data_length,
+	                                sc->r_ttl, NULL);
+	if (ctx->ret != KNOT_EOK) {
+		return;
+	}
+
+	if (ctx->zone != NULL) {
+		zone_node_t *node = NULL;
+		ctx->ret = zone_contents_add_rr(ctx->zone, &rr, &node);
+	} else if (ctx->add) {
+		ctx->ret = changeset_add_addition(ctx->ch, &rr, 0);
+	} else {
+		ctx->ret = changeset_add_removal(ctx->ch, &rr, 0);
+	}
+	knot_rdataset_clear(&rr.rrs, NULL);
+}
+
+static int parse(parse_ctx_t *ctx, const char *str)
+{
+	zs_scanner_t sc;
+	if (zs_init(&sc, ORIGIN, KNOT_CLASS_IN, 3600) != 0 ||
+	    zs_set_processing(&sc, parse_rr, NULL, ctx) != 0 ||
+	    zs_set_input_string(&sc, str, strlen(str)) != 0 ||
+	    zs_parse_all(&sc) != 0) {
+		zs_deinit(&sc);
+		return KNOT_EPARSEFAIL;
+	}
+	zs_deinit(&sc);
+
+	return ctx->ret;
+}
+
+/*! \brief Apply a changeset to the zone the same way an update is applied. */
+static int apply_chain(apply_ctx_t *ctx, const changeset_t *ch)
+{
+	changeset_iter_t itt;
+	int ret = changeset_iter_rem(&itt, ch, false);
+	knot_rrset_t rr = changeset_iter_next(&itt);
+	while (ret == KNOT_EOK && !knot_rrset_empty(&rr)) {
+		ret = apply_remove_rr(ctx, &rr);
+		rr = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = changeset_iter_add(&itt, ch, false);
+	rr = changeset_iter_next(&itt);
+	while (ret == KNOT_EOK && !knot_rrset_empty(&rr)) {
+		ret = apply_add_rr(ctx, &rr);
+		rr = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+
+	return ret;
+}
+
+static int create_chain(const zone_contents_t *zone, const chain_t *chain,
+                        changeset_t *ch)
+{
+	if (chain->nsec3) {
+		return knot_nsec3_create_chain(zone, &chain->params, TTL, ch);
+	} else {
+		return knot_nsec_create_chain(zone, TTL, ch);
+	}
+}
+
+static int fix_chain(const zone_contents_t *zone, const chain_t *chain,
+                     const changeset_t *update, changeset_t *ch)
+{
+	if (chain->nsec3) {
+		return knot_nsec3_fix_chain(zone, update, &chain->params, TTL, ch);
+	} else {
+		return knot_nsec_fix_chain(zone, update, TTL, ch);
+	}
+}
+
+/*! \brief Create the zone with a complete chain. */
+static zone_contents_t *make_zone(const chain_t *chain)
+{
+	knot_dname_t *origin = knot_dname_from_str_alloc(ORIGIN);
+	zone_contents_t *zone = zone_contents_new(origin);
+	knot_dname_free(&origin, NULL);
+	assert(zone);
+
+	parse_ctx_t ctx = { .zone = zone };
+	int ret = parse(&ctx, zone_str);
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_adjust_full(zone);
+	}
+
+	changeset_t ch;
+	changeset_init(&ch, zone->apex->owner);
+	apply_ctx_t apply;
+	apply_init_ctx(&apply, zone, 0);
+	if (ret == KNOT_EOK) {
+		ret = create_chain(zone, chain, &ch);
+	}
+	if (ret == KNOT_EOK) {
+		ret = apply_chain(&apply, &ch);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_adjust_full(zone);
+	}
+	update_cleanup(&apply);
+	changeset_clear(&ch);
+
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(&zone);
+	}
+
+	return zone;
+}
+
+/*!
+ * \brief Apply the update and the repaired chain to a copy of the zone and
+ *        check that the full chain recreation finds no difference.
+ */
+static void test_update(zone_contents_t *zone, const chain_t *chain,
+                        const update_case_t *test)
+{
+	const char *type = chain->nsec3 ? "NSEC3" : "NSEC";
+
+	changeset_t update, fixed, full;
+	changeset_init(&update, zone->apex->owner);
+	changeset_init(&fixed, zone->apex->owner);
+	changeset_init(&full, zone->apex->owner);
+
+	parse_ctx_t rem = { .ch = &update, .add = false };
+	parse_ctx_t add = { .ch = &update, .add = true };
+	int ret = KNOT_EOK;
+	if (test->rem != NULL) {
+		ret = parse(&rem, test->rem);
+	}
+	if (ret == KNOT_EOK && test->add != NULL) {
+		ret = parse(&add, test->add);
+	}
+
+	zone_contents_t *copy = NULL;
+	if (ret == KNOT_EOK) {
+		ret = apply_prepare_zone_copy(zone, &copy);
+	}
+
+	apply_ctx_t ctx;
+	apply_init_ctx(&ctx, copy, 0);
+	if (ret == KNOT_EOK) {
+		ret = apply_chain(&ctx, &update);
+	}
+	if (ret == KNOT_EOK) {
+		ret = apply_prepare_to_sign(&ctx);
+	}
+	is_int(KNOT_EOK, ret, "%s, %s: update applied", type, test->name);
+
+	/* Repair the chain and apply the repair. */
+	if (ret == KNOT_EOK) {
+		ret = fix_chain(copy, chain, &update, &fixed);
+		is_int(KNOT_EOK, ret, "%s, %s: chain repaired", type, test->name);
+	}
+	if (ret == KNOT_EOK) {
+		ret = apply_chain(&ctx, &fixed);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_adjust_full(copy);
+	}
+
+	/* The repaired chain must be equal to the recreated one. */
+	if (ret == KNOT_EOK) {
+		ret = create_chain(copy, chain, &full);
+	}
+	ok(ret == KNOT_EOK && changeset_empty(&full),
+	   "%s, %s: chain matches full recreation", type, test->name);
+
+	update_rollback(&ctx);
+	update_free_zone(&copy);
+	changeset_clear(&update);
+	changeset_clear(&fixed);
+	changeset_clear(&full);
+}
+
+static void test_chain(const chain_t *chain)
+{
+	zone_contents_t *zone = make_zone(chain);
+	ok(zone != NULL, "%s: zone with chain created", chain->nsec3 ? "NSEC3" : "NSEC");
+	if (zone == NULL) {
+		return;
+	}
+
+	for (const update_case_t *test = updates; test->name != NULL; test++) {
+		test_update(zone, chain, test);
+	}
+
+	zone_contents_deep_free(&zone);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	chain_t nsec = { .nsec3 = false };
+	test_chain(&nsec);
+
+	chain_t nsec3 = {
+		.nsec3 = true,
+		.params = {
+			.algorithm = DNSSEC_NSEC3_ALGORITHM_SHA1,
+			.iterations = 1,
+			.salt = { .data = (uint8_t *)"\xca\xfe", .size = 2 }
+		}
+	};
+	test_chain(&nsec3);
+
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*  Copyright (C) 2011 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <string.h>
+#include <tap/basic.h>
+
+#include "knot/server/numa.h"
+
+#define MAX_ITEMS 16
+
+/*! \brief Parse the list and compare with the expected numbers. */
+static void test_list(const char *msg, const char *str, int expected_count,
+                      const unsigned *expected, size_t max)
+{
+	unsigned out[MAX_ITEMS] = { 0 };
+	int ret = numa_parse_list(str, out, max);
+	ok(ret == expected_count &&
+	   (ret <= 0 || memcmp(out, expected, ret * sizeof(*out)) == 0),
+	   "parse list, %s", msg);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	/* Valid lists. */
+	const unsigned ranges[] = { 0, 1, 2, 3, 8, 9, 10, 11 };
+	test_list("ranges", "0-3,8-11", 8, ranges, MAX_ITEMS);
+	test_list("ranges with new line", "0-3,8-11\n", 8, ranges, MAX_ITEMS);
+	const unsigned single[] = { 0 };
+	test_list("single number", "0", 1, single, MAX_ITEMS);
+	test_list("single number with new line", "0\n", 1, single, MAX_ITEMS);
+	const unsigned mixed[] = { 1, 4, 5, 6, 9 };
+	test_list("numbers and range", "1,4-6,9", 5, mixed, MAX_ITEMS);
+	const unsigned same[] = { 7 };
+	test_list("one-number range", "7-7", 1, same, MAX_ITEMS);
+
+	/* Empty lists (e.g. a node with memory only). */
+	test_list("empty", "", 0, NULL, MAX_ITEMS);
+	test_list("empty line", "\n", 0, NULL, MAX_ITEMS);
+
+	/* Output limit. */
+	test_list("output limit", "0-3,8-11", 5, ranges, 5);
+
+	/* Malformed lists. */
+	test_list("reversed range", "3-1", -1, NULL, MAX_ITEMS);
+	test_list("open range end", "1-", -1, NULL, MAX_ITEMS);
+	test_list("open range start", "-1", -1, NULL, MAX_ITEMS);
+	test_list("double range", "1-2-3", -1, NULL, MAX_ITEMS);
+	test_list("trailing comma", "1,", -1, NULL, MAX_ITEMS);
+	test_list("leading comma", ",1", -1, NULL, MAX_ITEMS);
+	test_list("double comma", "1,,2", -1, NULL, MAX_ITEMS);
+	test_list("space separator", "0-3 8", -1, NULL, MAX_ITEMS);
+	test_list("not a number", "x", -1, NULL, MAX_ITEMS);
+	test_list("large number", "99999999999999999999", -1, NULL, MAX_ITEMS);
+
+	return 0;
+}
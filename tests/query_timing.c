@@ -0,0 +1,60 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <tap/basic.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/nameserver/query_timing.h"
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	query_timing_t *a = calloc(1, sizeof(*a));
+	query_timing_t *b = calloc(1, sizeof(*b));
+	assert(a && b);
+
+	/* Record. */
+	for (uint64_t i = 1; i <= 10; i++) {
+		qtime_record(a, QTIME_ANSWER, i);
+	}
+	qtime_record(a, QTIME_TOTAL, 1000);
+	ok(a->stage[QTIME_ANSWER].count == 10 && a->stage[QTIME_ANSWER].sum == 55 &&
+	   a->stage[QTIME_ANSWER].max == 10, "record into stage");
+	ok(a->stage[QTIME_TOTAL].count == 1 && a->stage[QTIME_SEND].count == 0,
+	   "record stage separation");
+
+	/* Merge. */
+	qtime_merge(b, a);
+	qtime_merge(b, a);
+	ok(b->stage[QTIME_ANSWER].count == 20 && b->stage[QTIME_TOTAL].max == 1000,
+	   "merge all stages");
+	ok(hist_percentile(&b->stage[QTIME_ANSWER], 500) ==
+	   hist_percentile(&a->stage[QTIME_ANSWER], 500), "merge percentile");
+
+	/* NULL tolerance. */
+	qtime_record(NULL, QTIME_TOTAL, 1);
+	ok(qtime_stage_name(QTIME_STAGES) == NULL, "invalid stage name");
+	ok(strcmp(qtime_stage_name(QTIME_ZONE_FIND), "zone-find") == 0,
+	   "stage name");
+
+	free(a);
+	free(b);
+
+	return 0;
+}
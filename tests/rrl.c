@@ -96,9 +96,9 @@ static void rrl_hopscotch(struct runnable_data* rd)
 int main(int argc, char *argv[])
 {
 #ifdef ENABLE_TIMED_TESTS
-	plan(10);
+	plan(13);
 #else
-	plan(5);
+	plan(6);
 #endif
 
 	dnssec_crypto_init();
@@ -161,17 +161,41 @@ int main(int argc, char *argv[])
 	}
 	is_int(0, ret, "rrl: unlimited IPv4/v6 requests");
 
+	/* 5. early check of an unknown source. */
+	struct sockaddr_storage addr_other;
+	sockaddr_set(&addr_other, AF_INET, "5.6.7.8", 0);
+	ret = rrl_query_early(rrl, &addr_other, query);
+	is_int(KNOT_ENOENT, ret, "rrl: early check of unlimited source");
+
 #ifdef ENABLE_TIMED_TESTS
-	/* 5. limited request */
+	/* 6. limited request */
 	ret = rrl_query(rrl, &addr, &rq, zone);
 	is_int(KNOT_ELIMIT, ret, "rrl: throttled IPv4 request");
 
-	/* 6. limited IPv6 request */
+	/* 7. limited IPv6 request */
 	ret = rrl_query(rrl, &addr6, &rq, zone);
 	is_int(KNOT_ELIMIT, ret, "rrl: throttled IPv6 request");
+
+	/* 8. early check of a source limited in the QTYPE class. */
+	knot_pkt_t *query_any = knot_pkt_new(NULL, 512, NULL);
+	qname = knot_dname_from_str_alloc("beef.");
+	knot_pkt_put_question(query_any, qname, KNOT_CLASS_IN, KNOT_RRTYPE_ANY);
+	knot_dname_free(&qname, NULL);
+	rrl_req_t rq_any = rq;
+	rq_any.query = query_any;
+	for (unsigned i = 0; i <= rate; ++i) {
+		ret = rrl_query(rrl, &addr, &rq_any, zone);
+	}
+	ret = (ret == KNOT_ELIMIT) ? rrl_query_early(rrl, &addr, query_any) : ret;
+	is_int(KNOT_ELIMIT, ret, "rrl: early check of throttled ANY source");
+
+	/* 9. early check doesn't apply to classes depending on the answer. */
+	ret = rrl_query_early(rrl, &addr, query);
+	is_int(KNOT_ENOENT, ret, "rrl: early check of throttled source, other class");
+	knot_pkt_free(&query_any);
 #endif
 
-	/* 7. invalid values. */
+	/* 10. invalid values. */
 	ret = 0;
 	rrl_create(0);            // NULL
 	ret += rrl_setrate(0, 0); // 0
@@ -184,17 +208,17 @@ int main(int argc, char *argv[])
 	is_int(-88, ret, "rrl: not crashed while executing functions on NULL context");
 
 #ifdef ENABLE_TIMED_TESTS
-	/* 8. hopscotch test */
+	/* 11. hopscotch test */
 	struct runnable_data rd = {
 		1, rrl, &addr, &rq, zone
 	};
 	rrl_hopscotch(&rd);
 	ok(rd.passed, "rrl: hashtable is ~ consistent");
 
-	/* 9. reseed */
+	/* 12. reseed */
 	is_int(0, rrl_reseed(rrl), "rrl: reseed");
 
-	/* 10. hopscotch after reseed. */
+	/* 13. hopscotch after reseed. */
 	rrl_hopscotch(&rd);
 	ok(rd.passed, "rrl: hashtable is ~ consistent");
 #endif
@@ -0,0 +1,299 @@
+/*  Copyright (C) 2016 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <assert.h>
+#include <string.h>
+#include <tap/basic.h>
+
+#include "libknot/libknot.h"
+#include "knot/dnssec/nsec3-chain.h"
+#include "knot/updates/changesets.h"
+#include "knot/zone/contents.h"
+#include "zscanner/scanner.h"
+
+#define ORIGIN "example."
+#define TTL 300
+
+static const char *zone_str =
+	"@        SOA ns hostmaster 1 3600 900 604800 300\n"
+	"@        NS ns\n"
+	"@        MX 10 mail\n"
+	"@        NSEC3PARAM 1 0 1 cafe\n"
+	"ns       A 192.0.2.1\n"
+	"mail     A 192.0.2.2\n"
+	"mail     AAAA 2001:db8::2\n"
+	"*.wild   A 192.0.2.3\n"
+	"srv      SRV 0 0 53 x.wild\n"
+	"deleg    NS ns.deleg\n"
+	"ns.deleg A 192.0.2.4\n"
+	"x.a.b.c  TXT \"text\"\n";
+
+typedef struct {
+	zone_contents_t *zone;
+	int ret;
+} parse_ctx_t;
+
+static void parse_rr(zs_scanner_t *sc)
+{
+	parse_ctx_t *ctx = sc->process.data;
+	if (ctx->ret != KNOT_EOK) {
+		return;
+	}
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, sc->r_owner, sc->r_type, sc->r_class);
+	ctx->ret = knot_rrset_add_rdata(&rr, sc->r_data, sc->r_data_length,
+	                                sc->r_ttl, NULL);
+	if (ctx->ret == KNOT_EOK) {
+		zone_node_t *node = NULL;
+		ctx->ret = zone_contents_add_rr(ctx->zone, &rr, &node);
+	}
+	knot_rdataset_clear(&rr.rrs, NULL);
+}
+
+/*! \brief Create the zone from the zone string. */
+static zone_contents_t *parse_zone(void)
+{
+	knot_dname_t *origin = knot_dname_from_str_alloc(ORIGIN);
+	zone_contents_t *zone = zone_contents_new(origin);
+	knot_dname_free(&origin, NULL);
+	assert(zone);
+
+	parse_ctx_t ctx = { .zone = zone };
+	zs_scanner_t sc;
+	int ret = KNOT_EPARSEFAIL;
+	if (zs_init(&sc, ORIGIN, KNOT_CLASS_IN, TTL) == 0 &&
+	    zs_set_processing(&sc, parse_rr, NULL, &ctx) == 0 &&
+	    zs_set_input_string(&sc, zone_str, strlen(zone_str)) == 0 &&
+	    zs_parse_all(&sc) == 0) {
+		ret = ctx.ret;
+	}
+	zs_deinit(&sc);
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_adjust_full(zone);
+	}
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(&zone);
+	}
+
+	return zone;
+}
+
+/*!
+ * \brief Create the zone with a complete NSEC3 chain.
+ *
+ * The chain is generated for a temporary zone and added to the zone the same
+ * way a signed zone is loaded.
+ */
+static zone_contents_t *make_zone(void)
+{
+	zone_contents_t *unsigned_zone = parse_zone();
+	zone_contents_t *zone = parse_zone();
+	if (unsigned_zone == NULL || zone == NULL) {
+		zone_contents_deep_free(&unsigned_zone);
+		zone_contents_deep_free(&zone);
+		return NULL;
+	}
+
+	changeset_t ch;
+	changeset_init(&ch, zone->apex->owner);
+	int ret = knot_nsec3_create_chain(unsigned_zone, &zone->nsec3_params,
+	                                  TTL, &ch);
+
+	changeset_iter_t itt;
+	if (ret == KNOT_EOK) {
+		ret = changeset_iter_add(&itt, &ch, false);
+	}
+	if (ret == KNOT_EOK) {
+		knot_rrset_t rr = changeset_iter_next(&itt);
+		while (ret == KNOT_EOK && !knot_rrset_empty(&rr)) {
+			zone_node_t *node = NULL;
+			ret = zone_contents_add_rr(zone, &rr, &node);
+			rr = changeset_iter_next(&itt);
+		}
+		changeset_iter_clear(&itt);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_adjust_full(zone);
+	}
+	changeset_clear(&ch);
+	zone_contents_deep_free(&unsigned_zone);
+
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(&zone);
+	}
+
+	return zone;
+}
+
+typedef struct {
+	zone_contents_t *copy;
+	bool nsec3;
+	size_t count;
+	bool equal;
+} compare_ctx_t;
+
+static zone_node_t *find_node(zone_tree_t *tree, const knot_dname_t *owner)
+{
+	zone_node_t *node = NULL;
+	zone_tree_get(tree, owner, &node);
+	return node;
+}
+
+/*!
+ * \brief Check that the replica pointer refers to the replica node
+ *        corresponding to the original one.
+ */
+static bool same_node(const zone_node_t *orig, const zone_node_t *copy,
+                      zone_tree_t *copy_tree)
+{
+	if (orig == NULL || copy == NULL) {
+		return orig == copy;
+	}
+
+	return orig != copy && knot_dname_is_equal(orig->owner, copy->owner) &&
+	       find_node(copy_tree, copy->owner) == copy;
+}
+
+static bool same_rrsets(const zone_node_t *orig, const zone_node_t *copy,
+                        zone_tree_t *copy_tree)
+{
+	if (orig->rrset_count != copy->rrset_count) {
+		return false;
+	}
+
+	for (uint16_t i = 0; i < orig->rrset_count; i++) {
+		const struct rr_data *a = &orig->rrs[i];
+		const struct rr_data *b = &copy->rrs[i];
+		if (a->type != b->type || a->rrs.data == b->rrs.data ||
+		    !knot_rdataset_eq(&a->rrs, &b->rrs)) {
+			return false;
+		}
+		if (a->additional == NULL || b->additional == NULL) {
+			if (a->additional != b->additional) {
+				return false;
+			}
+			continue;
+		}
+		for (uint16_t j = 0; j < a->rrs.rr_count; j++) {
+			if (!same_node(a->additional[j], b->additional[j], copy_tree)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static int compare_node(zone_node_t **node, void *data)
+{
+	compare_ctx_t *ctx = data;
+	const zone_node_t *orig = *node;
+	zone_tree_t *tree = ctx->nsec3 ? ctx->copy->nsec3_nodes : ctx->copy->nodes;
+	const zone_node_t *copy = find_node(tree, orig->owner);
+
+	ctx->count += 1;
+	if (copy == NULL || copy == orig || orig->flags != copy->flags ||
+	    orig->children != copy->children ||
+	    !same_rrsets(orig, copy, ctx->copy->nodes) ||
+	    !same_node(orig->prev, copy->prev, tree) ||
+	    !same_node(orig->parent, copy->parent, ctx->copy->nodes) ||
+	    !same_node(orig->nsec3_node, copy->nsec3_node, ctx->copy->nsec3_nodes)) {
+		char owner[KNOT_DNAME_TXT_MAXLEN];
+		knot_dname_to_str(owner, orig->owner, sizeof(owner));
+		diag("node %s differs", owner);
+		ctx->equal = false;
+	}
+
+	return KNOT_EOK;
+}
+
+static bool same_nsec3_params(const dnssec_nsec3_params_t *a,
+                              const dnssec_nsec3_params_t *b)
+{
+	return a->algorithm == b->algorithm && a->flags == b->flags &&
+	       a->iterations == b->iterations && a->salt.size == b->salt.size &&
+	       memcmp(a->salt.data, b->salt.data, a->salt.size) == 0;
+}
+
+static void test_replica(zone_contents_t *zone, bool huge_pages)
+{
+	const char *arena = huge_pages ? "huge pages" : "default pages";
+
+	zone_contents_t *copy = NULL;
+	int ret = zone_contents_deep_copy(zone, &copy, huge_pages);
+	ok(ret == KNOT_EOK && copy != NULL, "%s: deep copy", arena);
+	if (ret != KNOT_EOK) {
+		return;
+	}
+
+	ok(copy->mm != NULL && copy->replicas == NULL && copy->size == zone->size &&
+	   knot_dname_is_equal(copy->apex->owner, zone->apex->owner) &&
+	   find_node(copy->nodes, zone->apex->owner) == copy->apex &&
+	   same_nsec3_params(&copy->nsec3_params, &zone->nsec3_params),
+	   "%s: zone properties", arena);
+
+	compare_ctx_t ctx = { .copy = copy, .equal = true };
+	zone_tree_apply_inorder(zone->nodes, compare_node, &ctx);
+	ok(ctx.equal && ctx.count == zone_tree_weight(copy->nodes),
+	   "%s: nodes equal", arena);
+
+	ctx = (compare_ctx_t){ .copy = copy, .nsec3 = true, .equal = true };
+	zone_tree_apply_inorder(zone->nsec3_nodes, compare_node, &ctx);
+	ok(ctx.equal && ctx.count == zone_tree_weight(copy->nsec3_nodes),
+	   "%s: NSEC3 nodes equal", arena);
+
+	zone_contents_deep_free(&copy);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	zone_contents_t *zone = make_zone();
+	ok(zone != NULL && zone->apex->nsec3_node != NULL &&
+	   zone_tree_weight(zone->nsec3_nodes) > 0, "zone with NSEC3 chain created");
+	if (zone == NULL) {
+		return 1;
+	}
+
+	test_replica(zone, false);
+	test_replica(zone, true);
+
+	/* Replica of a replica is equal as well. */
+	zone_contents_t *copy = NULL;
+	int ret = zone_contents_deep_copy(zone, &copy, false);
+	zone_contents_t *copy2 = NULL;
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_deep_copy(copy, &copy2, false);
+	}
+	compare_ctx_t ctx = { .copy = copy2, .equal = true };
+	if (ret == KNOT_EOK) {
+		zone_tree_apply_inorder(copy->nodes, compare_node, &ctx);
+	}
+	ok(ret == KNOT_EOK && ctx.equal, "copy of a copy");
+	zone_contents_deep_free(&copy2);
+	zone_contents_deep_free(&copy);
+
+	ok(zone_contents_deep_copy(NULL, &copy, false) == KNOT_EINVAL &&
+	   zone_contents_deep_copy(zone, NULL, false) == KNOT_EINVAL,
+	   "invalid parameters");
+
+	zone_contents_deep_free(&zone);
+
+	return 0;
+}